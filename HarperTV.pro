@@ -1,4 +1,4 @@
-QT       += core widgets openglwidgets multimedia network
+QT       += core widgets openglwidgets multimedia network concurrent
 
 TARGET = HarperTV
 TEMPLATE = app
@@ -15,6 +15,9 @@ win32 {
     # Adjust these paths according to your MPV installation
     INCLUDEPATH += C:/mpv-dev/include
     LIBS += -LC:/mpv-dev/lib -lmpv
+
+    # Peak memory of the benchmarks
+    LIBS += -lpsapi
 }
 
 macx {
@@ -32,11 +35,36 @@ SOURCES += \
     src/ui/playercontrols.cpp \
     src/ui/channelselector.cpp \
     src/ui/settingsdialog.cpp \
+    src/ui/recordingdialog.cpp \
+    src/ui/statsoverlay.cpp \
     src/core/mediaplayer.cpp \
     src/core/mpvcore.cpp \
     src/core/playbackcontroller.cpp \
     src/core/channelmanager.cpp \
     src/core/jsonparser.cpp \
+    src/core/channeljournal.cpp \
+    src/core/usagetracker.cpp \
+    src/core/m3uparser.cpp \
+    src/core/streamproxy.cpp \
+    src/core/vodcache.cpp \
+    src/core/adaptivecachecontroller.cpp \
+    src/core/timeshiftcontroller.cpp \
+    src/core/keyframeindexer.cpp \
+    src/core/thumbnailgenerator.cpp \
+    src/core/resumestore.cpp \
+    src/core/mpvconfig.cpp \
+    src/core/profilebenchmark.cpp \
+    src/core/benchmarkserver.cpp \
+    src/core/cachetracebenchmark.cpp \
+    src/core/recordingbenchmark.cpp \
+    src/core/playbackstats.cpp \
+    src/core/streamrecorder.cpp \
+    src/core/recordingscheduler.cpp \
+    src/core/xmltvparser.cpp \
+    src/core/epgindex.cpp \
+    src/core/epgstore.cpp \
+    src/core/epgmanager.cpp \
+    src/core/logocache.cpp \
     src/data/settings.cpp \
     src/data/channeldata.cpp
 
@@ -46,13 +74,42 @@ HEADERS += \
     src/ui/playercontrols.h \
     src/ui/channelselector.h \
     src/ui/settingsdialog.h \
+    src/ui/recordingdialog.h \
+    src/ui/statsoverlay.h \
     src/core/mediaplayer.h \
     src/core/mpvcore.h \
     src/core/playbackcontroller.h \
     src/core/channelmanager.h \
     src/core/jsonparser.h \
+    src/core/channeljournal.h \
+    src/core/usagetracker.h \
+    src/core/m3uparser.h \
+    src/core/streamproxy.h \
+    src/core/vodcache.h \
+    src/core/adaptivecachecontroller.h \
+    src/core/timeshiftcontroller.h \
+    src/core/keyframeindexer.h \
+    src/core/thumbnailgenerator.h \
+    src/core/resumestore.h \
+    src/core/mpvconfig.h \
+    src/core/profilebenchmark.h \
+    src/core/benchmarkserver.h \
+    src/core/cachetracebenchmark.h \
+    src/core/recordingbenchmark.h \
+    src/core/playbackstats.h \
+    src/core/streamrecorder.h \
+    src/core/recordingscheduler.h \
+    src/core/xmltvparser.h \
+    src/core/epgindex.h \
+    src/core/epgstore.h \
+    src/core/epgmanager.h \
+    src/core/logocache.h \
     src/data/settings.h \
-    src/data/channeldata.h
+    src/data/settingsschema.h \
+    src/data/channeldata.h \
+    src/data/programmedata.h \
+    src/data/channelsource.h \
+    src/data/scheduledrecording.h
 
 # Resource files
 RESOURCES += \
@@ -0,0 +1,185 @@
+#include "adaptivecachecontroller.h"
+#include <QDebug>
+
+static const int MAX_CACHE_SECS = 300;
+static const int EVALUATE_INTERVAL_MS = 5000;
+static const qint64 STABLE_PERIOD_MS = 60 * 1000;
+static const qint64 DEFAULT_MEMORY_BUDGET = 256LL * 1024 * 1024;
+static const qint64 MIN_FORWARD_BYTES = 8LL * 1024 * 1024;
+static const double GROW_HEADROOM = 1.2;
+static const double SHRINK_HEADROOM = 3.0;
+static const double SPEED_SMOOTHING = 0.3;
+
+AdaptiveCacheController::AdaptiveCacheController(MPVCore *mpvCore, QObject *parent)
+    : QObject(parent), m_mpvCore(mpvCore), m_memoryBudget(DEFAULT_MEMORY_BUDGET), m_speed(0.0), m_cachedSecs(0.0), m_videoBitrate(0.0), m_audioBitrate(0.0), m_baselineSecs(10), m_cacheSecs(10), m_stalls(0), m_enabled(true), m_active(false), m_pausedForCache(false)
+{
+    m_evaluateTimer.setInterval(EVALUATE_INTERVAL_MS);
+    connect(&m_evaluateTimer, &QTimer::timeout, this, &AdaptiveCacheController::evaluate);
+    connect(m_mpvCore, &MPVCore::propertyChanged, this, &AdaptiveCacheController::onPropertyChanged);
+
+    m_mpvCore->observeProperty("cache-speed");
+    m_mpvCore->observeProperty("demuxer-cache-duration");
+    m_mpvCore->observeProperty("paused-for-cache");
+    m_mpvCore->observeProperty("video-bitrate");
+    m_mpvCore->observeProperty("audio-bitrate");
+}
+
+void AdaptiveCacheController::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    if (!enabled)
+    {
+        stop();
+    }
+}
+
+bool AdaptiveCacheController::isEnabled() const
+{
+    return m_enabled;
+}
+
+void AdaptiveCacheController::setMemoryBudget(qint64 bytes)
+{
+    m_memoryBudget = qMax(bytes, 2 * MIN_FORWARD_BYTES);
+    if (m_active)
+    {
+        apply(m_cacheSecs, "memory budget changed");
+    }
+}
+
+void AdaptiveCacheController::setFixedOptions(const QMap<QString, QString> &options)
+{
+    m_fixedOptions = options;
+}
+
+void AdaptiveCacheController::start(int baselineSecs)
+{
+    if (!m_enabled)
+    {
+        return;
+    }
+
+    bool ok = false;
+    int fixedSecs = m_fixedOptions.value("cache-secs").toInt(&ok);
+    if (ok)
+    {
+        baselineSecs = fixedSecs;
+    }
+
+    m_baselineSecs = qBound(1, baselineSecs, MAX_CACHE_SECS);
+    m_speed = 0.0;
+    m_cachedSecs = 0.0;
+    m_videoBitrate = 0.0;
+    m_audioBitrate = 0.0;
+    m_stalls = 0;
+    m_pausedForCache = false;
+    m_active = true;
+    m_sinceStall.start();
+    m_evaluateTimer.start();
+
+    apply(m_baselineSecs, "new stream");
+}
+
+void AdaptiveCacheController::stop()
+{
+    m_active = false;
+    m_evaluateTimer.stop();
+}
+
+int AdaptiveCacheController::cacheSecs() const
+{
+    return m_cacheSecs;
+}
+
+void AdaptiveCacheController::onPropertyChanged(const QString &name, const QVariant &value)
+{
+    if (name == "cache-speed")
+    {
+        // Smoothed, since the reported speed jumps with every network read
+        m_speed = m_speed > 0 ? m_speed + SPEED_SMOOTHING * (value.toDouble() - m_speed) : value.toDouble();
+    }
+    else if (name == "demuxer-cache-duration")
+    {
+        m_cachedSecs = value.toDouble();
+    }
+    else if (name == "video-bitrate")
+    {
+        m_videoBitrate = value.toDouble();
+    }
+    else if (name == "audio-bitrate")
+    {
+        m_audioBitrate = value.toDouble();
+    }
+    else if (name == "paused-for-cache")
+    {
+        bool paused = value.toBool();
+        if (paused && !m_pausedForCache && m_active)
+        {
+            ++m_stalls;
+            m_sinceStall.restart();
+            apply(qMin(MAX_CACHE_SECS, m_cacheSecs * 2), "playback stalled");
+        }
+        m_pausedForCache = paused;
+    }
+}
+
+void AdaptiveCacheController::evaluate()
+{
+    if (!m_active || m_pausedForCache)
+    {
+        return;
+    }
+
+    // How many times faster than real time the stream arrives
+    double rate = bitrate();
+    double headroom = rate > 0 ? m_speed * 8 / rate : 0.0;
+
+    if (headroom > 0 && headroom < GROW_HEADROOM && m_cachedSecs < m_cacheSecs / 2.0 && m_cacheSecs < MAX_CACHE_SECS)
+    {
+        apply(qMin(MAX_CACHE_SECS, m_cacheSecs * 3 / 2), "throughput barely above bitrate");
+        return;
+    }
+
+    // mpv stops reading once the cache is full, so a full cache also counts as keeping up
+    bool keepingUp = headroom > SHRINK_HEADROOM || m_cachedSecs >= m_cacheSecs * 0.9;
+    if (keepingUp && m_sinceStall.elapsed() > STABLE_PERIOD_MS && m_cacheSecs > m_baselineSecs)
+    {
+        apply(qMax(m_baselineSecs, m_cacheSecs * 3 / 4), "throughput well above bitrate");
+
+        // Give the smaller cache a full period to prove itself
+        m_sinceStall.restart();
+    }
+}
+
+void AdaptiveCacheController::apply(int secs, const char *reason)
+{
+    // Enough bytes for the readahead at the current bitrate with some slack;
+    // whatever the forward buffer does not need goes to the back buffer for seeking back
+    double rate = bitrate();
+    qint64 forwardBytes = rate > 0 ? static_cast<qint64>(rate / 8 * secs * 1.5) : m_memoryBudget / 2;
+    forwardBytes = qBound(MIN_FORWARD_BYTES, forwardBytes, m_memoryBudget * 3 / 4);
+    qint64 backBytes = m_memoryBudget - forwardBytes;
+
+    m_cacheSecs = secs;
+    write("cache-secs", secs);
+    write("demuxer-readahead-secs", secs);
+    write("demuxer-max-bytes", QVariant::fromValue<qlonglong>(forwardBytes));
+    write("demuxer-max-back-bytes", QVariant::fromValue<qlonglong>(backBytes));
+
+    qInfo() << "Adaptive cache:" << reason << "-> readahead" << secs << "s," << forwardBytes / (1024 * 1024)
+            << "MiB forward," << backBytes / (1024 * 1024) << "MiB back; speed" << qRound(m_speed * 8 / 1000)
+            << "kbit/s, bitrate" << qRound(rate / 1000) << "kbit/s," << m_stalls << "stalls";
+}
+
+double AdaptiveCacheController::bitrate() const
+{
+    return m_videoBitrate + m_audioBitrate;
+}
+
+void AdaptiveCacheController::write(const QString &name, const QVariant &value)
+{
+    if (!m_fixedOptions.contains(name))
+    {
+        m_mpvCore->setProperty(name, value);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+#ifndef ADAPTIVECACHECONTROLLER_H
+#define ADAPTIVECACHECONTROLLER_H
+
+#include <QObject>
+#include <QVariant>
+#include <QMap>
+#include <QTimer>
+#include <QElapsedTimer>
+#include "mpvcore.h"
+
+/**
+ * @brief The AdaptiveCacheController class sizes the demuxer cache from measured throughput
+ *
+ * The controller watches how fast the cache fills (cache-speed), how much
+ * media it holds (demuxer-cache-duration) and whether playback had to wait
+ * for it (paused-for-cache). A stall doubles the readahead; a stream that
+ * has played without stalling and arrives several times faster than its
+ * bitrate gets its readahead trimmed back towards the configured baseline.
+ * Byte limits follow the readahead and the stream bitrate, and the forward
+ * and back buffers together never exceed the memory budget.
+ *
+ * Options set by the active performance profile are fixed: the controller
+ * never writes them, and a profile's cache-secs is the baseline.
+ */
+class AdaptiveCacheController : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor
+     * @param mpvCore MPV core instance
+     * @param parent Parent object
+     */
+    explicit AdaptiveCacheController(MPVCore *mpvCore, QObject *parent = nullptr);
+
+    /**
+     * @brief Enable or disable adaptation
+     * @param enabled True to adapt the cache while playing network streams
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * @brief Check whether adaptation is enabled
+     * @return True if enabled
+     */
+    bool isEnabled() const;
+
+    /**
+     * @brief Set the memory available to the demuxer cache
+     * @param bytes Maximum bytes for the forward and back buffers together
+     */
+    void setMemoryBudget(qint64 bytes);
+
+    /**
+     * @brief Set the options the controller must leave alone
+     * @param options Option values by name, e.g. those of the performance profile
+     */
+    void setFixedOptions(const QMap<QString, QString> &options);
+
+    /**
+     * @brief Start adapting for a newly loaded network stream
+     * @param baselineSecs Configured readahead in seconds, never shrunk below;
+     * a fixed cache-secs takes its place
+     */
+    void start(int baselineSecs);
+
+    /**
+     * @brief Stop adapting, e.g. for local files
+     */
+    void stop();
+
+    /**
+     * @brief Get the current readahead target
+     * @return Readahead in seconds
+     */
+    int cacheSecs() const;
+
+private slots:
+    /**
+     * @brief Track cache properties
+     * @param name Property name
+     * @param value Property value
+     */
+    void onPropertyChanged(const QString &name, const QVariant &value);
+
+    /**
+     * @brief Periodically decide whether to shrink the cache
+     */
+    void evaluate();
+
+private:
+    /**
+     * @brief Set the readahead and the byte limits that go with it
+     * @param secs Readahead in seconds
+     * @param reason Reason for the change, for the log
+     */
+    void apply(int secs, const char *reason);
+
+    /**
+     * @brief Get the stream bitrate reported by the demuxer
+     * @return Bits per second, 0 if unknown
+     */
+    double bitrate() const;
+
+    /**
+     * @brief Write an option unless it is fixed
+     * @param name Option name
+     * @param value Option value
+     */
+    void write(const QString &name, const QVariant &value);
+
+    MPVCore *m_mpvCore;
+    QMap<QString, QString> m_fixedOptions;
+    QTimer m_evaluateTimer;
+    QElapsedTimer m_sinceStall;
+    qint64 m_memoryBudget;
+    double m_speed;
+    double m_cachedSecs;
+    double m_videoBitrate;
+    double m_audioBitrate;
+    int m_baselineSecs;
+    int m_cacheSecs;
+    int m_stalls;
+    bool m_enabled;
+    bool m_active;
+    bool m_pausedForCache;
+};
+
+#endif // ADAPTIVECACHECONTROLLER_H
\ No newline at end of file
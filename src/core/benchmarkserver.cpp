@@ -0,0 +1,268 @@
+#include "benchmarkserver.h"
+#include <QDebug>
+#include <QTcpSocket>
+#include <QRegularExpression>
+
+static const int SEND_INTERVAL_MS = 50;
+static const qint64 MAX_REQUEST_HEADER = 16 * 1024;
+
+// Keeps the server from running ahead of the rate by filling the socket buffer
+static const qint64 MAX_UNSENT_BYTES = 64 * 1024;
+
+qint64 BenchmarkServer::Resource::size() const
+{
+    return file ? file->size() : data.size();
+}
+
+QByteArray BenchmarkServer::Resource::read(qint64 offset, qint64 length) const
+{
+    if (!file)
+    {
+        return data.mid(offset, length);
+    }
+
+    file->seek(offset);
+    return file->read(length);
+}
+
+BenchmarkServer::BenchmarkServer(QObject *parent)
+    : QObject(parent), m_requests(0), m_bytesSent(0)
+{
+    m_sendTimer.setInterval(SEND_INTERVAL_MS);
+    connect(&m_sendTimer, &QTimer::timeout, this, &BenchmarkServer::sendThrottled);
+    connect(&m_server, &QTcpServer::newConnection, this, &BenchmarkServer::onNewConnection);
+}
+
+BenchmarkServer::~BenchmarkServer()
+{
+    stop();
+}
+
+bool BenchmarkServer::start()
+{
+    if (m_server.isListening())
+    {
+        return true;
+    }
+
+    if (!m_server.listen(QHostAddress::LocalHost))
+    {
+        qWarning() << "Could not start benchmark server:" << m_server.errorString();
+        return false;
+    }
+
+    if (m_rate)
+    {
+        m_sendTimer.start();
+    }
+    return true;
+}
+
+void BenchmarkServer::stop()
+{
+    m_sendTimer.stop();
+    m_server.close();
+    abortConnections();
+}
+
+void BenchmarkServer::abortConnections()
+{
+    // abort() emits disconnected, which removes the socket from the hash
+    const QList<QTcpSocket *> sockets = m_transfers.keys();
+    for (QTcpSocket *socket : sockets)
+    {
+        socket->abort();
+    }
+    m_transfers.clear();
+}
+
+QString BenchmarkServer::url(const QString &path) const
+{
+    return QString("http://127.0.0.1:%1%2").arg(m_server.serverPort()).arg(path);
+}
+
+void BenchmarkServer::setData(const QString &path, const QByteArray &data, const QByteArray &contentType)
+{
+    Resource resource;
+    resource.data = data;
+    resource.contentType = contentType;
+    m_resources.insert(path, resource);
+}
+
+bool BenchmarkServer::setFile(const QString &path, const QString &filePath, const QByteArray &contentType)
+{
+    QSharedPointer<QFile> file(new QFile(filePath));
+    if (!file->open(QIODevice::ReadOnly))
+    {
+        qWarning() << "Benchmark server could not open:" << filePath;
+        return false;
+    }
+
+    Resource resource;
+    resource.file = file;
+    resource.contentType = contentType;
+    m_resources.insert(path, resource);
+    return true;
+}
+
+void BenchmarkServer::setRate(const RateFunction &rate)
+{
+    m_rate = rate;
+    if (m_rate && m_server.isListening())
+    {
+        m_sendTimer.start();
+    }
+    else if (!m_rate)
+    {
+        m_sendTimer.stop();
+    }
+}
+
+int BenchmarkServer::requests() const
+{
+    return m_requests;
+}
+
+qint64 BenchmarkServer::bytesSent() const
+{
+    return m_bytesSent;
+}
+
+void BenchmarkServer::onNewConnection()
+{
+    while (QTcpSocket *socket = m_server.nextPendingConnection())
+    {
+        m_transfers.insert(socket, Transfer());
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]()
+                { handleRequest(socket); });
+        connect(socket, &QTcpSocket::bytesWritten, this, [this, socket]()
+                {
+            if (!m_rate)
+            {
+                send(socket, MAX_UNSENT_BYTES);
+            } });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]()
+                {
+            m_transfers.remove(socket);
+            socket->deleteLater(); });
+    }
+}
+
+void BenchmarkServer::handleRequest(QTcpSocket *socket)
+{
+    auto it = m_transfers.find(socket);
+    if (it == m_transfers.end() || it->position >= 0)
+    {
+        return;
+    }
+
+    if (!socket->peek(MAX_REQUEST_HEADER).contains("\r\n\r\n"))
+    {
+        return;
+    }
+
+    const QString request = QString::fromLatin1(socket->readAll());
+    const QStringList requestLine = request.section("\r\n", 0, 0).split(' ');
+    const QString path = requestLine.value(1);
+    ++m_requests;
+
+    auto resource = m_resources.constFind(path);
+    if (requestLine.value(0) != "GET" || resource == m_resources.constEnd())
+    {
+        socket->write("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        socket->disconnectFromHost();
+        return;
+    }
+
+    const qint64 total = resource->size();
+    qint64 start = 0;
+    qint64 end = total - 1;
+    QRegularExpressionMatch range = QRegularExpression("\r\nRange: *bytes=(\\d+)-(\\d*)", QRegularExpression::CaseInsensitiveOption)
+                                        .match(request);
+    if (range.hasMatch())
+    {
+        start = range.captured(1).toLongLong();
+        if (!range.captured(2).isEmpty())
+        {
+            end = qMin(end, range.captured(2).toLongLong());
+        }
+
+        if (start >= total || end < start)
+        {
+            QByteArray header = "HTTP/1.1 416 Range Not Satisfiable\r\n";
+            header += "Content-Range: bytes */" + QByteArray::number(total) + "\r\n";
+            header += "Content-Length: 0\r\nConnection: close\r\n\r\n";
+            socket->write(header);
+            socket->disconnectFromHost();
+            return;
+        }
+    }
+
+    QByteArray header = range.hasMatch() ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+    header += "Content-Type: " + resource->contentType + "\r\n";
+    header += "Accept-Ranges: bytes\r\nConnection: close\r\n";
+    header += "Content-Length: " + QByteArray::number(end - start + 1) + "\r\n";
+    if (range.hasMatch())
+    {
+        header += "Content-Range: bytes " + QByteArray::number(start) + "-" + QByteArray::number(end) + "/" +
+                  QByteArray::number(total) + "\r\n";
+    }
+    header += "\r\n";
+    socket->write(header);
+
+    it->resource = resource.value();
+    it->position = start;
+    it->end = end;
+
+    if (!m_rate)
+    {
+        send(socket, MAX_UNSENT_BYTES);
+    }
+}
+
+void BenchmarkServer::sendThrottled()
+{
+    QList<QTcpSocket *> sending;
+    for (auto it = m_transfers.constBegin(); it != m_transfers.constEnd(); ++it)
+    {
+        if (it->position >= 0 && it->position <= it->end)
+        {
+            sending.append(it.key());
+        }
+    }
+
+    if (sending.isEmpty() || !m_rate)
+    {
+        return;
+    }
+
+    // Connections share the link, as they would on a real one
+    qint64 budget = static_cast<qint64>(m_rate() * SEND_INTERVAL_MS / 1000 / sending.size());
+    for (QTcpSocket *socket : std::as_const(sending))
+    {
+        if (socket->bytesToWrite() <= MAX_UNSENT_BYTES)
+        {
+            send(socket, budget);
+        }
+    }
+}
+
+void BenchmarkServer::send(QTcpSocket *socket, qint64 budget)
+{
+    auto it = m_transfers.find(socket);
+    if (it == m_transfers.end() || it->position < 0 || it->position > it->end || budget <= 0)
+    {
+        return;
+    }
+
+    QByteArray data = it->resource.read(it->position, qMin(budget, it->end - it->position + 1));
+    socket->write(data);
+    it->position += data.size();
+    m_bytesSent += data.size();
+
+    if (data.isEmpty() || it->position > it->end)
+    {
+        it->position = it->end + 1;
+        socket->disconnectFromHost();
+    }
+}
\ No newline at end of file
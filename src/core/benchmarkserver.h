@@ -0,0 +1,161 @@
+#ifndef BENCHMARKSERVER_H
+#define BENCHMARKSERVER_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QTimer>
+#include <QTcpServer>
+#include <QSharedPointer>
+#include <QFile>
+#include <functional>
+
+class QTcpSocket;
+
+/**
+ * @brief The BenchmarkServer class is a local HTTP server for benchmarks and checks
+ *
+ * Serves files and in-memory resources on localhost with byte ranges as a
+ * web server would: 206 for satisfiable ranges, 416 for ranges past the end
+ * and 404 for unknown paths. Every response closes its connection. Sending
+ * can be throttled to a rate that may change from moment to moment, shared
+ * by all connections as on a real link.
+ */
+class BenchmarkServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Function giving the current send rate in bytes per second
+     */
+    using RateFunction = std::function<double()>;
+
+    /**
+     * @brief Constructor
+     * @param parent Parent object
+     */
+    explicit BenchmarkServer(QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor
+     */
+    ~BenchmarkServer();
+
+    /**
+     * @brief Start listening on an ephemeral localhost port
+     * @return True if successful, false otherwise
+     */
+    bool start();
+
+    /**
+     * @brief Stop listening and drop all connections
+     */
+    void stop();
+
+    /**
+     * @brief Drop all open connections but keep listening
+     */
+    void abortConnections();
+
+    /**
+     * @brief Get the URL of a path on the server
+     * @param path Path starting with '/'
+     * @return URL on localhost
+     */
+    QString url(const QString &path) const;
+
+    /**
+     * @brief Serve data from memory, replacing anything served at the path before
+     * @param path Path starting with '/'
+     * @param data Response body
+     * @param contentType Content type
+     */
+    void setData(const QString &path, const QByteArray &data, const QByteArray &contentType);
+
+    /**
+     * @brief Serve a file, replacing anything served at the path before
+     * @param path Path starting with '/'
+     * @param filePath Local file
+     * @param contentType Content type
+     * @return True if the file could be opened
+     */
+    bool setFile(const QString &path, const QString &filePath, const QByteArray &contentType);
+
+    /**
+     * @brief Throttle sending
+     * @param rate Current rate in bytes per second, empty to send as fast as the client reads
+     */
+    void setRate(const RateFunction &rate);
+
+    /**
+     * @brief Get how many requests were answered
+     * @return Requests since the server was created
+     */
+    int requests() const;
+
+    /**
+     * @brief Get how many body bytes were sent
+     * @return Bytes since the server was created
+     */
+    qint64 bytesSent() const;
+
+private slots:
+    /**
+     * @brief Accept pending client connections
+     */
+    void onNewConnection();
+
+    /**
+     * @brief Send each throttled connection its share of the current rate
+     */
+    void sendThrottled();
+
+private:
+    /**
+     * @brief Something served at a path
+     */
+    struct Resource
+    {
+        QByteArray data;
+        QSharedPointer<QFile> file;
+        QByteArray contentType;
+
+        qint64 size() const;
+        QByteArray read(qint64 offset, qint64 length) const;
+    };
+
+    /**
+     * @brief Response being sent on a connection
+     */
+    struct Transfer
+    {
+        Resource resource;
+        qint64 position = -1;
+        qint64 end = -1;
+    };
+
+    /**
+     * @brief Parse a complete request and send the response header
+     * @param socket Client connection
+     */
+    void handleRequest(QTcpSocket *socket);
+
+    /**
+     * @brief Send up to a number of body bytes on a connection
+     * @param socket Client connection
+     * @param budget Maximum bytes to send
+     */
+    void send(QTcpSocket *socket, qint64 budget);
+
+    QTcpServer m_server;
+    QHash<QString, Resource> m_resources;
+    QHash<QTcpSocket *, Transfer> m_transfers;
+    QTimer m_sendTimer;
+    RateFunction m_rate;
+    int m_requests;
+    qint64 m_bytesSent;
+};
+
+#endif // BENCHMARKSERVER_H
\ No newline at end of file
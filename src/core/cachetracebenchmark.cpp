@@ -0,0 +1,140 @@
+#include "cachetracebenchmark.h"
+#include "mediaplayer.h"
+#include <QDebug>
+#include <QFile>
+#include <QTextStream>
+#include <QRegularExpression>
+
+static const int SETTLE_MS = 1000;
+
+CacheTraceBenchmark::CacheTraceBenchmark(MediaPlayer *player, QObject *parent)
+    : QObject(parent), m_player(player), m_traceMs(0), m_runStartBytes(0), m_adaptiveWasEnabled(true)
+{
+    m_runTimer.setSingleShot(true);
+    connect(&m_runTimer, &QTimer::timeout, this, &CacheTraceBenchmark::finishRun);
+    m_server.setRate([this]()
+                     { return currentRate(); });
+}
+
+bool CacheTraceBenchmark::loadTrace(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        qWarning() << "Could not open throughput trace:" << filePath;
+        return false;
+    }
+
+    m_trace.clear();
+    m_traceMs = 0;
+
+    QTextStream in(&file);
+    while (!in.atEnd())
+    {
+        QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+        {
+            continue;
+        }
+
+        const QStringList fields = line.split(QRegularExpression("\\s+"));
+        bool durationOk = false;
+        bool rateOk = false;
+        double seconds = fields.value(0).toDouble(&durationOk);
+        double kbps = fields.value(1).toDouble(&rateOk);
+        if (!durationOk || !rateOk || seconds <= 0 || kbps < 0)
+        {
+            qWarning() << "Skipping malformed trace line:" << line;
+            continue;
+        }
+
+        m_traceMs += static_cast<qint64>(seconds * 1000);
+        m_trace.append(qMakePair(m_traceMs, kbps * 1000 / 8));
+    }
+
+    return !m_trace.isEmpty();
+}
+
+void CacheTraceBenchmark::setClip(const QString &filePath)
+{
+    m_clip = filePath;
+}
+
+bool CacheTraceBenchmark::start()
+{
+    if (m_trace.isEmpty() || !m_server.setFile("/trace", m_clip, "video/mp2t"))
+    {
+        qWarning() << "Cache trace benchmark needs a trace and a readable clip:" << m_clip;
+        return false;
+    }
+
+    if (!m_server.start())
+    {
+        return false;
+    }
+
+    // The fixed run goes first, so it does not inherit limits the controller set
+    m_adaptiveWasEnabled = m_player->cacheController()->isEnabled();
+    m_queue = {false, true};
+    m_results.clear();
+    runNext();
+    return true;
+}
+
+QList<CacheTraceBenchmark::Result> CacheTraceBenchmark::results() const
+{
+    return m_results;
+}
+
+void CacheTraceBenchmark::runNext()
+{
+    if (m_queue.isEmpty())
+    {
+        m_server.stop();
+        m_player->cacheController()->setEnabled(m_adaptiveWasEnabled);
+        emit finished();
+        return;
+    }
+
+    bool adaptive = m_queue.takeFirst();
+    m_current = Result();
+    m_current.mode = adaptive ? "adaptive" : "fixed";
+    qInfo() << "Replaying" << m_traceMs / 1000 << "s throughput trace with" << m_current.mode << "cache";
+
+    m_player->cacheController()->setEnabled(adaptive);
+    m_runClock.start();
+    m_runStartBytes = m_server.bytesSent();
+    m_player->loadMedia(m_server.url("/trace"));
+    m_runTimer.start(m_traceMs);
+}
+
+void CacheTraceBenchmark::finishRun()
+{
+    PlaybackController::SessionMetrics metrics = m_player->playbackController()->sessionMetrics();
+    m_current.startupMs = metrics.startupMs;
+    m_current.stalls = metrics.rebufferCount;
+    m_current.stalledMs = metrics.rebufferMs;
+    m_current.finalCacheSecs = m_player->cacheController()->isEnabled()
+                                   ? m_player->cacheController()->cacheSecs()
+                                   : m_player->mpvCore()->getProperty("cache-secs").toInt();
+    m_current.bytesSent = m_server.bytesSent() - m_runStartBytes;
+    m_results.append(m_current);
+
+    m_player->mpvCore()->stop();
+    m_server.abortConnections();
+
+    QTimer::singleShot(SETTLE_MS, this, &CacheTraceBenchmark::runNext);
+}
+
+double CacheTraceBenchmark::currentRate() const
+{
+    qint64 elapsed = m_runClock.elapsed();
+    for (const auto &step : m_trace)
+    {
+        if (elapsed < step.first)
+        {
+            return step.second;
+        }
+    }
+    return m_trace.last().second;
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+#ifndef CACHETRACEBENCHMARK_H
+#define CACHETRACEBENCHMARK_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QPair>
+#include <QTimer>
+#include <QElapsedTimer>
+#include "benchmarkserver.h"
+
+class MediaPlayer;
+
+/**
+ * @brief The CacheTraceBenchmark class replays a throughput trace against the adaptive cache
+ *
+ * A local HTTP server sends a clip at the rate the trace gives for each
+ * moment, so the player sees the same congested link on every run. The
+ * trace is played once with the adaptive cache controller and once with
+ * the fixed readahead it starts from, and each run records the stalls,
+ * the time spent stalled and the readahead it ended with.
+ *
+ * A trace has one step per line, "<seconds> <kbit/s>"; lines starting
+ * with '#' are comments.
+ */
+class CacheTraceBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Measurements of one run
+     */
+    struct Result
+    {
+        QString mode;
+        qint64 startupMs = -1;
+        int stalls = 0;
+        qint64 stalledMs = 0;
+        qint64 bytesSent = 0;
+        int finalCacheSecs = 0;
+    };
+
+    /**
+     * @brief Constructor
+     * @param player Media player to run the clip in
+     * @param parent Parent object
+     */
+    explicit CacheTraceBenchmark(MediaPlayer *player, QObject *parent = nullptr);
+
+    /**
+     * @brief Load a throughput trace
+     * @param filePath Trace file
+     * @return True if the trace has at least one step
+     */
+    bool loadTrace(const QString &filePath);
+
+    /**
+     * @brief Set the clip the server sends
+     * @param filePath Local media file, ideally a transport stream longer than the trace
+     */
+    void setClip(const QString &filePath);
+
+    /**
+     * @brief Start the server and run the trace with and without adaptation
+     * @return True if the runs started
+     */
+    bool start();
+
+    /**
+     * @brief Get the measurements of the finished runs
+     * @return Results in run order
+     */
+    QList<Result> results() const;
+
+signals:
+    /**
+     * @brief Signal emitted when both runs are done
+     */
+    void finished();
+
+private slots:
+    /**
+     * @brief Start the next run, or finish
+     */
+    void runNext();
+
+    /**
+     * @brief Record the measurements of the current run
+     */
+    void finishRun();
+
+private:
+    /**
+     * @brief Get the rate the trace gives for the current moment
+     * @return Bytes per second
+     */
+    double currentRate() const;
+
+    MediaPlayer *m_player;
+    QString m_clip;
+    QList<QPair<qint64, double>> m_trace;
+    qint64 m_traceMs;
+    BenchmarkServer m_server;
+    qint64 m_runStartBytes;
+    QTimer m_runTimer;
+    QElapsedTimer m_runClock;
+    QList<bool> m_queue;
+    QList<Result> m_results;
+    Result m_current;
+    bool m_adaptiveWasEnabled;
+};
+
+#endif // CACHETRACEBENCHMARK_H
\ No newline at end of file
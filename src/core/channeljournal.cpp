@@ -0,0 +1,405 @@
+#include "channeljournal.h"
+#include "jsonparser.h"
+#include <QDebug>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QCryptographicHash>
+#include <QMutexLocker>
+#include <QtConcurrent/QtConcurrentRun>
+
+static const int JOURNAL_VERSION = 1;
+static const int DEFAULT_COMPACT_THRESHOLD = 1000;
+
+ChannelJournal::ChannelJournal(QObject *parent)
+    : QObject(parent), m_entryCount(0), m_checkpoint(0), m_compactThreshold(DEFAULT_COMPACT_THRESHOLD), m_compacting(false)
+{
+    connect(&m_compactWatcher, &QFutureWatcher<CompactResult>::finished, this, &ChannelJournal::onCompactFinished);
+}
+
+ChannelJournal::~ChannelJournal()
+{
+    close();
+}
+
+bool ChannelJournal::open(const QString &basePath, const QByteArray &baseHash, QList<ChannelData> *channels)
+{
+    close();
+
+    m_basePath = QFileInfo(basePath).absoluteFilePath();
+    m_journalPath = m_basePath + ".journal";
+
+    QList<QByteArray> pending;
+
+    QFile journal(m_journalPath);
+    if (journal.open(QIODevice::ReadOnly))
+    {
+        const QList<QByteArray> lines = journal.readAll().split('\n');
+        journal.close();
+
+        QList<QJsonObject> entries;
+        for (const QByteArray &line : lines)
+        {
+            if (line.isEmpty())
+            {
+                continue;
+            }
+
+            QJsonParseError error;
+            QJsonDocument doc = QJsonDocument::fromJson(line, &error);
+            if (error.error != QJsonParseError::NoError || !doc.isObject())
+            {
+                // A torn last line after a crash; everything before it is intact
+                qWarning() << "Ignoring truncated channel journal entry in" << m_journalPath;
+                break;
+            }
+            entries.append(doc.object());
+        }
+
+        // Replay from the start if the journal was written against this file, or
+        // from the checkpoint whose compacted snapshot this file is
+        int start = -1;
+        const QString hashHex = QString::fromLatin1(baseHash.toHex());
+        if (!entries.isEmpty() && entries.first().value("base").toString() == hashHex)
+        {
+            start = 1;
+        }
+        else
+        {
+            int checkpoint = -1;
+            for (const QJsonObject &entry : entries)
+            {
+                if (entry.value("op").toString() == "commit" && entry.value("base").toString() == hashHex)
+                {
+                    checkpoint = entry.value("checkpoint").toInt();
+                }
+            }
+
+            for (int i = 0; checkpoint >= 0 && i < entries.size(); ++i)
+            {
+                if (entries[i].value("op").toString() == "checkpoint" && entries[i].value("id").toInt() == checkpoint)
+                {
+                    start = i + 1;
+                }
+            }
+        }
+
+        if (start < 0)
+        {
+            if (!entries.isEmpty())
+            {
+                qWarning() << "Discarding channel journal written for a different channels file:" << m_journalPath;
+            }
+            start = entries.size();
+        }
+
+        for (int i = start; i < entries.size(); ++i)
+        {
+            const QString op = entries[i].value("op").toString();
+            if (op == "checkpoint" || op == "commit")
+            {
+                continue;
+            }
+
+            if (!replay(entries[i], channels))
+            {
+                qWarning() << "Stopping channel journal replay at an entry that does not apply:" << op;
+                break;
+            }
+            pending.append(QJsonDocument(entries[i]).toJson(QJsonDocument::Compact));
+        }
+
+        if (!pending.isEmpty())
+        {
+            qDebug() << "Replayed" << pending.size() << "channel journal entries from" << m_journalPath;
+        }
+    }
+
+    // Start from a clean journal holding only the edits that still apply
+    if (!rewrite(baseHash, pending))
+    {
+        qWarning() << "Could not open channel journal:" << m_journalPath;
+        m_basePath.clear();
+        m_journalPath.clear();
+        return false;
+    }
+
+    m_entryCount = pending.size();
+    return true;
+}
+
+void ChannelJournal::close()
+{
+    if (m_compacting)
+    {
+        m_compactWatcher.waitForFinished();
+        onCompactFinished();
+    }
+
+    if (m_file.isOpen())
+    {
+        m_file.close();
+    }
+
+    m_basePath.clear();
+    m_journalPath.clear();
+    m_baseHash.clear();
+    m_entryCount = 0;
+}
+
+bool ChannelJournal::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+QString ChannelJournal::basePath() const
+{
+    return m_basePath;
+}
+
+bool ChannelJournal::reset(const QByteArray &baseHash)
+{
+    if (!isOpen())
+    {
+        return false;
+    }
+
+    if (m_compacting)
+    {
+        m_compactWatcher.waitForFinished();
+        onCompactFinished();
+    }
+
+    m_entryCount = 0;
+    return rewrite(baseHash, QList<QByteArray>());
+}
+
+bool ChannelJournal::recordAdd(const ChannelData &channel)
+{
+    QJsonObject entry;
+    entry["op"] = "add";
+    entry["channel"] = channel.toJson();
+    return append(entry);
+}
+
+bool ChannelJournal::recordUpdate(int index, const ChannelData &channel)
+{
+    QJsonObject entry;
+    entry["op"] = "update";
+    entry["index"] = index;
+    entry["channel"] = channel.toJson();
+    return append(entry);
+}
+
+bool ChannelJournal::recordRemove(int index)
+{
+    QJsonObject entry;
+    entry["op"] = "remove";
+    entry["index"] = index;
+    return append(entry);
+}
+
+bool ChannelJournal::flush()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_file.isOpen() && m_file.flush();
+}
+
+void ChannelJournal::compactIfNeeded(const QList<ChannelData> &channels)
+{
+    if (!isOpen() || m_compacting || m_entryCount < m_compactThreshold)
+    {
+        return;
+    }
+
+    QJsonObject checkpoint;
+    checkpoint["op"] = "checkpoint";
+    checkpoint["id"] = ++m_checkpoint;
+    if (!append(checkpoint))
+    {
+        return;
+    }
+
+    m_compacting = true;
+    m_sinceCheckpoint.clear();
+
+    // The list is implicitly shared, so the snapshot is free until the next edit
+    m_compactWatcher.setFuture(QtConcurrent::run(&ChannelJournal::writeSnapshot, this, channels, m_checkpoint));
+}
+
+void ChannelJournal::setCompactThreshold(int entries)
+{
+    m_compactThreshold = qMax(1, entries);
+}
+
+int ChannelJournal::entryCount() const
+{
+    return m_entryCount;
+}
+
+void ChannelJournal::onCompactFinished()
+{
+    if (!m_compacting)
+    {
+        return;
+    }
+
+    m_compacting = false;
+    CompactResult result = m_compactWatcher.result();
+
+    if (!result.ok)
+    {
+        qWarning() << "Error compacting channel journal:" << result.error;
+        m_sinceCheckpoint.clear();
+        return;
+    }
+
+    // The channels file now holds the snapshot; keep only the edits made since
+    m_entryCount = m_sinceCheckpoint.size();
+    if (!rewrite(result.hash, m_sinceCheckpoint))
+    {
+        qWarning() << "Could not rewrite channel journal:" << m_journalPath;
+    }
+    m_sinceCheckpoint.clear();
+
+    emit compacted(result.hash);
+}
+
+ChannelJournal::CompactResult ChannelJournal::writeSnapshot(const QList<ChannelData> &channels, int checkpoint)
+{
+    CompactResult result;
+
+    QSaveFile file(m_basePath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        result.error = QString("Could not open file: %1").arg(m_basePath);
+        return result;
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    JSONParser parser;
+    if (!parser.writeChannels(channels, &file, &hash))
+    {
+        file.cancelWriting();
+        result.error = QString("Could not write file: %1").arg(m_basePath);
+        return result;
+    }
+
+    // Record the new file hash before the rename, so a crash in between still replays correctly
+    QJsonObject commit;
+    commit["op"] = "commit";
+    commit["checkpoint"] = checkpoint;
+    commit["base"] = QString::fromLatin1(hash.result().toHex());
+    if (!append(commit))
+    {
+        file.cancelWriting();
+        result.error = QString("Could not write journal: %1").arg(m_journalPath);
+        return result;
+    }
+
+    if (!file.commit())
+    {
+        result.error = QString("Could not commit file: %1").arg(m_basePath);
+        return result;
+    }
+
+    result.hash = hash.result();
+    result.ok = true;
+    return result;
+}
+
+bool ChannelJournal::append(const QJsonObject &entry)
+{
+    QByteArray line = QJsonDocument(entry).toJson(QJsonDocument::Compact);
+    const QString op = entry.value("op").toString();
+    const bool isEdit = op != "checkpoint" && op != "commit";
+
+    QMutexLocker locker(&m_mutex);
+
+    if (!m_file.isOpen())
+    {
+        return false;
+    }
+
+    if (m_compacting && isEdit)
+    {
+        m_sinceCheckpoint.append(line);
+    }
+
+    line.append('\n');
+    if (m_file.write(line) != line.size() || !m_file.flush())
+    {
+        return false;
+    }
+
+    if (isEdit)
+    {
+        ++m_entryCount;
+    }
+
+    return true;
+}
+
+bool ChannelJournal::rewrite(const QByteArray &baseHash, const QList<QByteArray> &entries)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_file.isOpen())
+    {
+        m_file.close();
+    }
+
+    QJsonObject header;
+    header["journal"] = JOURNAL_VERSION;
+    header["base"] = QString::fromLatin1(baseHash.toHex());
+
+    QSaveFile file(m_journalPath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    file.write(QJsonDocument(header).toJson(QJsonDocument::Compact));
+    file.write("\n");
+    for (const QByteArray &entry : entries)
+    {
+        file.write(entry);
+        file.write("\n");
+    }
+
+    if (!file.commit())
+    {
+        return false;
+    }
+
+    m_baseHash = baseHash;
+    m_file.setFileName(m_journalPath);
+    return m_file.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+bool ChannelJournal::replay(const QJsonObject &entry, QList<ChannelData> *channels)
+{
+    const QString op = entry.value("op").toString();
+    const int index = entry.value("index").toInt(-1);
+
+    if (op == "add")
+    {
+        channels->append(ChannelData::fromJson(entry.value("channel").toObject()));
+        return true;
+    }
+
+    if (op == "update" && index >= 0 && index < channels->size())
+    {
+        (*channels)[index] = ChannelData::fromJson(entry.value("channel").toObject());
+        return true;
+    }
+
+    if (op == "remove" && index >= 0 && index < channels->size())
+    {
+        channels->removeAt(index);
+        return true;
+    }
+
+    return false;
+}
\ No newline at end of file
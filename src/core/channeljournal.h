@@ -0,0 +1,193 @@
+#ifndef CHANNELJOURNAL_H
+#define CHANNELJOURNAL_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QByteArray>
+#include <QFile>
+#include <QJsonObject>
+#include <QMutex>
+#include <QFutureWatcher>
+#include "../data/channeldata.h"
+
+/**
+ * @brief The ChannelJournal class records channel edits in an append-only journal
+ *
+ * Each edit appends one compact JSON line to "<channels file>.journal", so
+ * saving after a single edit costs one small write regardless of the list
+ * size. The journal header records the SHA1 of the channels file it applies
+ * to; a journal written against a different file is discarded on load.
+ *
+ * Once the journal grows past a threshold it is compacted on a worker
+ * thread: a checkpoint marker is appended, the snapshot taken at that point
+ * is written to the channels file through QSaveFile, and a commit marker
+ * carrying the new file hash is appended just before the rename. Edits
+ * made while compaction runs keep appending after the checkpoint, so a
+ * crash at any point leaves a channels file and journal that replay to the
+ * last recorded edit.
+ */
+class ChannelJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor
+     * @param parent Parent object
+     */
+    explicit ChannelJournal(QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor
+     */
+    ~ChannelJournal();
+
+    /**
+     * @brief Open the journal for a channels file and replay it
+     * @param basePath Path to the channels file
+     * @param baseHash SHA1 of the channels file as loaded
+     * @param channels Channels loaded from the file, updated with the journaled edits
+     * @return True if the journal is open for appending
+     */
+    bool open(const QString &basePath, const QByteArray &baseHash, QList<ChannelData> *channels);
+
+    /**
+     * @brief Close the journal, waiting for a running compaction
+     */
+    void close();
+
+    /**
+     * @brief Check whether the journal is open
+     * @return True if edits are being journaled
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Get the channels file the journal applies to
+     * @return Absolute path of the channels file, empty if closed
+     */
+    QString basePath() const;
+
+    /**
+     * @brief Start a new, empty journal for a replaced channels file
+     * @param baseHash SHA1 of the new channels file
+     * @return True if successful, false otherwise
+     */
+    bool reset(const QByteArray &baseHash);
+
+    /**
+     * @brief Record an appended channel
+     * @param channel Channel data
+     * @return True if successful, false otherwise
+     */
+    bool recordAdd(const ChannelData &channel);
+
+    /**
+     * @brief Record a changed channel
+     * @param index Channel index
+     * @param channel New channel data
+     * @return True if successful, false otherwise
+     */
+    bool recordUpdate(int index, const ChannelData &channel);
+
+    /**
+     * @brief Record a removed channel
+     * @param index Channel index
+     * @return True if successful, false otherwise
+     */
+    bool recordRemove(int index);
+
+    /**
+     * @brief Flush recorded edits to disk
+     * @return True if successful, false otherwise
+     */
+    bool flush();
+
+    /**
+     * @brief Compact the journal in the background if it grew past the threshold
+     * @param channels Current channel list, matching all recorded edits
+     */
+    void compactIfNeeded(const QList<ChannelData> &channels);
+
+    /**
+     * @brief Set the number of journal entries that triggers compaction
+     * @param entries Entry threshold
+     */
+    void setCompactThreshold(int entries);
+
+    /**
+     * @brief Get the number of edits recorded since the last compaction
+     * @return Number of journal entries
+     */
+    int entryCount() const;
+
+signals:
+    /**
+     * @brief Signal emitted when the channels file was rewritten by compaction
+     * @param baseHash SHA1 of the new channels file
+     */
+    void compacted(const QByteArray &baseHash);
+
+private slots:
+    /**
+     * @brief Rewrite the journal after a background compaction
+     */
+    void onCompactFinished();
+
+private:
+    /**
+     * @brief Result of a background compaction
+     */
+    struct CompactResult
+    {
+        QByteArray hash;
+        QString error;
+        bool ok = false;
+    };
+
+    /**
+     * @brief Write a snapshot to the channels file (runs on a worker thread)
+     * @param channels Snapshot to write
+     * @param checkpoint Checkpoint the snapshot was taken at
+     * @return Compaction result
+     */
+    CompactResult writeSnapshot(const QList<ChannelData> &channels, int checkpoint);
+
+    /**
+     * @brief Append one entry to the journal
+     * @param entry Entry object
+     * @return True if successful, false otherwise
+     */
+    bool append(const QJsonObject &entry);
+
+    /**
+     * @brief Replace the journal file with a header and entries
+     * @param baseHash SHA1 of the channels file the entries apply to
+     * @param entries Serialized entries, one per line
+     * @return True if successful, false otherwise
+     */
+    bool rewrite(const QByteArray &baseHash, const QList<QByteArray> &entries);
+
+    /**
+     * @brief Apply one journal entry to a channel list
+     * @param entry Entry object
+     * @param channels Channel list
+     * @return True if the entry applied cleanly
+     */
+    static bool replay(const QJsonObject &entry, QList<ChannelData> *channels);
+
+    QString m_basePath;
+    QString m_journalPath;
+    QByteArray m_baseHash;
+    QFile m_file;
+    QMutex m_mutex;
+    QList<QByteArray> m_sinceCheckpoint;
+    QFutureWatcher<CompactResult> m_compactWatcher;
+    int m_entryCount;
+    int m_checkpoint;
+    int m_compactThreshold;
+    bool m_compacting;
+};
+
+#endif // CHANNELJOURNAL_H
\ No newline at end of file
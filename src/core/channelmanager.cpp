@@ -1,42 +1,148 @@
 #include "channelmanager.h"
+#include "m3uparser.h"
 #include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QHash>
+#include <QVector>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+
+// Provisioning tools tend to write a lineup in several bursts; wait for them to settle
+static const int RELOAD_DEBOUNCE_MS = 500;
 
 ChannelManager::ChannelManager(QObject *parent)
-    : QObject(parent), m_currentIndex(-1)
+    : QObject(parent), m_currentIndex(-1), m_reloadPending(false)
 {
+    m_reloadTimer.setSingleShot(true);
+    m_reloadTimer.setInterval(RELOAD_DEBOUNCE_MS);
+
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, &ChannelManager::onWatchedPathChanged);
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &ChannelManager::onWatchedPathChanged);
+    connect(&m_reloadTimer, &QTimer::timeout, this, &ChannelManager::onReloadTimeout);
+    connect(&m_reloadWatcher, &QFutureWatcher<QList<ParseResult>>::finished, this, &ChannelManager::onReloadFinished);
+    connect(&m_journal, &ChannelJournal::compacted, this, &ChannelManager::onJournalCompacted);
 }
 
 ChannelManager::~ChannelManager()
 {
+    m_reloadWatcher.waitForFinished();
 }
 
 bool ChannelManager::loadFromFile(const QString &filePath)
 {
-    try
+    ParseResult result = readChannelsFile(filePath);
+    if (!result.ok)
     {
-        m_channels = m_jsonParser.parseFile(filePath);
-        m_currentIndex = m_channels.isEmpty() ? -1 : 0;
+        qWarning() << "Error loading channels:" << result.error;
+        return false;
+    }
 
-        emit channelsLoaded();
-        emit channelListChanged();
+    m_journal.close();
+    if (!filePath.startsWith(":/"))
+    {
+        m_journal.open(filePath, result.hash, &result.channels);
+    }
+
+    ChannelSource source;
+    source.path = sourcePath(filePath);
 
-        if (m_currentIndex >= 0)
+    m_sources = {source};
+    m_sourceChannels = {{source.path, result.channels}};
+    m_sourceHashes = {{source.path, result.hash}};
+
+    installChannels(result.channels);
+    return true;
+}
+
+bool ChannelManager::loadFromSources(const QList<ChannelSource> &sources)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QStringList paths;
+    for (const ChannelSource &source : sources)
+    {
+        paths.append(sourcePath(source.path));
+    }
+
+    QList<ParseResult> results = QtConcurrent::blockingMapped<QList<ParseResult>>(paths, [](const QString &path)
+                                                                                  { return readChannelsFile(path); });
+
+    bool loaded = false;
+    for (const ParseResult &result : results)
+    {
+        if (result.ok)
         {
-            emit currentChannelChanged(m_channels[m_currentIndex]);
+            loaded = true;
+        }
+        else
+        {
+            qWarning() << "Error loading channel source:" << result.error;
         }
-
-        return true;
     }
-    catch (const QString &error)
+
+    if (!loaded)
     {
-        qWarning() << "Error loading channels:" << error;
         return false;
     }
+
+    m_journal.close();
+
+    // Failed sources stay listed so they are picked up once they are fixed
+    m_sources.clear();
+    m_sourceChannels.clear();
+    m_sourceHashes.clear();
+    for (int i = 0; i < sources.size(); ++i)
+    {
+        ChannelSource source = sources[i];
+        source.path = paths[i];
+        m_sources.append(source);
+        m_sourceChannels.insert(source.path, results[i].channels);
+        m_sourceHashes.insert(source.path, results[i].hash);
+    }
+
+    QList<ChannelData> channels = mergeSources();
+
+    qDebug() << "Merged" << sources.size() << "channel sources into" << channels.size() << "channels in" << timer.elapsed() << "ms";
+
+    installChannels(channels);
+    return true;
+}
+
+QList<ChannelSource> ChannelManager::sources() const
+{
+    return m_sources;
 }
 
 bool ChannelManager::saveToFile(const QString &filePath)
 {
-    return m_jsonParser.saveToFile(m_channels, filePath);
+    const QString absolutePath = QFileInfo(filePath).absoluteFilePath();
+
+    if (m_journal.isOpen() && absolutePath == m_journal.basePath())
+    {
+        return m_journal.flush();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (!m_jsonParser.saveToFile(m_channels, filePath, &hash))
+    {
+        return false;
+    }
+
+    // Our own write must not come back as an external change
+    if (m_sourceHashes.contains(absolutePath))
+    {
+        m_sourceHashes[absolutePath] = hash.result();
+        m_sourceChannels[absolutePath] = m_channels;
+    }
+
+    return true;
 }
 
 QList<ChannelData> ChannelManager::channels() const
@@ -79,6 +185,12 @@ void ChannelManager::addChannel(const ChannelData &channel)
 {
     m_channels.append(channel);
 
+    if (m_journal.isOpen())
+    {
+        m_journal.recordAdd(channel);
+        m_journal.compactIfNeeded(m_channels);
+    }
+
     if (m_currentIndex < 0)
     {
         m_currentIndex = 0;
@@ -97,6 +209,12 @@ bool ChannelManager::removeChannel(int index)
 
     m_channels.removeAt(index);
 
+    if (m_journal.isOpen())
+    {
+        m_journal.recordRemove(index);
+        m_journal.compactIfNeeded(m_channels);
+    }
+
     if (m_channels.isEmpty())
     {
         m_currentIndex = -1;
@@ -124,6 +242,12 @@ bool ChannelManager::updateChannel(int index, const ChannelData &channel)
 
     m_channels[index] = channel;
 
+    if (m_journal.isOpen())
+    {
+        m_journal.recordUpdate(index, channel);
+        m_journal.compactIfNeeded(m_channels);
+    }
+
     if (m_currentIndex == index)
     {
         emit currentChannelChanged(m_channels[m_currentIndex]);
@@ -136,4 +260,605 @@ bool ChannelManager::updateChannel(int index, const ChannelData &channel)
 int ChannelManager::count() const
 {
     return m_channels.size();
+}
+
+void ChannelManager::watchFile(const QString &filePath)
+{
+    watchFiles(filePath.isEmpty() ? QStringList() : QStringList{filePath});
+}
+
+void ChannelManager::watchFiles(const QStringList &filePaths)
+{
+    if (!m_watcher.files().isEmpty())
+    {
+        m_watcher.removePaths(m_watcher.files());
+    }
+    if (!m_watcher.directories().isEmpty())
+    {
+        m_watcher.removePaths(m_watcher.directories());
+    }
+
+    m_reloadTimer.stop();
+    m_watchedFiles.clear();
+
+    QSet<QString> directories;
+    for (const QString &filePath : filePaths)
+    {
+        // Resource files never change at runtime
+        if (filePath.isEmpty() || filePath.startsWith(":/"))
+        {
+            continue;
+        }
+
+        QFileInfo info(filePath);
+        m_watchedFiles.append(info.absoluteFilePath());
+        m_watcher.addPath(info.absoluteFilePath());
+
+        // Tools that replace the file by rename drop the file watch, so also watch the directory
+        if (!directories.contains(info.absolutePath()))
+        {
+            directories.insert(info.absolutePath());
+            m_watcher.addPath(info.absolutePath());
+        }
+    }
+}
+
+QStringList ChannelManager::watchedFiles() const
+{
+    return m_watchedFiles;
+}
+
+QString ChannelManager::channelKey(const ChannelData &channel)
+{
+    // The guide id survives URL rotations, so prefer it when the lineup provides one
+    if (!channel.tvgId().isEmpty())
+    {
+        return "tvg:" + channel.tvgId();
+    }
+
+    return channel.url();
+}
+
+QList<ChannelData> ChannelManager::channelsForKeys(const QStringList &keys) const
+{
+    QHash<QString, int> positions;
+    for (int i = 0; i < keys.size(); ++i)
+    {
+        positions.insert(keys[i], i);
+    }
+
+    QList<ChannelData> found(keys.size());
+    QList<bool> present(keys.size(), false);
+    for (const ChannelData &channel : m_channels)
+    {
+        auto it = positions.constFind(channelKey(channel));
+        if (it != positions.constEnd() && !present[it.value()])
+        {
+            found[it.value()] = channel;
+            present[it.value()] = true;
+        }
+    }
+
+    QList<ChannelData> channels;
+    for (int i = 0; i < found.size(); ++i)
+    {
+        if (present[i])
+        {
+            channels.append(found[i]);
+        }
+    }
+
+    return channels;
+}
+
+void ChannelManager::setGuide(const QSharedPointer<const EPGStore> &guide)
+{
+    if (guide == m_guide)
+    {
+        return;
+    }
+
+    m_guide = guide;
+    emit guideChanged();
+}
+
+QSharedPointer<const EPGStore> ChannelManager::guide() const
+{
+    return m_guide;
+}
+
+bool ChannelManager::nowAndNext(const ChannelData &channel, ProgrammeData *now, ProgrammeData *next) const
+{
+    if (now)
+    {
+        *now = ProgrammeData();
+    }
+    if (next)
+    {
+        *next = ProgrammeData();
+    }
+
+    if (!m_guide || channel.tvgId().isEmpty())
+    {
+        return false;
+    }
+
+    qint64 time = QDateTime::currentSecsSinceEpoch();
+    bool hasNow = m_guide->programmeAt(channel.tvgId(), time, now);
+    bool hasNext = m_guide->nextProgramme(channel.tvgId(), time, next);
+    return hasNow || hasNext;
+}
+
+void ChannelManager::onWatchedPathChanged(const QString &path)
+{
+    Q_UNUSED(path);
+
+    if (m_watchedFiles.isEmpty())
+    {
+        return;
+    }
+
+    // Re-arm file watches for files that were replaced
+    const QStringList watched = m_watcher.files();
+    for (const QString &filePath : std::as_const(m_watchedFiles))
+    {
+        if (!watched.contains(filePath) && QFileInfo::exists(filePath))
+        {
+            m_watcher.addPath(filePath);
+        }
+    }
+
+    m_reloadTimer.start();
+}
+
+void ChannelManager::onReloadTimeout()
+{
+    if (m_watchedFiles.isEmpty())
+    {
+        return;
+    }
+
+    if (m_reloadWatcher.isRunning())
+    {
+        m_reloadPending = true;
+        return;
+    }
+
+    m_reloadWatcher.setFuture(QtConcurrent::run(&ChannelManager::readChangedFiles, m_watchedFiles, m_sourceHashes));
+}
+
+void ChannelManager::onReloadFinished()
+{
+    const QList<ParseResult> results = m_reloadWatcher.result();
+
+    if (m_reloadPending)
+    {
+        m_reloadPending = false;
+        m_reloadTimer.start();
+    }
+
+    // Only sources that changed are replaced; the others are merged from their cached lists
+    bool changed = false;
+    for (const ParseResult &result : results)
+    {
+        if (!m_sourceChannels.contains(result.filePath))
+        {
+            continue;
+        }
+
+        if (!result.ok)
+        {
+            // Keep the current list; the file is probably still being written
+            qWarning() << "Error reloading channels:" << result.error;
+            continue;
+        }
+
+        if (result.unchanged || result.hash == m_sourceHashes.value(result.filePath))
+        {
+            continue;
+        }
+
+        m_sourceHashes[result.filePath] = result.hash;
+        m_sourceChannels[result.filePath] = result.channels;
+        changed = true;
+    }
+
+    if (!changed)
+    {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QList<ChannelData> channels = mergeSources();
+    if (m_sources.size() > 1)
+    {
+        qDebug() << "Re-merged" << m_sources.size() << "channel sources in" << timer.elapsed() << "ms";
+    }
+
+    applyChannelDiff(channels);
+
+    // The external file wins; edits journaled against the old file no longer apply
+    if (m_journal.isOpen() && m_sourceHashes.contains(m_journal.basePath()))
+    {
+        if (m_journal.entryCount() > 0)
+        {
+            qWarning() << "Channels file changed externally, dropping" << m_journal.entryCount() << "journaled edits";
+        }
+        m_journal.reset(m_sourceHashes.value(m_journal.basePath()));
+    }
+}
+
+void ChannelManager::onJournalCompacted(const QByteArray &hash)
+{
+    if (m_sourceHashes.contains(m_journal.basePath()))
+    {
+        m_sourceHashes[m_journal.basePath()] = hash;
+    }
+}
+
+ChannelManager::ParseResult ChannelManager::readChannelsFile(const QString &filePath, const QByteArray &knownHash)
+{
+    ParseResult result;
+    result.filePath = filePath;
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        result.error = QString("Could not open file: %1").arg(filePath);
+        return result;
+    }
+
+    QByteArray data = file.readAll();
+    file.close();
+
+    result.hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+
+    // Directory events also fire for our own atomic writes; no need to parse those again
+    if (!knownHash.isEmpty() && result.hash == knownHash)
+    {
+        result.ok = true;
+        result.unchanged = true;
+        return result;
+    }
+
+    try
+    {
+        QString suffix = QFileInfo(filePath).suffix().toLower();
+        if (suffix == "m3u" || suffix == "m3u8" || M3UParser::isPlaylist(data))
+        {
+            M3UParser parser;
+            result.channels = parser.parseData(data);
+        }
+        else
+        {
+            JSONParser parser;
+            result.channels = parser.parseData(data);
+        }
+        result.ok = true;
+    }
+    catch (const QString &error)
+    {
+        result.error = error;
+    }
+
+    return result;
+}
+
+QList<ChannelManager::ParseResult> ChannelManager::readChangedFiles(const QStringList &filePaths, const QHash<QString, QByteArray> &knownHashes)
+{
+    QList<ParseResult> results;
+    for (const QString &filePath : filePaths)
+    {
+        results.append(readChannelsFile(filePath, knownHashes.value(filePath)));
+    }
+    return results;
+}
+
+QString ChannelManager::normalizedUrl(const QString &url)
+{
+    // Cheap string surgery rather than QUrl, which is too slow for large lineups
+    QString normalized = url.trimmed();
+
+    qsizetype fragment = normalized.indexOf('#');
+    if (fragment >= 0)
+    {
+        normalized.truncate(fragment);
+    }
+
+    qsizetype schemeEnd = normalized.indexOf("://");
+    if (schemeEnd > 0)
+    {
+        qsizetype hostStart = schemeEnd + 3;
+        qsizetype hostEnd = normalized.indexOf('/', hostStart);
+        if (hostEnd < 0)
+        {
+            hostEnd = normalized.size();
+        }
+
+        QString scheme = normalized.left(schemeEnd).toLower();
+        QString host = normalized.mid(hostStart, hostEnd - hostStart).toLower();
+        if ((scheme == "http" && host.endsWith(":80")) || (scheme == "https" && host.endsWith(":443")))
+        {
+            host.truncate(host.lastIndexOf(':'));
+        }
+
+        normalized = scheme + "://" + host + normalized.mid(hostEnd);
+    }
+
+    while (normalized.endsWith('/'))
+    {
+        normalized.chop(1);
+    }
+
+    return normalized;
+}
+
+QString ChannelManager::sourcePath(const QString &filePath)
+{
+    if (filePath.startsWith(":/"))
+    {
+        return filePath;
+    }
+
+    return QFileInfo(filePath).absoluteFilePath();
+}
+
+QList<ChannelData> ChannelManager::mergeSources() const
+{
+    // A single source is used as is, duplicates included
+    if (m_sources.size() == 1)
+    {
+        return m_sourceChannels.value(m_sources.first().path);
+    }
+
+    int total = 0;
+    for (const ChannelSource &source : m_sources)
+    {
+        total += m_sourceChannels.value(source.path).size();
+    }
+
+    QList<ChannelData> channels;
+    QList<int> priorities;
+    QHash<QString, int> byUrl;
+    QHash<QString, int> byTvgId;
+    channels.reserve(total);
+    priorities.reserve(total);
+    byUrl.reserve(total);
+    byTvgId.reserve(total);
+
+    for (const ChannelSource &source : m_sources)
+    {
+        const QList<ChannelData> sourceChannels = m_sourceChannels.value(source.path);
+        for (const ChannelData &sourceChannel : sourceChannels)
+        {
+            const QString url = normalizedUrl(sourceChannel.url());
+            const QString &tvgId = sourceChannel.tvgId();
+
+            int existing = -1;
+            if (!tvgId.isEmpty())
+            {
+                existing = byTvgId.value(tvgId, -1);
+            }
+            if (existing < 0)
+            {
+                existing = byUrl.value(url, -1);
+            }
+
+            if (existing >= 0 && priorities[existing] >= source.priority)
+            {
+                continue;
+            }
+
+            ChannelData channel = sourceChannel;
+            channel.setSource(source.name);
+
+            int index = existing;
+            if (index >= 0)
+            {
+                channels[index] = channel;
+                priorities[index] = source.priority;
+            }
+            else
+            {
+                index = channels.size();
+                channels.append(channel);
+                priorities.append(source.priority);
+            }
+
+            byUrl.insert(url, index);
+            if (!tvgId.isEmpty())
+            {
+                byTvgId.insert(tvgId, index);
+            }
+        }
+    }
+
+    return channels;
+}
+
+void ChannelManager::installChannels(const QList<ChannelData> &channels)
+{
+    m_channels = channels;
+    m_currentIndex = m_channels.isEmpty() ? -1 : 0;
+
+    emit channelsLoaded();
+    emit channelListChanged();
+
+    if (m_currentIndex >= 0)
+    {
+        emit currentChannelChanged(m_channels[m_currentIndex]);
+    }
+}
+
+QStringList ChannelManager::channelKeys(const QList<ChannelData> &channels)
+{
+    QStringList keys;
+    keys.reserve(channels.size());
+
+    QHash<QString, int> occurrences;
+    for (const ChannelData &channel : channels)
+    {
+        QString key = channelKey(channel);
+        int occurrence = occurrences[key]++;
+        if (occurrence > 0)
+        {
+            key += QString("#%1").arg(occurrence);
+        }
+        keys.append(key);
+    }
+
+    return keys;
+}
+
+void ChannelManager::applyChannelDiff(const QList<ChannelData> &channels)
+{
+    QStringList oldKeys = channelKeys(m_channels);
+    const QStringList newKeys = channelKeys(channels);
+    const QString currentKey = (m_currentIndex >= 0 && m_currentIndex < oldKeys.size()) ? oldKeys[m_currentIndex] : QString();
+
+    const QSet<QString> oldKeySet(oldKeys.constBegin(), oldKeys.constEnd());
+    const QSet<QString> newKeySet(newKeys.constBegin(), newKeys.constEnd());
+
+    // If the current channel goes, the nearest surviving one after it (or else before it) takes over
+    QString fallbackKey = currentKey;
+    if (!currentKey.isEmpty() && !newKeySet.contains(currentKey))
+    {
+        fallbackKey.clear();
+        for (int i = m_currentIndex + 1; i < oldKeys.size() && fallbackKey.isEmpty(); ++i)
+        {
+            fallbackKey = newKeySet.contains(oldKeys[i]) ? oldKeys[i] : QString();
+        }
+        for (int i = m_currentIndex - 1; i >= 0 && fallbackKey.isEmpty(); --i)
+        {
+            fallbackKey = newKeySet.contains(oldKeys[i]) ? oldKeys[i] : QString();
+        }
+        if (fallbackKey.isEmpty() && !newKeys.isEmpty())
+        {
+            fallbackKey = newKeys.first();
+        }
+    }
+    const bool currentRemoved = fallbackKey != currentKey;
+
+    int common = 0;
+    for (const QString &key : newKeys)
+    {
+        if (oldKeySet.contains(key))
+        {
+            ++common;
+        }
+    }
+
+    // A mostly new lineup is cheaper to replace than to patch row by row
+    if (common * 2 < newKeys.size())
+    {
+        m_channels = channels;
+        m_currentIndex = fallbackKey.isEmpty() ? -1 : newKeys.indexOf(fallbackKey);
+
+        emit channelListChanged();
+        emit channelsMerged();
+        if (currentRemoved && m_currentIndex >= 0)
+        {
+            emit currentChannelChanged(m_channels[m_currentIndex]);
+        }
+        return;
+    }
+
+    int removed = 0;
+    int inserted = 0;
+    int updated = 0;
+
+    // Drop channels that are gone, back to front so indices stay valid
+    for (int i = oldKeys.size() - 1; i >= 0; --i)
+    {
+        if (!newKeySet.contains(oldKeys[i]))
+        {
+            oldKeys.removeAt(i);
+            m_channels.removeAt(i);
+            ++removed;
+            emit channelRemoved(i);
+        }
+    }
+
+    // Old rows not yet placed keep their relative order behind the placed ones,
+    // so a row's current index is j plus the number of pending rows before it.
+    // A Fenwick tree over the surviving rows counts those in O(log n).
+    const int survivors = oldKeys.size();
+    QHash<QString, int> oldIndex;
+    oldIndex.reserve(survivors);
+    QVector<int> pending(survivors + 1, 0);
+    for (int i = 0; i < survivors; ++i)
+    {
+        oldIndex.insert(oldKeys[i], i);
+        for (int k = i + 1; k <= survivors; k += k & -k)
+        {
+            ++pending[k];
+        }
+    }
+
+    auto pendingBefore = [&pending](int index)
+    {
+        int count = 0;
+        for (int k = index; k > 0; k -= k & -k)
+        {
+            count += pending[k];
+        }
+        return count;
+    };
+    auto place = [&pending, survivors](int index)
+    {
+        for (int k = index + 1; k <= survivors; k += k & -k)
+        {
+            --pending[k];
+        }
+    };
+
+    QVector<bool> placed(survivors, false);
+    int next = 0;
+
+    // Walk the new list, moving, inserting or updating rows as needed
+    for (int j = 0; j < newKeys.size(); ++j)
+    {
+        while (next < survivors && placed[next])
+        {
+            ++next;
+        }
+
+        if (next < survivors && oldKeys[next] == newKeys[j])
+        {
+            placed[next] = true;
+            place(next);
+            if (m_channels[j] != channels[j])
+            {
+                m_channels[j] = channels[j];
+                ++updated;
+                emit channelUpdated(j);
+            }
+            continue;
+        }
+
+        auto it = oldIndex.constFind(newKeys[j]);
+        if (it != oldIndex.constEnd())
+        {
+            int from = j + pendingBefore(it.value());
+            placed[it.value()] = true;
+            place(it.value());
+            m_channels.removeAt(from);
+            emit channelRemoved(from);
+        }
+
+        m_channels.insert(j, channels[j]);
+        ++inserted;
+        emit channelInserted(j);
+    }
+
+    m_currentIndex = fallbackKey.isEmpty() ? -1 : newKeys.indexOf(fallbackKey);
+
+    qDebug() << "Merged channel reload:" << removed << "removed," << inserted << "inserted or moved," << updated << "updated";
+
+    emit channelsMerged();
+    if (currentRemoved && m_currentIndex >= 0)
+    {
+        emit currentChannelChanged(m_channels[m_currentIndex]);
+    }
 }
\ No newline at end of file
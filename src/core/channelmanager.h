@@ -3,8 +3,18 @@
 
 #include <QObject>
 #include <QList>
+#include <QStringList>
+#include <QByteArray>
+#include <QTimer>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <QHash>
 #include "../data/channeldata.h"
+#include "../data/channelsource.h"
 #include "jsonparser.h"
+#include "epgstore.h"
+#include "channeljournal.h"
 
 /**
  * @brief The ChannelManager class manages channel data and selection
@@ -27,13 +37,40 @@ public:
 
     /**
      * @brief Load channels from a file
+     *
+     * Edits journaled since the file was last written are replayed, and
+     * further edits are journaled until the list is loaded from elsewhere.
+     *
      * @param filePath Path to the channels file
      * @return True if successful, false otherwise
      */
     bool loadFromFile(const QString &filePath);
 
+    /**
+     * @brief Load and merge channels from several sources
+     *
+     * Sources are parsed in parallel, then merged in list order. A channel
+     * is a duplicate if its normalised URL or its tvg-id was already seen;
+     * the entry from the source with the higher priority is kept, in the
+     * position of its first occurrence. Edits are not journaled.
+     *
+     * @param sources Sources in lineup order
+     * @return True if at least one source was loaded, false otherwise
+     */
+    bool loadFromSources(const QList<ChannelSource> &sources);
+
+    /**
+     * @brief Get the sources of the current channel list
+     * @return Sources in lineup order
+     */
+    QList<ChannelSource> sources() const;
+
     /**
      * @brief Save channels to a file
+     *
+     * Saving to the loaded file only flushes the edit journal; the file itself
+     * is rewritten atomically when the journal is compacted in the background.
+     *
      * @param filePath Path to the channels file
      * @return True if successful, false otherwise
      */
@@ -91,6 +128,63 @@ public:
      */
     int count() const;
 
+    /**
+     * @brief Watch a channels file and merge external changes into the list
+     *
+     * Changes are debounced, parsed on a worker thread and applied as a keyed
+     * diff, so the current channel keeps playing across reloads.
+     *
+     * @param filePath Path to the channels file, empty to stop watching
+     */
+    void watchFile(const QString &filePath);
+
+    /**
+     * @brief Watch several source files; only the ones that changed are parsed again
+     * @param filePaths Paths to the source files, empty to stop watching
+     */
+    void watchFiles(const QStringList &filePaths);
+
+    /**
+     * @brief Get the files currently being watched
+     * @return Absolute paths of the watched files
+     */
+    QStringList watchedFiles() const;
+
+    /**
+     * @brief Get the key identifying a channel across reloads
+     * @param channel Channel data
+     * @return Channel key
+     */
+    static QString channelKey(const ChannelData &channel);
+
+    /**
+     * @brief Find channels by key
+     * @param keys Channel keys
+     * @return Channels in the order of the keys, skipping keys not in the list
+     */
+    QList<ChannelData> channelsForKeys(const QStringList &keys) const;
+
+    /**
+     * @brief Attach the programme guide for the channel list
+     * @param guide Mapped guide store, null to detach
+     */
+    void setGuide(const QSharedPointer<const EPGStore> &guide);
+
+    /**
+     * @brief Get the programme guide for the channel list
+     * @return Mapped guide store, null if none is attached
+     */
+    QSharedPointer<const EPGStore> guide() const;
+
+    /**
+     * @brief Get the programmes airing now and next on a channel
+     * @param channel Channel data
+     * @param now Filled with the current programme, cleared if there is none
+     * @param next Filled with the next programme, cleared if there is none
+     * @return True if the guide has data for the channel
+     */
+    bool nowAndNext(const ChannelData &channel, ProgrammeData *now, ProgrammeData *next) const;
+
 signals:
     /**
      * @brief Signal emitted when channels are loaded
@@ -108,10 +202,141 @@ signals:
      */
     void channelListChanged();
 
+    /**
+     * @brief Signal emitted when a channel is inserted by a reload merge
+     * @param index Index of the new channel
+     */
+    void channelInserted(int index);
+
+    /**
+     * @brief Signal emitted when a channel is removed by a reload merge
+     * @param index Index the channel had before removal
+     */
+    void channelRemoved(int index);
+
+    /**
+     * @brief Signal emitted when a channel is changed in place by a reload merge
+     * @param index Index of the changed channel
+     */
+    void channelUpdated(int index);
+
+    /**
+     * @brief Signal emitted once all deltas of a reload merge have been applied
+     */
+    void channelsMerged();
+
+    /**
+     * @brief Signal emitted when a different programme guide is attached
+     */
+    void guideChanged();
+
+private slots:
+    /**
+     * @brief Handle a change notification for the watched file or its directory
+     * @param path Changed path
+     */
+    void onWatchedPathChanged(const QString &path);
+
+    /**
+     * @brief Start a background reload once the debounce interval elapsed
+     */
+    void onReloadTimeout();
+
+    /**
+     * @brief Merge the result of a background reload
+     */
+    void onReloadFinished();
+
+    /**
+     * @brief Remember the hash of a channels file written by journal compaction
+     * @param hash SHA1 of the new channels file
+     */
+    void onJournalCompacted(const QByteArray &hash);
+
 private:
+    /**
+     * @brief Result of reading and parsing a channels file
+     */
+    struct ParseResult
+    {
+        QString filePath;
+        QByteArray hash;
+        QList<ChannelData> channels;
+        QString error;
+        bool ok = false;
+        bool unchanged = false;
+    };
+
+    /**
+     * @brief Read, hash and parse a JSON or M3U channels file (thread-safe)
+     * @param filePath Path to the channels file
+     * @param knownHash Hash of the loaded file; parsing is skipped if it still matches
+     * @return Parse result
+     */
+    static ParseResult readChannelsFile(const QString &filePath, const QByteArray &knownHash = QByteArray());
+
+    /**
+     * @brief Read the watched files that changed (thread-safe)
+     * @param filePaths Paths to the files
+     * @param knownHashes Hashes of the loaded files
+     * @return One parse result per file
+     */
+    static QList<ParseResult> readChangedFiles(const QStringList &filePaths, const QHash<QString, QByteArray> &knownHashes);
+
+    /**
+     * @brief Normalise a stream URL for duplicate detection
+     * @param url Stream URL
+     * @return URL with lower-case scheme and host, no default port, fragment or trailing slash
+     */
+    static QString normalizedUrl(const QString &url);
+
+    /**
+     * @brief Get the path a source is cached and watched under
+     * @param filePath Source path as configured
+     * @return Absolute path, or the path unchanged for resources
+     */
+    static QString sourcePath(const QString &filePath);
+
+    /**
+     * @brief Merge the cached channel lists of all sources
+     * @return Merged channel list
+     */
+    QList<ChannelData> mergeSources() const;
+
+    /**
+     * @brief Replace the channel list after a load and select the first channel
+     * @param channels New channel list
+     */
+    void installChannels(const QList<ChannelData> &channels);
+
+    /**
+     * @brief Build the keys of a channel list, disambiguating duplicates
+     * @param channels Channel list
+     * @return One key per channel
+     */
+    static QStringList channelKeys(const QList<ChannelData> &channels);
+
+    /**
+     * @brief Apply a new channel list as a keyed diff against the current one
+     * @param channels New channel list
+     */
+    void applyChannelDiff(const QList<ChannelData> &channels);
+
     QList<ChannelData> m_channels;
     int m_currentIndex;
     JSONParser m_jsonParser;
+    ChannelJournal m_journal;
+    QSharedPointer<const EPGStore> m_guide;
+
+    QList<ChannelSource> m_sources;
+    QHash<QString, QList<ChannelData>> m_sourceChannels;
+    QHash<QString, QByteArray> m_sourceHashes;
+
+    QFileSystemWatcher m_watcher;
+    QTimer m_reloadTimer;
+    QFutureWatcher<QList<ParseResult>> m_reloadWatcher;
+    QStringList m_watchedFiles;
+    bool m_reloadPending;
 };
 
 #endif // CHANNELMANAGER_H
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "epgindex.h"
+#include <algorithm>
+
+EPGIndex::EPGIndex()
+    : m_programmeCount(0)
+{
+}
+
+void EPGIndex::addProgramme(const QString &channelId, const ProgrammeData &programme)
+{
+    m_channels[channelId].append(programme);
+    ++m_programmeCount;
+}
+
+void EPGIndex::finalize()
+{
+    m_programmeCount = 0;
+
+    for (auto it = m_channels.begin(); it != m_channels.end(); ++it)
+    {
+        QVector<ProgrammeData> &programmes = it.value();
+
+        std::stable_sort(programmes.begin(), programmes.end(),
+                         [](const ProgrammeData &a, const ProgrammeData &b)
+                         { return a.start < b.start; });
+
+        // Make stop times monotonic: a missing stop ends at the next start and
+        // an overlapping programme is cut short, so both columns stay sorted
+        QVector<ProgrammeData> cleaned;
+        cleaned.reserve(programmes.size());
+        for (int i = 0; i < programmes.size(); ++i)
+        {
+            ProgrammeData programme = programmes[i];
+            if (!cleaned.isEmpty() && programme.start < cleaned.last().stop)
+            {
+                cleaned.last().stop = programme.start;
+                if (cleaned.last().stop <= cleaned.last().start)
+                {
+                    cleaned.removeLast();
+                }
+            }
+
+            if (programme.stop <= programme.start)
+            {
+                if (i + 1 >= programmes.size())
+                {
+                    continue;
+                }
+                programme.stop = programmes[i + 1].start;
+                if (programme.stop <= programme.start)
+                {
+                    continue;
+                }
+            }
+
+            cleaned.append(programme);
+        }
+
+        cleaned.squeeze();
+        programmes = cleaned;
+        m_programmeCount += programmes.size();
+    }
+}
+
+const ProgrammeData *EPGIndex::programmeAt(const QString &channelId, qint64 time) const
+{
+    auto it = m_channels.constFind(channelId);
+    if (it == m_channels.constEnd())
+    {
+        return nullptr;
+    }
+
+    const QVector<ProgrammeData> &programmes = it.value();
+
+    // First programme that ends after the given time
+    auto pos = std::upper_bound(programmes.constBegin(), programmes.constEnd(), time,
+                                [](qint64 value, const ProgrammeData &programme)
+                                { return value < programme.stop; });
+
+    if (pos != programmes.constEnd() && pos->contains(time))
+    {
+        return &*pos;
+    }
+
+    return nullptr;
+}
+
+const ProgrammeData *EPGIndex::nextProgramme(const QString &channelId, qint64 time) const
+{
+    auto it = m_channels.constFind(channelId);
+    if (it == m_channels.constEnd())
+    {
+        return nullptr;
+    }
+
+    const QVector<ProgrammeData> &programmes = it.value();
+    auto pos = std::upper_bound(programmes.constBegin(), programmes.constEnd(), time,
+                                [](qint64 value, const ProgrammeData &programme)
+                                { return value < programme.start; });
+
+    return pos != programmes.constEnd() ? &*pos : nullptr;
+}
+
+QVector<ProgrammeData> EPGIndex::programmesBetween(const QString &channelId, qint64 from, qint64 to) const
+{
+    QVector<ProgrammeData> result;
+
+    auto it = m_channels.constFind(channelId);
+    if (it == m_channels.constEnd() || to <= from)
+    {
+        return result;
+    }
+
+    const QVector<ProgrammeData> &programmes = it.value();
+    auto first = std::upper_bound(programmes.constBegin(), programmes.constEnd(), from,
+                                  [](qint64 value, const ProgrammeData &programme)
+                                  { return value < programme.stop; });
+    auto last = std::lower_bound(first, programmes.constEnd(), to,
+                                 [](const ProgrammeData &programme, qint64 value)
+                                 { return programme.start < value; });
+
+    result.reserve(static_cast<int>(last - first));
+    for (auto pos = first; pos != last; ++pos)
+    {
+        result.append(*pos);
+    }
+
+    return result;
+}
+
+QVector<ProgrammeData> EPGIndex::programmes(const QString &channelId) const
+{
+    return m_channels.value(channelId);
+}
+
+QStringList EPGIndex::channelIds() const
+{
+    return m_channels.keys();
+}
+
+int EPGIndex::channelCount() const
+{
+    return m_channels.size();
+}
+
+int EPGIndex::programmeCount() const
+{
+    return m_programmeCount;
+}
\ No newline at end of file
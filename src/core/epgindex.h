@@ -0,0 +1,92 @@
+#ifndef EPGINDEX_H
+#define EPGINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+#include "../data/programmedata.h"
+
+/**
+ * @brief The EPGIndex class holds programme guide data per channel
+ *
+ * Programmes are appended while a guide is parsed and then sorted once by
+ * finalize(). After that every channel is a sorted run of non-overlapping
+ * intervals, so point and range queries are binary searches.
+ */
+class EPGIndex
+{
+public:
+    /**
+     * @brief Constructor
+     */
+    EPGIndex();
+
+    /**
+     * @brief Add a programme to a channel
+     * @param channelId XMLTV channel id
+     * @param programme Programme data
+     */
+    void addProgramme(const QString &channelId, const ProgrammeData &programme);
+
+    /**
+     * @brief Sort the programmes of every channel and resolve overlaps
+     */
+    void finalize();
+
+    /**
+     * @brief Get the programme airing on a channel at a given time
+     * @param channelId XMLTV channel id
+     * @param time Seconds since the Unix epoch
+     * @return Pointer to the programme, or nullptr if none is airing
+     */
+    const ProgrammeData *programmeAt(const QString &channelId, qint64 time) const;
+
+    /**
+     * @brief Get the first programme on a channel starting after a given time
+     * @param channelId XMLTV channel id
+     * @param time Seconds since the Unix epoch
+     * @return Pointer to the programme, or nullptr if there is none
+     */
+    const ProgrammeData *nextProgramme(const QString &channelId, qint64 time) const;
+
+    /**
+     * @brief Get all programmes on a channel that overlap a time range
+     * @param channelId XMLTV channel id
+     * @param from Range start in seconds since the Unix epoch
+     * @param to Range end in seconds since the Unix epoch
+     * @return Programmes overlapping [from, to), in start order
+     */
+    QVector<ProgrammeData> programmesBetween(const QString &channelId, qint64 from, qint64 to) const;
+
+    /**
+     * @brief Get all programmes of a channel
+     * @param channelId XMLTV channel id
+     * @return Programmes in start order
+     */
+    QVector<ProgrammeData> programmes(const QString &channelId) const;
+
+    /**
+     * @brief Get the ids of all channels with guide data
+     * @return List of channel ids
+     */
+    QStringList channelIds() const;
+
+    /**
+     * @brief Get the number of channels with guide data
+     * @return Number of channels
+     */
+    int channelCount() const;
+
+    /**
+     * @brief Get the total number of programmes
+     * @return Number of programmes
+     */
+    int programmeCount() const;
+
+private:
+    QHash<QString, QVector<ProgrammeData>> m_channels;
+    int m_programmeCount;
+};
+
+#endif // EPGINDEX_H
\ No newline at end of file
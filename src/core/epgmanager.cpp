@@ -0,0 +1,272 @@
+#include "epgmanager.h"
+#include "xmltvparser.h"
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+
+EPGManager::EPGManager(QObject *parent)
+    : QObject(parent), m_loadPending(false)
+{
+    connect(&m_refreshTimer, &QTimer::timeout, this, &EPGManager::refresh);
+    connect(&m_loadWatcher, &QFutureWatcher<LoadResult>::finished, this, &EPGManager::onLoadFinished);
+}
+
+EPGManager::~EPGManager()
+{
+    m_loadWatcher.waitForFinished();
+}
+
+void EPGManager::setGuideFile(const QString &filePath)
+{
+    if (filePath == m_guideFile)
+    {
+        return;
+    }
+
+    m_guideFile = filePath;
+
+    if (m_guideFile.isEmpty())
+    {
+        m_store.reset();
+        emit guideUpdated();
+        return;
+    }
+
+    if (!openCachedStore())
+    {
+        startLoad();
+    }
+}
+
+QString EPGManager::guideFile() const
+{
+    return m_guideFile;
+}
+
+void EPGManager::setRefreshInterval(int minutes)
+{
+    if (minutes > 0)
+    {
+        m_refreshTimer.start(minutes * 60 * 1000);
+    }
+    else
+    {
+        m_refreshTimer.stop();
+    }
+}
+
+void EPGManager::setChannelFilter(const QSet<QString> &channelIds)
+{
+    if (channelIds == m_channelFilter)
+    {
+        return;
+    }
+
+    m_channelFilter = channelIds;
+
+    if (!m_guideFile.isEmpty() && !openCachedStore())
+    {
+        startLoad();
+    }
+}
+
+QSharedPointer<const EPGStore> EPGManager::store() const
+{
+    return m_store;
+}
+
+bool EPGManager::isLoading() const
+{
+    return m_loadWatcher.isRunning();
+}
+
+void EPGManager::refresh()
+{
+    if (m_guideFile.isEmpty())
+    {
+        return;
+    }
+
+    // Guides are large; only parse again when the file actually changed
+    QFileInfo info(m_guideFile);
+    if (m_store && m_store->sourceModified() == info.lastModified().toMSecsSinceEpoch())
+    {
+        return;
+    }
+
+    startLoad();
+}
+
+void EPGManager::reload()
+{
+    if (m_guideFile.isEmpty())
+    {
+        return;
+    }
+
+    startLoad();
+}
+
+QString EPGManager::storePath() const
+{
+    // One store per guide file, version of it and lineup, so switching any of them never
+    // serves stale data, and a refreshed guide never has to replace a store that is still
+    // mapped, which Windows refuses
+    QStringList channelIds(m_channelFilter.constBegin(), m_channelFilter.constEnd());
+    std::sort(channelIds.begin(), channelIds.end());
+
+    QFileInfo info(m_guideFile);
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(info.absoluteFilePath().toUtf8());
+    hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    hash.addData(channelIds.join('\n').toUtf8());
+
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/epg";
+    return cacheDir + "/guide-" + QString::fromLatin1(hash.result().toHex().left(16)) + ".epg";
+}
+
+bool EPGManager::openCachedStore()
+{
+    QFileInfo info(m_guideFile);
+    if (!info.exists())
+    {
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QSharedPointer<EPGStore> store(new EPGStore());
+    if (!store->open(storePath()) || store->sourceModified() != info.lastModified().toMSecsSinceEpoch())
+    {
+        return false;
+    }
+
+    qDebug() << "Mapped cached programme guide:" << store->programmeCount() << "programmes for"
+             << store->channelCount() << "channels in" << timer.nsecsElapsed() / 1000 << "us";
+
+    m_store = store;
+    emit guideUpdated();
+    return true;
+}
+
+void EPGManager::startLoad()
+{
+    if (m_loadWatcher.isRunning())
+    {
+        m_loadPending = true;
+        return;
+    }
+
+    // The mapped store was built from this very version of the guide and could not be
+    // replaced while mapped anyway
+    const QString path = storePath();
+    if (m_store && m_store->filePath() == path)
+    {
+        return;
+    }
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    m_loadWatcher.setFuture(QtConcurrent::run(&EPGManager::loadGuide, m_guideFile, m_channelFilter, path));
+}
+
+void EPGManager::onLoadFinished()
+{
+    LoadResult result = m_loadWatcher.result();
+
+    if (m_loadPending)
+    {
+        m_loadPending = false;
+        startLoad();
+        return;
+    }
+
+    if (result.filePath != m_guideFile || result.channelFilter != m_channelFilter)
+    {
+        return;
+    }
+
+    if (!result.store)
+    {
+        qWarning() << "Error loading programme guide:" << result.error;
+        emit error(result.error);
+        return;
+    }
+
+    qDebug() << "Loaded programme guide:" << result.store->programmeCount() << "programmes for"
+             << result.store->channelCount() << "channels in" << result.elapsedMs << "ms";
+
+    m_store = result.store;
+    emit guideUpdated();
+
+    // The guide may have changed again since, so the path is the loaded store's own
+    removeOtherStores(m_store->filePath());
+}
+
+void EPGManager::removeOtherStores(const QString &keepPath)
+{
+    // Every lineup change writes a new store; only the current one is worth keeping.
+    // A store still mapped elsewhere may refuse to go and is retried on the next load.
+    QFileInfo keep(keepPath);
+    QDir cacheDir = keep.absoluteDir();
+    const QStringList stores = cacheDir.entryList({"guide-*.epg"}, QDir::Files);
+    for (const QString &name : stores)
+    {
+        if (name != keep.fileName() && !cacheDir.remove(name))
+        {
+            qDebug() << "Could not remove old programme guide store:" << name;
+        }
+    }
+}
+
+EPGManager::LoadResult EPGManager::loadGuide(const QString &filePath, const QSet<QString> &channelFilter, const QString &storePath)
+{
+    LoadResult result;
+    result.filePath = filePath;
+    result.channelFilter = channelFilter;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    qint64 modified = QFileInfo(filePath).lastModified().toMSecsSinceEpoch();
+
+    try
+    {
+        // The index only lives until the store is written
+        EPGIndex index;
+        XMLTVParser parser;
+        parser.setChannelFilter(channelFilter);
+        parser.parseFile(filePath, [&index](const QString &channelId, const ProgrammeData &programme)
+                         { index.addProgramme(channelId, programme); });
+        index.finalize();
+
+        if (!EPGStore::write(index, storePath, modified))
+        {
+            throw QString("Could not write programme guide store: %1").arg(storePath);
+        }
+    }
+    catch (const QString &error)
+    {
+        result.error = error;
+        result.elapsedMs = timer.elapsed();
+        return result;
+    }
+
+    QSharedPointer<EPGStore> store(new EPGStore());
+    if (store->open(storePath))
+    {
+        result.store = store;
+    }
+    else
+    {
+        result.error = QString("Could not open programme guide store: %1").arg(storePath);
+    }
+
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
\ No newline at end of file
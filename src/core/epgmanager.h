@@ -0,0 +1,157 @@
+#ifndef EPGMANAGER_H
+#define EPGMANAGER_H
+
+#include <QObject>
+#include <QString>
+#include <QSet>
+#include <QDateTime>
+#include <QTimer>
+#include <QSharedPointer>
+#include <QFutureWatcher>
+#include "epgindex.h"
+#include "epgstore.h"
+
+/**
+ * @brief The EPGManager class loads and refreshes the programme guide
+ *
+ * Guides are parsed on a worker thread into an EPGIndex, which is written to
+ * a memory-mapped EPGStore in the cache directory and then dropped. The new
+ * store replaces the current one atomically when complete; readers keep a
+ * shared pointer to the store they started with. On the next start the
+ * cached store is mapped directly if the guide file has not changed.
+ */
+class EPGManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor
+     * @param parent Parent object
+     */
+    explicit EPGManager(QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor
+     */
+    ~EPGManager();
+
+    /**
+     * @brief Set the XMLTV guide file and load it in the background
+     * @param filePath Path to the XMLTV file, empty to drop the guide
+     */
+    void setGuideFile(const QString &filePath);
+
+    /**
+     * @brief Get the XMLTV guide file
+     * @return Path to the XMLTV file
+     */
+    QString guideFile() const;
+
+    /**
+     * @brief Set the interval between background refreshes
+     * @param minutes Refresh interval in minutes, 0 to disable
+     */
+    void setRefreshInterval(int minutes);
+
+    /**
+     * @brief Restrict the guide to a set of channel ids
+     * @param channelIds Channel ids to keep, empty to keep all channels
+     */
+    void setChannelFilter(const QSet<QString> &channelIds);
+
+    /**
+     * @brief Get the current guide store
+     * @return Shared pointer to the store, null if no guide is loaded
+     */
+    QSharedPointer<const EPGStore> store() const;
+
+    /**
+     * @brief Check whether a refresh is running
+     * @return True if a guide is being parsed
+     */
+    bool isLoading() const;
+
+public slots:
+    /**
+     * @brief Reload the guide if the file changed since the last load
+     */
+    void refresh();
+
+    /**
+     * @brief Reload the guide unconditionally
+     */
+    void reload();
+
+signals:
+    /**
+     * @brief Signal emitted when a new guide index is available
+     */
+    void guideUpdated();
+
+    /**
+     * @brief Signal emitted when loading the guide fails
+     * @param message Error message
+     */
+    void error(const QString &message);
+
+private slots:
+    /**
+     * @brief Install the result of a background parse
+     */
+    void onLoadFinished();
+
+private:
+    /**
+     * @brief Result of a background guide parse
+     */
+    struct LoadResult
+    {
+        QString filePath;
+        QSet<QString> channelFilter;
+        QSharedPointer<EPGStore> store;
+        QString error;
+        qint64 elapsedMs = 0;
+    };
+
+    /**
+     * @brief Parse a guide file and write it to a store (thread-safe)
+     * @param filePath Path to the XMLTV file
+     * @param channelFilter Channel ids to keep
+     * @param storePath Path of the store file to write
+     * @return Load result
+     */
+    static LoadResult loadGuide(const QString &filePath, const QSet<QString> &channelFilter, const QString &storePath);
+
+    /**
+     * @brief Get the store file for the current guide file, its modification time and the channel filter
+     * @return Path in the cache directory
+     */
+    QString storePath() const;
+
+    /**
+     * @brief Map the cached store if it is up to date with the guide file
+     * @return True if the cached store was installed
+     */
+    bool openCachedStore();
+
+    /**
+     * @brief Delete the stores of other guide files and lineups from the cache directory
+     * @param keepPath Store to keep
+     */
+    static void removeOtherStores(const QString &keepPath);
+
+    /**
+     * @brief Start a background parse of the guide file
+     */
+    void startLoad();
+
+    QString m_guideFile;
+    QSet<QString> m_channelFilter;
+    QSharedPointer<const EPGStore> m_store;
+    QTimer m_refreshTimer;
+    QFutureWatcher<LoadResult> m_loadWatcher;
+    bool m_loadPending;
+};
+
+#endif // EPGMANAGER_H
\ No newline at end of file
@@ -0,0 +1,475 @@
+#include "epgstore.h"
+#include <QDebug>
+#include <QSaveFile>
+#include <QHash>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+static const char STORE_MAGIC[8] = {'H', 'T', 'V', 'E', 'P', 'G', '\0', '\0'};
+static const quint32 STORE_VERSION = 1;
+static const quint32 STORE_BYTE_ORDER = 0x01020304;
+static const quint32 NO_STRING = 0xFFFFFFFF;
+
+struct EPGStore::Header
+{
+    char magic[8];
+    quint32 version;
+    quint32 byteOrder;
+    quint32 channelCount;
+    quint32 programmeCount;
+    qint64 sourceModified;
+    quint64 channelTableOffset;
+    quint64 startOffset;
+    quint64 stopOffset;
+    quint64 channelColumnOffset;
+    quint64 titleOffset;
+    quint64 descriptionOffset;
+    quint64 poolOffset;
+    quint64 poolSize;
+};
+
+struct EPGStore::ChannelEntry
+{
+    quint32 idOffset;
+    quint32 first;
+    quint32 count;
+    quint32 reserved;
+};
+
+static quint64 align8(quint64 offset)
+{
+    return (offset + 7) & ~quint64(7);
+}
+
+/**
+ * @brief Builds the deduplicated string pool of a store
+ */
+class StringPoolBuilder
+{
+public:
+    quint32 add(const QString &text)
+    {
+        if (text.isEmpty())
+        {
+            return NO_STRING;
+        }
+
+        QByteArray utf8 = text.toUtf8();
+        auto it = m_offsets.constFind(utf8);
+        if (it != m_offsets.constEnd())
+        {
+            return it.value();
+        }
+
+        quint32 offset = static_cast<quint32>(m_pool.size());
+        quint32 length = static_cast<quint32>(utf8.size());
+        m_pool.append(reinterpret_cast<const char *>(&length), sizeof(length));
+        m_pool.append(utf8);
+        m_offsets.insert(utf8, offset);
+        return offset;
+    }
+
+    const QByteArray &data() const
+    {
+        return m_pool;
+    }
+
+private:
+    QByteArray m_pool;
+    QHash<QByteArray, quint32> m_offsets;
+};
+
+// Pad the file with zeros up to an absolute offset, then write a block
+static bool writeBlock(QSaveFile &file, quint64 offset, const void *data, qint64 size)
+{
+    static const char zeros[8] = {};
+    while (static_cast<quint64>(file.pos()) < offset)
+    {
+        qint64 padding = qMin<qint64>(sizeof(zeros), offset - file.pos());
+        if (file.write(zeros, padding) != padding)
+        {
+            return false;
+        }
+    }
+
+    return size == 0 || file.write(static_cast<const char *>(data), size) == size;
+}
+
+EPGStore::EPGStore()
+    : m_data(nullptr), m_size(0), m_header(nullptr), m_channels(nullptr), m_starts(nullptr), m_stops(nullptr), m_titles(nullptr), m_descriptions(nullptr), m_pool(nullptr)
+{
+}
+
+EPGStore::~EPGStore()
+{
+    close();
+}
+
+bool EPGStore::write(const EPGIndex &index, const QString &filePath, qint64 sourceModified)
+{
+    static_assert(sizeof(Header) == 88, "EPG store header layout changed");
+    static_assert(sizeof(ChannelEntry) == 16, "EPG store channel entry layout changed");
+
+    // Channel table entries are sorted by UTF-8 id so lookups can binary search raw bytes
+    QStringList channelIds = index.channelIds();
+    std::sort(channelIds.begin(), channelIds.end(), [](const QString &a, const QString &b)
+              { return a.toUtf8() < b.toUtf8(); });
+
+    StringPoolBuilder pool;
+    QVector<ChannelEntry> channels;
+    QVector<qint64> starts;
+    QVector<qint64> stops;
+    QVector<quint32> channelColumn;
+    QVector<quint32> titles;
+    QVector<quint32> descriptions;
+
+    channels.reserve(channelIds.size());
+    starts.reserve(index.programmeCount());
+    stops.reserve(index.programmeCount());
+    channelColumn.reserve(index.programmeCount());
+    titles.reserve(index.programmeCount());
+    descriptions.reserve(index.programmeCount());
+
+    for (int i = 0; i < channelIds.size(); ++i)
+    {
+        const QVector<ProgrammeData> programmes = index.programmes(channelIds[i]);
+
+        ChannelEntry entry;
+        entry.idOffset = pool.add(channelIds[i]);
+        entry.first = static_cast<quint32>(starts.size());
+        entry.count = static_cast<quint32>(programmes.size());
+        entry.reserved = 0;
+        channels.append(entry);
+
+        for (const ProgrammeData &programme : programmes)
+        {
+            starts.append(programme.start);
+            stops.append(programme.stop);
+            channelColumn.append(static_cast<quint32>(i));
+            titles.append(pool.add(programme.title));
+            descriptions.append(pool.add(programme.description));
+        }
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, STORE_MAGIC, sizeof(header.magic));
+    header.version = STORE_VERSION;
+    header.byteOrder = STORE_BYTE_ORDER;
+    header.channelCount = static_cast<quint32>(channels.size());
+    header.programmeCount = static_cast<quint32>(starts.size());
+    header.sourceModified = sourceModified;
+
+    quint64 offset = sizeof(Header);
+    auto place = [&offset](quint64 size)
+    {
+        offset = align8(offset);
+        quint64 at = offset;
+        offset += size;
+        return at;
+    };
+
+    header.channelTableOffset = place(channels.size() * sizeof(ChannelEntry));
+    header.startOffset = place(starts.size() * sizeof(qint64));
+    header.stopOffset = place(stops.size() * sizeof(qint64));
+    header.channelColumnOffset = place(channelColumn.size() * sizeof(quint32));
+    header.titleOffset = place(titles.size() * sizeof(quint32));
+    header.descriptionOffset = place(descriptions.size() * sizeof(quint32));
+    header.poolOffset = place(pool.data().size());
+    header.poolSize = pool.data().size();
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Could not write programme guide store:" << filePath << file.errorString();
+        return false;
+    }
+
+    bool ok = writeBlock(file, 0, &header, sizeof(header)) &&
+              writeBlock(file, header.channelTableOffset, channels.constData(), channels.size() * sizeof(ChannelEntry)) &&
+              writeBlock(file, header.startOffset, starts.constData(), starts.size() * sizeof(qint64)) &&
+              writeBlock(file, header.stopOffset, stops.constData(), stops.size() * sizeof(qint64)) &&
+              writeBlock(file, header.channelColumnOffset, channelColumn.constData(), channelColumn.size() * sizeof(quint32)) &&
+              writeBlock(file, header.titleOffset, titles.constData(), titles.size() * sizeof(quint32)) &&
+              writeBlock(file, header.descriptionOffset, descriptions.constData(), descriptions.size() * sizeof(quint32)) &&
+              writeBlock(file, header.poolOffset, pool.data().constData(), pool.data().size());
+
+    if (!ok)
+    {
+        qWarning() << "Could not write programme guide store:" << filePath << file.errorString();
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
+}
+
+bool EPGStore::open(const QString &filePath)
+{
+    close();
+
+    m_file.setFileName(filePath);
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    m_size = m_file.size();
+    if (m_size < static_cast<qint64>(sizeof(Header)))
+    {
+        close();
+        return false;
+    }
+
+    m_data = m_file.map(0, m_size);
+    if (!m_data)
+    {
+        qWarning() << "Could not map programme guide store:" << filePath << m_file.errorString();
+        close();
+        return false;
+    }
+
+    const Header *header = reinterpret_cast<const Header *>(m_data);
+    if (std::memcmp(header->magic, STORE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != STORE_VERSION || header->byteOrder != STORE_BYTE_ORDER)
+    {
+        qWarning() << "Unsupported programme guide store:" << filePath;
+        close();
+        return false;
+    }
+
+    // Every section must be aligned and lie inside the file
+    const quint64 size = static_cast<quint64>(m_size);
+    auto fits = [size](quint64 offset, quint64 bytes)
+    {
+        return offset % 8 == 0 && offset <= size && bytes <= size - offset;
+    };
+
+    const quint64 channels = header->channelCount;
+    const quint64 programmes = header->programmeCount;
+    if (!fits(header->channelTableOffset, channels * sizeof(ChannelEntry)) ||
+        !fits(header->startOffset, programmes * sizeof(qint64)) ||
+        !fits(header->stopOffset, programmes * sizeof(qint64)) ||
+        !fits(header->channelColumnOffset, programmes * sizeof(quint32)) ||
+        !fits(header->titleOffset, programmes * sizeof(quint32)) ||
+        !fits(header->descriptionOffset, programmes * sizeof(quint32)) ||
+        !fits(header->poolOffset, header->poolSize))
+    {
+        qWarning() << "Corrupt programme guide store:" << filePath;
+        close();
+        return false;
+    }
+
+    m_header = header;
+    m_channels = reinterpret_cast<const ChannelEntry *>(m_data + header->channelTableOffset);
+    m_starts = reinterpret_cast<const qint64 *>(m_data + header->startOffset);
+    m_stops = reinterpret_cast<const qint64 *>(m_data + header->stopOffset);
+    m_titles = reinterpret_cast<const quint32 *>(m_data + header->titleOffset);
+    m_descriptions = reinterpret_cast<const quint32 *>(m_data + header->descriptionOffset);
+    m_pool = reinterpret_cast<const char *>(m_data + header->poolOffset);
+
+    for (quint32 i = 0; i < header->channelCount; ++i)
+    {
+        if (quint64(m_channels[i].first) + m_channels[i].count > programmes)
+        {
+            qWarning() << "Corrupt programme guide store:" << filePath;
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool EPGStore::isOpen() const
+{
+    return m_header != nullptr;
+}
+
+QString EPGStore::filePath() const
+{
+    return m_file.fileName();
+}
+
+qint64 EPGStore::sourceModified() const
+{
+    return m_header ? m_header->sourceModified : 0;
+}
+
+int EPGStore::channelCount() const
+{
+    return m_header ? static_cast<int>(m_header->channelCount) : 0;
+}
+
+int EPGStore::programmeCount() const
+{
+    return m_header ? static_cast<int>(m_header->programmeCount) : 0;
+}
+
+bool EPGStore::programmeAt(const QString &channelId, qint64 time, ProgrammeData *programme) const
+{
+    const ChannelEntry *entry = findChannel(channelId);
+    if (!entry)
+    {
+        return false;
+    }
+
+    // Stops are monotonic within a channel, so find the first programme ending after time
+    const qint64 *begin = m_stops + entry->first;
+    const qint64 *end = begin + entry->count;
+    const qint64 *pos = std::upper_bound(begin, end, time);
+    if (pos == end)
+    {
+        return false;
+    }
+
+    quint32 row = static_cast<quint32>(pos - m_stops);
+    if (m_starts[row] > time)
+    {
+        return false;
+    }
+
+    if (programme)
+    {
+        *programme = this->programme(row);
+    }
+    return true;
+}
+
+bool EPGStore::nextProgramme(const QString &channelId, qint64 time, ProgrammeData *programme) const
+{
+    const ChannelEntry *entry = findChannel(channelId);
+    if (!entry)
+    {
+        return false;
+    }
+
+    const qint64 *begin = m_starts + entry->first;
+    const qint64 *end = begin + entry->count;
+    const qint64 *pos = std::upper_bound(begin, end, time);
+    if (pos == end)
+    {
+        return false;
+    }
+
+    if (programme)
+    {
+        *programme = this->programme(static_cast<quint32>(pos - m_starts));
+    }
+    return true;
+}
+
+QVector<ProgrammeData> EPGStore::programmesBetween(const QString &channelId, qint64 from, qint64 to) const
+{
+    QVector<ProgrammeData> result;
+
+    const ChannelEntry *entry = findChannel(channelId);
+    if (!entry || to <= from)
+    {
+        return result;
+    }
+
+    const qint64 *stops = m_stops + entry->first;
+    const qint64 *starts = m_starts + entry->first;
+    quint32 first = static_cast<quint32>(std::upper_bound(stops, stops + entry->count, from) - stops);
+    quint32 last = static_cast<quint32>(std::lower_bound(starts, starts + entry->count, to) - starts);
+
+    for (quint32 i = first; i < last; ++i)
+    {
+        result.append(programme(entry->first + i));
+    }
+
+    return result;
+}
+
+const EPGStore::ChannelEntry *EPGStore::findChannel(const QString &channelId) const
+{
+    if (!m_header || channelId.isEmpty())
+    {
+        return nullptr;
+    }
+
+    const QByteArray id = channelId.toUtf8();
+    const ChannelEntry *begin = m_channels;
+    const ChannelEntry *end = m_channels + m_header->channelCount;
+
+    // Compare a channel's pooled id with the wanted id as raw bytes
+    auto compare = [this, &id](const ChannelEntry &entry)
+    {
+        const quint64 poolSize = m_header->poolSize;
+        if (entry.idOffset == NO_STRING || quint64(entry.idOffset) + sizeof(quint32) > poolSize)
+        {
+            return -1;
+        }
+
+        quint32 length = qFromUnaligned<quint32>(m_pool + entry.idOffset);
+        if (quint64(entry.idOffset) + sizeof(quint32) + length > poolSize)
+        {
+            return -1;
+        }
+
+        int common = static_cast<int>(qMin<qsizetype>(length, id.size()));
+        int result = std::memcmp(m_pool + entry.idOffset + sizeof(quint32), id.constData(), common);
+        if (result != 0)
+        {
+            return result;
+        }
+        return static_cast<int>(length) - static_cast<int>(id.size());
+    };
+
+    const ChannelEntry *pos = std::lower_bound(begin, end, id, [&compare](const ChannelEntry &entry, const QByteArray &)
+                                               { return compare(entry) < 0; });
+
+    if (pos != end && compare(*pos) == 0)
+    {
+        return pos;
+    }
+
+    return nullptr;
+}
+
+QString EPGStore::poolString(quint32 offset) const
+{
+    if (offset == NO_STRING || quint64(offset) + sizeof(quint32) > m_header->poolSize)
+    {
+        return QString();
+    }
+
+    quint32 length = qFromUnaligned<quint32>(m_pool + offset);
+    if (quint64(offset) + sizeof(quint32) + length > m_header->poolSize)
+    {
+        return QString();
+    }
+
+    return QString::fromUtf8(m_pool + offset + sizeof(quint32), length);
+}
+
+ProgrammeData EPGStore::programme(quint32 row) const
+{
+    ProgrammeData programme;
+    programme.start = m_starts[row];
+    programme.stop = m_stops[row];
+    programme.title = poolString(m_titles[row]);
+    programme.description = poolString(m_descriptions[row]);
+    return programme;
+}
+
+void EPGStore::close()
+{
+    if (m_data)
+    {
+        m_file.unmap(const_cast<uchar *>(m_data));
+    }
+
+    m_file.close();
+    m_data = nullptr;
+    m_size = 0;
+    m_header = nullptr;
+    m_channels = nullptr;
+    m_starts = nullptr;
+    m_stops = nullptr;
+    m_titles = nullptr;
+    m_descriptions = nullptr;
+    m_pool = nullptr;
+}
\ No newline at end of file
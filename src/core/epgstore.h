@@ -0,0 +1,151 @@
+#ifndef EPGSTORE_H
+#define EPGSTORE_H
+
+#include <QString>
+#include <QVector>
+#include <QFile>
+#include <QByteArray>
+#include "epgindex.h"
+
+/**
+ * @brief The EPGStore class is a memory-mapped, read-only programme guide
+ *
+ * The on-disk layout is columnar: start, stop and channel columns hold one
+ * entry per programme, grouped by channel and sorted by start time, while
+ * titles and descriptions are offsets into a deduplicated UTF-8 string pool.
+ * A channel table sorted by id gives each channel's run of programmes, so a
+ * query maps the file and binary-searches it without deserialising anything
+ * except the strings it returns.
+ *
+ * Stores are written with write() through QSaveFile, so a store is replaced
+ * atomically and readers that still map the old file are unaffected.
+ */
+class EPGStore
+{
+public:
+    /**
+     * @brief Constructor
+     */
+    EPGStore();
+
+    /**
+     * @brief Destructor
+     */
+    ~EPGStore();
+
+    /**
+     * @brief Write a guide index to a store file
+     * @param index Finalized guide index
+     * @param filePath Path to the store file
+     * @param sourceModified Modification time of the source guide, in ms since the epoch
+     * @return True if successful, false otherwise
+     */
+    static bool write(const EPGIndex &index, const QString &filePath, qint64 sourceModified);
+
+    /**
+     * @brief Map a store file
+     * @param filePath Path to the store file
+     * @return True if the file is a valid store, false otherwise
+     */
+    bool open(const QString &filePath);
+
+    /**
+     * @brief Check whether a store is mapped
+     * @return True if open
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Get the path of the mapped store
+     * @return Store file path
+     */
+    QString filePath() const;
+
+    /**
+     * @brief Get the modification time of the guide the store was built from
+     * @return Milliseconds since the epoch
+     */
+    qint64 sourceModified() const;
+
+    /**
+     * @brief Get the number of channels with guide data
+     * @return Number of channels
+     */
+    int channelCount() const;
+
+    /**
+     * @brief Get the total number of programmes
+     * @return Number of programmes
+     */
+    int programmeCount() const;
+
+    /**
+     * @brief Get the programme airing on a channel at a given time
+     * @param channelId XMLTV channel id
+     * @param time Seconds since the Unix epoch
+     * @param programme Filled with the programme if found
+     * @return True if a programme is airing
+     */
+    bool programmeAt(const QString &channelId, qint64 time, ProgrammeData *programme) const;
+
+    /**
+     * @brief Get the first programme on a channel starting after a given time
+     * @param channelId XMLTV channel id
+     * @param time Seconds since the Unix epoch
+     * @param programme Filled with the programme if found
+     * @return True if there is a next programme
+     */
+    bool nextProgramme(const QString &channelId, qint64 time, ProgrammeData *programme) const;
+
+    /**
+     * @brief Get all programmes on a channel that overlap a time range
+     * @param channelId XMLTV channel id
+     * @param from Range start in seconds since the Unix epoch
+     * @param to Range end in seconds since the Unix epoch
+     * @return Programmes overlapping [from, to), in start order
+     */
+    QVector<ProgrammeData> programmesBetween(const QString &channelId, qint64 from, qint64 to) const;
+
+private:
+    struct Header;
+    struct ChannelEntry;
+
+    /**
+     * @brief Find the channel table entry for a channel id
+     * @param channelId XMLTV channel id
+     * @return Pointer to the entry, or nullptr if the channel is not in the store
+     */
+    const ChannelEntry *findChannel(const QString &channelId) const;
+
+    /**
+     * @brief Read a string from the string pool
+     * @param offset Pool offset
+     * @return Decoded string
+     */
+    QString poolString(quint32 offset) const;
+
+    /**
+     * @brief Materialize one programme row
+     * @param row Programme row
+     * @return Programme data
+     */
+    ProgrammeData programme(quint32 row) const;
+
+    /**
+     * @brief Drop the current mapping
+     */
+    void close();
+
+    QFile m_file;
+    const uchar *m_data;
+    qint64 m_size;
+    const Header *m_header;
+    const ChannelEntry *m_channels;
+    const qint64 *m_starts;
+    const qint64 *m_stops;
+    const quint32 *m_titles;
+    const quint32 *m_descriptions;
+    const char *m_pool;
+};
+
+#endif // EPGSTORE_H
\ No newline at end of file
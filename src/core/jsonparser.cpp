@@ -1,7 +1,7 @@
 #include "jsonparser.h"
 #include <QFile>
+#include <QSaveFile>
 #include <QJsonParseError>
-#include <QTextStream>
 
 JSONParser::JSONParser()
 {
@@ -10,22 +10,26 @@ JSONParser::JSONParser()
 QList<ChannelData> JSONParser::parseFile(const QString &filePath)
 {
     QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    if (!file.open(QIODevice::ReadOnly))
     {
         throw QString("Could not open file: %1").arg(filePath);
     }
 
-    QTextStream in(&file);
-    QString jsonString = in.readAll();
+    QByteArray data = file.readAll();
     file.close();
 
-    return parseString(jsonString);
+    return parseData(data);
 }
 
 QList<ChannelData> JSONParser::parseString(const QString &jsonString)
+{
+    return parseData(jsonString.toUtf8());
+}
+
+QList<ChannelData> JSONParser::parseData(const QByteArray &data)
 {
     QJsonParseError error;
-    QJsonDocument doc = QJsonDocument::fromJson(jsonString.toUtf8(), &error);
+    QJsonDocument doc = QJsonDocument::fromJson(data, &error);
 
     if (error.error != QJsonParseError::NoError)
     {
@@ -68,24 +72,55 @@ bool JSONParser::isValidChannel(const QJsonObject &obj)
            obj["name"].isString() && obj["url"].isString();
 }
 
-bool JSONParser::saveToFile(const QList<ChannelData> &channels, const QString &filePath)
+bool JSONParser::saveToFile(const QList<ChannelData> &channels, const QString &filePath, QCryptographicHash *hash)
 {
-    QJsonArray array;
-    for (const ChannelData &channel : channels)
+    QSaveFile file(filePath);
+
+    if (!file.open(QIODevice::WriteOnly))
     {
-        array.append(channel.toJson());
+        return false;
     }
 
-    QJsonDocument doc(array);
-    QFile file(filePath);
-
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    if (!writeChannels(channels, &file, hash))
     {
+        file.cancelWriting();
         return false;
     }
 
-    file.write(doc.toJson(QJsonDocument::Indented));
-    file.close();
+    return file.commit();
+}
+
+bool JSONParser::writeChannels(const QList<ChannelData> &channels, QIODevice *device, QCryptographicHash *hash)
+{
+    // Serialize one object at a time into a bounded buffer instead of building a whole document
+    static const int FLUSH_SIZE = 64 * 1024;
+
+    QByteArray buffer;
+    buffer.reserve(FLUSH_SIZE + 1024);
+    buffer.append('[');
+
+    auto flush = [device, hash, &buffer]()
+    {
+        if (hash)
+        {
+            hash->addData(buffer);
+        }
+        bool ok = device->write(buffer) == buffer.size();
+        buffer.clear();
+        return ok;
+    };
+
+    for (int i = 0; i < channels.size(); ++i)
+    {
+        buffer.append(i == 0 ? "\n" : ",\n");
+        buffer.append(QJsonDocument(channels[i].toJson()).toJson(QJsonDocument::Compact));
+
+        if (buffer.size() >= FLUSH_SIZE && !flush())
+        {
+            return false;
+        }
+    }
 
-    return true;
+    buffer.append("\n]\n");
+    return flush();
 }
\ No newline at end of file
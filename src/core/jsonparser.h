@@ -6,6 +6,8 @@
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QJsonObject>
+#include <QIODevice>
+#include <QCryptographicHash>
 #include "../data/channeldata.h"
 
 /**
@@ -35,13 +37,35 @@ public:
      */
     QList<ChannelData> parseString(const QString &jsonString);
 
+    /**
+     * @brief Parse channels from raw UTF-8 JSON data
+     * @param data JSON data
+     * @return List of channel data
+     * @throws QString error message if parsing fails
+     */
+    QList<ChannelData> parseData(const QByteArray &data);
+
     /**
      * @brief Save channels to a JSON file
+     *
+     * The file is written through QSaveFile, so it is replaced atomically
+     * and a crash mid-write leaves the previous version intact.
+     *
      * @param channels List of channel data
      * @param filePath Path to the JSON file
+     * @param hash Optional hash fed with the bytes written
+     * @return True if successful, false otherwise
+     */
+    bool saveToFile(const QList<ChannelData> &channels, const QString &filePath, QCryptographicHash *hash = nullptr);
+
+    /**
+     * @brief Stream channels as a compact JSON array, one channel per line
+     * @param channels List of channel data
+     * @param device Device to write to
+     * @param hash Optional hash fed with the bytes written
      * @return True if successful, false otherwise
      */
-    bool saveToFile(const QList<ChannelData> &channels, const QString &filePath);
+    bool writeChannels(const QList<ChannelData> &channels, QIODevice *device, QCryptographicHash *hash = nullptr);
 
 private:
     /**
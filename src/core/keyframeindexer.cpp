@@ -0,0 +1,999 @@
+#include "keyframeindexer.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QCryptographicHash>
+#include <QtEndian>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+
+static const quint32 INDEX_MAGIC = 0x48544B46; // "HTKF"
+static const quint32 INDEX_VERSION = 2;
+static const qint64 MAX_HEADER_SIZE = 256 * 1024 * 1024;
+
+// Matroska element ids
+static const quint64 EBML_HEADER = 0x1A45DFA3;
+static const quint64 MKV_SEGMENT = 0x18538067;
+static const quint64 MKV_SEEK_HEAD = 0x114D9B74;
+static const quint64 MKV_SEEK = 0x4DBB;
+static const quint64 MKV_SEEK_ID = 0x53AB;
+static const quint64 MKV_SEEK_POSITION = 0x53AC;
+static const quint64 MKV_INFO = 0x1549A966;
+static const quint64 MKV_TIMESTAMP_SCALE = 0x2AD7B1;
+static const quint64 MKV_TRACKS = 0x1654AE6B;
+static const quint64 MKV_TRACK_ENTRY = 0xAE;
+static const quint64 MKV_TRACK_NUMBER = 0xD7;
+static const quint64 MKV_TRACK_TYPE = 0x83;
+static const quint64 MKV_CUES = 0x1C53BB6B;
+static const quint64 MKV_CUE_POINT = 0xBB;
+static const quint64 MKV_CUE_TIME = 0xB3;
+static const quint64 MKV_CUE_TRACK_POSITIONS = 0xB7;
+static const quint64 MKV_CUE_TRACK = 0xF7;
+static const quint64 MKV_CUE_CLUSTER_POSITION = 0xF1;
+static const quint64 MKV_CLUSTER = 0x1F43B675;
+
+/**
+ * @brief A byte range within a buffer
+ */
+struct ByteRange
+{
+    qint64 begin = 0;
+    qint64 end = 0;
+};
+
+static quint32 boxType(const char *code)
+{
+    return qFromBigEndian<quint32>(code);
+}
+
+static quint32 readU32(const QByteArray &data, qint64 offset)
+{
+    if (offset < 0 || offset + 4 > data.size())
+    {
+        throw QString("Truncated MP4 table");
+    }
+    return qFromBigEndian<quint32>(data.constData() + offset);
+}
+
+static quint64 readU64(const QByteArray &data, qint64 offset)
+{
+    if (offset < 0 || offset + 8 > data.size())
+    {
+        throw QString("Truncated MP4 table");
+    }
+    return qFromBigEndian<quint64>(data.constData() + offset);
+}
+
+/**
+ * @brief Step to the next MP4 box within a range
+ * @param data Buffer holding the boxes
+ * @param pos Position of the next box, advanced past it
+ * @param end End of the range
+ * @param type Set to the box type
+ * @param body Set to the box body
+ * @return False at the end of the range
+ */
+static bool nextBox(const QByteArray &data, qint64 *pos, qint64 end, quint32 *type, ByteRange *body)
+{
+    if (*pos + 8 > end)
+    {
+        return false;
+    }
+
+    quint64 size = readU32(data, *pos);
+    *type = readU32(data, *pos + 4);
+    qint64 header = 8;
+
+    if (size == 1)
+    {
+        size = readU64(data, *pos + 8);
+        header = 16;
+    }
+    else if (size == 0)
+    {
+        size = end - *pos;
+    }
+
+    if (size < static_cast<quint64>(header) || size > static_cast<quint64>(end - *pos))
+    {
+        throw QString("Truncated MP4 box");
+    }
+
+    body->begin = *pos + header;
+    body->end = *pos + static_cast<qint64>(size);
+    *pos = body->end;
+    return true;
+}
+
+/**
+ * @brief Find the first child box of a type
+ * @param data Buffer holding the boxes
+ * @param parent Body of the parent box
+ * @param type Box type
+ * @param body Set to the body of the child
+ * @return True if found
+ */
+static bool findBox(const QByteArray &data, const ByteRange &parent, const char *type, ByteRange *body)
+{
+    qint64 pos = parent.begin;
+    quint32 childType = 0;
+    while (nextBox(data, &pos, parent.end, &childType, body))
+    {
+        if (childType == boxType(type))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Get the entry count of a full box table and check it fits
+ * @param data Buffer holding the box
+ * @param body Body of the box
+ * @param header Bytes before the entry count, after version and flags
+ * @param entrySize Size of an entry
+ * @return Entry count
+ */
+static quint32 tableCount(const QByteArray &data, const ByteRange &body, qint64 header, qint64 entrySize)
+{
+    quint32 count = readU32(data, body.begin + 4 + header);
+    if (body.begin + 8 + header + static_cast<qint64>(count) * entrySize > body.end)
+    {
+        throw QString("Truncated MP4 table");
+    }
+    return count;
+}
+
+/**
+ * @brief Get the shift an MP4 edit list applies to the media times of a track
+ *
+ * Only the common lists are supported: optional empty edits that delay the
+ * track, then one edit played at normal rate. Anything else throws, so the
+ * file goes unindexed rather than indexed at the wrong times.
+ * @param data Buffer holding the box
+ * @param body Body of the elst box
+ * @param movieTimescale Timescale of the edit durations
+ * @param mediaTimescale Timescale of the media times
+ * @return Seconds to add to media times
+ */
+static double editListShift(const QByteArray &data, const ByteRange &body, quint32 movieTimescale, quint32 mediaTimescale)
+{
+    const bool version1 = static_cast<uchar>(data[body.begin]) == 1;
+    const qint64 entrySize = version1 ? 20 : 12;
+    const quint32 count = tableCount(data, body, 0, entrySize);
+
+    double delay = 0.0;
+    double shift = 0.0;
+    bool hasEdit = false;
+    for (quint32 i = 0; i < count; ++i)
+    {
+        const qint64 entry = body.begin + 8 + i * entrySize;
+        const quint64 duration = version1 ? readU64(data, entry) : readU32(data, entry);
+        const qint64 mediaTime = version1 ? static_cast<qint64>(readU64(data, entry + 8))
+                                          : static_cast<qint32>(readU32(data, entry + 4));
+        const quint32 rate = readU32(data, entry + (version1 ? 16 : 8));
+
+        if (mediaTime == -1 && !hasEdit)
+        {
+            if (movieTimescale == 0)
+            {
+                throw QString("Invalid MP4 movie timescale");
+            }
+            delay += static_cast<double>(duration) / movieTimescale;
+            continue;
+        }
+
+        if (hasEdit || mediaTime < 0 || rate != 0x00010000)
+        {
+            throw QString("Unsupported MP4 edit list");
+        }
+        hasEdit = true;
+        shift = delay - static_cast<double>(mediaTime) / mediaTimescale;
+    }
+
+    return hasEdit ? shift : delay;
+}
+
+/**
+ * @brief Read a Matroska variable-length integer
+ * @param p Data
+ * @param available Bytes available
+ * @param keepMarker True for element ids, which keep their length marker
+ * @param value Set to the value
+ * @param length Set to the encoded length
+ * @return False if the integer is invalid or truncated
+ */
+static bool readVint(const uchar *p, qint64 available, bool keepMarker, quint64 *value, int *length)
+{
+    if (available < 1 || p[0] == 0)
+    {
+        return false;
+    }
+
+    int len = 1;
+    uchar mask = 0x80;
+    while (!(p[0] & mask))
+    {
+        mask >>= 1;
+        ++len;
+    }
+
+    if (len > available)
+    {
+        return false;
+    }
+
+    quint64 result = keepMarker ? p[0] : (p[0] & (mask - 1));
+    for (int i = 1; i < len; ++i)
+    {
+        result = (result << 8) | p[i];
+    }
+
+    *value = result;
+    *length = len;
+    return true;
+}
+
+/**
+ * @brief Read a Matroska element header
+ * @param p Data
+ * @param available Bytes available
+ * @param id Set to the element id
+ * @param size Set to the body size, -1 if unknown
+ * @return Header length, 0 if invalid
+ */
+static int readElementHeader(const uchar *p, qint64 available, quint64 *id, qint64 *size)
+{
+    quint64 rawSize = 0;
+    int idLength = 0;
+    int sizeLength = 0;
+
+    if (!readVint(p, available, true, id, &idLength) || idLength > 4 ||
+        !readVint(p + idLength, available - idLength, false, &rawSize, &sizeLength))
+    {
+        return 0;
+    }
+
+    const quint64 unknown = (quint64(1) << (7 * sizeLength)) - 1;
+    *size = rawSize == unknown ? -1 : static_cast<qint64>(rawSize);
+    return idLength + sizeLength;
+}
+
+/**
+ * @brief Step to the next Matroska element within a range
+ * @param data Buffer holding the elements
+ * @param pos Position of the next element, advanced past it
+ * @param end End of the range
+ * @param id Set to the element id
+ * @param body Set to the element body
+ * @return False at the end of the range
+ */
+static bool nextElement(const QByteArray &data, qint64 *pos, qint64 end, quint64 *id, ByteRange *body)
+{
+    if (*pos >= end)
+    {
+        return false;
+    }
+
+    qint64 size = 0;
+    int header = readElementHeader(reinterpret_cast<const uchar *>(data.constData()) + *pos, end - *pos, id, &size);
+    if (header == 0)
+    {
+        throw QString("Invalid Matroska element");
+    }
+
+    body->begin = *pos + header;
+    body->end = size < 0 ? end : body->begin + size;
+    if (body->end > end)
+    {
+        throw QString("Truncated Matroska element");
+    }
+
+    *pos = body->end;
+    return true;
+}
+
+static quint64 readUInt(const QByteArray &data, const ByteRange &body)
+{
+    quint64 value = 0;
+    for (qint64 i = body.begin; i < body.end && i < body.begin + 8; ++i)
+    {
+        value = (value << 8) | static_cast<uchar>(data[i]);
+    }
+    return value;
+}
+
+KeyframeIndexer::KeyframeIndexer(QObject *parent)
+    : QObject(parent), m_ready(false), m_scanPending(false)
+{
+    // One file at a time, behind everything the player is doing
+    m_pool.setMaxThreadCount(1);
+    m_pool.setThreadPriority(QThread::LowestPriority);
+
+    connect(&m_scanWatcher, &QFutureWatcher<ScanResult>::finished, this, &KeyframeIndexer::onScanFinished);
+}
+
+KeyframeIndexer::~KeyframeIndexer()
+{
+    m_scanWatcher.waitForFinished();
+}
+
+void KeyframeIndexer::setCacheDirectory(const QString &directory)
+{
+    m_cacheDirectory = directory;
+}
+
+void KeyframeIndexer::index(const QString &filePath)
+{
+    if (filePath == m_filePath)
+    {
+        return;
+    }
+
+    m_filePath = filePath;
+    m_keyframes.clear();
+    m_ready = false;
+
+    if (!m_filePath.isEmpty())
+    {
+        startScan();
+    }
+}
+
+void KeyframeIndexer::clear()
+{
+    m_filePath.clear();
+    m_keyframes.clear();
+    m_ready = false;
+}
+
+bool KeyframeIndexer::isReady() const
+{
+    return m_ready;
+}
+
+int KeyframeIndexer::keyframeCount() const
+{
+    return m_keyframes.size();
+}
+
+double KeyframeIndexer::snap(double position) const
+{
+    if (m_keyframes.isEmpty())
+    {
+        return position;
+    }
+
+    auto it = std::lower_bound(m_keyframes.constBegin(), m_keyframes.constEnd(), position, [](const Keyframe &keyframe, double time)
+                               { return keyframe.time < time; });
+
+    if (it == m_keyframes.constEnd())
+    {
+        return m_keyframes.constLast().time;
+    }
+    if (it != m_keyframes.constBegin() && position - (it - 1)->time < it->time - position)
+    {
+        --it;
+    }
+    return it->time;
+}
+
+KeyframeIndexer::Keyframe KeyframeIndexer::keyframeBefore(double position) const
+{
+    auto it = std::upper_bound(m_keyframes.constBegin(), m_keyframes.constEnd(), position, [](double time, const Keyframe &keyframe)
+                               { return time < keyframe.time; });
+
+    if (it == m_keyframes.constBegin())
+    {
+        return Keyframe();
+    }
+    return *(it - 1);
+}
+
+void KeyframeIndexer::startScan()
+{
+    if (m_scanWatcher.isRunning())
+    {
+        m_scanPending = true;
+        return;
+    }
+
+    m_scanWatcher.setFuture(QtConcurrent::run(&m_pool, &KeyframeIndexer::scanFile, m_filePath, m_cacheDirectory));
+}
+
+void KeyframeIndexer::onScanFinished()
+{
+    ScanResult result = m_scanWatcher.result();
+
+    if (m_scanPending)
+    {
+        m_scanPending = false;
+        if (!m_filePath.isEmpty() && result.filePath != m_filePath)
+        {
+            startScan();
+            return;
+        }
+    }
+
+    if (result.filePath != m_filePath)
+    {
+        return;
+    }
+
+    if (!result.error.isEmpty())
+    {
+        qDebug() << "No keyframe index for" << result.filePath << ":" << result.error;
+        return;
+    }
+
+    qDebug() << (result.fromCache ? "Loaded" : "Built") << "keyframe index of" << result.filePath << "with"
+             << result.keyframes.size() << "keyframes in" << result.elapsedMs << "ms";
+
+    m_keyframes = result.keyframes;
+    m_ready = true;
+    emit indexReady(m_filePath, m_keyframes.size());
+}
+
+QString KeyframeIndexer::indexPath(const QString &filePath, const QString &cacheDirectory)
+{
+    QByteArray key = QCryptographicHash::hash(QFileInfo(filePath).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1).toHex();
+    return cacheDirectory + "/" + QString::fromLatin1(key) + ".kfi";
+}
+
+KeyframeIndexer::ScanResult KeyframeIndexer::scanFile(const QString &filePath, const QString &cacheDirectory)
+{
+    ScanResult result;
+    result.filePath = filePath;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QFileInfo info(filePath);
+    const qint64 size = info.size();
+    const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+    const QString cachePath = cacheDirectory.isEmpty() ? QString() : indexPath(filePath, cacheDirectory);
+
+    // Reuse the index from an earlier scan of the same file
+    QFile cached(cachePath);
+    if (!cachePath.isEmpty() && cached.open(QIODevice::ReadOnly))
+    {
+        QDataStream in(&cached);
+        in.setVersion(QDataStream::Qt_6_0);
+
+        quint32 magic = 0;
+        quint32 version = 0;
+        qint64 cachedSize = 0;
+        qint64 cachedModified = 0;
+        quint32 count = 0;
+        in >> magic >> version >> cachedSize >> cachedModified >> count;
+
+        if (magic == INDEX_MAGIC && version == INDEX_VERSION && cachedSize == size && cachedModified == modified)
+        {
+            QVector<Keyframe> keyframes;
+            keyframes.reserve(static_cast<int>(qMin<quint32>(count, 1 << 20)));
+            for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i)
+            {
+                Keyframe keyframe;
+                in >> keyframe.time >> keyframe.offset;
+                keyframes.append(keyframe);
+            }
+
+            if (in.status() == QDataStream::Ok)
+            {
+                result.keyframes = keyframes;
+                result.fromCache = true;
+                result.elapsedMs = timer.elapsed();
+                return result;
+            }
+        }
+        cached.close();
+    }
+
+    try
+    {
+        const QString suffix = info.suffix().toLower();
+        if (suffix == "mp4" || suffix == "m4v" || suffix == "mov")
+        {
+            result.keyframes = scanMp4(filePath);
+        }
+        else if (suffix == "mkv" || suffix == "webm")
+        {
+            result.keyframes = scanMatroska(filePath);
+        }
+        else
+        {
+            throw QString("Unsupported container");
+        }
+
+        if (result.keyframes.isEmpty())
+        {
+            throw QString("No keyframes found");
+        }
+    }
+    catch (const QString &error)
+    {
+        result.keyframes.clear();
+        result.error = error;
+        return result;
+    }
+
+    if (!cachePath.isEmpty())
+    {
+        QDir().mkpath(cacheDirectory);
+
+        QSaveFile file(cachePath);
+        if (file.open(QIODevice::WriteOnly))
+        {
+            QDataStream out(&file);
+            out.setVersion(QDataStream::Qt_6_0);
+            out << INDEX_MAGIC << INDEX_VERSION << size << modified << static_cast<quint32>(result.keyframes.size());
+            for (const Keyframe &keyframe : std::as_const(result.keyframes))
+            {
+                out << keyframe.time << keyframe.offset;
+            }
+            file.commit();
+        }
+    }
+
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
+
+QVector<KeyframeIndexer::Keyframe> KeyframeIndexer::scanMp4(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        throw QString("Could not open file: %1").arg(file.errorString());
+    }
+
+    // Find the movie box; only its sample tables are needed, not the media data
+    QByteArray moov;
+    qint64 pos = 0;
+    while (pos + 8 <= file.size())
+    {
+        file.seek(pos);
+        QByteArray header = file.read(16);
+        if (header.size() < 8)
+        {
+            break;
+        }
+
+        quint64 size = qFromBigEndian<quint32>(header.constData());
+        quint32 type = qFromBigEndian<quint32>(header.constData() + 4);
+        qint64 headerSize = 8;
+        if (size == 1 && header.size() == 16)
+        {
+            size = qFromBigEndian<quint64>(header.constData() + 8);
+            headerSize = 16;
+        }
+        else if (size == 0)
+        {
+            size = file.size() - pos;
+        }
+
+        if (size < static_cast<quint64>(headerSize))
+        {
+            throw QString("Invalid MP4 box");
+        }
+
+        if (type == boxType("moov"))
+        {
+            if (size > static_cast<quint64>(MAX_HEADER_SIZE))
+            {
+                throw QString("MP4 header too large");
+            }
+            file.seek(pos + headerSize);
+            moov = file.read(static_cast<qint64>(size) - headerSize);
+            break;
+        }
+
+        pos += static_cast<qint64>(size);
+    }
+
+    if (moov.isEmpty())
+    {
+        throw QString("No MP4 movie box");
+    }
+
+    // Use the first video track
+    const ByteRange movie = {0, moov.size()};
+    ByteRange stbl;
+    quint32 timescale = 0;
+    bool found = false;
+
+    qint64 trackPos = movie.begin;
+    quint32 type = 0;
+    ByteRange trak;
+    while (!found && nextBox(moov, &trackPos, movie.end, &type, &trak))
+    {
+        ByteRange mdia, hdlr, mdhd, minf;
+        if (type != boxType("trak") || !findBox(moov, trak, "mdia", &mdia) || !findBox(moov, mdia, "hdlr", &hdlr) ||
+            readU32(moov, hdlr.begin + 8) != boxType("vide"))
+        {
+            continue;
+        }
+
+        if (!findBox(moov, mdia, "mdhd", &mdhd) || !findBox(moov, mdia, "minf", &minf) || !findBox(moov, minf, "stbl", &stbl))
+        {
+            throw QString("Incomplete MP4 video track");
+        }
+
+        const bool version1 = static_cast<uchar>(moov[mdhd.begin]) == 1;
+        timescale = readU32(moov, mdhd.begin + (version1 ? 20 : 12));
+        found = true;
+    }
+
+    if (!found)
+    {
+        throw QString("No MP4 video track");
+    }
+    if (timescale == 0)
+    {
+        throw QString("Invalid MP4 timescale");
+    }
+
+    // The tables hold media times; the edit list maps them onto the timeline mpv seeks in
+    double shift = 0.0;
+    ByteRange edts, elst;
+    if (findBox(moov, trak, "edts", &edts) && findBox(moov, edts, "elst", &elst))
+    {
+        ByteRange mvhd;
+        quint32 movieTimescale = 0;
+        if (findBox(moov, movie, "mvhd", &mvhd))
+        {
+            movieTimescale = readU32(moov, mvhd.begin + (static_cast<uchar>(moov[mvhd.begin]) == 1 ? 20 : 12));
+        }
+        shift = editListShift(moov, elst, movieTimescale, timescale);
+    }
+
+    ByteRange stts, stsc, stsz, stco, stss, ctts;
+    if (!findBox(moov, stbl, "stts", &stts) || !findBox(moov, stbl, "stsc", &stsc) || !findBox(moov, stbl, "stsz", &stsz))
+    {
+        throw QString("No MP4 sample table (fragmented files are not indexed)");
+    }
+
+    bool largeOffsets = false;
+    if (!findBox(moov, stbl, "stco", &stco))
+    {
+        if (!findBox(moov, stbl, "co64", &stco))
+        {
+            throw QString("No MP4 chunk offsets");
+        }
+        largeOffsets = true;
+    }
+
+    // Without a sync sample table every sample is a keyframe
+    QVector<quint32> syncSamples;
+    const bool allSync = !findBox(moov, stbl, "stss", &stss);
+    if (!allSync)
+    {
+        quint32 count = tableCount(moov, stss, 0, 4);
+        syncSamples.reserve(static_cast<int>(count));
+        for (quint32 i = 0; i < count; ++i)
+        {
+            syncSamples.append(readU32(moov, stss.begin + 8 + i * 4));
+        }
+        std::sort(syncSamples.begin(), syncSamples.end());
+    }
+
+    const quint32 timeCount = tableCount(moov, stts, 0, 8);
+    const bool hasCompositionOffsets = findBox(moov, stbl, "ctts", &ctts);
+    const quint32 compositionCount = hasCompositionOffsets ? tableCount(moov, ctts, 0, 8) : 0;
+    const quint32 chunkRunCount = tableCount(moov, stsc, 0, 12);
+    const quint32 chunkCount = tableCount(moov, stco, 0, largeOffsets ? 8 : 4);
+    const quint32 constantSize = readU32(moov, stsz.begin + 4);
+    const quint32 sampleCount = tableCount(moov, stsz, 4, constantSize == 0 ? 4 : 0);
+
+    QVector<Keyframe> keyframes;
+    keyframes.reserve(allSync ? 0 : syncSamples.size());
+
+    quint32 sample = 1;
+    qint64 decodeTime = 0;
+    quint32 timeEntry = 0, timeLeft = timeCount > 0 ? readU32(moov, stts.begin + 8) : 0;
+    quint32 compositionEntry = 0, compositionLeft = compositionCount > 0 ? readU32(moov, ctts.begin + 8) : 0;
+    quint32 chunkRun = 0;
+    int syncIndex = 0;
+
+    for (quint32 chunk = 1; chunk <= chunkCount && sample <= sampleCount; ++chunk)
+    {
+        while (chunkRun + 1 < chunkRunCount && readU32(moov, stsc.begin + 8 + (chunkRun + 1) * 12) <= chunk)
+        {
+            ++chunkRun;
+        }
+
+        const quint32 samplesPerChunk = chunkRunCount > 0 ? readU32(moov, stsc.begin + 8 + chunkRun * 12 + 4) : 0;
+        qint64 offset = largeOffsets ? static_cast<qint64>(readU64(moov, stco.begin + 8 + (chunk - 1) * 8))
+                                     : static_cast<qint64>(readU32(moov, stco.begin + 8 + (chunk - 1) * 4));
+
+        for (quint32 i = 0; i < samplesPerChunk && sample <= sampleCount; ++i, ++sample)
+        {
+            while (timeLeft == 0 && timeEntry + 1 < timeCount)
+            {
+                ++timeEntry;
+                timeLeft = readU32(moov, stts.begin + 8 + timeEntry * 8);
+            }
+            const quint32 delta = timeCount > 0 ? readU32(moov, stts.begin + 8 + timeEntry * 8 + 4) : 0;
+
+            while (compositionLeft == 0 && compositionEntry + 1 < compositionCount)
+            {
+                ++compositionEntry;
+                compositionLeft = readU32(moov, ctts.begin + 8 + compositionEntry * 8);
+            }
+            const qint32 compositionOffset =
+                compositionCount > 0 ? static_cast<qint32>(readU32(moov, ctts.begin + 8 + compositionEntry * 8 + 4)) : 0;
+
+            while (!allSync && syncIndex < syncSamples.size() && syncSamples[syncIndex] < sample)
+            {
+                ++syncIndex;
+            }
+
+            if (allSync || (syncIndex < syncSamples.size() && syncSamples[syncIndex] == sample))
+            {
+                Keyframe keyframe;
+                // Keyframes cut off by the edit list are shown from the start
+                keyframe.time = qMax(0.0, static_cast<double>(decodeTime + compositionOffset) / timescale + shift);
+                keyframe.offset = offset;
+                keyframes.append(keyframe);
+            }
+
+            offset += constantSize != 0 ? constantSize : readU32(moov, stsz.begin + 12 + (sample - 1) * 4);
+            decodeTime += delta;
+            if (timeLeft > 0)
+            {
+                --timeLeft;
+            }
+            if (compositionLeft > 0)
+            {
+                --compositionLeft;
+            }
+        }
+    }
+
+    std::sort(keyframes.begin(), keyframes.end(), [](const Keyframe &a, const Keyframe &b)
+              { return a.time < b.time; });
+    return keyframes;
+}
+
+QVector<KeyframeIndexer::Keyframe> KeyframeIndexer::scanMatroska(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        throw QString("Could not open file: %1").arg(file.errorString());
+    }
+
+    auto readHeader = [&file](qint64 pos, quint64 *id, qint64 *size) -> int
+    {
+        file.seek(pos);
+        QByteArray header = file.read(12);
+        return readElementHeader(reinterpret_cast<const uchar *>(header.constData()), header.size(), id, size);
+    };
+
+    auto readBody = [&file](qint64 pos, qint64 size) -> QByteArray
+    {
+        if (size < 0 || size > MAX_HEADER_SIZE)
+        {
+            throw QString("Matroska element too large");
+        }
+        file.seek(pos);
+        QByteArray body = file.read(size);
+        if (body.size() != size)
+        {
+            throw QString("Truncated Matroska element");
+        }
+        return body;
+    };
+
+    quint64 id = 0;
+    qint64 size = 0;
+    int header = readHeader(0, &id, &size);
+    if (header == 0 || id != EBML_HEADER || size < 0)
+    {
+        throw QString("Not a Matroska file");
+    }
+
+    const qint64 segmentHeaderPos = header + size;
+    header = readHeader(segmentHeaderPos, &id, &size);
+    if (header == 0 || id != MKV_SEGMENT)
+    {
+        throw QString("No Matroska segment");
+    }
+
+    const qint64 segmentStart = segmentHeaderPos + header;
+    const qint64 segmentEnd = size < 0 ? file.size() : qMin(file.size(), segmentStart + size);
+
+    quint64 timestampScale = 1000000;
+    quint64 videoTrack = 0;
+    qint64 cuesPos = -1;
+    bool jumped = false;
+    QByteArray cues;
+
+    // Walk the top level up to the clusters, then jump straight to the cues
+    qint64 pos = segmentStart;
+    while (pos < segmentEnd && cues.isEmpty())
+    {
+        header = readHeader(pos, &id, &size);
+        if (header == 0)
+        {
+            break;
+        }
+
+        const qint64 bodyPos = pos + header;
+
+        if (id == MKV_CLUSTER && cuesPos >= 0 && !jumped)
+        {
+            jumped = true;
+            pos = cuesPos;
+            continue;
+        }
+
+        if (id == MKV_SEEK_HEAD)
+        {
+            const QByteArray body = readBody(bodyPos, size);
+            qint64 seekPos = 0;
+            ByteRange seek;
+            while (nextElement(body, &seekPos, body.size(), &id, &seek))
+            {
+                if (id != MKV_SEEK)
+                {
+                    continue;
+                }
+
+                quint64 seekId = 0;
+                qint64 seekPosition = -1;
+                qint64 childPos = seek.begin;
+                ByteRange child;
+                quint64 childId = 0;
+                while (nextElement(body, &childPos, seek.end, &childId, &child))
+                {
+                    if (childId == MKV_SEEK_ID)
+                    {
+                        seekId = readUInt(body, child);
+                    }
+                    else if (childId == MKV_SEEK_POSITION)
+                    {
+                        seekPosition = static_cast<qint64>(readUInt(body, child));
+                    }
+                }
+
+                if (seekId == MKV_CUES && seekPosition >= 0)
+                {
+                    cuesPos = segmentStart + seekPosition;
+                }
+            }
+        }
+        else if (id == MKV_INFO)
+        {
+            const QByteArray body = readBody(bodyPos, size);
+            qint64 childPos = 0;
+            ByteRange child;
+            while (nextElement(body, &childPos, body.size(), &id, &child))
+            {
+                if (id == MKV_TIMESTAMP_SCALE)
+                {
+                    timestampScale = readUInt(body, child);
+                }
+            }
+        }
+        else if (id == MKV_TRACKS)
+        {
+            const QByteArray body = readBody(bodyPos, size);
+            qint64 entryPos = 0;
+            ByteRange entry;
+            while (videoTrack == 0 && nextElement(body, &entryPos, body.size(), &id, &entry))
+            {
+                if (id != MKV_TRACK_ENTRY)
+                {
+                    continue;
+                }
+
+                quint64 number = 0;
+                quint64 trackType = 0;
+                qint64 childPos = entry.begin;
+                ByteRange child;
+                while (nextElement(body, &childPos, entry.end, &id, &child))
+                {
+                    if (id == MKV_TRACK_NUMBER)
+                    {
+                        number = readUInt(body, child);
+                    }
+                    else if (id == MKV_TRACK_TYPE)
+                    {
+                        trackType = readUInt(body, child);
+                    }
+                }
+
+                if (trackType == 1)
+                {
+                    videoTrack = number;
+                }
+            }
+        }
+        else if (id == MKV_CUES)
+        {
+            cues = readBody(bodyPos, size);
+            break;
+        }
+
+        if (size < 0)
+        {
+            // A live-written cluster without a size; nothing after it can be found cheaply
+            break;
+        }
+        pos = bodyPos + size;
+    }
+
+    if (cues.isEmpty())
+    {
+        throw QString("No Matroska cues");
+    }
+    if (timestampScale == 0)
+    {
+        throw QString("Invalid Matroska timestamp scale");
+    }
+
+    QVector<Keyframe> keyframes;
+    qint64 pointPos = 0;
+    ByteRange point;
+    while (nextElement(cues, &pointPos, cues.size(), &id, &point))
+    {
+        if (id != MKV_CUE_POINT)
+        {
+            continue;
+        }
+
+        quint64 cueTime = 0;
+        qint64 clusterPosition = -1;
+        qint64 childPos = point.begin;
+        ByteRange child;
+        while (nextElement(cues, &childPos, point.end, &id, &child))
+        {
+            if (id == MKV_CUE_TIME)
+            {
+                cueTime = readUInt(cues, child);
+            }
+            else if (id == MKV_CUE_TRACK_POSITIONS && clusterPosition < 0)
+            {
+                quint64 track = 0;
+                qint64 position = -1;
+                qint64 trackPos = child.begin;
+                ByteRange field;
+                while (nextElement(cues, &trackPos, child.end, &id, &field))
+                {
+                    if (id == MKV_CUE_TRACK)
+                    {
+                        track = readUInt(cues, field);
+                    }
+                    else if (id == MKV_CUE_CLUSTER_POSITION)
+                    {
+                        position = static_cast<qint64>(readUInt(cues, field));
+                    }
+                }
+
+                // Cues of other tracks do not mark video keyframes
+                if (videoTrack == 0 || track == videoTrack)
+                {
+                    clusterPosition = position;
+                }
+            }
+        }
+
+        if (clusterPosition >= 0)
+        {
+            Keyframe keyframe;
+            keyframe.time = static_cast<double>(cueTime) * timestampScale / 1e9;
+            keyframe.offset = segmentStart + clusterPosition;
+            keyframes.append(keyframe);
+        }
+    }
+
+    std::sort(keyframes.begin(), keyframes.end(), [](const Keyframe &a, const Keyframe &b)
+              { return a.time < b.time; });
+    return keyframes;
+}
\ No newline at end of file
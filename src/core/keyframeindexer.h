@@ -0,0 +1,161 @@
+#ifndef KEYFRAMEINDEXER_H
+#define KEYFRAMEINDEXER_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QThreadPool>
+#include <QFutureWatcher>
+
+/**
+ * @brief The KeyframeIndexer class builds a keyframe index for local files
+ *
+ * MP4 files are indexed from the sync sample table of their video track,
+ * shifted by its edit list, and Matroska files from their cues, so only
+ * the container headers are read. The scan runs once per file on a single
+ * low-priority worker and the result is kept in the cache directory, keyed
+ * by path, size and modification time; reopening an unchanged file just
+ * loads the index.
+ */
+class KeyframeIndexer : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief A keyframe in the index
+     */
+    struct Keyframe
+    {
+        double time = 0.0;
+        qint64 offset = 0;
+    };
+
+    /**
+     * @brief Constructor
+     * @param parent Parent object
+     */
+    explicit KeyframeIndexer(QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor, waits for a running scan
+     */
+    ~KeyframeIndexer();
+
+    /**
+     * @brief Set the directory the indexes are kept in
+     * @param directory Cache directory
+     */
+    void setCacheDirectory(const QString &directory);
+
+    /**
+     * @brief Index a local file in the background
+     * @param filePath Path to the media file
+     */
+    void index(const QString &filePath);
+
+    /**
+     * @brief Drop the current index
+     */
+    void clear();
+
+    /**
+     * @brief Check whether the index of the current file is available
+     * @return True if ready
+     */
+    bool isReady() const;
+
+    /**
+     * @brief Get the number of keyframes in the index
+     * @return Keyframe count
+     */
+    int keyframeCount() const;
+
+    /**
+     * @brief Snap a position to the nearest keyframe
+     * @param position Position in seconds
+     * @return Keyframe time, or the position itself without an index
+     */
+    double snap(double position) const;
+
+    /**
+     * @brief Find the last keyframe at or before a position
+     * @param position Position in seconds
+     * @return Keyframe, with time 0 and offset 0 if there is none
+     */
+    Keyframe keyframeBefore(double position) const;
+
+signals:
+    /**
+     * @brief Signal emitted when the index of the current file is available
+     * @param filePath Path to the media file
+     * @param count Number of keyframes
+     */
+    void indexReady(const QString &filePath, int count);
+
+private slots:
+    /**
+     * @brief Install the result of a background scan
+     */
+    void onScanFinished();
+
+private:
+    /**
+     * @brief Result of a background scan
+     */
+    struct ScanResult
+    {
+        QString filePath;
+        QVector<Keyframe> keyframes;
+        QString error;
+        bool fromCache = false;
+        qint64 elapsedMs = 0;
+    };
+
+    /**
+     * @brief Load or build the index of a file (thread-safe)
+     * @param filePath Path to the media file
+     * @param cacheDirectory Directory the indexes are kept in
+     * @return Scan result
+     */
+    static ScanResult scanFile(const QString &filePath, const QString &cacheDirectory);
+
+    /**
+     * @brief Read the keyframes of an MP4 file
+     * @param filePath Path to the media file
+     * @return Keyframes in presentation order
+     * @throws QString on a malformed file
+     */
+    static QVector<Keyframe> scanMp4(const QString &filePath);
+
+    /**
+     * @brief Read the keyframes of a Matroska file
+     * @param filePath Path to the media file
+     * @return Keyframes in presentation order
+     * @throws QString on a malformed file
+     */
+    static QVector<Keyframe> scanMatroska(const QString &filePath);
+
+    /**
+     * @brief Get the index file of a media file
+     * @param filePath Path to the media file
+     * @param cacheDirectory Directory the indexes are kept in
+     * @return Path of the index file
+     */
+    static QString indexPath(const QString &filePath, const QString &cacheDirectory);
+
+    /**
+     * @brief Start a background scan of the current file
+     */
+    void startScan();
+
+    QString m_cacheDirectory;
+    QString m_filePath;
+    QVector<Keyframe> m_keyframes;
+    bool m_ready;
+    bool m_scanPending;
+    QThreadPool m_pool;
+    QFutureWatcher<ScanResult> m_scanWatcher;
+};
+
+#endif // KEYFRAMEINDEXER_H
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "logocache.h"
+#include <QDebug>
+#include <QBuffer>
+#include <QImageReader>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QUrl>
+#include <QtConcurrent/QtConcurrentRun>
+#include <limits>
+
+static const qint64 DEFAULT_MEMORY_BUDGET = 16 * 1024 * 1024;
+static const qint64 DEFAULT_DISK_BUDGET = 64 * 1024 * 1024;
+static const qint64 FIRST_RETRY_MS = 30 * 1000;
+static const qint64 MAX_RETRY_MS = 60 * 60 * 1000;
+
+LogoCache::LogoCache(QObject *parent)
+    : QObject(parent), m_network(new QNetworkAccessManager(this)), m_diskCache(new QNetworkDiskCache(this)), m_logoSize(32, 32)
+{
+    m_diskCache->setCacheDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/logos");
+    m_diskCache->setMaximumCacheSize(DEFAULT_DISK_BUDGET);
+    m_network->setCache(m_diskCache);
+
+    m_logos.setMaxCost(DEFAULT_MEMORY_BUDGET);
+    m_clock.start();
+}
+
+LogoCache::~LogoCache()
+{
+}
+
+void LogoCache::setLogoSize(const QSize &size)
+{
+    if (size == m_logoSize)
+    {
+        return;
+    }
+
+    // Cached logos were scaled for the old size
+    m_logoSize = size;
+    m_logos.clear();
+}
+
+QSize LogoCache::logoSize() const
+{
+    return m_logoSize;
+}
+
+void LogoCache::setMemoryBudget(qint64 bytes)
+{
+    m_logos.setMaxCost(bytes);
+}
+
+void LogoCache::setDiskBudget(qint64 bytes)
+{
+    m_diskCache->setMaximumCacheSize(bytes);
+}
+
+QPixmap LogoCache::logo(const QString &url)
+{
+    if (url.isEmpty())
+    {
+        return QPixmap();
+    }
+
+    if (QPixmap *pixmap = m_logos.object(url))
+    {
+        return *pixmap;
+    }
+
+    auto failure = m_failed.constFind(url);
+    if (!m_pending.contains(url) && (failure == m_failed.constEnd() || m_clock.elapsed() >= failure->retryAt))
+    {
+        fetch(url);
+    }
+
+    return QPixmap();
+}
+
+void LogoCache::fetch(const QString &url)
+{
+    QUrl logoUrl = QUrl::fromUserInput(url);
+    if (!logoUrl.isValid())
+    {
+        markFailed(url, true);
+        return;
+    }
+
+    m_pending.insert(url);
+
+    QNetworkRequest request(logoUrl);
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferNetwork);
+    request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, true);
+
+    QNetworkReply *reply = m_network->get(request);
+    connect(reply, &QNetworkReply::finished, this, [this, reply, url]()
+            {
+                reply->deleteLater();
+
+                if (reply->error() != QNetworkReply::NoError)
+                {
+                    qDebug() << "Failed to fetch logo:" << url << reply->errorString();
+                    m_pending.remove(url);
+                    markFailed(url, false);
+                    return;
+                }
+
+                decode(url, reply->readAll()); });
+}
+
+void LogoCache::decode(const QString &url, const QByteArray &data)
+{
+    QtConcurrent::run(QThreadPool::globalInstance(), &LogoCache::decodeImage, data, m_logoSize)
+        .then(this, [this, url](const QImage &image)
+              {
+                  m_pending.remove(url);
+
+                  if (image.isNull())
+                  {
+                      // An error page instead of the image may be as passing as a network error
+                      markFailed(url, false);
+                      return;
+                  }
+
+                  m_failed.remove(url);
+
+                  QPixmap *pixmap = new QPixmap(QPixmap::fromImage(image));
+                  qint64 cost = static_cast<qint64>(image.sizeInBytes());
+                  m_logos.insert(url, pixmap, cost);
+                  emit logoReady(url); });
+}
+
+void LogoCache::markFailed(const QString &url, bool permanent)
+{
+    Failure &failure = m_failed[url];
+    ++failure.attempts;
+
+    if (permanent)
+    {
+        failure.retryAt = std::numeric_limits<qint64>::max();
+        return;
+    }
+
+    qint64 backoff = FIRST_RETRY_MS << qMin(failure.attempts - 1, 7);
+    failure.retryAt = m_clock.elapsed() + qMin(backoff, MAX_RETRY_MS);
+}
+
+QImage LogoCache::decodeImage(const QByteArray &data, const QSize &size)
+{
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer);
+    reader.setAutoTransform(true);
+
+    // Let the decoder scale while decoding; JPEG in particular decodes much less data this way
+    QSize original = reader.size();
+    if (original.isValid() && (original.width() > size.width() || original.height() > size.height()))
+    {
+        reader.setScaledSize(original.scaled(size, Qt::KeepAspectRatio));
+    }
+
+    QImage image = reader.read();
+    if (image.isNull())
+    {
+        return image;
+    }
+
+    if (image.width() > size.width() || image.height() > size.height())
+    {
+        image = image.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+
+    return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+#ifndef LOGOCACHE_H
+#define LOGOCACHE_H
+
+#include <QObject>
+#include <QString>
+#include <QSize>
+#include <QSet>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QCache>
+#include <QPixmap>
+#include <QImage>
+#include <QByteArray>
+#include <QNetworkAccessManager>
+#include <QNetworkDiskCache>
+
+/**
+ * @brief The LogoCache class loads channel logos asynchronously
+ *
+ * Logos are fetched with QNetworkAccessManager (http, https and file URLs),
+ * decoded and downscaled to the display size on the global thread pool and
+ * kept in a byte-budgeted LRU. Responses also go through a persistent
+ * QNetworkDiskCache, which revalidates stale entries with If-None-Match /
+ * If-Modified-Since so unchanged logos are not downloaded again.
+ *
+ * A logo that fails to load is retried after a backoff that doubles with
+ * every failure, from 30 seconds up to an hour, so a brief network error
+ * does not hide it for the rest of the session.
+ */
+class LogoCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor
+     * @param parent Parent object
+     */
+    explicit LogoCache(QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor
+     */
+    ~LogoCache();
+
+    /**
+     * @brief Set the size logos are scaled down to
+     * @param size Maximum logo size in pixels
+     */
+    void setLogoSize(const QSize &size);
+
+    /**
+     * @brief Get the size logos are scaled down to
+     * @return Maximum logo size in pixels
+     */
+    QSize logoSize() const;
+
+    /**
+     * @brief Set the in-memory cache budget
+     * @param bytes Maximum bytes of decoded logos kept in memory
+     */
+    void setMemoryBudget(qint64 bytes);
+
+    /**
+     * @brief Set the on-disk cache budget
+     * @param bytes Maximum bytes of downloaded logos kept on disk
+     */
+    void setDiskBudget(qint64 bytes);
+
+    /**
+     * @brief Get a logo, starting an asynchronous load if it is not cached
+     * @param url Logo URL
+     * @return The logo, or a null pixmap if it is not loaded yet
+     */
+    QPixmap logo(const QString &url);
+
+signals:
+    /**
+     * @brief Signal emitted when a requested logo has been loaded
+     * @param url Logo URL
+     */
+    void logoReady(const QString &url);
+
+private:
+    /**
+     * @brief Start downloading a logo
+     * @param url Logo URL
+     */
+    void fetch(const QString &url);
+
+    /**
+     * @brief Decode a downloaded logo on the thread pool
+     * @param url Logo URL
+     * @param data Encoded image data
+     */
+    void decode(const QString &url, const QByteArray &data);
+
+    /**
+     * @brief Decode and downscale image data (thread-safe)
+     * @param data Encoded image data
+     * @param size Maximum size
+     * @return Decoded image, null on failure
+     */
+    static QImage decodeImage(const QByteArray &data, const QSize &size);
+
+    /**
+     * @brief Record a failed load and when to try again
+     * @param url Logo URL
+     * @param permanent True if retrying cannot help, e.g. for an invalid URL
+     */
+    void markFailed(const QString &url, bool permanent);
+
+    /**
+     * @brief Failed loads of a logo and when the next attempt may start
+     */
+    struct Failure
+    {
+        int attempts = 0;
+        qint64 retryAt = 0;
+    };
+
+    QNetworkAccessManager *m_network;
+    QNetworkDiskCache *m_diskCache;
+    QCache<QString, QPixmap> m_logos;
+    QSet<QString> m_pending;
+    QHash<QString, Failure> m_failed;
+    QElapsedTimer m_clock;
+    QSize m_logoSize;
+};
+
+#endif // LOGOCACHE_H
\ No newline at end of file
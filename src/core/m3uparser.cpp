@@ -0,0 +1,149 @@
+#include "m3uparser.h"
+#include <QFile>
+
+M3UParser::M3UParser()
+{
+}
+
+QList<ChannelData> M3UParser::parseFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        throw QString("Could not open file: %1").arg(filePath);
+    }
+
+    QByteArray data = file.readAll();
+    file.close();
+
+    return parseData(data);
+}
+
+QList<ChannelData> M3UParser::parseData(const QByteArray &data)
+{
+    QList<ChannelData> channels;
+    ChannelData pending;
+    bool hasPending = false;
+
+    // Walk the buffer line by line without splitting it into a list first
+    qsizetype pos = 0;
+    while (pos < data.size())
+    {
+        qsizetype end = data.indexOf('\n', pos);
+        if (end < 0)
+        {
+            end = data.size();
+        }
+
+        QByteArrayView raw(data.constData() + pos, end - pos);
+        pos = end + 1;
+
+        raw = raw.trimmed();
+        if (raw.isEmpty())
+        {
+            continue;
+        }
+
+        if (raw.startsWith("#EXTINF:"))
+        {
+            const QString line = QString::fromUtf8(raw.mid(8));
+
+            // The display name follows the first comma outside of quoted attribute values
+            qsizetype comma = -1;
+            bool quoted = false;
+            for (qsizetype i = 0; i < line.size(); ++i)
+            {
+                if (line[i] == '"')
+                {
+                    quoted = !quoted;
+                }
+                else if (line[i] == ',' && !quoted)
+                {
+                    comma = i;
+                    break;
+                }
+            }
+
+            QStringView attributes = comma >= 0 ? QStringView(line).left(comma) : QStringView(line);
+            QString name = comma >= 0 ? line.mid(comma + 1).trimmed() : QString();
+            if (name.isEmpty())
+            {
+                name = attribute(attributes, u"tvg-name");
+            }
+
+            pending = ChannelData(name, QString());
+            pending.setTvgId(attribute(attributes, u"tvg-id"));
+            pending.setLogoUrl(attribute(attributes, u"tvg-logo"));
+            hasPending = true;
+            continue;
+        }
+
+        if (raw.startsWith('#'))
+        {
+            continue;
+        }
+
+        QString url = QString::fromUtf8(raw);
+        if (!hasPending)
+        {
+            pending = ChannelData(url, QString());
+        }
+        else if (pending.name().isEmpty())
+        {
+            pending.setName(url);
+        }
+
+        pending.setUrl(url);
+        channels.append(pending);
+        hasPending = false;
+    }
+
+    if (channels.isEmpty() && !isPlaylist(data))
+    {
+        throw QString("M3U parse error: not a playlist");
+    }
+
+    return channels;
+}
+
+bool M3UParser::isPlaylist(const QByteArray &data)
+{
+    QByteArrayView view(data);
+    if (view.startsWith("\xEF\xBB\xBF"))
+    {
+        view = view.mid(3);
+    }
+
+    return view.trimmed().startsWith("#EXTM3U");
+}
+
+QString M3UParser::attribute(QStringView attributes, QStringView name)
+{
+    qsizetype from = 0;
+    while (true)
+    {
+        qsizetype index = attributes.indexOf(name, from);
+        if (index < 0)
+        {
+            return QString();
+        }
+
+        qsizetype valueStart = index + name.size();
+        from = valueStart;
+
+        // Match whole attribute names only, so "tvg-id" does not hit "xtvg-id"
+        bool boundary = index == 0 || attributes[index - 1].isSpace();
+        if (!boundary || valueStart + 1 >= attributes.size() || attributes[valueStart] != '=' || attributes[valueStart + 1] != '"')
+        {
+            continue;
+        }
+
+        qsizetype valueEnd = attributes.indexOf('"', valueStart + 2);
+        if (valueEnd < 0)
+        {
+            return QString();
+        }
+
+        return attributes.mid(valueStart + 2, valueEnd - valueStart - 2).toString();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef M3UPARSER_H
+#define M3UPARSER_H
+
+#include <QString>
+#include <QStringView>
+#include <QList>
+#include <QByteArray>
+#include "../data/channeldata.h"
+
+/**
+ * @brief The M3UParser class handles parsing channel data from M3U playlists
+ *
+ * Understands extended M3U as produced by IPTV providers: each entry is an
+ * "#EXTINF:" line carrying tvg-id, tvg-name and tvg-logo attributes and the
+ * display name after the first unquoted comma, followed by the stream URL.
+ * Other directives are ignored.
+ */
+class M3UParser
+{
+public:
+    /**
+     * @brief Constructor
+     */
+    M3UParser();
+
+    /**
+     * @brief Parse channels from an M3U file
+     * @param filePath Path to the M3U file
+     * @return List of channel data
+     * @throws QString error message if parsing fails
+     */
+    QList<ChannelData> parseFile(const QString &filePath);
+
+    /**
+     * @brief Parse channels from raw UTF-8 M3U data
+     * @param data M3U data
+     * @return List of channel data
+     * @throws QString error message if parsing fails
+     */
+    QList<ChannelData> parseData(const QByteArray &data);
+
+    /**
+     * @brief Check whether data looks like an M3U playlist
+     * @param data File contents
+     * @return True if the data starts with an #EXTM3U header
+     */
+    static bool isPlaylist(const QByteArray &data);
+
+private:
+    /**
+     * @brief Extract a quoted attribute from an #EXTINF line
+     * @param attributes Attribute part of the line
+     * @param name Attribute name
+     * @return Attribute value, empty if missing
+     */
+    static QString attribute(QStringView attributes, QStringView name);
+};
+
+#endif // M3UPARSER_H
\ No newline at end of file
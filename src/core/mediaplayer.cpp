@@ -1,9 +1,17 @@
 #include "mediaplayer.h"
 #include <QDebug>
 #include <QUrl>
+#include <QSet>
+#include <QHostInfo>
+#include <QStandardPaths>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <algorithm>
 
 MediaPlayer::MediaPlayer(Settings *settings, QObject *parent)
-    : QObject(parent), m_mpvCore(nullptr), m_playbackController(nullptr), m_settings(settings), m_currentMedia(""), m_isNetworkStream(false)
+    : QObject(parent), m_mpvCore(nullptr), m_playbackController(nullptr), m_streamProxy(nullptr), m_vodCache(nullptr), m_cacheController(nullptr), m_timeshift(nullptr), m_keyframeIndexer(nullptr), m_thumbnails(nullptr), m_resumeStore(nullptr), m_stats(nullptr), m_settings(settings), m_currentMedia(""), m_isNetworkStream(false)
 {
 }
 
@@ -15,9 +23,10 @@ MediaPlayer::~MediaPlayer()
 
 bool MediaPlayer::initialize()
 {
-    // Create and initialize MPV core
+    // Create and initialize MPV core; the configured options are in place before it starts
+    m_mpvOptions = resolveMpvOptions();
     m_mpvCore = new MPVCore(this);
-    if (!m_mpvCore->initialize())
+    if (!m_mpvCore->initialize(m_mpvOptions))
     {
         qWarning() << "Failed to initialize MPV core";
         return false;
@@ -25,14 +34,45 @@ bool MediaPlayer::initialize()
 
     // Create playback controller
     m_playbackController = new PlaybackController(m_mpvCore, this);
+    m_cacheController = new AdaptiveCacheController(m_mpvCore, this);
+    m_timeshift = new TimeshiftController(m_mpvCore, this);
+    m_timeshift->setCacheDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/timeshift");
+
+    // Keyframes of local files are indexed once so scrubbing can snap to them
+    m_keyframeIndexer = new KeyframeIndexer(this);
+    m_keyframeIndexer->setCacheDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/keyframes");
+    m_playbackController->setKeyframeIndexer(m_keyframeIndexer);
+
+    // Seek bar previews come from a separate mpv instance on its own thread
+    m_thumbnails = new ThumbnailGenerator(this);
+
+    // Where each long file or VOD was left
+    QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(dataDir);
+    m_resumeStore = new ResumeStore(this);
+    m_resumeStore->load(dataDir + "/resume.dat");
+
+    // Sampled only while the stats overlay is shown
+    m_stats = new PlaybackStats(m_mpvCore, m_timeshift, this);
+
+    // Create the local HLS cache and the VOD disk cache behind it
+    m_streamProxy = new StreamProxy(this);
+    m_vodCache = new VodCache(this);
+    m_vodCache->open(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/vod");
 
     // Connect signals
     connect(m_mpvCore, &MPVCore::error, this, &MediaPlayer::onMpvError);
+    connect(m_mpvCore, &MPVCore::fileLoaded, this, &MediaPlayer::onFileLoaded);
+    connect(m_playbackController, &PlaybackController::positionChanged, this, &MediaPlayer::onPositionChanged);
     connect(m_settings, &Settings::settingsChanged, this, &MediaPlayer::onSettingsChanged);
     connect(m_settings, &Settings::mpvSettingsChanged, this, &MediaPlayer::onMpvSettingsChanged);
 
+    // Queued, so the video widget has a renderer for the new core before the media is reopened
+    connect(m_mpvCore, &MPVCore::coreRestarted, this, &MediaPlayer::onCoreRestarted, Qt::QueuedConnection);
+
     // Apply settings
     applySettings();
+    setPerformanceProfile(m_settings->get<Setting::PerformanceProfile>());
 
     return true;
 }
@@ -47,36 +87,215 @@ PlaybackController *MediaPlayer::playbackController() const
     return m_playbackController;
 }
 
-void MediaPlayer::loadMedia(const QString &path)
+StreamProxy *MediaPlayer::streamProxy() const
+{
+    return m_streamProxy;
+}
+
+VodCache *MediaPlayer::vodCache() const
+{
+    return m_vodCache;
+}
+
+AdaptiveCacheController *MediaPlayer::cacheController() const
+{
+    return m_cacheController;
+}
+
+TimeshiftController *MediaPlayer::timeshiftController() const
+{
+    return m_timeshift;
+}
+
+KeyframeIndexer *MediaPlayer::keyframeIndexer() const
+{
+    return m_keyframeIndexer;
+}
+
+ThumbnailGenerator *MediaPlayer::thumbnailGenerator() const
+{
+    return m_thumbnails;
+}
+
+ResumeStore *MediaPlayer::resumeStore() const
+{
+    return m_resumeStore;
+}
+
+PlaybackStats *MediaPlayer::playbackStats() const
+{
+    return m_stats;
+}
+
+void MediaPlayer::loadMedia(const QString &path, const QString &profile)
 {
     if (path.isEmpty())
     {
         return;
     }
 
+    // Switched before the file opens, so demuxer and decoder start with the profile's options
+    m_mediaProfile = profile;
+    setPerformanceProfile(profile.isEmpty() ? m_settings->get<Setting::PerformanceProfile>() : profile);
+
+    // Start where the user left off; as a loadfile option mpv seeks before the first frame is decoded
+    QVariantMap options;
+    double resumePosition = m_settings->get<Setting::ResumePlayback>() ? m_resumeStore->position(path) : 0.0;
+    if (resumePosition > 0)
+    {
+        options.insert("start", QString::number(resumePosition, 'f', 3));
+        qDebug() << "Resuming" << path << "at" << resumePosition << "s";
+    }
+
+    openMedia(path, options);
+}
+
+void MediaPlayer::openMedia(const QString &path, const QVariantMap &options)
+{
     m_currentMedia = path;
     m_isNetworkStream = isNetworkUrl(path);
 
+    // Positions reported until the new file is open still belong to the old one
+    m_resumeMedia.clear();
+    m_loadingMedia = path;
+    m_timeshift->stop();
+    QVariantMap fileOptions = options;
+
     // Configure cache for network streams
     if (m_isNetworkStream)
     {
+        // A performance profile's cache-secs wins over the setting
         m_mpvCore->setProperty("cache", true);
-        m_mpvCore->setProperty("cache-secs", m_settings->mpvValue("cache-secs", 10).toInt());
+        int cacheSecs = m_settings->get<Setting::CacheSecs>();
+        const QMap<QString, QString> profileValues = m_mpvConfig.profileValues(m_performanceProfile);
+        if (profileValues.contains("cache-secs"))
+        {
+            cacheSecs = profileValues.value("cache-secs").toInt();
+        }
+        else
+        {
+            m_mpvCore->setProperty("cache-secs", cacheSecs);
+        }
+
+        // The configured duration is the starting point; the controller adapts it to the link
+        if (isLowLatency())
+        {
+            m_cacheController->stop();
+        }
+        else
+        {
+            m_cacheController->start(cacheSecs);
+        }
+        m_keyframeIndexer->clear();
+
+        if (m_settings->get<Setting::Timeshift>())
+        {
+            fileOptions.insert(m_timeshift->prepare());
+        }
     }
     else
     {
         m_mpvCore->setProperty("cache", false);
+        m_cacheController->stop();
+        m_keyframeIndexer->index(QUrl(path).isLocalFile() ? QUrl(path).toLocalFile() : path);
+    }
+
+    // Route HLS through the local cache so zapping back to a channel is served from memory
+    QString target = path;
+    if (m_isNetworkStream && m_streamProxy->isRunning() && m_settings->get<Setting::HlsCache>() &&
+        StreamProxy::isHlsUrl(path))
+    {
+        target = m_streamProxy->proxyUrl(path);
+
+        StreamProxy::Stats stats = m_streamProxy->stats();
+        qDebug() << "Stream proxy:" << stats.requests << "requests," << qRound(stats.hitRate() * 100) << "% hits,"
+                 << stats.bytesFromCache / 1024 << "KiB saved";
+    }
+    else if (m_isNetworkStream && m_streamProxy->isRunning() && m_settings->get<Setting::VodCache>() &&
+             StreamProxy::isVodUrl(path))
+    {
+        target = m_streamProxy->vodUrl(path);
+
+        // The proxy keeps fetched ranges on disk, so mpv only needs its RAM cache for
+        // short seeks; a second copy in mpv's own disk cache would be wasted. As file
+        // options they end with this file instead of carrying over to the next one.
+        fileOptions.insert("cache-on-disk", "no");
+        fileOptions.insert("demuxer-seekable-cache", "yes");
+
+        VodCache::Stats stats = m_vodCache->stats();
+        qDebug() << "VOD cache:" << stats.titles << "titles," << stats.usedBytes / (1024 * 1024) << "MiB used,"
+                 << qRound(stats.hitRatio() * 100) << "% of bytes from disk";
+    }
+
+    // Previews only make sense for media with a fixed timeline
+    if (m_settings->get<Setting::SeekThumbnails>() && (!m_isNetworkStream || StreamProxy::isVodUrl(path)))
+    {
+        QString userAgent = m_settings->get<Setting::UserAgent>();
+        if (!userAgent.isEmpty())
+        {
+            m_thumbnails->setOption("user-agent", userAgent);
+        }
+        m_thumbnails->setMedia(target);
+    }
+    else
+    {
+        m_thumbnails->setMedia(QString());
     }
 
     // Load the file
-    m_mpvCore->loadFile(path);
+    m_mpvCore->loadFile(target, fileOptions);
 
     emit mediaLoaded(path);
 }
 
 void MediaPlayer::loadChannel(const ChannelData &channel)
 {
-    loadMedia(channel.url());
+    loadMedia(channel.url(), channel.profile());
+}
+
+void MediaPlayer::setPerformanceProfile(const QString &profile)
+{
+    if (profile == m_performanceProfile)
+    {
+        return;
+    }
+
+    if (!profile.isEmpty() && !m_mpvConfig.profiles().contains(profile))
+    {
+        qWarning() << "Unknown performance profile:" << profile;
+        return;
+    }
+
+    // Applied over the old one, a profile would snapshot the old profile's values as the ones to restore
+    if (!m_performanceProfile.isEmpty())
+    {
+        m_mpvCore->command({"apply-profile", m_performanceProfile, "restore"});
+    }
+    if (!profile.isEmpty())
+    {
+        m_mpvCore->command({"apply-profile", profile});
+    }
+
+    qInfo() << "Performance profile:" << (profile.isEmpty() ? QString("none") : profile);
+    m_performanceProfile = profile;
+
+    // The profile's cache options are not the controller's to change
+    m_cacheController->setFixedOptions(m_mpvConfig.profileValues(profile));
+    if (isLowLatency())
+    {
+        m_cacheController->stop();
+    }
+}
+
+bool MediaPlayer::isLowLatency() const
+{
+    // Growing the cache on a stall would give up the short delay the profile is for
+    return m_performanceProfile == "low-latency";
+}
+
+QString MediaPlayer::performanceProfile() const
+{
+    return m_performanceProfile;
 }
 
 bool MediaPlayer::isNetworkStream() const
@@ -92,19 +311,47 @@ QString MediaPlayer::currentMedia() const
 void MediaPlayer::applySettings()
 {
     // Apply volume
-    int volume = m_settings->value("volume", 100).toInt();
+    int volume = m_settings->get<Setting::Volume>();
     m_playbackController->setVolume(volume);
 
-    // Apply MPV settings
-    QMap<QString, QVariant> mpvSettings = m_settings->allMpvSettings();
-    for (auto it = mpvSettings.constBegin(); it != mpvSettings.constEnd(); ++it)
+    applyProxySettings();
+    applyCacheSettings();
+
+    // MPV options were applied when the core was created
+}
+
+void MediaPlayer::setPrefetchHints(const QStringList &urls)
+{
+    m_prefetchHints = urls;
+
+    QSet<QString> hosts;
+    for (const QString &path : urls)
     {
-        m_mpvCore->setProperty(it.key(), it.value());
+        if (!isNetworkUrl(path))
+        {
+            continue;
+        }
+
+        QString host = QUrl(path).host();
+        if (!host.isEmpty() && !hosts.contains(host))
+        {
+            hosts.insert(host);
+
+            // The lookup warms Qt's and the system resolver's caches; the result itself is not needed
+            QHostInfo::lookupHost(host, this, [](const QHostInfo &) {});
+        }
+
+        // For HLS, the master playlist can be fetched into the proxy cache outright
+        if (m_streamProxy && m_streamProxy->isRunning() && StreamProxy::isHlsUrl(path))
+        {
+            m_streamProxy->prefetch(path);
+        }
     }
+}
 
-    // Set up hardware acceleration
-    QString hwdec = m_settings->mpvValue("hwdec", "auto").toString();
-    m_mpvCore->setupHardwareAcceleration(hwdec);
+QStringList MediaPlayer::prefetchHints() const
+{
+    return m_prefetchHints;
 }
 
 void MediaPlayer::onMpvError(const QString &message)
@@ -113,25 +360,235 @@ void MediaPlayer::onMpvError(const QString &message)
     emit error(message);
 }
 
-void MediaPlayer::onSettingsChanged()
+void MediaPlayer::onSettingsChanged(const QStringList &keys)
 {
-    // Update volume
-    int volume = m_settings->value("volume", 100).toInt();
-    m_playbackController->setVolume(volume);
+    static const QStringList proxyKeys = {settingKey(Setting::HlsCache), settingKey(Setting::HlsCacheMB),
+                                          settingKey(Setting::VodCache), settingKey(Setting::VodCacheMB)};
+    static const QStringList cacheKeys = {settingKey(Setting::AdaptiveCache), settingKey(Setting::CacheMemoryMB),
+                                          settingKey(Setting::Timeshift), settingKey(Setting::TimeshiftMinutes),
+                                          settingKey(Setting::TimeshiftMemoryMB)};
+
+    // Only touch what changed; restarting the proxy or resizing caches mid-stream is not free
+    if (keys.contains(settingKey(Setting::Volume)))
+    {
+        m_playbackController->setVolume(m_settings->get<Setting::Volume>());
+    }
+
+    if (std::any_of(keys.cbegin(), keys.cend(), [](const QString &key)
+                    { return proxyKeys.contains(key); }))
+    {
+        applyProxySettings();
+    }
+
+    if (std::any_of(keys.cbegin(), keys.cend(), [](const QString &key)
+                    { return cacheKeys.contains(key); }))
+    {
+        applyCacheSettings();
+    }
+
+    if (keys.contains(settingKey(Setting::MpvConfigFile)) || keys.contains(settingKey(Setting::MpvProfiles)))
+    {
+        reconfigureMpv();
+    }
+
+    // Channels that name their own profile keep it
+    if (keys.contains(settingKey(Setting::PerformanceProfile)) && m_mediaProfile.isEmpty())
+    {
+        setPerformanceProfile(m_settings->get<Setting::PerformanceProfile>());
+    }
+}
+
+void MediaPlayer::onMpvSettingsChanged(const QStringList &keys)
+{
+    // The settings are only one layer of the options; the resolved set is compared instead
+    Q_UNUSED(keys);
+    reconfigureMpv();
+}
+
+QMap<QString, QString> MediaPlayer::resolveMpvOptions()
+{
+    MpvConfig config;
+
+    QString configFile = m_settings->get<Setting::MpvConfigFile>();
+    if (!configFile.isEmpty() && QFile::exists(configFile))
+    {
+        try
+        {
+            config.loadFile(configFile);
+        }
+        catch (const QString &message)
+        {
+            qWarning() << "Ignoring mpv config file:" << message;
+        }
+    }
+
+    config.addSettings(m_settings->allMpvSettings());
+
+    QStringList profiles = m_settings->get<Setting::MpvProfiles>().split(',', Qt::SkipEmptyParts);
+    for (QString &profile : profiles)
+    {
+        profile = profile.trimmed();
+    }
+
+    QMap<QString, QString> options = config.resolve(profiles);
+
+    // Named by content, so edited profiles change the include and restart the core
+    QByteArray profileData = config.profileData();
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QString profileName = "mpv-profiles-" +
+                          QCryptographicHash::hash(profileData, QCryptographicHash::Sha1).toHex().left(12) + ".conf";
+    QString profilePath = cacheDir + "/" + profileName;
+    if (!QFile::exists(profilePath))
+    {
+        QDir().mkpath(cacheDir);
+        QSaveFile file(profilePath);
+        if (!file.open(QIODevice::WriteOnly) || file.write(profileData) != profileData.size() || !file.commit())
+        {
+            qWarning() << "Could not write mpv profiles:" << profilePath;
+        }
+    }
+
+    // mpv reads the include when a core starts, so earlier versions are no longer needed
+    QDir dir(cacheDir);
+    const QStringList oldFiles = dir.entryList({"mpv-profiles-*.conf"}, QDir::Files);
+    for (const QString &name : oldFiles)
+    {
+        if (name != profileName && !dir.remove(name))
+        {
+            qDebug() << "Could not remove old mpv profiles:" << name;
+        }
+    }
+    options.insert("include", profilePath);
+
+    m_mpvConfig = config;
+    return options;
+}
+
+void MediaPlayer::reconfigureMpv()
+{
+    QMap<QString, QString> options = resolveMpvOptions();
+
+    // Rewriting an unchanged option such as hwdec can reinitialize the decoder
+    QStringList changed;
+    bool needsRestart = false;
+    for (auto it = options.constBegin(); it != options.constEnd(); ++it)
+    {
+        if (m_mpvOptions.value(it.key()) != it.value() || !m_mpvOptions.contains(it.key()))
+        {
+            changed.append(it.key());
+            needsRestart = needsRestart || MpvConfig::isInitOnly(it.key());
+        }
+    }
+
+    // Dropping an init-only option only takes effect in a new core as well
+    for (auto it = m_mpvOptions.constBegin(); it != m_mpvOptions.constEnd(); ++it)
+    {
+        needsRestart = needsRestart || (!options.contains(it.key()) && MpvConfig::isInitOnly(it.key()));
+    }
+
+    m_mpvOptions = options;
+
+    if (needsRestart)
+    {
+        m_mpvCore->restart(options);
+        return;
+    }
+
+    for (const QString &key : std::as_const(changed))
+    {
+        if (key == "hwdec")
+        {
+            m_mpvCore->setupHardwareAcceleration(options.value(key));
+        }
+        else
+        {
+            m_mpvCore->setProperty(key, options.value(key));
+        }
+    }
 }
 
-void MediaPlayer::onMpvSettingsChanged()
+void MediaPlayer::onCoreRestarted(double position, bool paused)
 {
-    // Apply MPV settings
-    QMap<QString, QVariant> mpvSettings = m_settings->allMpvSettings();
-    for (auto it = mpvSettings.constBegin(); it != mpvSettings.constEnd(); ++it)
+    // The new core starts without the profile; apply it again
+    QString profile = m_performanceProfile;
+    m_performanceProfile.clear();
+    setPerformanceProfile(profile);
+
+    if (m_currentMedia.isEmpty())
     {
-        m_mpvCore->setProperty(it.key(), it.value());
+        return;
     }
 
-    // Set up hardware acceleration
-    QString hwdec = m_settings->mpvValue("hwdec", "auto").toString();
-    m_mpvCore->setupHardwareAcceleration(hwdec);
+    // Live streams have no duration and rejoin at the live edge; everything else continues where it was
+    QVariantMap options;
+    if (position > 0 && m_playbackController->duration() > 0)
+    {
+        options.insert("start", QString::number(position, 'f', 3));
+    }
+    if (paused)
+    {
+        options.insert("pause", "yes");
+    }
+
+    qInfo() << "Reopening" << m_currentMedia << "in the restarted MPV core";
+    openMedia(m_currentMedia, options);
+}
+
+void MediaPlayer::applyProxySettings()
+{
+    m_streamProxy->setMemoryBudget(static_cast<qint64>(m_settings->get<Setting::HlsCacheMB>()) * 1024 * 1024);
+
+    bool vodCache = m_settings->get<Setting::VodCache>();
+    m_vodCache->setQuota(static_cast<qint64>(m_settings->get<Setting::VodCacheMB>()) * 1024 * 1024);
+    m_streamProxy->setDiskCache(vodCache ? m_vodCache : nullptr);
+
+    if (m_settings->get<Setting::HlsCache>() || vodCache)
+    {
+        m_streamProxy->start();
+    }
+    else
+    {
+        m_streamProxy->stop();
+    }
+}
+
+void MediaPlayer::onFileLoaded()
+{
+    m_resumeMedia = m_loadingMedia;
+
+    // Live streams have no duration; VOD is seekable without help
+    if (!m_isNetworkStream || !m_settings->get<Setting::Timeshift>() || m_mpvCore->getProperty("duration").isValid())
+    {
+        return;
+    }
+
+    // The timeshift window owns the cache limits while it is active
+    m_cacheController->stop();
+    m_timeshift->start();
+}
+
+void MediaPlayer::onPositionChanged(double position)
+{
+    if (m_resumeMedia.isEmpty() || !m_settings->get<Setting::ResumePlayback>())
+    {
+        return;
+    }
+
+    // Live streams have no duration and are ignored by the store
+    m_resumeStore->setPosition(m_resumeMedia, position, m_playbackController->duration());
+}
+
+void MediaPlayer::applyCacheSettings()
+{
+    m_cacheController->setMemoryBudget(static_cast<qint64>(m_settings->get<Setting::CacheMemoryMB>()) * 1024 * 1024);
+    m_cacheController->setEnabled(m_settings->get<Setting::AdaptiveCache>());
+
+    m_timeshift->setWindow(m_settings->get<Setting::TimeshiftMinutes>());
+    m_timeshift->setMemoryBudget(static_cast<qint64>(m_settings->get<Setting::TimeshiftMemoryMB>()) * 1024 * 1024);
+    if (!m_settings->get<Setting::Timeshift>())
+    {
+        m_timeshift->stop();
+    }
 }
 
 bool MediaPlayer::isNetworkUrl(const QString &path) const
@@ -3,8 +3,17 @@
 
 #include <QObject>
 #include <QString>
+#include <QStringList>
 #include "mpvcore.h"
+#include "mpvconfig.h"
 #include "playbackcontroller.h"
+#include "streamproxy.h"
+#include "adaptivecachecontroller.h"
+#include "timeshiftcontroller.h"
+#include "keyframeindexer.h"
+#include "thumbnailgenerator.h"
+#include "resumestore.h"
+#include "playbackstats.h"
 #include "../data/settings.h"
 #include "../data/channeldata.h"
 
@@ -46,11 +55,60 @@ public:
      */
     PlaybackController *playbackController() const;
 
+    /**
+     * @brief Get the local HLS caching proxy
+     * @return Stream proxy instance
+     */
+    StreamProxy *streamProxy() const;
+
+    /**
+     * @brief Get the on-disk cache for VOD streams
+     * @return VOD cache instance
+     */
+    VodCache *vodCache() const;
+
+    /**
+     * @brief Get the controller that sizes the demuxer cache from throughput
+     * @return Adaptive cache controller instance
+     */
+    AdaptiveCacheController *cacheController() const;
+
+    /**
+     * @brief Get the controller for pausing and rewinding live streams
+     * @return Timeshift controller instance
+     */
+    TimeshiftController *timeshiftController() const;
+
+    /**
+     * @brief Get the keyframe index of the current local file
+     * @return Keyframe indexer instance
+     */
+    KeyframeIndexer *keyframeIndexer() const;
+
+    /**
+     * @brief Get the generator of seek bar thumbnails
+     * @return Thumbnail generator instance
+     */
+    ThumbnailGenerator *thumbnailGenerator() const;
+
+    /**
+     * @brief Get the store of resume positions
+     * @return Resume store instance
+     */
+    ResumeStore *resumeStore() const;
+
+    /**
+     * @brief Get the sampler of the figures shown in the stats overlay
+     * @return Playback stats instance
+     */
+    PlaybackStats *playbackStats() const;
+
     /**
      * @brief Load a media file or URL
      * @param path File path or URL
+     * @param profile Performance profile to play it with, empty for the global one
      */
-    void loadMedia(const QString &path);
+    void loadMedia(const QString &path, const QString &profile = QString());
 
     /**
      * @brief Load a channel
@@ -75,6 +133,48 @@ public:
      */
     void applySettings();
 
+    /**
+     * @brief Switch the running core to a performance profile
+     *
+     * The profiles are included into mpv when it starts, so a switch is an
+     * apply-profile command and all of a profile's options change together.
+     * The previous profile is always restored first, so none of its options
+     * linger. Cache options the profile sets take precedence over the cache
+     * settings and are left alone by the adaptive cache controller, which is
+     * off entirely under low-latency.
+     *
+     * @param profile Profile name, empty for none
+     */
+    void setPerformanceProfile(const QString &profile);
+
+    /**
+     * @brief Get the performance profile in use
+     * @return Profile name, empty for none
+     */
+    QString performanceProfile() const;
+
+    /**
+     * @brief Check whether the low-latency profile is in use
+     * @return True under low-latency, where the cache is not adapted
+     */
+    bool isLowLatency() const;
+
+    /**
+     * @brief Hint which streams are likely to be played next
+     *
+     * Host names of network streams are resolved ahead of time, so tuning
+     * to one of them does not wait for DNS.
+     *
+     * @param urls Stream URLs, most likely first
+     */
+    void setPrefetchHints(const QStringList &urls);
+
+    /**
+     * @brief Get the streams hinted as likely to be played next
+     * @return Stream URLs, most likely first
+     */
+    QStringList prefetchHints() const;
+
 public slots:
     /**
      * @brief Handle MPV errors
@@ -83,14 +183,35 @@ public slots:
     void onMpvError(const QString &message);
 
     /**
-     * @brief Handle settings changes
+     * @brief Apply the settings that changed
+     * @param keys Keys whose values changed
+     */
+    void onSettingsChanged(const QStringList &keys);
+
+    /**
+     * @brief Apply the MPV options that changed
+     * @param keys MPV option names whose values changed
+     */
+    void onMpvSettingsChanged(const QStringList &keys);
+
+    /**
+     * @brief Start timeshifting once a live stream has been opened
+     */
+    void onFileLoaded();
+
+private slots:
+    /**
+     * @brief Remember the position of the current media
+     * @param position Position in seconds
      */
-    void onSettingsChanged();
+    void onPositionChanged(double position);
 
     /**
-     * @brief Handle MPV settings changes
+     * @brief Reopen the current media after the mpv core was restarted
+     * @param position Position the old core was at, -1 if unknown
+     * @param paused True if the old core was paused
      */
-    void onMpvSettingsChanged();
+    void onCoreRestarted(double position, bool paused);
 
 signals:
     /**
@@ -113,10 +234,60 @@ private:
      */
     bool isNetworkUrl(const QString &path) const;
 
+    /**
+     * @brief Start, stop and size the stream proxy and VOD cache from the settings
+     */
+    void applyProxySettings();
+
+    /**
+     * @brief Configure the adaptive cache and timeshift controllers from the settings
+     */
+    void applyCacheSettings();
+
+    /**
+     * @brief Resolve the MPV options from the config file, profiles and settings
+     *
+     * Also writes the profiles to a file the options include, so they can
+     * be switched at runtime.
+     *
+     * @return Option values by name
+     */
+    QMap<QString, QString> resolveMpvOptions();
+
+    /**
+     * @brief Apply a changed MPV configuration
+     *
+     * Options that can change at runtime are set as properties; if an
+     * init-only option changed, the core is restarted instead.
+     */
+    void reconfigureMpv();
+
+    /**
+     * @brief Open a media with per-file options
+     * @param path File path or URL
+     * @param options Options for this file only, such as the start position
+     */
+    void openMedia(const QString &path, const QVariantMap &options);
+
     MPVCore *m_mpvCore;
     PlaybackController *m_playbackController;
+    StreamProxy *m_streamProxy;
+    VodCache *m_vodCache;
+    AdaptiveCacheController *m_cacheController;
+    TimeshiftController *m_timeshift;
+    KeyframeIndexer *m_keyframeIndexer;
+    ThumbnailGenerator *m_thumbnails;
+    ResumeStore *m_resumeStore;
+    PlaybackStats *m_stats;
     Settings *m_settings;
     QString m_currentMedia;
+    QString m_loadingMedia;
+    QString m_resumeMedia;
+    QStringList m_prefetchHints;
+    QMap<QString, QString> m_mpvOptions;
+    MpvConfig m_mpvConfig;
+    QString m_performanceProfile;
+    QString m_mediaProfile;
     bool m_isNetworkStream;
 };
 
@@ -0,0 +1,298 @@
+#include "mpvconfig.h"
+#include "../data/settings.h"
+#include <QDebug>
+#include <QFile>
+#include <algorithm>
+
+static const int MAX_PROFILE_DEPTH = 8;
+
+// The cache options here win over the cache settings and the adaptive cache controller
+static const char PERFORMANCE_PROFILES[] = R"(
+[low-latency]
+profile-desc=Shortest delay to the live edge and fastest channel changes
+vd-lavc-threads=1
+hwdec=auto-safe
+video-sync=audio
+interpolation=no
+scale=bilinear
+cscale=bilinear
+dscale=bilinear
+cache-secs=2
+demuxer-readahead-secs=1
+demuxer-max-bytes=16MiB
+
+[power-saver]
+profile-desc=Hardware decoding, cheap scaling and bursty network reads
+vd-lavc-threads=2
+hwdec=auto-safe
+video-sync=audio
+interpolation=no
+scale=bilinear
+cscale=bilinear
+dscale=bilinear
+cache-secs=30
+demuxer-readahead-secs=30
+demuxer-max-bytes=150MiB
+
+[quality]
+profile-desc=High quality scaling and smooth motion at the cost of CPU and GPU time
+vd-lavc-threads=0
+hwdec=auto-copy-safe
+video-sync=display-resample
+interpolation=yes
+scale=ewa_lanczossharp
+cscale=ewa_lanczossharp
+dscale=mitchell
+cache-secs=20
+demuxer-readahead-secs=20
+demuxer-max-bytes=300MiB
+)";
+
+MpvConfig::MpvConfig()
+{
+    loadData(QByteArray(PERFORMANCE_PROFILES));
+}
+
+void MpvConfig::loadFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        throw QString("Could not open file: %1").arg(filePath);
+    }
+
+    QByteArray data = file.readAll();
+    file.close();
+
+    loadData(data);
+}
+
+void MpvConfig::loadData(const QByteArray &data)
+{
+    const QString text = QString::fromUtf8(data);
+    OptionList *section = &m_options;
+
+    int lineNumber = 0;
+    for (QStringView line : QStringView(text).split(QLatin1Char('\n')))
+    {
+        ++lineNumber;
+        line = line.trimmed();
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#')))
+        {
+            continue;
+        }
+
+        if (line.startsWith(QLatin1Char('[')))
+        {
+            if (!line.endsWith(QLatin1Char(']')) || line.size() < 3)
+            {
+                throw QString("mpv config parse error at line %1: bad profile header").arg(lineNumber);
+            }
+
+            QString name = line.mid(1, line.size() - 2).trimmed().toString();
+            if (!m_profiles.contains(name))
+            {
+                m_profileNames.append(name);
+            }
+
+            // A section named again adds to the existing profile, as in mpv
+            section = &m_profiles[name];
+            continue;
+        }
+
+        if (line.startsWith(QLatin1String("--")))
+        {
+            line = line.mid(2);
+        }
+
+        qsizetype equals = line.indexOf(QLatin1Char('='));
+        QStringView name = (equals < 0 ? line : line.left(equals)).trimmed();
+        if (name.isEmpty())
+        {
+            throw QString("mpv config parse error at line %1: missing option name").arg(lineNumber);
+        }
+
+        // Descriptions and conditions are metadata of the profile, not options
+        if (section != &m_options && name.startsWith(QLatin1String("profile-")))
+        {
+            continue;
+        }
+
+        QString value = equals < 0 ? QStringLiteral("yes") : unquote(line.mid(equals + 1).trimmed());
+        section->append(qMakePair(name.toString(), value));
+    }
+}
+
+void MpvConfig::setOverride(const QString &name, const QString &value)
+{
+    m_overrides.insert(name, value);
+}
+
+void MpvConfig::setDefault(const QString &name, const QString &value)
+{
+    m_defaults.insert(name, value);
+}
+
+void MpvConfig::addSettings(const QMap<QString, QVariant> &settings)
+{
+    static const QMap<QString, QVariant> defaults = Settings::defaultMpvSettings();
+
+    for (auto it = settings.constBegin(); it != settings.constEnd(); ++it)
+    {
+        QString value = it.value().typeId() == QMetaType::Bool ? (it.value().toBool() ? "yes" : "no") : it.value().toString();
+
+        // Stored defaults are indistinguishable from chosen ones, so only a different value is the user's
+        auto def = defaults.constFind(it.key());
+        if (def != defaults.constEnd() && def.value() == it.value())
+        {
+            setDefault(it.key(), value);
+        }
+        else
+        {
+            setOverride(it.key(), value);
+        }
+    }
+}
+
+QStringList MpvConfig::profiles() const
+{
+    return m_profileNames;
+}
+
+MpvConfig::OptionList MpvConfig::profileOptions(const QString &name) const
+{
+    return m_profiles.value(name);
+}
+
+QMap<QString, QString> MpvConfig::profileValues(const QString &name) const
+{
+    QMap<QString, QString> values;
+    apply(m_profiles.value(name), values, 1);
+    return values;
+}
+
+QStringList MpvConfig::performanceProfiles()
+{
+    return {"low-latency", "power-saver", "quality"};
+}
+
+QByteArray MpvConfig::profileData() const
+{
+    QByteArray data;
+    for (const QString &name : m_profileNames)
+    {
+        data += '[' + name.toUtf8() + "]\n";
+        data += "profile-restore=copy-equal\n";
+        for (const auto &option : m_profiles.value(name))
+        {
+            // %length% quoting keeps any value intact
+            QByteArray value = option.second.toUtf8();
+            data += option.first.toUtf8() + "=%" + QByteArray::number(value.size()) + '%' + value + '\n';
+        }
+        data += '\n';
+    }
+    return data;
+}
+
+QMap<QString, QString> MpvConfig::resolve(const QStringList &profiles) const
+{
+    // What the player needs whatever the user configured
+    QMap<QString, QString> resolved = {
+        {"video-sync", "display-resample"},
+        {"hwdec", "auto"},
+        {"vo", "gpu"},
+        {"gpu-api", "auto"},
+        {"keep-open", "yes"}};
+
+    for (auto it = m_defaults.constBegin(); it != m_defaults.constEnd(); ++it)
+    {
+        resolved.insert(it.key(), it.value());
+    }
+
+    apply(m_options, resolved, 0);
+
+    for (const QString &profile : profiles)
+    {
+        if (!m_profiles.contains(profile))
+        {
+            qWarning() << "Unknown mpv profile:" << profile;
+            continue;
+        }
+        apply(m_profiles.value(profile), resolved, 1);
+    }
+
+    for (auto it = m_overrides.constBegin(); it != m_overrides.constEnd(); ++it)
+    {
+        resolved.insert(it.key(), it.value());
+    }
+
+    return resolved;
+}
+
+bool MpvConfig::isInitOnly(const QString &name)
+{
+    // Read once when the core starts; setting them later is ignored or rejected
+    static const QStringList initOnly = {
+        "vo", "ao", "gpu-api", "gpu-context", "gpu-hwdec-interop", "opengl-es",
+        "config", "config-dir", "include", "input-default-bindings", "input-vo-keyboard"};
+
+    if (initOnly.contains(name))
+    {
+        return true;
+    }
+
+    return std::any_of(std::begin(SETTINGS_SCHEMA), std::end(SETTINGS_SCHEMA), [&name](const SettingInfo &info)
+                       { return info.initOnly && name == QLatin1String(info.key); });
+}
+
+void MpvConfig::apply(const OptionList &options, QMap<QString, QString> &resolved, int depth) const
+{
+    for (const auto &option : options)
+    {
+        if (option.first != QLatin1String("profile"))
+        {
+            resolved.insert(option.first, option.second);
+            continue;
+        }
+
+        if (depth >= MAX_PROFILE_DEPTH)
+        {
+            qWarning() << "mpv profiles nested too deeply, ignoring:" << option.second;
+            continue;
+        }
+
+        const QStringList names = option.second.split(QLatin1Char(','), Qt::SkipEmptyParts);
+        for (const QString &name : names)
+        {
+            apply(m_profiles.value(name.trimmed()), resolved, depth + 1);
+        }
+    }
+}
+
+QString MpvConfig::unquote(QStringView value)
+{
+    if (value.size() >= 2 && (value.front() == QLatin1Char('"') || value.front() == QLatin1Char('\'')))
+    {
+        qsizetype end = value.indexOf(value.front(), 1);
+        if (end > 0)
+        {
+            return value.mid(1, end - 1).toString();
+        }
+    }
+
+    // %length%value quotes a value that may contain anything
+    if (value.startsWith(QLatin1Char('%')))
+    {
+        qsizetype end = value.indexOf(QLatin1Char('%'), 1);
+        bool ok = false;
+        int length = end > 0 ? value.mid(1, end - 1).toInt(&ok) : 0;
+        if (ok && length >= 0)
+        {
+            return value.mid(end + 1, length).toString();
+        }
+    }
+
+    // Unquoted values end at a comment
+    qsizetype comment = value.indexOf(QLatin1Char('#'));
+    return (comment < 0 ? value : value.left(comment)).trimmed().toString();
+}
\ No newline at end of file
@@ -0,0 +1,152 @@
+#ifndef MPVCONFIG_H
+#define MPVCONFIG_H
+
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <QList>
+#include <QPair>
+#include <QMap>
+#include <QByteArray>
+#include <QVariant>
+
+/**
+ * @brief The MpvConfig class resolves the options an mpv instance starts with
+ *
+ * Options come in layers, each overriding the one before: the built-in
+ * defaults and the application settings still at their defaults, the top
+ * of an mpv.conf-style file, the named profiles selected for the session,
+ * and finally the application settings the user changed. A vo or hwdec
+ * line in the file therefore holds until the same setting is changed in
+ * the application.
+ * The file follows mpv's own syntax: "name=value" or "--name=value" lines,
+ * bare names meaning "yes", "#" comments, "[name]" profile sections and
+ * "profile=a,b" lines that pull profiles in where they appear. The result
+ * is a single option set that is applied before mpv_initialize.
+ *
+ * The performance profiles low-latency, power-saver and quality are built
+ * in; a file may add to them. Their cache options take precedence over the
+ * cache settings and the adaptive cache controller while they are active.
+ */
+class MpvConfig
+{
+public:
+    typedef QList<QPair<QString, QString>> OptionList;
+
+    /**
+     * @brief Constructor
+     */
+    MpvConfig();
+
+    /**
+     * @brief Read options and profiles from an mpv.conf-style file
+     * @param filePath Path to the file
+     * @throws QString error message if the file cannot be read or parsed
+     */
+    void loadFile(const QString &filePath);
+
+    /**
+     * @brief Read options and profiles from mpv.conf-style data
+     * @param data UTF-8 file contents
+     * @throws QString error message if parsing fails
+     */
+    void loadData(const QByteArray &data);
+
+    /**
+     * @brief Set an option that overrides the file and profiles
+     * @param name Option name
+     * @param value Option value
+     */
+    void setOverride(const QString &name, const QString &value);
+
+    /**
+     * @brief Set an option that the file and profiles override
+     * @param name Option name
+     * @param value Option value
+     */
+    void setDefault(const QString &name, const QString &value);
+
+    /**
+     * @brief Add the MPV settings of the application
+     *
+     * Settings that differ from their schema default, and settings outside
+     * the schema, override the file and profiles; the others only replace
+     * the built-in defaults.
+     *
+     * @param settings MPV settings by option name
+     */
+    void addSettings(const QMap<QString, QVariant> &settings);
+
+    /**
+     * @brief Get the names of the profiles defined in the file
+     * @return Profile names in the order they were defined
+     */
+    QStringList profiles() const;
+
+    /**
+     * @brief Get the options of a profile
+     * @param name Profile name
+     * @return Options in file order, empty if the profile does not exist
+     */
+    OptionList profileOptions(const QString &name) const;
+
+    /**
+     * @brief Get the values a profile sets, with the profiles it references expanded
+     * @param name Profile name
+     * @return Option values by name, empty if the profile does not exist
+     */
+    QMap<QString, QString> profileValues(const QString &name) const;
+
+    /**
+     * @brief Get the built-in performance profiles
+     * @return Profile names
+     */
+    static QStringList performanceProfiles();
+
+    /**
+     * @brief Write all profiles as an mpv config file mpv can include
+     *
+     * Every profile restores the values it changed when it is unapplied.
+     *
+     * @return Config file contents
+     */
+    QByteArray profileData() const;
+
+    /**
+     * @brief Resolve all layers into one option set
+     * @param profiles Profiles to apply on top of the file
+     * @return Option values by name
+     */
+    QMap<QString, QString> resolve(const QStringList &profiles = QStringList()) const;
+
+    /**
+     * @brief Check whether an option only takes effect when mpv is initialized
+     * @param name Option name
+     * @return True if changing the option needs a new mpv instance
+     */
+    static bool isInitOnly(const QString &name);
+
+private:
+    /**
+     * @brief Apply options in order, expanding profile references
+     * @param options Options to apply
+     * @param resolved Option set to update
+     * @param depth Profile nesting depth, to stop reference cycles
+     */
+    void apply(const OptionList &options, QMap<QString, QString> &resolved, int depth) const;
+
+    /**
+     * @brief Remove quotes and mpv's %length% prefix from a value
+     * @param value Raw value
+     * @return Plain value
+     */
+    static QString unquote(QStringView value);
+
+    OptionList m_options;
+    QStringList m_profileNames;
+    QMap<QString, OptionList> m_profiles;
+    QMap<QString, QString> m_defaults;
+    QMap<QString, QString> m_overrides;
+};
+
+#endif // MPVCONFIG_H
\ No newline at end of file
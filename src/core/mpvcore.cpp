@@ -1,5 +1,6 @@
 #include "mpvcore.h"
 #include <QDebug>
+#include <QtConcurrent/QtConcurrentRun>
 #include <stdexcept>
 #include <clocale>
 
@@ -28,14 +29,25 @@ static void on_mpv_render_update(void *ctx)
 }
 
 MPVCore::MPVCore(QObject *parent)
-    : QObject(parent), m_mpv(nullptr), m_mpvGL(nullptr)
+    : QObject(parent), m_mpv(nullptr), m_mpvGL(nullptr), m_nextRequestId(1), m_propertyWrites(0), m_restartPending(false)
 {
     // Set C locale to ensure consistent number formatting
     std::setlocale(LC_NUMERIC, "C");
+
+    connect(&m_spareWatcher, &QFutureWatcher<mpv_handle *>::finished, this, &MPVCore::onSpareReady);
 }
 
 MPVCore::~MPVCore()
 {
+    if (m_spareWatcher.isRunning())
+    {
+        m_spareWatcher.waitForFinished();
+        if (mpv_handle *spare = m_spareWatcher.result())
+        {
+            mpv_terminate_destroy(spare);
+        }
+    }
+
     if (m_mpvGL)
     {
         mpv_render_context_free(m_mpvGL);
@@ -49,48 +61,159 @@ MPVCore::~MPVCore()
     }
 }
 
-bool MPVCore::initialize()
+bool MPVCore::initialize(const QMap<QString, QString> &options)
 {
-    m_mpv = mpv_create();
+    m_mpv = createHandle(options);
     if (!m_mpv)
     {
-        qWarning() << "Failed to create MPV instance";
         return false;
     }
 
-    // Set default options
-    mpv_set_option_string(m_mpv, "video-sync", "display-resample");
-    mpv_set_option_string(m_mpv, "hwdec", "auto");
-    mpv_set_option_string(m_mpv, "vo", "gpu");
-    mpv_set_option_string(m_mpv, "gpu-api", "auto");
-    mpv_set_option_string(m_mpv, "keep-open", "yes");
+    // Set up event handling
+    mpv_set_wakeup_callback(m_mpv, on_mpv_events, this);
+
+    // Observe properties
+    observeProperty("time-pos");
+    observeProperty("duration");
+    observeProperty("pause");
+    observeProperty("volume");
+    observeProperty("eof-reached");
+
+    return true;
+}
+
+mpv_handle *MPVCore::createHandle(const QMap<QString, QString> &options)
+{
+    mpv_handle *mpv = mpv_create();
+    if (!mpv)
+    {
+        qWarning() << "Failed to create MPV instance";
+        return nullptr;
+    }
+
+    // Everything is set as an option, so init-only ones such as vo take effect
+    for (auto it = options.constBegin(); it != options.constEnd(); ++it)
+    {
+        int result = mpv_set_option_string(mpv, it.key().toUtf8().constData(), it.value().toUtf8().constData());
+        if (result < 0)
+        {
+            qWarning() << "Failed to set MPV option" << it.key() << "=" << it.value() << ":" << mpv_error_string(result);
+        }
+    }
 
     // Enable message handling
-    int result = mpv_request_log_messages(m_mpv, "warn");
+    int result = mpv_request_log_messages(mpv, "warn");
     if (result < 0)
     {
         qWarning() << "Failed to set log messages:" << mpv_error_string(result);
     }
 
     // Initialize MPV
-    result = mpv_initialize(m_mpv);
+    result = mpv_initialize(mpv);
     if (result < 0)
     {
         qWarning() << "Failed to initialize MPV:" << mpv_error_string(result);
-        return false;
+        mpv_terminate_destroy(mpv);
+        return nullptr;
+    }
+
+    return mpv;
+}
+
+void MPVCore::destroyLater(mpv_handle *handle)
+{
+    // Termination waits for mpv's threads to wind down
+    QtConcurrent::run([handle]()
+                      { mpv_terminate_destroy(handle); });
+}
+
+void MPVCore::restart(const QMap<QString, QString> &options)
+{
+    m_spareOptions = options;
+
+    if (m_spareWatcher.isRunning())
+    {
+        m_restartPending = true;
+        return;
+    }
+
+    qInfo() << "Restarting MPV core with new options";
+    m_spareWatcher.setFuture(QtConcurrent::run(&MPVCore::createHandle, options));
+}
+
+bool MPVCore::isRestarting() const
+{
+    return m_spareWatcher.isRunning() || m_restartPending;
+}
+
+void MPVCore::onSpareReady()
+{
+    mpv_handle *spare = m_spareWatcher.result();
+
+    // Options changed again while this one was starting
+    if (m_restartPending)
+    {
+        m_restartPending = false;
+        if (spare)
+        {
+            destroyLater(spare);
+        }
+        restart(m_spareOptions);
+        return;
+    }
+
+    if (!spare)
+    {
+        emit error("Could not restart MPV with the new options");
+        return;
+    }
+
+    // What the user hears and where they were carry over to the new instance
+    double position = -1.0;
+    bool paused = false;
+    QVariant volume;
+    QVariant mute;
+    if (m_mpv)
+    {
+        QVariant timePos = getProperty("time-pos");
+        position = timePos.isValid() ? timePos.toDouble() : -1.0;
+        paused = getProperty("pause").toBool();
+        volume = getProperty("volume");
+        mute = getProperty("mute");
+    }
+
+    // The video widget frees the renderer with its GL context current
+    emit aboutToRestart();
+    if (m_mpvGL)
+    {
+        qWarning() << "MPV renderer was not released before the restart";
+        releaseRenderer();
+    }
+
+    mpv_handle *old = m_mpv;
+    m_mpv = spare;
+    if (old)
+    {
+        mpv_set_wakeup_callback(old, nullptr, nullptr);
+        destroyLater(old);
     }
 
-    // Set up event handling
     mpv_set_wakeup_callback(m_mpv, on_mpv_events, this);
+    for (const QString &name : std::as_const(m_observedProperties))
+    {
+        mpv_observe_property(m_mpv, 0, name.toUtf8().constData(), MPV_FORMAT_NODE);
+    }
 
-    // Observe properties
-    observeProperty("time-pos");
-    observeProperty("duration");
-    observeProperty("pause");
-    observeProperty("volume");
-    observeProperty("eof-reached");
+    if (volume.isValid())
+    {
+        setProperty("volume", volume);
+    }
+    if (mute.isValid())
+    {
+        setProperty("mute", mute);
+    }
 
-    return true;
+    emit coreRestarted(position, paused);
 }
 
 bool MPVCore::initializeRenderer(QOpenGLContext *context)
@@ -160,7 +283,16 @@ bool MPVCore::initializeRenderer(QOpenGLContext *context)
     return true;
 }
 
-void MPVCore::loadFile(const QString &path)
+void MPVCore::releaseRenderer()
+{
+    if (m_mpvGL)
+    {
+        mpv_render_context_free(m_mpvGL);
+        m_mpvGL = nullptr;
+    }
+}
+
+void MPVCore::loadFile(const QString &path, const QVariantMap &options)
 {
     if (!m_mpv)
     {
@@ -168,6 +300,30 @@ void MPVCore::loadFile(const QString &path)
         return;
     }
 
+    if (!options.isEmpty())
+    {
+        // Named arguments, so the options land in the right slot whatever the mpv version
+        QVariantMap command;
+        command.insert("name", "loadfile");
+        command.insert("url", path);
+        command.insert("flags", "replace");
+        command.insert("options", options);
+
+        mpv_node node;
+        if (variantToMpvNode(command, &node))
+        {
+            mpv_node result;
+            int error = mpv_command_node(m_mpv, &node, &result);
+            freeMpvNode(&node);
+            if (error >= 0)
+            {
+                mpv_free_node_contents(&result);
+                return;
+            }
+            qWarning() << "Failed to load file with options:" << mpv_error_string(error);
+        }
+    }
+
     const QByteArray pathUtf8 = path.toUtf8();
     const char *args[] = {"loadfile", pathUtf8.constData(), nullptr};
 
@@ -224,6 +380,49 @@ void MPVCore::seek(double position)
     }
 }
 
+quint64 MPVCore::seekAsync(double position, bool exact)
+{
+    if (!m_mpv)
+    {
+        return 0;
+    }
+
+    const QByteArray target = QByteArray::number(position, 'f', 3);
+    const char *args[] = {"seek", target.constData(), exact ? "absolute+exact" : "absolute+keyframes", nullptr};
+
+    // Ids start at 1; 0 is the reply id of fire-and-forget property writes
+    quint64 requestId = m_nextRequestId++;
+    int error = mpv_command_async(m_mpv, requestId, args);
+    if (error < 0)
+    {
+        qWarning() << "Failed to seek:" << mpv_error_string(error);
+        return 0;
+    }
+
+    return requestId;
+}
+
+quint64 MPVCore::seekRelativeAsync(double offset)
+{
+    if (!m_mpv)
+    {
+        return 0;
+    }
+
+    const QByteArray amount = QByteArray::number(offset, 'f', 3);
+    const char *args[] = {"seek", amount.constData(), "relative", nullptr};
+
+    quint64 requestId = m_nextRequestId++;
+    int error = mpv_command_async(m_mpv, requestId, args);
+    if (error < 0)
+    {
+        qWarning() << "Failed to seek:" << mpv_error_string(error);
+        return 0;
+    }
+
+    return requestId;
+}
+
 void MPVCore::setVolume(int volume)
 {
     setProperty("volume", volume);
@@ -245,6 +444,7 @@ void MPVCore::setProperty(const QString &name, const QVariant &value)
 
     int result = mpv_set_property_async(m_mpv, 0, name.toUtf8().constData(), MPV_FORMAT_NODE, &node);
     freeMpvNode(&node);
+    ++m_propertyWrites;
 
     if (result < 0)
     {
@@ -252,6 +452,34 @@ void MPVCore::setProperty(const QString &name, const QVariant &value)
     }
 }
 
+quint64 MPVCore::propertyWriteCount() const
+{
+    return m_propertyWrites;
+}
+
+quint64 MPVCore::getPropertiesAsync(const QStringList &names)
+{
+    if (!m_mpv)
+    {
+        return 0;
+    }
+
+    quint64 requestId = m_nextRequestId++;
+    int sent = 0;
+    for (const QString &name : names)
+    {
+        int error = mpv_get_property_async(m_mpv, requestId, name.toUtf8().constData(), MPV_FORMAT_NODE);
+        if (error < 0)
+        {
+            qWarning() << "Failed to read property:" << name << "error:" << mpv_error_string(error);
+            continue;
+        }
+        ++sent;
+    }
+
+    return sent > 0 ? requestId : 0;
+}
+
 QVariant MPVCore::getProperty(const QString &name)
 {
     if (!m_mpv)
@@ -290,6 +518,12 @@ void MPVCore::observeProperty(const QString &name)
         return;
     }
 
+    // Remembered so a restarted instance reports the same properties
+    if (!m_observedProperties.contains(name))
+    {
+        m_observedProperties.append(name);
+    }
+
     mpv_observe_property(m_mpv, 0, name.toUtf8().constData(), MPV_FORMAT_NODE);
 }
 
@@ -424,10 +658,25 @@ void MPVCore::handleEvents()
                 break;
             }
 
+            case MPV_EVENT_START_FILE:
+                emit fileStarted();
+                break;
+
             case MPV_EVENT_FILE_LOADED:
                 emit fileLoaded();
                 break;
 
+            case MPV_EVENT_END_FILE:
+            {
+                mpv_event_end_file *endFile = static_cast<mpv_event_end_file *>(event->data);
+                if (endFile)
+                {
+                    QString message = endFile->reason == MPV_END_FILE_REASON_ERROR ? QString::fromUtf8(mpv_error_string(endFile->error)) : QString();
+                    emit fileEnded(endFile->reason, message);
+                }
+                break;
+            }
+
             case MPV_EVENT_LOG_MESSAGE:
             {
                 mpv_event_log_message *msg = static_cast<mpv_event_log_message *>(event->data);
@@ -447,13 +696,35 @@ void MPVCore::handleEvents()
 
             case MPV_EVENT_COMMAND_REPLY:
             {
-                if (event->error < 0)
+                if (event->reply_userdata != 0)
+                {
+                    emit commandReply(event->reply_userdata, event->error);
+                }
+                else if (event->error < 0)
                 {
                     emit error(QString::fromUtf8(mpv_error_string(event->error)));
                 }
                 break;
             }
 
+            case MPV_EVENT_GET_PROPERTY_REPLY:
+            {
+                mpv_event_property *prop = static_cast<mpv_event_property *>(event->data);
+                if (prop)
+                {
+                    // Properties that do not apply right now, such as cache-speed of a local file, fail here
+                    QVariant value = event->error >= 0 && prop->format == MPV_FORMAT_NODE
+                                         ? mpvPropertyToVariant(*static_cast<mpv_node *>(prop->data))
+                                         : QVariant();
+                    emit propertyReply(event->reply_userdata, QString::fromUtf8(prop->name), value);
+                }
+                break;
+            }
+
+            case MPV_EVENT_PLAYBACK_RESTART:
+                emit playbackRestarted();
+                break;
+
             default:
                 break;
             }
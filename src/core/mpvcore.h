@@ -4,6 +4,9 @@
 #include <QObject>
 #include <QString>
 #include <QVariant>
+#include <QMap>
+#include <QStringList>
+#include <QFutureWatcher>
 #include <QOpenGLContext>
 #include <mpv/client.h>
 #include <mpv/render_gl.h>
@@ -29,9 +32,30 @@ public:
 
     /**
      * @brief Initialize MPV
+     * @param options Options applied before mpv_initialize
      * @return True if successful, false otherwise
      */
-    bool initialize();
+    bool initialize(const QMap<QString, QString> &options = QMap<QString, QString>());
+
+    /**
+     * @brief Replace the mpv instance with one started with new options
+     *
+     * The new instance is created and initialized on a worker thread while
+     * the current one keeps playing, then swapped in; the old one is torn
+     * down on a worker thread as well. aboutToRestart() is emitted just before
+     * the swap so the renderer can be released. Observed properties, volume and mute
+     * carry over, and coreRestarted() is emitted so the media can be opened
+     * again. A restart requested while one is being prepared replaces it.
+     *
+     * @param options Options applied before mpv_initialize
+     */
+    void restart(const QMap<QString, QString> &options);
+
+    /**
+     * @brief Check if a restart is being prepared
+     * @return True while the new instance is starting
+     */
+    bool isRestarting() const;
 
     /**
      * @brief Initialize the OpenGL renderer
@@ -40,11 +64,17 @@ public:
      */
     bool initializeRenderer(QOpenGLContext *context);
 
+    /**
+     * @brief Free the OpenGL renderer; the context it was created in must be current
+     */
+    void releaseRenderer();
+
     /**
      * @brief Load a file or URL
      * @param path File path or URL
+     * @param options Per-file options applied before the file is opened, e.g. start
      */
-    void loadFile(const QString &path);
+    void loadFile(const QString &path, const QVariantMap &options = QVariantMap());
 
     /**
      * @brief Play the current file
@@ -72,6 +102,25 @@ public:
      */
     void seek(double position);
 
+    /**
+     * @brief Seek to a position without waiting for mpv
+     *
+     * The command reply arrives as commandReply() with the returned id; the
+     * seek itself has completed when playbackRestarted() is emitted.
+     *
+     * @param position Position in seconds
+     * @param exact True for a frame-exact seek, false to land on the nearest keyframe
+     * @return Request id, 0 if the command could not be sent
+     */
+    quint64 seekAsync(double position, bool exact);
+
+    /**
+     * @brief Start an asynchronous seek relative to the current position
+     * @param offset Offset in seconds, negative to go back
+     * @return Request id, 0 if the command could not be sent
+     */
+    quint64 seekRelativeAsync(double offset);
+
     /**
      * @brief Set the volume
      * @param volume Volume level (0-100)
@@ -85,6 +134,12 @@ public:
      */
     void setProperty(const QString &name, const QVariant &value);
 
+    /**
+     * @brief Get how many properties have been written since the core was created
+     * @return Number of setProperty() calls that reached mpv
+     */
+    quint64 propertyWriteCount() const;
+
     /**
      * @brief Get a property
      * @param name Property name
@@ -92,6 +147,17 @@ public:
      */
     QVariant getProperty(const QString &name);
 
+    /**
+     * @brief Read properties without waiting for mpv
+     *
+     * All reads go out at once and share one request id; each value
+     * arrives as propertyReply(), in any order.
+     *
+     * @param names Property names
+     * @return Request id, 0 if nothing could be sent
+     */
+    quint64 getPropertiesAsync(const QStringList &names);
+
     /**
      * @brief Observe a property for changes
      * @param name Property name
@@ -126,11 +192,23 @@ signals:
      */
     void propertyChanged(const QString &name, const QVariant &value);
 
+    /**
+     * @brief Signal emitted when a file starts loading
+     */
+    void fileStarted();
+
     /**
      * @brief Signal emitted when a file is loaded
      */
     void fileLoaded();
 
+    /**
+     * @brief Signal emitted when a file is unloaded
+     * @param reason MPV end-file reason
+     * @param error Error message if the reason is an error, empty otherwise
+     */
+    void fileEnded(int reason, const QString &error);
+
     /**
      * @brief Signal emitted when playback ends
      */
@@ -141,19 +219,76 @@ signals:
      */
     void frameSwapped();
 
+    /**
+     * @brief Signal emitted when an asynchronous command finishes
+     * @param requestId Id returned when the command was sent
+     * @param error MPV error code, 0 or greater on success
+     */
+    void commandReply(quint64 requestId, int error);
+
+    /**
+     * @brief Signal emitted when an asynchronous property read finishes
+     * @param requestId Id returned when the read was sent
+     * @param name Property name
+     * @param value Property value, invalid if the property is unavailable
+     */
+    void propertyReply(quint64 requestId, const QString &name, const QVariant &value);
+
+    /**
+     * @brief Signal emitted when playback resumes after a seek or file start
+     */
+    void playbackRestarted();
+
     /**
      * @brief Signal emitted when an error occurs
      * @param message Error message
      */
     void error(const QString &message);
 
+    /**
+     * @brief Signal emitted right before a restart swaps in a new mpv instance
+     *
+     * The renderer of the old instance has to be released here, with its
+     * OpenGL context current; connect with Qt::DirectConnection.
+     */
+    void aboutToRestart();
+
+    /**
+     * @brief Signal emitted when a restart has swapped in a new mpv instance
+     *
+     * The renderer has to be initialized again, and the media that was
+     * playing has to be reopened.
+     *
+     * @param position Position of the old instance in seconds, -1 if unknown
+     * @param paused True if the old instance was paused
+     */
+    void coreRestarted(double position, bool paused);
+
 private slots:
     /**
      * @brief Handle MPV events
      */
     void handleEvents();
 
+    /**
+     * @brief Swap in the instance prepared by restart()
+     */
+    void onSpareReady();
+
 private:
+    /**
+     * @brief Create and initialize an mpv instance; safe to call from any thread
+     * @param options Options applied before mpv_initialize
+     * @return The instance, nullptr on failure
+     */
+    static mpv_handle *createHandle(const QMap<QString, QString> &options);
+
+    /**
+     * @brief Destroy an mpv instance on a worker thread
+     * @param handle Instance to destroy
+     */
+    static void destroyLater(mpv_handle *handle);
+
     /**
      * @brief Convert MPV property to QVariant
      * @param prop MPV property
@@ -177,6 +312,12 @@ private:
 
     mpv_handle *m_mpv;
     mpv_render_context *m_mpvGL;
+    quint64 m_nextRequestId;
+    quint64 m_propertyWrites;
+    QStringList m_observedProperties;
+    QFutureWatcher<mpv_handle *> m_spareWatcher;
+    QMap<QString, QString> m_spareOptions;
+    bool m_restartPending;
 };
 
 #endif // MPVCORE_H
\ No newline at end of file
@@ -1,16 +1,43 @@
 #include "playbackcontroller.h"
 #include <QDebug>
 
+static const int SCRUB_INTERVAL_MS = 50;
+static const int SEEK_TIMEOUT_MS = 3000;
+
 PlaybackController::PlaybackController(MPVCore *mpvCore, QObject *parent)
-    : QObject(parent), m_mpvCore(mpvCore), m_isPlaying(false), m_duration(0.0), m_position(0.0), m_volume(100), m_isMuted(false), m_lastVolume(100)
+    : QObject(parent), m_mpvCore(mpvCore), m_keyframeIndexer(nullptr), m_isPlaying(false), m_duration(0.0), m_position(0.0), m_volume(100), m_isMuted(false), m_lastVolume(100), m_seekInFlight(0), m_inFlightTarget(0.0), m_inFlightExact(false), m_inFlightRelative(false), m_pendingTarget(0.0), m_pendingExact(false), m_hasPendingSeek(false), m_pendingOffset(0.0), m_hasPendingOffset(false), m_state(State::Idle), m_fileActive(false), m_fileLoaded(false), m_hasStarted(false), m_isEnded(false), m_hasError(false), m_isPaused(false), m_isSeeking(false), m_isPausedForCache(false), m_isCoreIdle(false)
 {
     // Connect MPV property change signals
     connect(m_mpvCore, &MPVCore::propertyChanged, this, &PlaybackController::onPropertyChanged);
     connect(m_mpvCore, &MPVCore::playbackFinished, this, &PlaybackController::onPlaybackFinished);
+    connect(m_mpvCore, &MPVCore::commandReply, this, &PlaybackController::onCommandReply);
+    connect(m_mpvCore, &MPVCore::playbackRestarted, this, &PlaybackController::onPlaybackRestarted);
+    connect(m_mpvCore, &MPVCore::fileStarted, this, &PlaybackController::onFileStarted);
+    connect(m_mpvCore, &MPVCore::fileLoaded, this, &PlaybackController::onFileLoaded);
+    connect(m_mpvCore, &MPVCore::fileEnded, this, &PlaybackController::onFileEnded);
+
+    // Inputs of the state machine besides pause and the file events
+    m_mpvCore->observeProperty("paused-for-cache");
+    m_mpvCore->observeProperty("seeking");
+    m_mpvCore->observeProperty("core-idle");
+    m_mpvCore->observeProperty("cache-buffering-state");
+
+    m_scrubTimer.setSingleShot(true);
+    connect(&m_scrubTimer, &QTimer::timeout, this, [this]()
+            {
+        sendPendingSeek();
+        updateState(); });
+
+    // A seek into a stream that never restarts must not block later seeks
+    m_seekWatchdog.setSingleShot(true);
+    m_seekWatchdog.setInterval(SEEK_TIMEOUT_MS);
+    connect(&m_seekWatchdog, &QTimer::timeout, this, [this]()
+            { completeSeek("timed out"); });
 
     // Initialize properties from MPV with safe defaults
     QVariant pauseVar = m_mpvCore->getProperty("pause");
     m_isPlaying = pauseVar.isValid() ? !pauseVar.toBool() : false;
+    m_isPaused = pauseVar.isValid() ? pauseVar.toBool() : false;
 
     // These properties may not be available until media is loaded
     QVariant durationVar = m_mpvCore->getProperty("duration");
@@ -36,6 +63,44 @@ bool PlaybackController::isPlaying() const
     return m_isPlaying;
 }
 
+PlaybackController::State PlaybackController::state() const
+{
+    return m_state;
+}
+
+QString PlaybackController::stateName(State state)
+{
+    switch (state)
+    {
+    case State::Idle:
+        return "Idle";
+    case State::Loading:
+        return "Loading";
+    case State::Buffering:
+        return "Buffering";
+    case State::Playing:
+        return "Playing";
+    case State::Paused:
+        return "Paused";
+    case State::Seeking:
+        return "Seeking";
+    case State::Stalled:
+        return "Stalled";
+    case State::Ended:
+        return "Ended";
+    case State::Error:
+        return "Error";
+    }
+    return QString();
+}
+
+PlaybackController::SessionMetrics PlaybackController::sessionMetrics() const
+{
+    SessionMetrics metrics = m_session;
+    accountStateTime(metrics);
+    return metrics;
+}
+
 double PlaybackController::duration() const
 {
     return m_duration;
@@ -50,11 +115,39 @@ void PlaybackController::setPosition(double position)
 {
     if (position != m_position)
     {
-        m_mpvCore->seek(position);
+        queueSeek(position, true);
         // The position will be updated through the property change signal
     }
 }
 
+void PlaybackController::setKeyframeIndexer(KeyframeIndexer *indexer)
+{
+    m_keyframeIndexer = indexer;
+}
+
+void PlaybackController::scrubTo(double position)
+{
+    if (m_keyframeIndexer && m_keyframeIndexer->isReady())
+    {
+        // mpv would land on this keyframe anyway; knowing it up front saves repeat seeks within a GOP
+        position = m_keyframeIndexer->snap(position);
+
+        const bool alreadyPending = m_hasPendingSeek && !m_pendingExact && m_pendingTarget == position;
+        const bool alreadyInFlight = !m_hasPendingSeek && m_seekInFlight != 0 && !m_inFlightRelative && m_inFlightTarget == position;
+        if (alreadyPending || alreadyInFlight)
+        {
+            return;
+        }
+    }
+
+    queueSeek(position, false);
+}
+
+void PlaybackController::endScrub(double position)
+{
+    queueSeek(position, true);
+}
+
 int PlaybackController::volume() const
 {
     return m_volume;
@@ -98,19 +191,12 @@ void PlaybackController::stop()
 
 void PlaybackController::seekForward(double seconds)
 {
-    double newPosition = m_position + seconds;
-    if (m_duration > 0)
-    {
-        newPosition = qMin(newPosition, m_duration);
-    }
-    setPosition(newPosition);
+    queueRelativeSeek(seconds);
 }
 
 void PlaybackController::seekBackward(double seconds)
 {
-    double newPosition = m_position - seconds;
-    newPosition = qMax(0.0, newPosition);
-    setPosition(newPosition);
+    queueRelativeSeek(-seconds);
 }
 
 void PlaybackController::setMute(bool mute)
@@ -143,7 +229,36 @@ void PlaybackController::onPropertyChanged(const QString &name, const QVariant &
     else if (name == "pause")
     {
         m_isPlaying = !value.toBool();
+        m_isPaused = value.toBool();
         emit playbackStateChanged(m_isPlaying);
+        updateState();
+    }
+    else if (name == "paused-for-cache")
+    {
+        m_isPausedForCache = value.toBool();
+        updateState();
+    }
+    else if (name == "seeking")
+    {
+        m_isSeeking = value.toBool();
+        updateState();
+    }
+    else if (name == "core-idle")
+    {
+        m_isCoreIdle = value.toBool();
+        updateState();
+    }
+    else if (name == "eof-reached")
+    {
+        m_isEnded = value.toBool();
+        updateState();
+    }
+    else if (name == "cache-buffering-state")
+    {
+        if (m_state == State::Buffering || m_state == State::Stalled)
+        {
+            emit bufferingProgress(value.toInt());
+        }
     }
     else if (name == "volume")
     {
@@ -162,4 +277,266 @@ void PlaybackController::onPlaybackFinished()
     m_isPlaying = false;
     emit playbackStateChanged(m_isPlaying);
     emit playbackFinished();
+}
+
+void PlaybackController::onCommandReply(quint64 requestId, int error)
+{
+    if (requestId != m_seekInFlight || error >= 0)
+    {
+        return;
+    }
+
+    // The seek was rejected, so no playback restart will follow
+    completeSeek(mpv_error_string(error));
+}
+
+void PlaybackController::onPlaybackRestarted()
+{
+    // The first restart of a file is its first frame being ready
+    if (m_fileLoaded)
+    {
+        m_hasStarted = true;
+    }
+
+    if (m_seekInFlight != 0)
+    {
+        completeSeek("done");
+    }
+    updateState();
+}
+
+void PlaybackController::onFileStarted()
+{
+    m_session = SessionMetrics();
+    m_session.media = m_mpvCore->getProperty("path").toString();
+    m_session.started = QDateTime::currentDateTime();
+    m_sessionTimer.start();
+
+    m_fileActive = true;
+    m_fileLoaded = false;
+    m_hasStarted = false;
+    m_isEnded = false;
+    m_hasError = false;
+    m_isSeeking = false;
+    m_isPausedForCache = false;
+    updateState();
+}
+
+void PlaybackController::onFileLoaded()
+{
+    m_fileLoaded = true;
+    updateState();
+}
+
+void PlaybackController::onFileEnded(int reason, const QString &error)
+{
+    if (!m_fileActive)
+    {
+        return;
+    }
+
+    m_fileActive = false;
+    m_isEnded = reason == MPV_END_FILE_REASON_EOF;
+    m_hasError = reason == MPV_END_FILE_REASON_ERROR;
+    updateState();
+
+    if (m_hasError)
+    {
+        qWarning() << "Playback of" << m_session.media << "failed:" << error;
+    }
+
+    qInfo() << "Playback session" << m_session.media << "- startup" << m_session.startupMs << "ms,"
+             << m_session.rebufferCount << "stalls," << m_session.rebufferMs << "ms stalled,"
+             << qRound(m_session.rebufferRatio() * 1000) / 10.0 << "% rebuffer ratio";
+
+    emit sessionFinished(m_session);
+}
+
+void PlaybackController::sendPendingSeek()
+{
+    if (m_seekInFlight != 0)
+    {
+        return;
+    }
+
+    if (!m_hasPendingSeek)
+    {
+        if (!m_hasPendingOffset)
+        {
+            return;
+        }
+
+        // All skips made since the last seek went out, as a single step
+        m_hasPendingOffset = false;
+        if (qFuzzyIsNull(m_pendingOffset))
+        {
+            return;
+        }
+
+        quint64 requestId = m_mpvCore->seekRelativeAsync(m_pendingOffset);
+        if (requestId == 0)
+        {
+            return;
+        }
+
+        m_seekInFlight = requestId;
+        m_inFlightTarget = m_pendingOffset;
+        m_inFlightExact = false;
+        m_inFlightRelative = true;
+        m_seekLatency.start();
+        m_seekWatchdog.start();
+        return;
+    }
+
+    // Keyframe seeks while scrubbing go out at a steady rate; the final exact seek goes at once
+    if (!m_pendingExact && m_sinceSeekSent.isValid() && m_sinceSeekSent.elapsed() < SCRUB_INTERVAL_MS)
+    {
+        if (!m_scrubTimer.isActive())
+        {
+            m_scrubTimer.start(SCRUB_INTERVAL_MS - static_cast<int>(m_sinceSeekSent.elapsed()));
+        }
+        return;
+    }
+
+    m_hasPendingSeek = false;
+    m_scrubTimer.stop();
+
+    quint64 requestId = m_mpvCore->seekAsync(m_pendingTarget, m_pendingExact);
+    if (requestId == 0)
+    {
+        return;
+    }
+
+    m_seekInFlight = requestId;
+    m_inFlightTarget = m_pendingTarget;
+    m_inFlightExact = m_pendingExact;
+    m_inFlightRelative = false;
+    m_seekLatency.start();
+    m_sinceSeekSent.start();
+    m_seekWatchdog.start();
+}
+
+void PlaybackController::queueSeek(double position, bool exact)
+{
+    // Whatever was waiting is out of date now
+    m_pendingTarget = position;
+    m_pendingExact = exact;
+    m_hasPendingSeek = true;
+    m_hasPendingOffset = false;
+
+    sendPendingSeek();
+    updateState();
+}
+
+void PlaybackController::queueRelativeSeek(double offset)
+{
+    if (m_hasPendingSeek)
+    {
+        // Skipping from a target that has not been sent yet moves the target
+        m_pendingTarget = qMax(0.0, m_pendingTarget + offset);
+        if (m_duration > 0)
+        {
+            m_pendingTarget = qMin(m_pendingTarget, m_duration);
+        }
+    }
+    else
+    {
+        m_pendingOffset = m_hasPendingOffset ? m_pendingOffset + offset : offset;
+        m_hasPendingOffset = true;
+    }
+
+    sendPendingSeek();
+    updateState();
+}
+
+void PlaybackController::completeSeek(const char *outcome)
+{
+    if (m_inFlightRelative)
+    {
+        qDebug() << "Relative seek by" << m_inFlightTarget << outcome << "after" << m_seekLatency.elapsed() << "ms";
+    }
+    else
+    {
+        qDebug() << (m_inFlightExact ? "Exact" : "Keyframe") << "seek to" << m_inFlightTarget << outcome << "after"
+                 << m_seekLatency.elapsed() << "ms";
+    }
+
+    m_seekInFlight = 0;
+    m_seekWatchdog.stop();
+    sendPendingSeek();
+    updateState();
+}
+
+void PlaybackController::updateState()
+{
+    State next = State::Playing;
+    if (!m_fileActive)
+    {
+        next = m_hasError ? State::Error : (m_isEnded ? State::Ended : State::Idle);
+    }
+    else if (m_isEnded)
+    {
+        next = State::Ended;
+    }
+    else if (!m_fileLoaded)
+    {
+        next = State::Loading;
+    }
+    else if (m_isSeeking || m_seekInFlight != 0)
+    {
+        next = State::Seeking;
+    }
+    else if (m_isPaused)
+    {
+        next = State::Paused;
+    }
+    else if (m_isPausedForCache && m_session.startupMs >= 0)
+    {
+        // Only waiting after playback has begun counts as a rebuffer
+        next = State::Stalled;
+    }
+    else if (m_isPausedForCache || m_isCoreIdle || !m_hasStarted)
+    {
+        next = State::Buffering;
+    }
+
+    if (next == m_state)
+    {
+        return;
+    }
+
+    const State previous = m_state;
+    accountStateTime(m_session);
+
+    if (next == State::Stalled)
+    {
+        ++m_session.rebufferCount;
+    }
+    if (next == State::Playing && m_fileActive && m_session.startupMs < 0)
+    {
+        m_session.startupMs = m_sessionTimer.elapsed();
+    }
+
+    m_state = next;
+    m_stateTimer.start();
+
+    qDebug() << "Playback state:" << stateName(previous) << "->" << stateName(next);
+    emit stateChanged(previous, next, QDateTime::currentMSecsSinceEpoch());
+}
+
+void PlaybackController::accountStateTime(SessionMetrics &metrics) const
+{
+    if (!m_stateTimer.isValid())
+    {
+        return;
+    }
+
+    if (m_state == State::Playing)
+    {
+        metrics.playingMs += m_stateTimer.elapsed();
+    }
+    else if (m_state == State::Stalled)
+    {
+        metrics.rebufferMs += m_stateTimer.elapsed();
+    }
 }
\ No newline at end of file
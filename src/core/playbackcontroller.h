@@ -2,10 +2,29 @@
 #define PLAYBACKCONTROLLER_H
 
 #include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QDateTime>
 #include "mpvcore.h"
+#include "keyframeindexer.h"
 
 /**
  * @brief The PlaybackController class manages playback state and controls
+ *
+ * Seeks are sent asynchronously with at most one in flight. A request made
+ * while another is in flight replaces any request still waiting, so only
+ * the newest target is sent once mpv has landed, and while scrubbing the
+ * keyframe seeks are additionally spaced out to a steady rate. Relative
+ * skips are added up while a seek is in flight and sent as one relative
+ * seek, so a held skip key cannot flood mpv with competing targets.
+ * With a keyframe index, scrub targets are snapped to keyframes and a
+ * target that lands on the keyframe already being sought is dropped.
+ *
+ * Playback is tracked as an explicit state derived from the file events
+ * and the pause, paused-for-cache, seeking and core-idle properties. Each
+ * file is a session: the time to the first played frame, the number of
+ * stalls and the share of time spent stalled are measured and reported
+ * when the file is unloaded.
  */
 class PlaybackController : public QObject
 {
@@ -16,6 +35,46 @@ class PlaybackController : public QObject
     Q_PROPERTY(int volume READ volume WRITE setVolume NOTIFY volumeChanged)
 
 public:
+    /**
+     * @brief Playback states
+     */
+    enum class State
+    {
+        Idle,      ///< No file
+        Loading,   ///< Opening the file
+        Buffering, ///< Opened, filling the cache before playback
+        Playing,   ///< Frames are being presented
+        Paused,    ///< Paused by the user
+        Seeking,   ///< A seek is in progress
+        Stalled,   ///< Waiting for the cache after playback started
+        Ended,     ///< Reached the end of the file
+        Error      ///< The file failed to play
+    };
+    Q_ENUM(State)
+
+    /**
+     * @brief Quality metrics of one playback session
+     */
+    struct SessionMetrics
+    {
+        QString media;
+        QDateTime started;
+        qint64 startupMs = -1;
+        int rebufferCount = 0;
+        qint64 rebufferMs = 0;
+        qint64 playingMs = 0;
+
+        /**
+         * @brief Get the share of watching time spent stalled
+         * @return Ratio between 0 and 1
+         */
+        double rebufferRatio() const
+        {
+            qint64 total = playingMs + rebufferMs;
+            return total > 0 ? static_cast<double>(rebufferMs) / total : 0.0;
+        }
+    };
+
     /**
      * @brief Constructor
      * @param mpvCore MPV core instance
@@ -29,6 +88,25 @@ public:
      */
     bool isPlaying() const;
 
+    /**
+     * @brief Get the playback state
+     * @return Current state
+     */
+    State state() const;
+
+    /**
+     * @brief Get the name of a state for logs
+     * @param state State
+     * @return State name
+     */
+    static QString stateName(State state);
+
+    /**
+     * @brief Get the metrics of the current session
+     * @return Metrics up to now
+     */
+    SessionMetrics sessionMetrics() const;
+
     /**
      * @brief Get the duration of the current media
      * @return Duration in seconds
@@ -47,6 +125,24 @@ public:
      */
     void setPosition(double position);
 
+    /**
+     * @brief Set the keyframe index used to snap scrub targets
+     * @param indexer Keyframe indexer, nullptr to seek unsnapped
+     */
+    void setKeyframeIndexer(KeyframeIndexer *indexer);
+
+    /**
+     * @brief Seek quickly to the keyframe nearest a position while scrubbing
+     * @param position Position in seconds
+     */
+    void scrubTo(double position);
+
+    /**
+     * @brief Finish scrubbing with a frame-exact seek
+     * @param position Position in seconds
+     */
+    void endScrub(double position);
+
     /**
      * @brief Get the current volume
      * @return Volume level (0-100)
@@ -139,6 +235,26 @@ signals:
      */
     void playbackFinished();
 
+    /**
+     * @brief Signal emitted on every state transition
+     * @param previous State left
+     * @param current State entered
+     * @param timestamp Time of the transition in milliseconds since the epoch
+     */
+    void stateChanged(PlaybackController::State previous, PlaybackController::State current, qint64 timestamp);
+
+    /**
+     * @brief Signal emitted while filling the cache
+     * @param percent Fill level needed to resume, 0-100
+     */
+    void bufferingProgress(int percent);
+
+    /**
+     * @brief Signal emitted when a file is unloaded
+     * @param metrics Metrics of the session
+     */
+    void sessionFinished(const PlaybackController::SessionMetrics &metrics);
+
 private slots:
     /**
      * @brief Handle MPV property changes
@@ -152,14 +268,107 @@ private slots:
      */
     void onPlaybackFinished();
 
+    /**
+     * @brief Handle the reply to a seek command
+     * @param requestId Request id
+     * @param error MPV error code
+     */
+    void onCommandReply(quint64 requestId, int error);
+
+    /**
+     * @brief Handle playback resuming after a seek
+     */
+    void onPlaybackRestarted();
+
+    /**
+     * @brief Start a new session
+     */
+    void onFileStarted();
+
+    /**
+     * @brief Note that the file has been opened
+     */
+    void onFileLoaded();
+
+    /**
+     * @brief End the session
+     * @param reason MPV end-file reason
+     * @param error Error message
+     */
+    void onFileEnded(int reason, const QString &error);
+
+    /**
+     * @brief Send the waiting seek if none is in flight
+     */
+    void sendPendingSeek();
+
 private:
+    /**
+     * @brief Queue a seek, replacing any seek still waiting
+     * @param position Position in seconds
+     * @param exact True for a frame-exact seek
+     */
+    void queueSeek(double position, bool exact);
+
+    /**
+     * @brief Queue a relative seek, adding it to any seek still waiting
+     * @param offset Offset in seconds, negative to go back
+     */
+    void queueRelativeSeek(double offset);
+
+    /**
+     * @brief Mark the seek in flight as done
+     * @param outcome Outcome for the log
+     */
+    void completeSeek(const char *outcome);
+
+    /**
+     * @brief Derive the state from the inputs and record a transition
+     */
+    void updateState();
+
+    /**
+     * @brief Add the time spent in the current state to the session metrics
+     * @param metrics Metrics to add to
+     */
+    void accountStateTime(SessionMetrics &metrics) const;
+
     MPVCore *m_mpvCore;
+    KeyframeIndexer *m_keyframeIndexer;
     bool m_isPlaying;
     double m_duration;
     double m_position;
     int m_volume;
     bool m_isMuted;
     int m_lastVolume;
+
+    QTimer m_scrubTimer;
+    QTimer m_seekWatchdog;
+    QElapsedTimer m_seekLatency;
+    QElapsedTimer m_sinceSeekSent;
+    quint64 m_seekInFlight;
+    double m_inFlightTarget;
+    bool m_inFlightExact;
+    bool m_inFlightRelative;
+    double m_pendingTarget;
+    bool m_pendingExact;
+    bool m_hasPendingSeek;
+    double m_pendingOffset;
+    bool m_hasPendingOffset;
+
+    State m_state;
+    QElapsedTimer m_stateTimer;
+    QElapsedTimer m_sessionTimer;
+    SessionMetrics m_session;
+    bool m_fileActive;
+    bool m_fileLoaded;
+    bool m_hasStarted;
+    bool m_isEnded;
+    bool m_hasError;
+    bool m_isPaused;
+    bool m_isSeeking;
+    bool m_isPausedForCache;
+    bool m_isCoreIdle;
 };
 
 #endif // PLAYBACKCONTROLLER_H
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "playbackstats.h"
+#include <QDebug>
+#include <QStringList>
+
+static const int POLL_INTERVAL_MS = 500;
+
+// A batch missing replies, e.g. for reads that could not be sent, is given up after this many polls
+static const int MAX_SKIPPED_POLLS = 4;
+
+static const QStringList STATS_PROPERTIES = {
+    "hwdec-current",
+    "estimated-vf-fps",
+    "frame-drop-count",
+    "decoder-frame-drop-count",
+    "vo-delayed-frame-count",
+    "demuxer-cache-duration",
+    "cache-speed",
+    "video-bitrate",
+    "audio-bitrate"};
+
+PlaybackStats::PlaybackStats(MPVCore *mpvCore, TimeshiftController *timeshift, QObject *parent)
+    : QObject(parent), m_mpvCore(mpvCore), m_timeshift(timeshift), m_requestId(0), m_pendingReplies(0), m_skippedPolls(0), m_videoBitrate(-1), m_audioBitrate(-1)
+{
+    m_pollTimer.setInterval(POLL_INTERVAL_MS);
+    connect(&m_pollTimer, &QTimer::timeout, this, &PlaybackStats::poll);
+    connect(m_mpvCore, &MPVCore::propertyReply, this, &PlaybackStats::onPropertyReply);
+    connect(m_mpvCore, &MPVCore::coreRestarted, this, &PlaybackStats::onCoreRestarted);
+}
+
+void PlaybackStats::setEnabled(bool enabled)
+{
+    if (enabled == m_pollTimer.isActive())
+    {
+        return;
+    }
+
+    if (enabled)
+    {
+        m_pollTimer.start();
+        poll();
+    }
+    else
+    {
+        m_pollTimer.stop();
+        m_requestId = 0;
+    }
+}
+
+bool PlaybackStats::isEnabled() const
+{
+    return m_pollTimer.isActive();
+}
+
+PlaybackStats::Sample PlaybackStats::sample() const
+{
+    return m_sample;
+}
+
+void PlaybackStats::poll()
+{
+    // One batch at a time; a slow mpv gets fewer samples rather than a queue of them
+    if (m_requestId != 0 && ++m_skippedPolls < MAX_SKIPPED_POLLS)
+    {
+        return;
+    }
+
+    m_current = Sample();
+    m_videoBitrate = -1;
+    m_audioBitrate = -1;
+    m_skippedPolls = 0;
+    m_pendingReplies = STATS_PROPERTIES.size();
+    m_requestId = m_mpvCore->getPropertiesAsync(STATS_PROPERTIES);
+}
+
+void PlaybackStats::onPropertyReply(quint64 requestId, const QString &name, const QVariant &value)
+{
+    if (requestId == 0 || requestId != m_requestId)
+    {
+        return;
+    }
+
+    if (value.isValid())
+    {
+        if (name == "hwdec-current")
+        {
+            m_current.hwdec = value.toString();
+        }
+        else if (name == "estimated-vf-fps")
+        {
+            m_current.estimatedFps = value.toDouble();
+        }
+        else if (name == "frame-drop-count")
+        {
+            m_current.droppedFrames = value.toLongLong();
+        }
+        else if (name == "decoder-frame-drop-count")
+        {
+            m_current.decoderDroppedFrames = value.toLongLong();
+        }
+        else if (name == "vo-delayed-frame-count")
+        {
+            m_current.delayedFrames = value.toLongLong();
+        }
+        else if (name == "demuxer-cache-duration")
+        {
+            m_current.cacheSeconds = value.toDouble();
+        }
+        else if (name == "cache-speed")
+        {
+            m_current.cacheSpeed = value.toLongLong();
+        }
+        else if (name == "video-bitrate")
+        {
+            m_videoBitrate = value.toLongLong();
+        }
+        else if (name == "audio-bitrate")
+        {
+            m_audioBitrate = value.toLongLong();
+        }
+    }
+
+    if (--m_pendingReplies > 0)
+    {
+        return;
+    }
+
+    if (m_videoBitrate >= 0 || m_audioBitrate >= 0)
+    {
+        m_current.bitrate = qMax<qint64>(0, m_videoBitrate) + qMax<qint64>(0, m_audioBitrate);
+    }
+
+    // Kept by the timeshift controller, which already follows the live edge
+    if (m_timeshift && m_timeshift->isActive())
+    {
+        m_current.liveDelay = m_timeshift->delay();
+    }
+
+    m_requestId = 0;
+    m_sample = m_current;
+    emit updated();
+}
+
+void PlaybackStats::onCoreRestarted()
+{
+    // Replies of the old instance went with it
+    m_requestId = 0;
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#ifndef PLAYBACKSTATS_H
+#define PLAYBACKSTATS_H
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include "mpvcore.h"
+#include "timeshiftcontroller.h"
+
+/**
+ * @brief The PlaybackStats class samples the playback figures shown in the stats overlay
+ *
+ * While enabled it reads a fixed set of mpv properties twice a second, all
+ * in one batch of asynchronous gets, so the UI thread never waits on mpv's
+ * core lock. A sample is published only once every reply of its batch has
+ * arrived, so the figures shown together were read together. Nothing is
+ * read while disabled.
+ */
+class PlaybackStats : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Playback figures read in one batch; negative means unavailable
+     */
+    struct Sample
+    {
+        QString hwdec;
+        double estimatedFps = -1.0;
+        qint64 droppedFrames = -1;
+        qint64 decoderDroppedFrames = -1;
+        qint64 delayedFrames = -1;
+        double cacheSeconds = -1.0;
+        qint64 cacheSpeed = -1;
+        qint64 bitrate = -1;
+        double liveDelay = -1.0;
+    };
+
+    /**
+     * @brief Constructor
+     * @param mpvCore MPV core instance
+     * @param timeshift Timeshift controller, for the delay behind the live edge
+     * @param parent Parent object
+     */
+    explicit PlaybackStats(MPVCore *mpvCore, TimeshiftController *timeshift, QObject *parent = nullptr);
+
+    /**
+     * @brief Start or stop sampling
+     * @param enabled True to sample
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * @brief Check whether sampling is enabled
+     * @return True if enabled
+     */
+    bool isEnabled() const;
+
+    /**
+     * @brief Get the latest complete sample
+     * @return Sample, all unavailable before the first batch completes
+     */
+    Sample sample() const;
+
+signals:
+    /**
+     * @brief Signal emitted when a new sample is complete
+     */
+    void updated();
+
+private slots:
+    /**
+     * @brief Send the next batch of property reads
+     */
+    void poll();
+
+    /**
+     * @brief Record a property of the current batch
+     * @param requestId Batch the reply belongs to
+     * @param name Property name
+     * @param value Property value, invalid if unavailable
+     */
+    void onPropertyReply(quint64 requestId, const QString &name, const QVariant &value);
+
+    /**
+     * @brief Drop the batch that went with the old mpv instance
+     */
+    void onCoreRestarted();
+
+private:
+    MPVCore *m_mpvCore;
+    TimeshiftController *m_timeshift;
+    QTimer m_pollTimer;
+    quint64 m_requestId;
+    int m_pendingReplies;
+    int m_skippedPolls;
+    qint64 m_videoBitrate;
+    qint64 m_audioBitrate;
+    Sample m_current;
+    Sample m_sample;
+};
+
+#endif // PLAYBACKSTATS_H
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "profilebenchmark.h"
+#include "mediaplayer.h"
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Generated by libavfilter, so every run decodes exactly the same frames
+static const char *DEFAULT_CLIP = "av://lavfi:testsrc2=size=1920x1080:rate=60";
+static const int DEFAULT_DURATION_MS = 15000;
+static const int SETTLE_MS = 1000;
+
+ProfileBenchmark::ProfileBenchmark(MediaPlayer *player, QObject *parent)
+    : QObject(parent), m_player(player), m_clip(DEFAULT_CLIP), m_durationMs(DEFAULT_DURATION_MS), m_cpuStartMs(0)
+{
+    m_runTimer.setSingleShot(true);
+    connect(&m_runTimer, &QTimer::timeout, this, &ProfileBenchmark::finishRun);
+}
+
+void ProfileBenchmark::setClip(const QString &url)
+{
+    m_clip = url;
+}
+
+void ProfileBenchmark::setDuration(int seconds)
+{
+    m_durationMs = qMax(1, seconds) * 1000;
+}
+
+void ProfileBenchmark::start(const QStringList &profiles)
+{
+    m_queue = profiles;
+    m_results.clear();
+    runNext();
+}
+
+QList<ProfileBenchmark::Result> ProfileBenchmark::results() const
+{
+    return m_results;
+}
+
+void ProfileBenchmark::runNext()
+{
+    if (m_queue.isEmpty())
+    {
+        m_player->mpvCore()->stop();
+        emit finished();
+        return;
+    }
+
+    m_profile = m_queue.takeFirst();
+    qInfo() << "Benchmarking profile" << m_profile << "for" << m_durationMs / 1000 << "s";
+
+    m_cpuStartMs = processCpuMs();
+    m_wallTimer.start();
+    m_player->loadMedia(m_clip, m_profile);
+    m_runTimer.start(m_durationMs);
+}
+
+void ProfileBenchmark::finishRun()
+{
+    MPVCore *core = m_player->mpvCore();
+    PlaybackController::SessionMetrics metrics = m_player->playbackController()->sessionMetrics();
+
+    Result result;
+    result.profile = m_profile;
+    result.cpuPercent = 100.0 * (processCpuMs() - m_cpuStartMs) / qMax<qint64>(1, m_wallTimer.elapsed());
+    result.droppedFrames = core->getProperty("frame-drop-count").toLongLong();
+    result.decoderDroppedFrames = core->getProperty("decoder-frame-drop-count").toLongLong();
+    result.startupMs = metrics.startupMs;
+    result.rebufferMs = metrics.rebufferMs;
+    m_results.append(result);
+
+    // Let the previous run's threads wind down before the next one is measured
+    core->stop();
+    QTimer::singleShot(SETTLE_MS, this, &ProfileBenchmark::runNext);
+}
+
+qint64 ProfileBenchmark::processCpuMs()
+{
+#ifdef Q_OS_WIN
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+    {
+        return 0;
+    }
+
+    // FILETIME counts 100 ns intervals
+    ULARGE_INTEGER kernelTime = {{kernel.dwLowDateTime, kernel.dwHighDateTime}};
+    ULARGE_INTEGER userTime = {{user.dwLowDateTime, user.dwHighDateTime}};
+    return static_cast<qint64>((kernelTime.QuadPart + userTime.QuadPart) / 10000);
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+
+    return static_cast<qint64>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000 +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+#endif
+}
+
+qint64 ProfileBenchmark::peakMemoryBytes()
+{
+#ifdef Q_OS_WIN
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return 0;
+    }
+
+    return static_cast<qint64>(counters.PeakWorkingSetSize);
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+
+    // Bytes on macOS, kilobytes everywhere else
+#ifdef Q_OS_MACOS
+    return static_cast<qint64>(usage.ru_maxrss);
+#else
+    return static_cast<qint64>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#ifndef PROFILEBENCHMARK_H
+#define PROFILEBENCHMARK_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QTimer>
+#include <QElapsedTimer>
+
+class MediaPlayer;
+
+/**
+ * @brief The ProfileBenchmark class compares the performance profiles on this machine
+ *
+ * Plays the same synthetic clip for a fixed time under each profile, one
+ * after the other, through the normal player and renderer. For each run it
+ * records the process CPU time as a share of one core, the frames dropped
+ * by the video output and the decoder, and the startup and stall times
+ * measured by the playback controller.
+ */
+class ProfileBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Measurements of one profile
+     */
+    struct Result
+    {
+        QString profile;
+        double cpuPercent = 0.0;
+        qint64 droppedFrames = 0;
+        qint64 decoderDroppedFrames = 0;
+        qint64 startupMs = -1;
+        qint64 rebufferMs = 0;
+    };
+
+    /**
+     * @brief Constructor
+     * @param player Media player to run the clip in
+     * @param parent Parent object
+     */
+    explicit ProfileBenchmark(MediaPlayer *player, QObject *parent = nullptr);
+
+    /**
+     * @brief Set the clip to play
+     * @param url File path or URL, by default a generated 1080p60 test pattern
+     */
+    void setClip(const QString &url);
+
+    /**
+     * @brief Set how long each profile plays
+     * @param seconds Run time in seconds
+     */
+    void setDuration(int seconds);
+
+    /**
+     * @brief Run the clip under each profile
+     * @param profiles Profile names, in run order
+     */
+    void start(const QStringList &profiles);
+
+    /**
+     * @brief Get the measurements of the finished runs
+     * @return Results in run order
+     */
+    QList<Result> results() const;
+
+    /**
+     * @brief Get the CPU time used by this process so far
+     * @return CPU time in milliseconds, user and system
+     */
+    static qint64 processCpuMs();
+
+    /**
+     * @brief Get the most memory this process has had resident so far
+     * @return Peak resident set size in bytes, 0 if unknown
+     */
+    static qint64 peakMemoryBytes();
+
+signals:
+    /**
+     * @brief Signal emitted when all profiles have run
+     */
+    void finished();
+
+private slots:
+    /**
+     * @brief Start the next profile's run, or finish
+     */
+    void runNext();
+
+    /**
+     * @brief Record the measurements of the current run
+     */
+    void finishRun();
+
+private:
+    MediaPlayer *m_player;
+    QString m_clip;
+    int m_durationMs;
+    QStringList m_queue;
+    QString m_profile;
+    QList<Result> m_results;
+    QTimer m_runTimer;
+    QElapsedTimer m_wallTimer;
+    qint64 m_cpuStartMs;
+};
+
+#endif // PROFILEBENCHMARK_H
\ No newline at end of file
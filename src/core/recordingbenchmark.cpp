@@ -0,0 +1,116 @@
+#include "recordingbenchmark.h"
+#include "streamrecorder.h"
+#include "profilebenchmark.h"
+#include <QDebug>
+#include <QFile>
+
+static const int DEFAULT_DURATION_MS = 30000;
+static const int SETTLE_MS = 2000;
+
+// Recorders of the same stream that run side by side; 0 is the baseline
+static const QList<int> RUNS = {0, 1, 2, 4};
+
+RecordingBenchmark::RecordingBenchmark(const QString &url, QObject *parent)
+    : QObject(parent), m_url(url), m_durationMs(DEFAULT_DURATION_MS), m_cpuStartMs(0), m_baselinePercent(0.0)
+{
+    m_runTimer.setSingleShot(true);
+    connect(&m_runTimer, &QTimer::timeout, this, &RecordingBenchmark::finishRun);
+}
+
+RecordingBenchmark::~RecordingBenchmark()
+{
+    stopRecorders();
+}
+
+void RecordingBenchmark::setDuration(int seconds)
+{
+    m_durationMs = qMax(1, seconds) * 1000;
+}
+
+bool RecordingBenchmark::start()
+{
+    if (!m_outputDir.isValid())
+    {
+        qWarning() << "Could not create a directory for the benchmark recordings";
+        return false;
+    }
+
+    m_queue = RUNS;
+    m_results.clear();
+    m_baselinePercent = 0.0;
+    runNext();
+    return true;
+}
+
+QList<RecordingBenchmark::Result> RecordingBenchmark::results() const
+{
+    return m_results;
+}
+
+void RecordingBenchmark::runNext()
+{
+    if (m_queue.isEmpty())
+    {
+        emit finished();
+        return;
+    }
+
+    int recordings = m_queue.takeFirst();
+    qInfo() << "Benchmarking" << recordings << "recordings of" << m_url << "for" << m_durationMs / 1000 << "s";
+
+    for (int i = 0; i < recordings; ++i)
+    {
+        StreamRecorder *recorder = new StreamRecorder(m_url, m_outputDir.filePath(QString("recording-%1.ts").arg(i)), this);
+        if (!recorder->start())
+        {
+            delete recorder;
+            continue;
+        }
+        m_recorders.append(recorder);
+    }
+
+    m_cpuStartMs = ProfileBenchmark::processCpuMs();
+    m_wallTimer.start();
+    m_runTimer.start(m_durationMs);
+}
+
+void RecordingBenchmark::finishRun()
+{
+    qint64 elapsedMs = qMax<qint64>(1, m_wallTimer.elapsed());
+    double cpuPercent = 100.0 * (ProfileBenchmark::processCpuMs() - m_cpuStartMs) / elapsedMs;
+
+    Result result;
+    result.recordings = m_recorders.size();
+    result.cpuPercent = cpuPercent;
+    if (result.recordings == 0)
+    {
+        m_baselinePercent = cpuPercent;
+    }
+    else
+    {
+        result.cpuPercentPerRecording = qMax(0.0, cpuPercent - m_baselinePercent) / result.recordings;
+
+        qint64 bytes = 0;
+        for (const StreamRecorder *recorder : std::as_const(m_recorders))
+        {
+            bytes += recorder->bytesWritten();
+        }
+        result.bytesPerSecond = bytes * 1000 / elapsedMs / result.recordings;
+    }
+    m_results.append(result);
+
+    // Let the recorders' threads wind down before the next run is measured
+    stopRecorders();
+    QTimer::singleShot(SETTLE_MS, this, &RecordingBenchmark::runNext);
+}
+
+void RecordingBenchmark::stopRecorders()
+{
+    for (StreamRecorder *recorder : std::as_const(m_recorders))
+    {
+        recorder->stop();
+        QFile::remove(recorder->outputPath());
+        delete recorder;
+    }
+    m_recorders.clear();
+}
\ No newline at end of file
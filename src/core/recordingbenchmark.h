@@ -0,0 +1,103 @@
+#ifndef RECORDINGBENCHMARK_H
+#define RECORDINGBENCHMARK_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+
+class StreamRecorder;
+
+/**
+ * @brief The RecordingBenchmark class measures the CPU cost of background recordings
+ *
+ * First measures the process with no recording for a baseline, then runs
+ * one, two and four recorders of the same stream side by side. Each run
+ * records the process CPU time above the baseline, as a share of one core
+ * per recording, and how fast the output files grew. Recordings go to a
+ * temporary directory that is removed afterwards.
+ */
+class RecordingBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Measurements of one run
+     */
+    struct Result
+    {
+        int recordings = 0;
+        double cpuPercent = 0.0;
+        double cpuPercentPerRecording = 0.0;
+        qint64 bytesPerSecond = 0;
+    };
+
+    /**
+     * @brief Constructor
+     * @param url Stream to record, ideally a live channel
+     * @param parent Parent object
+     */
+    explicit RecordingBenchmark(const QString &url, QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor, stops any recorder still running
+     */
+    ~RecordingBenchmark();
+
+    /**
+     * @brief Set how long each run lasts
+     * @param seconds Run time in seconds
+     */
+    void setDuration(int seconds);
+
+    /**
+     * @brief Measure the baseline and then each number of recordings
+     * @return True if the runs started
+     */
+    bool start();
+
+    /**
+     * @brief Get the measurements of the finished runs
+     * @return Results in run order, the baseline first
+     */
+    QList<Result> results() const;
+
+signals:
+    /**
+     * @brief Signal emitted when all runs are done
+     */
+    void finished();
+
+private slots:
+    /**
+     * @brief Start the next run, or finish
+     */
+    void runNext();
+
+    /**
+     * @brief Record the measurements of the current run
+     */
+    void finishRun();
+
+private:
+    /**
+     * @brief Stop and delete the recorders of the current run
+     */
+    void stopRecorders();
+
+    QString m_url;
+    int m_durationMs;
+    QTemporaryDir m_outputDir;
+    QList<int> m_queue;
+    QList<StreamRecorder *> m_recorders;
+    QList<Result> m_results;
+    QTimer m_runTimer;
+    QElapsedTimer m_wallTimer;
+    qint64 m_cpuStartMs;
+    double m_baselinePercent;
+};
+
+#endif // RECORDINGBENCHMARK_H
\ No newline at end of file
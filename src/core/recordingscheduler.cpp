@@ -0,0 +1,241 @@
+#include "recordingscheduler.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QUuid>
+#include <QRegularExpression>
+
+static const qint64 MAX_TIMER_MS = 60 * 60 * 1000;
+static const int RETRY_DELAY_MS = 10 * 1000;
+
+RecordingScheduler::RecordingScheduler(Settings *settings, QObject *parent)
+    : QObject(parent), m_settings(settings)
+{
+    m_recordings = m_settings->scheduledRecordings();
+
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &RecordingScheduler::update);
+
+    // Catch up on anything that became due while the application was closed
+    QTimer::singleShot(0, this, &RecordingScheduler::update);
+}
+
+RecordingScheduler::~RecordingScheduler()
+{
+    // Recordings still scheduled resume on the next start
+    qDeleteAll(m_recorders);
+    m_recorders.clear();
+}
+
+QList<ScheduledRecording> RecordingScheduler::recordings() const
+{
+    return m_recordings;
+}
+
+QString RecordingScheduler::schedule(const ScheduledRecording &recording)
+{
+    ScheduledRecording entry = recording;
+    if (entry.id.isEmpty())
+    {
+        entry.id = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    }
+
+    m_recordings.append(entry);
+    save();
+    update();
+
+    return entry.id;
+}
+
+QString RecordingScheduler::recordNow(const QString &channelName, const QString &url, int minutes)
+{
+    ScheduledRecording recording;
+    recording.channelName = channelName;
+    recording.url = url;
+    recording.start = QDateTime::currentDateTime();
+    recording.end = recording.start.addSecs(minutes * 60);
+
+    return schedule(recording);
+}
+
+void RecordingScheduler::remove(const QString &id)
+{
+    for (int i = 0; i < m_recordings.size(); ++i)
+    {
+        if (m_recordings[i].id == id)
+        {
+            m_recordings.removeAt(i);
+            break;
+        }
+    }
+    save();
+
+    if (StreamRecorder *recorder = m_recorders.take(id))
+    {
+        recorder->disconnect(this);
+        recorder->stop();
+        recorder->deleteLater();
+        emit recordingFinished(id, true, QString());
+    }
+
+    update();
+}
+
+bool RecordingScheduler::isRecording(const QString &id) const
+{
+    return m_recorders.contains(id);
+}
+
+QString RecordingScheduler::recordingForUrl(const QString &url) const
+{
+    for (auto it = m_recorders.constBegin(); it != m_recorders.constEnd(); ++it)
+    {
+        if (it.value()->url() == url)
+        {
+            return it.key();
+        }
+    }
+    return QString();
+}
+
+void RecordingScheduler::update()
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    QDateTime next;
+    bool changed = false;
+
+    for (int i = 0; i < m_recordings.size();)
+    {
+        const ScheduledRecording &recording = m_recordings[i];
+
+        if (recording.end <= now)
+        {
+            // Over, whether it ran or the application was closed throughout
+            if (StreamRecorder *recorder = m_recorders.take(recording.id))
+            {
+                recorder->disconnect(this);
+                recorder->stop();
+                recorder->deleteLater();
+                emit recordingFinished(recording.id, true, QString());
+            }
+            m_recordings.removeAt(i);
+            changed = true;
+            continue;
+        }
+
+        if (recording.start <= now)
+        {
+            if (!m_recorders.contains(recording.id))
+            {
+                startRecorder(recording);
+            }
+            next = next.isValid() ? qMin(next, recording.end) : recording.end;
+        }
+        else
+        {
+            next = next.isValid() ? qMin(next, recording.start) : recording.start;
+        }
+        ++i;
+    }
+
+    if (changed)
+    {
+        save();
+    }
+
+    // Re-armed at least hourly so clock changes and suspends are noticed
+    if (next.isValid())
+    {
+        m_timer.start(static_cast<int>(qBound<qint64>(0, now.msecsTo(next), MAX_TIMER_MS)));
+    }
+    else
+    {
+        m_timer.stop();
+    }
+}
+
+void RecordingScheduler::startRecorder(const ScheduledRecording &recording)
+{
+    QDir().mkpath(m_settings->get<Setting::RecordingsDir>());
+
+    StreamRecorder *recorder = new StreamRecorder(recording.url, outputPath(recording), this);
+
+    QString userAgent = m_settings->get<Setting::UserAgent>();
+    if (!userAgent.isEmpty())
+    {
+        recorder->setOption("user-agent", userAgent);
+    }
+    recorder->setOption("network-timeout", QString::number(m_settings->get<Setting::NetworkTimeout>()));
+
+    const QString id = recording.id;
+    connect(recorder, &StreamRecorder::finished, this, [this, id](bool ok, const QString &error)
+            { onRecorderFinished(id, ok, error); });
+
+    if (!recorder->start())
+    {
+        delete recorder;
+        emit recordingFinished(id, false, tr("Could not start the recorder"));
+        QTimer::singleShot(RETRY_DELAY_MS, this, &RecordingScheduler::update);
+        return;
+    }
+
+    m_recorders.insert(id, recorder);
+    emit recordingStarted(id, recorder->outputPath());
+}
+
+void RecordingScheduler::onRecorderFinished(const QString &id, bool ok, const QString &error)
+{
+    StreamRecorder *recorder = m_recorders.take(id);
+    if (!recorder)
+    {
+        return;
+    }
+    recorder->deleteLater();
+    emit recordingFinished(id, ok, error);
+
+    if (ok)
+    {
+        // The stream itself ended, so there is nothing left to record
+        for (int i = 0; i < m_recordings.size(); ++i)
+        {
+            if (m_recordings[i].id == id)
+            {
+                m_recordings.removeAt(i);
+                save();
+                break;
+            }
+        }
+        return;
+    }
+
+    // The stream dropped out before the end time; reopen it shortly into a new file
+    QTimer::singleShot(RETRY_DELAY_MS, this, &RecordingScheduler::update);
+}
+
+QString RecordingScheduler::outputPath(const ScheduledRecording &recording) const
+{
+    static const QRegularExpression unsafe("[\\\\/:*?\"<>|]");
+
+    QString name = recording.channelName;
+    name.replace(unsafe, "_");
+    if (name.trimmed().isEmpty())
+    {
+        name = "Recording";
+    }
+
+    const QString base = m_settings->get<Setting::RecordingsDir>() + "/" + name + " " +
+                         QDateTime::currentDateTime().toString("yyyy-MM-dd hh-mm");
+
+    QString path = base + ".mkv";
+    for (int i = 2; QFile::exists(path); ++i)
+    {
+        path = QString("%1 (%2).mkv").arg(base).arg(i);
+    }
+    return path;
+}
+
+void RecordingScheduler::save()
+{
+    m_settings->setScheduledRecordings(m_recordings);
+    emit scheduleChanged();
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+#ifndef RECORDINGSCHEDULER_H
+#define RECORDINGSCHEDULER_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QTimer>
+#include "streamrecorder.h"
+#include "../data/settings.h"
+#include "../data/scheduledrecording.h"
+
+/**
+ * @brief The RecordingScheduler class starts and stops recordings at their scheduled times
+ *
+ * The schedule is kept in the settings, so recordings survive a restart
+ * and one whose time has come while the application was closed starts as
+ * soon as it runs again. A single timer is armed for the next start or
+ * end. Recordings are written to the recordings directory, one file per
+ * run; a stream that drops out is reopened into a new file until the end
+ * time.
+ */
+class RecordingScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor
+     * @param settings Settings instance
+     * @param parent Parent object
+     */
+    explicit RecordingScheduler(Settings *settings, QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor, stops all running recordings
+     */
+    ~RecordingScheduler();
+
+    /**
+     * @brief Get all scheduled and running recordings
+     * @return Recordings in the order they were scheduled
+     */
+    QList<ScheduledRecording> recordings() const;
+
+    /**
+     * @brief Add a recording to the schedule
+     * @param recording Recording to add; an id is assigned if it has none
+     * @return Id of the recording
+     */
+    QString schedule(const ScheduledRecording &recording);
+
+    /**
+     * @brief Start recording a channel now
+     * @param channelName Channel name
+     * @param url Stream URL
+     * @param minutes Maximum length in minutes
+     * @return Id of the recording
+     */
+    QString recordNow(const QString &channelName, const QString &url, int minutes = 240);
+
+    /**
+     * @brief Stop a running recording, or cancel a scheduled one
+     * @param id Recording id
+     */
+    void remove(const QString &id);
+
+    /**
+     * @brief Check whether a recording is running
+     * @param id Recording id
+     * @return True if running
+     */
+    bool isRecording(const QString &id) const;
+
+    /**
+     * @brief Find the running recording of a stream
+     * @param url Stream URL
+     * @return Recording id, empty if the stream is not being recorded
+     */
+    QString recordingForUrl(const QString &url) const;
+
+signals:
+    /**
+     * @brief Signal emitted when the schedule changes
+     */
+    void scheduleChanged();
+
+    /**
+     * @brief Signal emitted when a recording starts
+     * @param id Recording id
+     * @param outputPath File being written
+     */
+    void recordingStarted(const QString &id, const QString &outputPath);
+
+    /**
+     * @brief Signal emitted when a recording stops
+     * @param id Recording id
+     * @param ok True if it stopped as planned
+     * @param error Error message, empty on success
+     */
+    void recordingFinished(const QString &id, bool ok, const QString &error);
+
+private slots:
+    /**
+     * @brief Start due recordings, stop finished ones and arm the timer
+     */
+    void update();
+
+private:
+    /**
+     * @brief Start the recorder for a recording
+     * @param recording Recording to start
+     */
+    void startRecorder(const ScheduledRecording &recording);
+
+    /**
+     * @brief Handle a recorder that ended
+     * @param id Recording id
+     * @param ok True if the stream ended normally
+     * @param error Error message
+     */
+    void onRecorderFinished(const QString &id, bool ok, const QString &error);
+
+    /**
+     * @brief Get a new output file for a recording
+     * @param recording Recording
+     * @return Path that does not exist yet
+     */
+    QString outputPath(const ScheduledRecording &recording) const;
+
+    /**
+     * @brief Write the schedule to the settings
+     */
+    void save();
+
+    Settings *m_settings;
+    QList<ScheduledRecording> m_recordings;
+    QHash<QString, StreamRecorder *> m_recorders;
+    QTimer m_timer;
+};
+
+#endif // RECORDINGSCHEDULER_H
\ No newline at end of file
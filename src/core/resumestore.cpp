@@ -0,0 +1,192 @@
+#include "resumestore.h"
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <algorithm>
+
+static const quint32 RESUME_MAGIC = 0x48545652; // "HTVR"
+static const quint16 RESUME_VERSION = 1;
+static const int KEY_BYTES = 8;
+static const int MAX_ENTRIES = 1000;
+static const qint64 MAX_AGE_SECS = 180LL * 24 * 60 * 60;
+static const int SAVE_DELAY_MS = 10000;
+static const double MIN_DURATION_SECS = 5 * 60;
+static const double MIN_POSITION_SECS = 30;
+static const double END_MARGIN_SECS = 60;
+static const double END_FRACTION = 0.95;
+
+ResumeStore::ResumeStore(QObject *parent)
+    : QObject(parent)
+{
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(SAVE_DELAY_MS);
+    connect(&m_saveTimer, &QTimer::timeout, this, &ResumeStore::save);
+}
+
+ResumeStore::~ResumeStore()
+{
+    if (m_saveTimer.isActive())
+    {
+        save();
+    }
+}
+
+bool ResumeStore::load(const QString &filePath)
+{
+    m_filePath = filePath;
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 count = 0;
+    in >> magic >> version >> count;
+    if (magic != RESUME_MAGIC || version != RESUME_VERSION)
+    {
+        qWarning() << "Ignoring resume file with unknown format:" << filePath;
+        return false;
+    }
+
+    // Fixed-size records: key, position, last update
+    QHash<QByteArray, Entry> entries;
+    entries.reserve(static_cast<int>(qMin<quint32>(count, MAX_ENTRIES)));
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i)
+    {
+        QByteArray key(KEY_BYTES, Qt::Uninitialized);
+        Entry entry;
+        in.readRawData(key.data(), KEY_BYTES);
+        in >> entry.position >> entry.updated;
+        entries.insert(key, entry);
+    }
+
+    if (in.status() != QDataStream::Ok)
+    {
+        qWarning() << "Ignoring truncated resume file:" << filePath;
+        return false;
+    }
+
+    m_entries = entries;
+    prune();
+    return true;
+}
+
+bool ResumeStore::save()
+{
+    m_saveTimer.stop();
+
+    if (m_filePath.isEmpty())
+    {
+        return false;
+    }
+
+    prune();
+
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Could not save resume positions:" << m_filePath;
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+
+    out << RESUME_MAGIC << RESUME_VERSION << static_cast<quint32>(m_entries.size());
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+    {
+        out.writeRawData(it.key().constData(), KEY_BYTES);
+        out << it.value().position << it.value().updated;
+    }
+
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+double ResumeStore::position(const QString &media) const
+{
+    auto it = m_entries.constFind(mediaKey(media));
+    return it != m_entries.constEnd() ? it.value().position : 0.0;
+}
+
+void ResumeStore::setPosition(const QString &media, double position, double duration)
+{
+    if (media.isEmpty() || duration < MIN_DURATION_SECS)
+    {
+        return;
+    }
+
+    // Barely started or watched to the end: the next open starts from the beginning
+    if (position < MIN_POSITION_SECS || position > qMin(duration - END_MARGIN_SECS, duration * END_FRACTION))
+    {
+        remove(media);
+        return;
+    }
+
+    Entry &entry = m_entries[mediaKey(media)];
+    if (qAbs(entry.position - position) < 1.0)
+    {
+        return;
+    }
+
+    entry.position = position;
+    entry.updated = QDateTime::currentSecsSinceEpoch();
+    scheduleSave();
+}
+
+void ResumeStore::remove(const QString &media)
+{
+    if (m_entries.remove(mediaKey(media)) > 0)
+    {
+        scheduleSave();
+    }
+}
+
+QByteArray ResumeStore::mediaKey(const QString &media)
+{
+    return QCryptographicHash::hash(media.toUtf8(), QCryptographicHash::Sha1).left(KEY_BYTES);
+}
+
+void ResumeStore::prune()
+{
+    const qint64 oldest = QDateTime::currentSecsSinceEpoch() - MAX_AGE_SECS;
+    m_entries.removeIf([oldest](QHash<QByteArray, Entry>::iterator it)
+                       { return it.value().updated < oldest; });
+
+    if (m_entries.size() <= MAX_ENTRIES)
+    {
+        return;
+    }
+
+    QList<qint64> updated;
+    updated.reserve(m_entries.size());
+    for (const Entry &entry : std::as_const(m_entries))
+    {
+        updated.append(entry.updated);
+    }
+
+    // Keep the most recently updated entries
+    auto cutoff = updated.begin() + (updated.size() - MAX_ENTRIES);
+    std::nth_element(updated.begin(), cutoff, updated.end());
+    const qint64 threshold = *cutoff;
+
+    m_entries.removeIf([threshold](QHash<QByteArray, Entry>::iterator it)
+                       { return it.value().updated < threshold; });
+}
+
+void ResumeStore::scheduleSave()
+{
+    // Not restarted by later changes, so a steady stream of updates still gets written
+    if (!m_filePath.isEmpty() && !m_saveTimer.isActive())
+    {
+        m_saveTimer.start();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#ifndef RESUMESTORE_H
+#define RESUMESTORE_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QTimer>
+
+/**
+ * @brief The ResumeStore class remembers where each file or VOD was left
+ *
+ * Entries are keyed by a truncated SHA-1 of the path or URL, so lookups are
+ * a single hash probe and the file stays small whatever the URLs look like.
+ * Only media long enough to be worth resuming are kept, and an entry is
+ * dropped once the media has been watched to the end. Position updates are
+ * batched and written atomically at most every few seconds; the store is
+ * capped in size and entries not touched for months are pruned.
+ */
+class ResumeStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor
+     * @param parent Parent object
+     */
+    explicit ResumeStore(QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor, writes pending changes
+     */
+    ~ResumeStore();
+
+    /**
+     * @brief Load resume positions and persist future changes to a file
+     * @param filePath Path to the resume file
+     * @return True if the file was loaded, false if it is missing or invalid
+     */
+    bool load(const QString &filePath);
+
+    /**
+     * @brief Save resume positions to the file they were loaded from
+     * @return True if successful, false otherwise
+     */
+    bool save();
+
+    /**
+     * @brief Get the position to resume a media at
+     * @param media File path or URL
+     * @return Position in seconds, 0 to start from the beginning
+     */
+    double position(const QString &media) const;
+
+    /**
+     * @brief Record the playback position of a media
+     * @param media File path or URL
+     * @param position Position in seconds
+     * @param duration Duration in seconds
+     */
+    void setPosition(const QString &media, double position, double duration);
+
+    /**
+     * @brief Forget the position of a media
+     * @param media File path or URL
+     */
+    void remove(const QString &media);
+
+    /**
+     * @brief Get the key a media is stored under
+     * @param media File path or URL
+     * @return Truncated SHA-1 of the media
+     */
+    static QByteArray mediaKey(const QString &media);
+
+private:
+    /**
+     * @brief A stored position
+     */
+    struct Entry
+    {
+        double position = 0.0;
+        qint64 updated = 0;
+    };
+
+    /**
+     * @brief Drop old entries and the least recently updated ones over the cap
+     */
+    void prune();
+
+    /**
+     * @brief Schedule a batched save
+     */
+    void scheduleSave();
+
+    QString m_filePath;
+    QHash<QByteArray, Entry> m_entries;
+    QTimer m_saveTimer;
+};
+
+#endif // RESUMESTORE_H
\ No newline at end of file
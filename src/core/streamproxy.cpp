@@ -0,0 +1,941 @@
+#include "streamproxy.h"
+#include <QDebug>
+#include <QDateTime>
+#include <QNetworkRequest>
+#include <QRegularExpression>
+
+static const qint64 DEFAULT_MEMORY_BUDGET = 64 * 1024 * 1024;
+static const qint64 MAX_REQUEST_HEADER = 16 * 1024;
+static const qint64 STATIC_PLAYLIST_TTL_MS = 10 * 60 * 1000;
+static const qint64 MIN_LIVE_PLAYLIST_TTL_MS = 500;
+static const qint64 VOD_CHUNK_SIZE = 256 * 1024;
+static const qint64 VOD_WRITE_HIGH_WATER = 1024 * 1024;
+static const qint64 VOD_UPSTREAM_BUFFER = 1024 * 1024;
+
+StreamProxy::StreamProxy(QObject *parent)
+    : QObject(parent), m_diskCache(nullptr)
+{
+    m_cache.setMaxCost(DEFAULT_MEMORY_BUDGET);
+    connect(&m_server, &QTcpServer::newConnection, this, &StreamProxy::onNewConnection);
+}
+
+StreamProxy::~StreamProxy()
+{
+    stop();
+}
+
+bool StreamProxy::start()
+{
+    if (m_server.isListening())
+    {
+        return true;
+    }
+
+    if (!m_server.listen(QHostAddress::LocalHost, 0))
+    {
+        qWarning() << "Could not start stream proxy:" << m_server.errorString();
+        return false;
+    }
+
+    qDebug() << "Stream proxy listening on port" << m_server.serverPort();
+    return true;
+}
+
+void StreamProxy::stop()
+{
+    if (!m_server.isListening())
+    {
+        return;
+    }
+
+    m_server.close();
+
+    const QList<QTcpSocket *> sockets = m_buffers.keys();
+    for (QTcpSocket *socket : sockets)
+    {
+        socket->abort();
+        socket->deleteLater();
+    }
+    qDeleteAll(m_transfers);
+    m_transfers.clear();
+    m_buffers.clear();
+    m_busy.clear();
+    m_fetches.clear();
+    m_cache.clear();
+
+    qDebug() << "Stream proxy stopped:" << m_stats.requests << "requests," << qRound(m_stats.hitRate() * 100) << "% hits,"
+             << m_stats.bytesFromCache / 1024 << "KiB served from cache";
+}
+
+bool StreamProxy::isRunning() const
+{
+    return m_server.isListening();
+}
+
+void StreamProxy::setMemoryBudget(qint64 bytes)
+{
+    m_cache.setMaxCost(bytes);
+}
+
+QString StreamProxy::proxyUrl(const QString &url) const
+{
+    if (!m_server.isListening())
+    {
+        return url;
+    }
+
+    return routeUrl("s", url);
+}
+
+void StreamProxy::setDiskCache(VodCache *cache)
+{
+    m_diskCache = cache;
+}
+
+QString StreamProxy::vodUrl(const QString &url) const
+{
+    if (!m_server.isListening() || !m_diskCache)
+    {
+        return url;
+    }
+
+    return routeUrl("v", url);
+}
+
+bool StreamProxy::isVodUrl(const QString &url)
+{
+    static const QStringList extensions = {".mp4", ".m4v", ".mkv", ".webm", ".mov", ".avi", ".flv", ".wmv"};
+
+    QUrl parsed(url);
+    if (parsed.scheme() != "http" && parsed.scheme() != "https")
+    {
+        return false;
+    }
+
+    const QString path = parsed.path();
+    for (const QString &extension : extensions)
+    {
+        if (path.endsWith(extension, Qt::CaseInsensitive))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool StreamProxy::isHlsUrl(const QString &url)
+{
+    QUrl parsed(url);
+    return (parsed.scheme() == "http" || parsed.scheme() == "https") &&
+           parsed.path().endsWith(".m3u8", Qt::CaseInsensitive);
+}
+
+void StreamProxy::prefetch(const QString &url)
+{
+    if (!m_server.isListening() || cached(url) || m_fetches.contains(url))
+    {
+        return;
+    }
+
+    fetch(url, Request(), QHash<QByteArray, QByteArray>());
+}
+
+StreamProxy::Stats StreamProxy::stats() const
+{
+    return m_stats;
+}
+
+void StreamProxy::onNewConnection()
+{
+    while (QTcpSocket *socket = m_server.nextPendingConnection())
+    {
+        m_buffers.insert(socket, QByteArray());
+        connect(socket, &QTcpSocket::readyRead, this, &StreamProxy::onReadyRead);
+        connect(socket, &QTcpSocket::disconnected, this, &StreamProxy::onDisconnected);
+    }
+}
+
+void StreamProxy::onReadyRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (!socket || !m_buffers.contains(socket))
+    {
+        return;
+    }
+
+    m_buffers[socket].append(socket->readAll());
+    processRequest(socket);
+}
+
+void StreamProxy::onDisconnected()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (!socket)
+    {
+        return;
+    }
+
+    // Stop any VOD transfer still streaming to this client
+    if (VodTransfer *transfer = m_transfers.take(socket))
+    {
+        transfer->deleteLater();
+    }
+
+    m_buffers.remove(socket);
+    m_busy.remove(socket);
+    socket->deleteLater();
+}
+
+void StreamProxy::processRequest(QTcpSocket *socket)
+{
+    // Requests on one connection are answered strictly in order
+    if (m_busy.contains(socket))
+    {
+        return;
+    }
+
+    QByteArray &buffer = m_buffers[socket];
+    qsizetype headerEnd = buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0)
+    {
+        if (buffer.size() > MAX_REQUEST_HEADER)
+        {
+            buffer.clear();
+            m_busy.insert(socket);
+            respondError(socket, 431, "Request Header Fields Too Large");
+            socket->disconnectFromHost();
+        }
+        return;
+    }
+
+    const QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+    buffer.remove(0, headerEnd + 4);
+    m_busy.insert(socket);
+
+    const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+    if (requestLine.size() < 2 || (requestLine[0] != "GET" && requestLine[0] != "HEAD"))
+    {
+        respondError(socket, 405, "Method Not Allowed");
+        return;
+    }
+
+    QByteArray route;
+    const QString url = upstreamUrl(requestLine[1], &route);
+    if (url.isEmpty() || (route == "v" && !m_diskCache))
+    {
+        respondError(socket, 404, "Not Found");
+        return;
+    }
+
+    Request request;
+    request.socket = socket;
+    request.headOnly = requestLine[0] == "HEAD";
+
+    QHash<QByteArray, QByteArray> headers;
+    for (int i = 1; i < lines.size(); ++i)
+    {
+        qsizetype colon = lines[i].indexOf(':');
+        if (colon <= 0)
+        {
+            continue;
+        }
+
+        QByteArray name = lines[i].left(colon).trimmed().toLower();
+        QByteArray value = lines[i].mid(colon + 1).trimmed();
+
+        if (name == "range" && value.startsWith("bytes="))
+        {
+            QList<QByteArray> range = value.mid(6).split('-');
+            bool ok = false;
+            request.rangeStart = range.value(0).toLongLong(&ok);
+            if (!ok)
+            {
+                request.rangeStart = -1;
+            }
+            else if (!range.value(1).isEmpty())
+            {
+                request.rangeEnd = range.value(1).toLongLong(&ok);
+                if (!ok)
+                {
+                    request.rangeEnd = -1;
+                }
+            }
+        }
+        else if (name == "user-agent" || name == "referer" || name == "cookie")
+        {
+            headers.insert(name, value);
+        }
+    }
+
+    if (route == "v")
+    {
+        VodTransfer *transfer = new VodTransfer(this, url, request, headers);
+        m_transfers.insert(socket, transfer);
+        connect(socket, &QTcpSocket::bytesWritten, transfer, [transfer]()
+                { transfer->onBytesWritten(); });
+        transfer->start();
+        return;
+    }
+
+    ++m_stats.requests;
+
+    if (const Entry *entry = cached(url))
+    {
+        ++m_stats.hits;
+        m_stats.bytesFromCache += entry->data.size();
+        respond(request, *entry);
+        return;
+    }
+
+    fetch(url, request, headers);
+}
+
+const StreamProxy::Entry *StreamProxy::cached(const QString &url)
+{
+    const Entry *entry = m_cache.object(url);
+    if (!entry)
+    {
+        return nullptr;
+    }
+
+    if (entry->expires > 0 && entry->expires <= QDateTime::currentMSecsSinceEpoch())
+    {
+        m_cache.remove(url);
+        return nullptr;
+    }
+
+    return entry;
+}
+
+void StreamProxy::fetch(const QString &url, const Request &request, const QHash<QByteArray, QByteArray> &headers)
+{
+    auto it = m_fetches.find(url);
+    if (it != m_fetches.end())
+    {
+        // Someone is already fetching this; answer both from the same response
+        if (request.socket)
+        {
+            it->append(request);
+        }
+        return;
+    }
+
+    QList<Request> waiting;
+    if (request.socket)
+    {
+        waiting.append(request);
+    }
+    m_fetches.insert(url, waiting);
+
+    QNetworkRequest upstream{QUrl(url)};
+    for (auto header = headers.constBegin(); header != headers.constEnd(); ++header)
+    {
+        upstream.setRawHeader(header.key(), header.value());
+    }
+
+    QNetworkReply *reply = m_network.get(upstream);
+    connect(reply, &QNetworkReply::finished, this, [this, url, reply]()
+            { onFetchFinished(url, reply); });
+}
+
+void StreamProxy::onFetchFinished(const QString &url, QNetworkReply *reply)
+{
+    reply->deleteLater();
+
+    if (!m_fetches.contains(url))
+    {
+        return;
+    }
+
+    const QList<Request> waiting = m_fetches.take(url);
+
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (reply->error() != QNetworkReply::NoError)
+    {
+        qDebug() << "Stream proxy fetch failed:" << url << reply->errorString();
+
+        for (const Request &request : waiting)
+        {
+            if (request.socket)
+            {
+                respondError(request.socket, status >= 400 ? status : 502, "Bad Gateway");
+            }
+        }
+        return;
+    }
+
+    Entry *entry = new Entry();
+    entry->data = reply->readAll();
+    entry->contentType = reply->header(QNetworkRequest::ContentTypeHeader).toByteArray();
+    m_stats.bytesFromUpstream += entry->data.size();
+
+    if (entry->data.startsWith("#EXTM3U"))
+    {
+        // Relative URIs resolve against the final URL, after redirects
+        entry->data = rewritePlaylist(entry->data, reply->url());
+        entry->expires = QDateTime::currentMSecsSinceEpoch() + playlistTtl(entry->data);
+    }
+
+    for (const Request &request : waiting)
+    {
+        if (request.socket)
+        {
+            respond(request, *entry);
+        }
+    }
+
+    // Anything bigger than a quarter of the budget would flush the cache for little gain
+    if (entry->data.size() <= m_cache.maxCost() / 4)
+    {
+        m_cache.insert(url, entry, entry->data.size());
+    }
+    else
+    {
+        delete entry;
+    }
+}
+
+void StreamProxy::respond(const Request &request, const Entry &entry)
+{
+    QTcpSocket *socket = request.socket;
+    const qint64 total = entry.data.size();
+
+    qint64 start = 0;
+    qint64 end = total - 1;
+    bool partial = false;
+
+    if (request.rangeStart >= 0)
+    {
+        if (request.rangeStart >= total)
+        {
+            QByteArray header = "HTTP/1.1 416 Range Not Satisfiable\r\n";
+            header += "Content-Range: bytes */" + QByteArray::number(total) + "\r\n";
+            header += "Content-Length: 0\r\n";
+            header += "Connection: keep-alive\r\n\r\n";
+            socket->write(header);
+            finishRequest(socket);
+            return;
+        }
+
+        start = request.rangeStart;
+        if (request.rangeEnd >= start && request.rangeEnd < total)
+        {
+            end = request.rangeEnd;
+        }
+        partial = true;
+    }
+
+    QByteArray header;
+    header += partial ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+    if (!entry.contentType.isEmpty())
+    {
+        header += "Content-Type: " + entry.contentType + "\r\n";
+    }
+    header += "Content-Length: " + QByteArray::number(end - start + 1) + "\r\n";
+    if (partial)
+    {
+        header += "Content-Range: bytes " + QByteArray::number(start) + "-" + QByteArray::number(end) + "/" +
+                  QByteArray::number(total) + "\r\n";
+    }
+    header += "Accept-Ranges: bytes\r\n";
+    header += "Cache-Control: no-cache\r\n";
+    header += "Connection: keep-alive\r\n\r\n";
+
+    socket->write(header);
+    if (!request.headOnly)
+    {
+        socket->write(entry.data.constData() + start, end - start + 1);
+    }
+
+    finishRequest(socket);
+}
+
+void StreamProxy::respondError(QTcpSocket *socket, int status, const QByteArray &reason)
+{
+    QByteArray header = "HTTP/1.1 " + QByteArray::number(status) + " " + reason + "\r\n";
+    header += "Content-Length: 0\r\n";
+    header += "Connection: keep-alive\r\n\r\n";
+    socket->write(header);
+    finishRequest(socket);
+}
+
+void StreamProxy::finishRequest(QTcpSocket *socket)
+{
+    m_busy.remove(socket);
+
+    // The client may already have sent its next request
+    if (m_buffers.contains(socket) && !m_buffers.value(socket).isEmpty())
+    {
+        processRequest(socket);
+    }
+}
+
+void StreamProxy::finishTransfer(QTcpSocket *socket)
+{
+    VodTransfer *transfer = m_transfers.take(socket);
+    if (transfer)
+    {
+        transfer->deleteLater();
+    }
+
+    finishRequest(socket);
+}
+
+QByteArray StreamProxy::rewritePlaylist(const QByteArray &playlist, const QUrl &base) const
+{
+    static const QRegularExpression uriAttribute("URI=\"([^\"]*)\"");
+
+    QByteArray rewritten;
+    rewritten.reserve(playlist.size() * 2);
+
+    const QList<QByteArray> lines = playlist.split('\n');
+    for (const QByteArray &rawLine : lines)
+    {
+        QString line = QString::fromUtf8(rawLine).trimmed();
+
+        if (line.isEmpty())
+        {
+            continue;
+        }
+
+        if (line.startsWith('#'))
+        {
+            // Keys, init sections and alternate renditions carry their URI as an attribute
+            if (line.contains("URI=\""))
+            {
+                QString result;
+                qsizetype last = 0;
+                QRegularExpressionMatchIterator matches = uriAttribute.globalMatch(line);
+                while (matches.hasNext())
+                {
+                    QRegularExpressionMatch match = matches.next();
+                    QString uri = base.resolved(QUrl(match.captured(1))).toString();
+                    result += line.mid(last, match.capturedStart(1) - last);
+                    result += proxyUrl(uri);
+                    last = match.capturedEnd(1);
+                }
+                result += line.mid(last);
+                line = result;
+            }
+        }
+        else
+        {
+            line = proxyUrl(base.resolved(QUrl(line)).toString());
+        }
+
+        rewritten += line.toUtf8();
+        rewritten += '\n';
+    }
+
+    return rewritten;
+}
+
+qint64 StreamProxy::playlistTtl(const QByteArray &playlist)
+{
+    // Master playlists and finished media playlists do not change
+    if (playlist.contains("#EXT-X-STREAM-INF") || playlist.contains("#EXT-X-ENDLIST"))
+    {
+        return STATIC_PLAYLIST_TTL_MS;
+    }
+
+    // A live playlist gains a segment about every target duration; poll at twice that rate
+    qsizetype tag = playlist.indexOf("#EXT-X-TARGETDURATION:");
+    if (tag >= 0)
+    {
+        qsizetype valueStart = tag + 22;
+        qsizetype valueEnd = playlist.indexOf('\n', valueStart);
+        bool ok = false;
+        double targetDuration = playlist.mid(valueStart, valueEnd < 0 ? -1 : valueEnd - valueStart).trimmed().toDouble(&ok);
+        if (ok && targetDuration > 0)
+        {
+            return qMax(MIN_LIVE_PLAYLIST_TTL_MS, static_cast<qint64>(targetDuration * 1000 / 2));
+        }
+    }
+
+    return MIN_LIVE_PLAYLIST_TTL_MS;
+}
+
+QString StreamProxy::routeUrl(const char *route, const QString &url) const
+{
+    // Keep the file name so the demuxer can still probe by extension
+    QString fileName = QUrl(url).fileName();
+    if (fileName.isEmpty())
+    {
+        fileName = "stream";
+    }
+
+    QByteArray encoded = url.toUtf8().toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals);
+    return QString("http://127.0.0.1:%1/%2/%3/%4")
+        .arg(m_server.serverPort())
+        .arg(QString::fromLatin1(route), QString::fromLatin1(encoded), fileName);
+}
+
+QString StreamProxy::upstreamUrl(const QByteArray &path, QByteArray *route)
+{
+    // "/s/<base64url of the upstream URL>/<file name>" for HLS, "/v/..." for VOD files
+    if (!path.startsWith("/s/") && !path.startsWith("/v/"))
+    {
+        return QString();
+    }
+    *route = path.mid(1, 1);
+
+    qsizetype end = path.indexOf('/', 3);
+    QByteArray encoded = path.mid(3, end < 0 ? -1 : end - 3);
+
+    auto decoded = QByteArray::fromBase64Encoding(encoded, QByteArray::Base64UrlEncoding | QByteArray::AbortOnBase64DecodingErrors);
+    if (!decoded)
+    {
+        return QString();
+    }
+
+    // Only ever proxy web URLs, never local files
+    QString url = QString::fromUtf8(*decoded);
+    QString scheme = QUrl(url).scheme();
+    return scheme == "http" || scheme == "https" ? url : QString();
+}
+
+StreamProxy::VodTransfer::VodTransfer(StreamProxy *proxy, const QString &url, const Request &request, const QHash<QByteArray, QByteArray> &headers)
+    : QObject(proxy), m_proxy(proxy), m_url(url), m_request(request), m_headers(headers), m_reply(nullptr), m_position(qMax<qint64>(0, request.rangeStart)), m_end(-1), m_total(-1), m_skip(0), m_headerSent(false), m_upstreamDone(false), m_finished(false)
+{
+}
+
+StreamProxy::VodTransfer::~VodTransfer()
+{
+    dropReply();
+}
+
+void StreamProxy::VodTransfer::start()
+{
+    if (!m_proxy->m_diskCache->resourceInfo(m_url, &m_total, &m_contentType))
+    {
+        // Size unknown yet; the upstream response headers will tell
+        m_total = -1;
+        startUpstream();
+        return;
+    }
+
+    m_end = m_request.rangeEnd >= m_position && m_request.rangeEnd < m_total ? m_request.rangeEnd : m_total - 1;
+    if (m_position >= m_total)
+    {
+        QByteArray header = "HTTP/1.1 416 Range Not Satisfiable\r\n";
+        header += "Content-Range: bytes */" + QByteArray::number(m_total) + "\r\n";
+        header += "Content-Length: 0\r\n";
+        header += "Connection: keep-alive\r\n\r\n";
+        m_request.socket->write(header);
+        finish();
+        return;
+    }
+
+    sendHeader();
+    pump();
+}
+
+void StreamProxy::VodTransfer::onBytesWritten()
+{
+    if (m_finished)
+    {
+        return;
+    }
+
+    if (m_reply)
+    {
+        onUpstreamData();
+    }
+    else
+    {
+        pump();
+    }
+}
+
+void StreamProxy::VodTransfer::pump()
+{
+    if (m_finished || !m_request.socket)
+    {
+        return;
+    }
+
+    if (m_request.headOnly)
+    {
+        finish();
+        return;
+    }
+
+    VodCache *cache = m_proxy->m_diskCache;
+    while (m_position <= m_end && m_request.socket->bytesToWrite() < VOD_WRITE_HIGH_WATER)
+    {
+        QByteArray data = cache->read(m_url, m_position, qMin(VOD_CHUNK_SIZE, m_end - m_position + 1));
+        if (data.isEmpty())
+        {
+            // A gap; fetch it and continue from disk afterwards
+            if (!m_reply)
+            {
+                startUpstream();
+            }
+            return;
+        }
+
+        m_request.socket->write(data);
+        m_position += data.size();
+    }
+
+    if (m_position > m_end)
+    {
+        finish();
+    }
+}
+
+void StreamProxy::VodTransfer::startUpstream()
+{
+    QNetworkRequest request{QUrl(m_url)};
+    for (auto header = m_headers.constBegin(); header != m_headers.constEnd(); ++header)
+    {
+        request.setRawHeader(header.key(), header.value());
+    }
+
+    // Only fetch up to the next range already on disk
+    QByteArray range = "bytes=" + QByteArray::number(m_position) + "-";
+    if (m_end >= 0)
+    {
+        qint64 next = m_proxy->m_diskCache->nextCachedOffset(m_url, m_position);
+        qint64 upstreamEnd = next > m_position && next <= m_end ? next - 1 : m_end;
+        range += QByteArray::number(upstreamEnd);
+    }
+    request.setRawHeader("Range", range);
+
+    m_skip = 0;
+    m_upstreamDone = false;
+    m_reply = m_proxy->m_network.get(request);
+
+    // Bounded so a slow client throttles the download instead of filling memory
+    m_reply->setReadBufferSize(VOD_UPSTREAM_BUFFER);
+
+    connect(m_reply, &QNetworkReply::metaDataChanged, this, [this]()
+            { onUpstreamHeaders(); });
+    connect(m_reply, &QNetworkReply::readyRead, this, [this]()
+            { onUpstreamData(); });
+    connect(m_reply, &QNetworkReply::finished, this, [this]()
+            { onUpstreamFinished(); });
+}
+
+void StreamProxy::VodTransfer::onUpstreamHeaders()
+{
+    int status = m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    qint64 total = -1;
+
+    if (status == 206)
+    {
+        // "bytes <start>-<end>/<total>"
+        QByteArray contentRange = m_reply->rawHeader("Content-Range");
+        qsizetype slash = contentRange.lastIndexOf('/');
+        bool ok = false;
+        total = contentRange.mid(slash + 1).toLongLong(&ok);
+        if (slash < 0 || !ok)
+        {
+            total = -1;
+        }
+    }
+    else if (status == 200)
+    {
+        // The server ignored the range and sends the whole file from the start
+        m_skip = m_position;
+        bool ok = false;
+        total = m_reply->header(QNetworkRequest::ContentLengthHeader).toLongLong(&ok);
+        if (!ok)
+        {
+            total = -1;
+        }
+    }
+    else
+    {
+        return;
+    }
+
+    if (m_total < 0 && total > 0)
+    {
+        m_total = total;
+        m_contentType = m_reply->header(QNetworkRequest::ContentTypeHeader).toByteArray();
+        m_proxy->m_diskCache->setResourceInfo(m_url, m_total, m_contentType);
+    }
+
+    if (m_headerSent)
+    {
+        return;
+    }
+
+    if (m_total >= 0)
+    {
+        m_end = m_request.rangeEnd >= m_position && m_request.rangeEnd < m_total ? m_request.rangeEnd : m_total - 1;
+    }
+    sendHeader();
+
+    if (m_request.headOnly)
+    {
+        dropReply();
+        finish();
+    }
+}
+
+void StreamProxy::VodTransfer::onUpstreamData()
+{
+    if (m_finished || !m_reply || !m_request.socket || !m_headerSent)
+    {
+        return;
+    }
+
+    VodCache *cache = m_proxy->m_diskCache;
+    while (m_reply->bytesAvailable() > 0 && m_request.socket->bytesToWrite() < VOD_WRITE_HIGH_WATER)
+    {
+        QByteArray data = m_reply->read(VOD_CHUNK_SIZE);
+
+        if (m_skip > 0)
+        {
+            qint64 skipped = qMin<qint64>(m_skip, data.size());
+            data.remove(0, skipped);
+            m_skip -= skipped;
+        }
+
+        if (m_end >= 0 && m_position + data.size() > m_end + 1)
+        {
+            data.truncate(m_end + 1 - m_position);
+        }
+
+        if (data.isEmpty())
+        {
+            continue;
+        }
+
+        // Only bytes of a known resource are cached; write() ignores the rest
+        if (m_total >= 0)
+        {
+            cache->write(m_url, m_position, data);
+        }
+
+        if (!m_request.headOnly)
+        {
+            m_request.socket->write(data);
+        }
+        m_position += data.size();
+
+        if (m_end >= 0 && m_position > m_end)
+        {
+            dropReply();
+            finish();
+            return;
+        }
+    }
+
+    if (m_upstreamDone && m_reply->bytesAvailable() == 0)
+    {
+        dropReply();
+        if (m_end < 0 || m_position > m_end)
+        {
+            finish();
+        }
+        else
+        {
+            pump();
+        }
+    }
+}
+
+void StreamProxy::VodTransfer::onUpstreamFinished()
+{
+    if (m_reply->error() != QNetworkReply::NoError)
+    {
+        qDebug() << "VOD cache fetch failed:" << m_url << m_reply->errorString();
+
+        int status = m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        dropReply();
+
+        if (!m_headerSent && m_request.socket)
+        {
+            m_finished = true;
+            m_proxy->m_transfers.remove(m_request.socket);
+            deleteLater();
+            m_proxy->respondError(m_request.socket, status >= 400 ? status : 502, "Bad Gateway");
+        }
+        else if (m_request.socket)
+        {
+            // The header promised more bytes than we can deliver
+            m_request.socket->abort();
+        }
+        return;
+    }
+
+    // Drain whatever the client has not taken yet before moving on
+    m_upstreamDone = true;
+    onUpstreamData();
+}
+
+void StreamProxy::VodTransfer::sendHeader()
+{
+    if (!m_request.socket)
+    {
+        return;
+    }
+
+    bool partial = m_request.rangeStart >= 0 && m_total >= 0;
+
+    QByteArray header;
+    header += partial ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+    if (!m_contentType.isEmpty())
+    {
+        header += "Content-Type: " + m_contentType + "\r\n";
+    }
+    if (m_total >= 0)
+    {
+        header += "Content-Length: " + QByteArray::number(m_end - m_position + 1) + "\r\n";
+        header += "Accept-Ranges: bytes\r\n";
+        header += "Connection: keep-alive\r\n";
+    }
+    else
+    {
+        // Without a length the end of the body is the end of the connection
+        header += "Connection: close\r\n";
+    }
+    if (partial)
+    {
+        header += "Content-Range: bytes " + QByteArray::number(m_position) + "-" + QByteArray::number(m_end) + "/" +
+                  QByteArray::number(m_total) + "\r\n";
+    }
+    header += "\r\n";
+
+    m_request.socket->write(header);
+    m_headerSent = true;
+}
+
+void StreamProxy::VodTransfer::finish()
+{
+    if (m_finished)
+    {
+        return;
+    }
+    m_finished = true;
+
+    QTcpSocket *socket = m_request.socket;
+    if (!socket)
+    {
+        return;
+    }
+
+    bool close = m_total < 0;
+    m_proxy->finishTransfer(socket);
+    if (close)
+    {
+        socket->disconnectFromHost();
+    }
+}
+
+void StreamProxy::VodTransfer::dropReply()
+{
+    if (!m_reply)
+    {
+        return;
+    }
+
+    QNetworkReply *reply = m_reply;
+    m_reply = nullptr;
+    reply->disconnect(this);
+    reply->abort();
+    reply->deleteLater();
+}
\ No newline at end of file
@@ -0,0 +1,315 @@
+#ifndef STREAMPROXY_H
+#define STREAMPROXY_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QCache>
+#include <QUrl>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include "vodcache.h"
+
+/**
+ * @brief The StreamProxy class is a caching HTTP proxy for HLS streams
+ *
+ * The proxy listens on localhost and serves mpv from a byte-budgeted RAM
+ * cache of playlists and segments, so switching back to a channel that was
+ * just watched does not download its playlists and recent segments again.
+ * Playlists are rewritten so that every URI in them, including URI="..."
+ * attributes of keys and init sections, also goes through the proxy.
+ *
+ * Segments never change and are kept until evicted. Live media playlists
+ * expire after half their target duration, so the player sees new segments
+ * as soon as upstream publishes them; master playlists and playlists with
+ * #EXT-X-ENDLIST are kept much longer. Concurrent requests for the same URL
+ * share one upstream fetch.
+ *
+ * With a VodCache attached, VOD files are served through a second route that
+ * streams byte ranges from disk where they are cached and from upstream
+ * where they are not, writing fetched ranges to the disk cache as they pass.
+ */
+class StreamProxy : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Cache statistics
+     */
+    struct Stats
+    {
+        qint64 requests = 0;
+        qint64 hits = 0;
+        qint64 bytesFromCache = 0;
+        qint64 bytesFromUpstream = 0;
+
+        /**
+         * @brief Get the fraction of requests served from the cache
+         * @return Hit rate between 0 and 1
+         */
+        double hitRate() const
+        {
+            return requests > 0 ? static_cast<double>(hits) / requests : 0.0;
+        }
+    };
+
+    /**
+     * @brief Constructor
+     * @param parent Parent object
+     */
+    explicit StreamProxy(QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor
+     */
+    ~StreamProxy();
+
+    /**
+     * @brief Start listening on an ephemeral localhost port
+     * @return True if successful, false otherwise
+     */
+    bool start();
+
+    /**
+     * @brief Stop listening and drop all connections and cached data
+     */
+    void stop();
+
+    /**
+     * @brief Check whether the proxy is listening
+     * @return True if listening
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief Set the in-memory cache budget
+     * @param bytes Maximum bytes of playlists and segments kept in memory
+     */
+    void setMemoryBudget(qint64 bytes);
+
+    /**
+     * @brief Get the proxy URL for an upstream URL
+     * @param url Upstream URL
+     * @return URL on the local proxy, or the URL unchanged if the proxy is not running
+     */
+    QString proxyUrl(const QString &url) const;
+
+    /**
+     * @brief Attach a disk cache for VOD files
+     * @param cache Disk cache, null to disable the VOD route
+     */
+    void setDiskCache(VodCache *cache);
+
+    /**
+     * @brief Get the proxy URL that serves a VOD file through the disk cache
+     * @param url Upstream URL
+     * @return URL on the local proxy, or the URL unchanged if there is no disk cache
+     */
+    QString vodUrl(const QString &url) const;
+
+    /**
+     * @brief Check whether a URL points to a VOD file
+     * @param url Stream URL
+     * @return True for http(s) URLs with a common media file extension
+     */
+    static bool isVodUrl(const QString &url);
+
+    /**
+     * @brief Check whether a URL points to an HLS playlist
+     * @param url Stream URL
+     * @return True for http(s) URLs ending in .m3u8
+     */
+    static bool isHlsUrl(const QString &url);
+
+    /**
+     * @brief Fetch a URL into the cache ahead of time
+     * @param url Upstream URL
+     */
+    void prefetch(const QString &url);
+
+    /**
+     * @brief Get cache statistics
+     * @return Statistics since the proxy was started
+     */
+    Stats stats() const;
+
+private slots:
+    /**
+     * @brief Accept pending client connections
+     */
+    void onNewConnection();
+
+    /**
+     * @brief Read requests from a client
+     */
+    void onReadyRead();
+
+    /**
+     * @brief Forget a disconnected client
+     */
+    void onDisconnected();
+
+private:
+    /**
+     * @brief Cached response
+     */
+    struct Entry
+    {
+        QByteArray data;
+        QByteArray contentType;
+        qint64 expires = 0;
+    };
+
+    /**
+     * @brief Client request waiting for a response
+     */
+    struct Request
+    {
+        QPointer<QTcpSocket> socket;
+        qint64 rangeStart = -1;
+        qint64 rangeEnd = -1;
+        bool headOnly = false;
+    };
+
+    /**
+     * @brief Streams one VOD range request from the disk cache and upstream
+     */
+    class VodTransfer : public QObject
+    {
+    public:
+        VodTransfer(StreamProxy *proxy, const QString &url, const Request &request, const QHash<QByteArray, QByteArray> &headers);
+        ~VodTransfer();
+
+        void start();
+        void onBytesWritten();
+
+    private:
+        void pump();
+        void startUpstream();
+        void onUpstreamHeaders();
+        void onUpstreamData();
+        void onUpstreamFinished();
+        void sendHeader();
+        void finish();
+        void dropReply();
+
+        StreamProxy *m_proxy;
+        QString m_url;
+        Request m_request;
+        QHash<QByteArray, QByteArray> m_headers;
+        QNetworkReply *m_reply;
+        QByteArray m_contentType;
+        qint64 m_position;
+        qint64 m_end;
+        qint64 m_total;
+        qint64 m_skip;
+        bool m_headerSent;
+        bool m_upstreamDone;
+        bool m_finished;
+    };
+
+    /**
+     * @brief Forget a finished VOD transfer and continue with the next request
+     * @param socket Client socket
+     */
+    void finishTransfer(QTcpSocket *socket);
+
+    /**
+     * @brief Parse and answer the next buffered request of a client
+     * @param socket Client socket
+     */
+    void processRequest(QTcpSocket *socket);
+
+    /**
+     * @brief Get a cached response that has not expired
+     * @param url Upstream URL
+     * @return Cached entry, null on a miss
+     */
+    const Entry *cached(const QString &url);
+
+    /**
+     * @brief Start an upstream fetch, or join the one already running
+     * @param url Upstream URL
+     * @param request Client request to answer, or one without a socket for prefetches
+     * @param headers Client headers forwarded upstream
+     */
+    void fetch(const QString &url, const Request &request, const QHash<QByteArray, QByteArray> &headers);
+
+    /**
+     * @brief Cache an upstream response and answer the waiting clients
+     * @param url Upstream URL
+     * @param reply Finished reply
+     */
+    void onFetchFinished(const QString &url, QNetworkReply *reply);
+
+    /**
+     * @brief Send a response to a client
+     * @param request Client request
+     * @param entry Response to send
+     */
+    void respond(const Request &request, const Entry &entry);
+
+    /**
+     * @brief Send an error response to a client
+     * @param socket Client socket
+     * @param status HTTP status code
+     * @param reason Reason phrase
+     */
+    void respondError(QTcpSocket *socket, int status, const QByteArray &reason);
+
+    /**
+     * @brief Mark a client ready for its next request
+     * @param socket Client socket
+     */
+    void finishRequest(QTcpSocket *socket);
+
+    /**
+     * @brief Route all URIs of a playlist through the proxy
+     * @param playlist Playlist text
+     * @param base URL the playlist was loaded from
+     * @return Rewritten playlist
+     */
+    QByteArray rewritePlaylist(const QByteArray &playlist, const QUrl &base) const;
+
+    /**
+     * @brief Get how long a playlist may be served from the cache
+     * @param playlist Playlist text
+     * @return Time to live in milliseconds
+     */
+    static qint64 playlistTtl(const QByteArray &playlist);
+
+    /**
+     * @brief Build a proxy URL
+     * @param route Route prefix
+     * @param url Upstream URL
+     * @return URL on the local proxy
+     */
+    QString routeUrl(const char *route, const QString &url) const;
+
+    /**
+     * @brief Decode the upstream URL from a proxy request path
+     * @param path Request path
+     * @param route Filled with the route prefix
+     * @return Upstream URL, empty if the path is invalid
+     */
+    static QString upstreamUrl(const QByteArray &path, QByteArray *route);
+
+    QTcpServer m_server;
+    QNetworkAccessManager m_network;
+    QCache<QString, Entry> m_cache;
+    QHash<QString, QList<Request>> m_fetches;
+    QHash<QTcpSocket *, QByteArray> m_buffers;
+    QSet<QTcpSocket *> m_busy;
+    QHash<QTcpSocket *, VodTransfer *> m_transfers;
+    VodCache *m_diskCache;
+    Stats m_stats;
+};
+
+#endif // STREAMPROXY_H
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "streamrecorder.h"
+#include <QDebug>
+#include <QFileInfo>
+
+// Static callback for MPV events
+static void on_recorder_events(void *ctx)
+{
+    StreamRecorder *recorder = static_cast<StreamRecorder *>(ctx);
+    QMetaObject::invokeMethod(recorder, "handleEvents", Qt::QueuedConnection);
+}
+
+StreamRecorder::StreamRecorder(const QString &url, const QString &outputPath, QObject *parent)
+    : QObject(parent), m_mpv(nullptr), m_url(url), m_outputPath(outputPath)
+{
+}
+
+StreamRecorder::~StreamRecorder()
+{
+    shutdown();
+}
+
+void StreamRecorder::setOption(const QString &name, const QString &value)
+{
+    m_options.insert(name, value);
+}
+
+bool StreamRecorder::start()
+{
+    if (m_mpv)
+    {
+        return true;
+    }
+
+    m_mpv = mpv_create();
+    if (!m_mpv)
+    {
+        qWarning() << "Failed to create MPV instance for recording";
+        return false;
+    }
+
+    // Headless: nothing is shown or played; packets are remuxed to the file. The tracks
+    // stay selected because stream-record only writes selected tracks, and they keep
+    // working decoders because mpv deselects a track whose decoder fails to open. What
+    // remains is decoding audio and parsing video with every frame skipped; run
+    // --bench-recording to see what that costs per recording on this machine.
+    mpv_set_option_string(m_mpv, "vo", "null");
+    mpv_set_option_string(m_mpv, "ao", "null");
+    mpv_set_option_string(m_mpv, "sid", "no");
+    mpv_set_option_string(m_mpv, "audio-display", "no");
+    mpv_set_option_string(m_mpv, "hwdec", "no");
+    mpv_set_option_string(m_mpv, "vd-lavc-skipframe", "all");
+    mpv_set_option_string(m_mpv, "vd-lavc-skipidct", "all");
+    mpv_set_option_string(m_mpv, "vd-lavc-skiploopfilter", "all");
+    mpv_set_option_string(m_mpv, "vd-lavc-threads", "1");
+    mpv_set_option_string(m_mpv, "untimed", "yes");
+    mpv_set_option_string(m_mpv, "keep-open", "no");
+    mpv_set_option_string(m_mpv, "idle", "no");
+    mpv_set_option_string(m_mpv, "ytdl", "no");
+    mpv_set_option_string(m_mpv, "input-default-bindings", "no");
+    mpv_set_option_string(m_mpv, "stream-record", m_outputPath.toUtf8().constData());
+
+    for (auto it = m_options.constBegin(); it != m_options.constEnd(); ++it)
+    {
+        mpv_set_option_string(m_mpv, it.key().toUtf8().constData(), it.value().toUtf8().constData());
+    }
+
+    mpv_request_log_messages(m_mpv, "error");
+
+    int result = mpv_initialize(m_mpv);
+    if (result < 0)
+    {
+        qWarning() << "Failed to initialize MPV for recording:" << mpv_error_string(result);
+        mpv_terminate_destroy(m_mpv);
+        m_mpv = nullptr;
+        return false;
+    }
+
+    mpv_set_wakeup_callback(m_mpv, on_recorder_events, this);
+
+    const QByteArray url = m_url.toUtf8();
+    const char *args[] = {"loadfile", url.constData(), nullptr};
+    result = mpv_command(m_mpv, args);
+    if (result < 0)
+    {
+        qWarning() << "Failed to start recording:" << mpv_error_string(result);
+        shutdown();
+        return false;
+    }
+
+    qDebug() << "Recording" << m_url << "to" << m_outputPath;
+    return true;
+}
+
+void StreamRecorder::stop()
+{
+    if (!m_mpv)
+    {
+        return;
+    }
+
+    shutdown();
+    emit finished(true, QString());
+}
+
+bool StreamRecorder::isRecording() const
+{
+    return m_mpv != nullptr;
+}
+
+QString StreamRecorder::url() const
+{
+    return m_url;
+}
+
+QString StreamRecorder::outputPath() const
+{
+    return m_outputPath;
+}
+
+qint64 StreamRecorder::bytesWritten() const
+{
+    return QFileInfo(m_outputPath).size();
+}
+
+void StreamRecorder::handleEvents()
+{
+    bool ended = false;
+    QString error;
+
+    while (m_mpv)
+    {
+        mpv_event *event = mpv_wait_event(m_mpv, 0);
+        if (!event || event->event_id == MPV_EVENT_NONE)
+        {
+            break;
+        }
+
+        switch (event->event_id)
+        {
+        case MPV_EVENT_END_FILE:
+        {
+            mpv_event_end_file *endFile = static_cast<mpv_event_end_file *>(event->data);
+            if (endFile && endFile->reason == MPV_END_FILE_REASON_ERROR)
+            {
+                error = QString::fromUtf8(mpv_error_string(endFile->error));
+            }
+            ended = true;
+            break;
+        }
+
+        case MPV_EVENT_SHUTDOWN:
+            ended = true;
+            break;
+
+        case MPV_EVENT_LOG_MESSAGE:
+        {
+            mpv_event_log_message *msg = static_cast<mpv_event_log_message *>(event->data);
+            if (msg)
+            {
+                qWarning() << "Recorder [" << msg->prefix << "]:" << QString::fromUtf8(msg->text).trimmed();
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    if (ended && m_mpv)
+    {
+        shutdown();
+        qDebug() << "Recording of" << m_url << "ended:" << (error.isEmpty() ? QString("end of stream") : error);
+        emit finished(error.isEmpty(), error);
+    }
+}
+
+void StreamRecorder::shutdown()
+{
+    if (!m_mpv)
+    {
+        return;
+    }
+
+    mpv_set_wakeup_callback(m_mpv, nullptr, nullptr);
+    mpv_terminate_destroy(m_mpv);
+    m_mpv = nullptr;
+}
\ No newline at end of file
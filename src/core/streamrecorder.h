@@ -0,0 +1,105 @@
+#ifndef STREAMRECORDER_H
+#define STREAMRECORDER_H
+
+#include <QObject>
+#include <QString>
+#include <QMap>
+#include <mpv/client.h>
+
+/**
+ * @brief The StreamRecorder class records a stream to disk without re-encoding
+ *
+ * Each recorder runs its own headless mpv instance, independent of the one
+ * used for playback, with null video and audio outputs. mpv's stream-record
+ * remuxes the demuxed packets into the output file through a buffered,
+ * strictly sequential writer. The video decoder is told to skip every
+ * frame; audio is still decoded, since the tracks must stay selected for
+ * stream-record to write them.
+ */
+class StreamRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor
+     * @param url Stream URL
+     * @param outputPath File to record to; the container follows its extension
+     * @param parent Parent object
+     */
+    StreamRecorder(const QString &url, const QString &outputPath, QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor, finishes the recording if still running
+     */
+    ~StreamRecorder();
+
+    /**
+     * @brief Set an extra mpv option, e.g. user-agent
+     * @param name Option name
+     * @param value Option value
+     */
+    void setOption(const QString &name, const QString &value);
+
+    /**
+     * @brief Start recording
+     * @return True if the recorder started, false otherwise
+     */
+    bool start();
+
+    /**
+     * @brief Stop recording and close the output file
+     */
+    void stop();
+
+    /**
+     * @brief Check whether the recorder is running
+     * @return True if recording
+     */
+    bool isRecording() const;
+
+    /**
+     * @brief Get the stream URL
+     * @return Stream URL
+     */
+    QString url() const;
+
+    /**
+     * @brief Get the output file
+     * @return Output file path
+     */
+    QString outputPath() const;
+
+    /**
+     * @brief Get the size of the output file so far
+     * @return Size in bytes
+     */
+    qint64 bytesWritten() const;
+
+signals:
+    /**
+     * @brief Signal emitted when the recording ends, by stop() or because the stream ended
+     * @param ok True if the stream ended normally or the recording was stopped
+     * @param error Error message, empty on success
+     */
+    void finished(bool ok, const QString &error);
+
+private slots:
+    /**
+     * @brief Handle MPV events
+     */
+    void handleEvents();
+
+private:
+    /**
+     * @brief Destroy the mpv instance, which finalizes the output file
+     */
+    void shutdown();
+
+    mpv_handle *m_mpv;
+    QString m_url;
+    QString m_outputPath;
+    QMap<QString, QString> m_options;
+};
+
+#endif // STREAMRECORDER_H
\ No newline at end of file
@@ -0,0 +1,347 @@
+#include "thumbnailgenerator.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <mpv/client.h>
+#include <mpv/render.h>
+#include <cstdlib>
+
+static const double BUCKET_SECS = 5.0;
+static const int THUMBNAIL_WIDTH = 160;
+static const int STALE_BUCKETS = 24;
+static const qint64 DEFAULT_CACHE_BUDGET = 16 * 1024 * 1024;
+static const int LOAD_TIMEOUT_MS = 10000;
+static const int FRAME_TIMEOUT_MS = 3000;
+
+/**
+ * @brief Owns the thumbnail mpv instance; lives on the worker thread
+ */
+class ThumbnailGenerator::Worker : public QObject
+{
+public:
+    ~Worker()
+    {
+        close();
+    }
+
+    /**
+     * @brief Render the frame at the keyframe nearest a position
+     * @param media File path or URL
+     * @param options MPV options
+     * @param time Position in seconds
+     * @return Thumbnail, null on failure
+     */
+    QImage render(const QString &media, const QHash<QString, QString> &options, double time)
+    {
+        if (media != m_media || !m_mpv)
+        {
+            close();
+            if (!open(media, options))
+            {
+                return QImage();
+            }
+        }
+
+        // Forget any frame left over from the previous request
+        mpv_render_context_update(m_render);
+
+        const QByteArray target = QByteArray::number(time, 'f', 3);
+        const char *args[] = {"seek", target.constData(), "absolute+keyframes", nullptr};
+        if (mpv_command(m_mpv, args) < 0)
+        {
+            return QImage();
+        }
+
+        // Paused, so the new frame is the one decoded at the keyframe
+        QElapsedTimer timer;
+        timer.start();
+        while (!(mpv_render_context_update(m_render) & MPV_RENDER_UPDATE_FRAME))
+        {
+            if (timer.elapsed() > FRAME_TIMEOUT_MS)
+            {
+                return QImage();
+            }
+
+            mpv_event *event = mpv_wait_event(m_mpv, 0.02);
+            if (event->event_id == MPV_EVENT_END_FILE || event->event_id == MPV_EVENT_SHUTDOWN)
+            {
+                close();
+                return QImage();
+            }
+        }
+
+        qint64 displayWidth = 0;
+        qint64 displayHeight = 0;
+        mpv_get_property(m_mpv, "dwidth", MPV_FORMAT_INT64, &displayWidth);
+        mpv_get_property(m_mpv, "dheight", MPV_FORMAT_INT64, &displayHeight);
+        if (displayWidth <= 0 || displayHeight <= 0)
+        {
+            return QImage();
+        }
+
+        int height = qBound(2, static_cast<int>(THUMBNAIL_WIDTH * displayHeight / displayWidth) & ~1, THUMBNAIL_WIDTH * 2);
+        QImage image(THUMBNAIL_WIDTH, height, QImage::Format_RGBX8888);
+
+        int size[2] = {image.width(), image.height()};
+        size_t stride = static_cast<size_t>(image.bytesPerLine());
+        mpv_render_param params[] = {
+            {MPV_RENDER_PARAM_SW_SIZE, size},
+            {MPV_RENDER_PARAM_SW_FORMAT, const_cast<char *>("rgb0")},
+            {MPV_RENDER_PARAM_SW_STRIDE, &stride},
+            {MPV_RENDER_PARAM_SW_POINTER, image.bits()},
+            {MPV_RENDER_PARAM_INVALID, nullptr}};
+
+        if (mpv_render_context_render(m_render, params) < 0)
+        {
+            return QImage();
+        }
+
+        return image;
+    }
+
+private:
+    /**
+     * @brief Create the mpv instance and load a file, paused
+     * @param media File path or URL
+     * @param options MPV options
+     * @return True if the file loaded
+     */
+    bool open(const QString &media, const QHash<QString, QString> &options)
+    {
+        m_mpv = mpv_create();
+        if (!m_mpv)
+        {
+            qWarning() << "Failed to create MPV instance for thumbnails";
+            return false;
+        }
+
+        // No audio, no subtitles, one cheap software decode per request
+        mpv_set_option_string(m_mpv, "vo", "libmpv");
+        mpv_set_option_string(m_mpv, "ao", "null");
+        mpv_set_option_string(m_mpv, "aid", "no");
+        mpv_set_option_string(m_mpv, "sid", "no");
+        mpv_set_option_string(m_mpv, "hwdec", "no");
+        mpv_set_option_string(m_mpv, "pause", "yes");
+        mpv_set_option_string(m_mpv, "keep-open", "always");
+        mpv_set_option_string(m_mpv, "hr-seek", "no");
+        mpv_set_option_string(m_mpv, "vd-lavc-fast", "yes");
+        mpv_set_option_string(m_mpv, "vd-lavc-skiploopfilter", "all");
+        mpv_set_option_string(m_mpv, "vd-lavc-threads", "1");
+        mpv_set_option_string(m_mpv, "sws-scaler", "fast-bilinear");
+        mpv_set_option_string(m_mpv, "demuxer-readahead-secs", "0");
+        mpv_set_option_string(m_mpv, "ytdl", "no");
+        mpv_set_option_string(m_mpv, "input-default-bindings", "no");
+
+        for (auto it = options.constBegin(); it != options.constEnd(); ++it)
+        {
+            mpv_set_option_string(m_mpv, it.key().toUtf8().constData(), it.value().toUtf8().constData());
+        }
+
+        int result = mpv_initialize(m_mpv);
+        if (result < 0)
+        {
+            qWarning() << "Failed to initialize MPV for thumbnails:" << mpv_error_string(result);
+            close();
+            return false;
+        }
+
+        mpv_render_param params[] = {
+            {MPV_RENDER_PARAM_API_TYPE, const_cast<char *>(MPV_RENDER_API_TYPE_SW)},
+            {MPV_RENDER_PARAM_INVALID, nullptr}};
+
+        result = mpv_render_context_create(&m_render, m_mpv, params);
+        if (result < 0)
+        {
+            qWarning() << "Failed to create thumbnail render context:" << mpv_error_string(result);
+            m_render = nullptr;
+            close();
+            return false;
+        }
+
+        const QByteArray url = media.toUtf8();
+        const char *args[] = {"loadfile", url.constData(), nullptr};
+        if (mpv_command(m_mpv, args) < 0)
+        {
+            close();
+            return false;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        while (timer.elapsed() < LOAD_TIMEOUT_MS)
+        {
+            mpv_event *event = mpv_wait_event(m_mpv, 0.1);
+            if (event->event_id == MPV_EVENT_FILE_LOADED)
+            {
+                m_media = media;
+                return true;
+            }
+            if (event->event_id == MPV_EVENT_END_FILE || event->event_id == MPV_EVENT_SHUTDOWN)
+            {
+                break;
+            }
+        }
+
+        qWarning() << "Could not open" << media << "for thumbnails";
+        close();
+        return false;
+    }
+
+    /**
+     * @brief Destroy the mpv instance
+     */
+    void close()
+    {
+        if (m_render)
+        {
+            mpv_render_context_free(m_render);
+            m_render = nullptr;
+        }
+
+        if (m_mpv)
+        {
+            mpv_terminate_destroy(m_mpv);
+            m_mpv = nullptr;
+        }
+
+        m_media.clear();
+    }
+
+    mpv_handle *m_mpv = nullptr;
+    mpv_render_context *m_render = nullptr;
+    QString m_media;
+};
+
+ThumbnailGenerator::ThumbnailGenerator(QObject *parent)
+    : QObject(parent), m_worker(new Worker()), m_generation(0), m_cursorBucket(0), m_busy(false)
+{
+    m_cache.setMaxCost(DEFAULT_CACHE_BUDGET);
+
+    m_thread.setObjectName("ThumbnailGenerator");
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    m_thread.start(QThread::LowPriority);
+}
+
+ThumbnailGenerator::~ThumbnailGenerator()
+{
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void ThumbnailGenerator::setOption(const QString &name, const QString &value)
+{
+    m_options.insert(name, value);
+}
+
+void ThumbnailGenerator::setMedia(const QString &url)
+{
+    if (url == m_media)
+    {
+        return;
+    }
+
+    // Renders still under way for the old media are discarded on arrival
+    m_media = url;
+    ++m_generation;
+    m_queue.clear();
+}
+
+QString ThumbnailGenerator::media() const
+{
+    return m_media;
+}
+
+void ThumbnailGenerator::setCacheBudget(qint64 bytes)
+{
+    m_cache.setMaxCost(bytes);
+}
+
+double ThumbnailGenerator::bucketStart(double time) const
+{
+    return static_cast<int>(qMax(0.0, time) / BUCKET_SECS) * BUCKET_SECS;
+}
+
+QImage ThumbnailGenerator::thumbnail(double time) const
+{
+    const QImage *image = m_cache.object(cacheKey(static_cast<int>(qMax(0.0, time) / BUCKET_SECS)));
+    return image ? *image : QImage();
+}
+
+void ThumbnailGenerator::request(double time)
+{
+    if (m_media.isEmpty())
+    {
+        return;
+    }
+
+    const int bucket = static_cast<int>(qMax(0.0, time) / BUCKET_SECS);
+    m_cursorBucket = bucket;
+
+    // Requests the cursor has moved far away from are no longer wanted
+    m_queue.removeIf([bucket](int queued)
+                     { return std::abs(queued - bucket) > STALE_BUCKETS; });
+
+    if (!m_cache.contains(cacheKey(bucket)) && !m_queue.contains(bucket))
+    {
+        m_queue.append(bucket);
+    }
+
+    dispatch();
+}
+
+void ThumbnailGenerator::cancel()
+{
+    m_queue.clear();
+}
+
+void ThumbnailGenerator::dispatch()
+{
+    if (m_busy || m_queue.isEmpty())
+    {
+        return;
+    }
+
+    int nearest = 0;
+    for (int i = 1; i < m_queue.size(); ++i)
+    {
+        if (std::abs(m_queue[i] - m_cursorBucket) < std::abs(m_queue[nearest] - m_cursorBucket))
+        {
+            nearest = i;
+        }
+    }
+
+    const int bucket = m_queue.takeAt(nearest);
+    const quint64 generation = m_generation;
+    const QString media = m_media;
+    const QHash<QString, QString> options = m_options;
+    Worker *worker = m_worker;
+
+    // Rendered on the worker thread, delivered back on this one
+    auto render = [this, worker, media, options, generation, bucket]()
+    {
+        QImage image = worker->render(media, options, bucket * BUCKET_SECS);
+        QMetaObject::invokeMethod(this, [this, generation, bucket, image]()
+                                  { onRendered(generation, bucket, image); }, Qt::QueuedConnection);
+    };
+
+    m_busy = true;
+    QMetaObject::invokeMethod(m_worker, render, Qt::QueuedConnection);
+}
+
+void ThumbnailGenerator::onRendered(quint64 generation, int bucket, const QImage &image)
+{
+    m_busy = false;
+
+    if (generation == m_generation && !image.isNull())
+    {
+        m_cache.insert(cacheKey(bucket), new QImage(image), image.sizeInBytes());
+        emit thumbnailReady(bucket * BUCKET_SECS, image);
+    }
+
+    dispatch();
+}
+
+QString ThumbnailGenerator::cacheKey(int bucket) const
+{
+    return m_media + QLatin1Char('#') + QString::number(bucket);
+}
\ No newline at end of file
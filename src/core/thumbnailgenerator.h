@@ -0,0 +1,131 @@
+#ifndef THUMBNAILGENERATOR_H
+#define THUMBNAILGENERATOR_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QList>
+#include <QImage>
+#include <QCache>
+#include <QThread>
+
+/**
+ * @brief The ThumbnailGenerator class renders seek bar previews of the current media
+ *
+ * Thumbnails come from a second, audio-less mpv instance on a worker
+ * thread that seeks to the keyframe nearest each request and renders one
+ * small frame through the software render API; the playback instance is
+ * never touched. Thumbnails are cached per media and time bucket in an
+ * LRU with a byte budget. Only one request is rendered at a time; the
+ * queued ones are taken closest to the cursor first, and those that have
+ * fallen too far behind the cursor are dropped.
+ */
+class ThumbnailGenerator : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor
+     * @param parent Parent object
+     */
+    explicit ThumbnailGenerator(QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor, stops the worker thread
+     */
+    ~ThumbnailGenerator();
+
+    /**
+     * @brief Set an mpv option for the thumbnail instance
+     * @param name Option name
+     * @param value Option value
+     */
+    void setOption(const QString &name, const QString &value);
+
+    /**
+     * @brief Set the media to preview
+     * @param url File path or URL, empty to disable previews
+     */
+    void setMedia(const QString &url);
+
+    /**
+     * @brief Get the media being previewed
+     * @return File path or URL, empty if previews are disabled
+     */
+    QString media() const;
+
+    /**
+     * @brief Set the memory budget of the thumbnail cache
+     * @param bytes Budget in bytes
+     */
+    void setCacheBudget(qint64 bytes);
+
+    /**
+     * @brief Get the start of the time bucket a position falls in
+     * @param time Position in seconds
+     * @return Bucket start in seconds
+     */
+    double bucketStart(double time) const;
+
+    /**
+     * @brief Get a cached thumbnail
+     * @param time Position in seconds
+     * @return Thumbnail of the position's bucket, null if not cached
+     */
+    QImage thumbnail(double time) const;
+
+    /**
+     * @brief Request a thumbnail and move the cursor to its position
+     * @param time Position in seconds
+     */
+    void request(double time);
+
+    /**
+     * @brief Drop all queued requests
+     */
+    void cancel();
+
+signals:
+    /**
+     * @brief Signal emitted when a thumbnail has been rendered
+     * @param time Bucket start in seconds
+     * @param image Thumbnail
+     */
+    void thumbnailReady(double time, const QImage &image);
+
+private:
+    class Worker;
+
+    /**
+     * @brief Send the queued request closest to the cursor to the worker
+     */
+    void dispatch();
+
+    /**
+     * @brief Store a thumbnail rendered by the worker
+     * @param generation Media generation of the request
+     * @param bucket Time bucket
+     * @param image Thumbnail, null on failure
+     */
+    void onRendered(quint64 generation, int bucket, const QImage &image);
+
+    /**
+     * @brief Get the cache key of a bucket of the current media
+     * @param bucket Time bucket
+     * @return Cache key
+     */
+    QString cacheKey(int bucket) const;
+
+    QThread m_thread;
+    Worker *m_worker;
+    QHash<QString, QString> m_options;
+    QString m_media;
+    quint64 m_generation;
+    QCache<QString, QImage> m_cache;
+    QList<int> m_queue;
+    int m_cursorBucket;
+    bool m_busy;
+};
+
+#endif // THUMBNAILGENERATOR_H
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include "timeshiftcontroller.h"
+#include <QDebug>
+#include <QDir>
+
+static const int DEFAULT_WINDOW_SECS = 60 * 60;
+static const qint64 DEFAULT_MEMORY_BUDGET = 512LL * 1024 * 1024;
+static const double DEFAULT_BITRATE = 8e6;
+static const double LIVE_MARGIN_SECS = 1.0;
+
+TimeshiftController::TimeshiftController(MPVCore *mpvCore, QObject *parent)
+    : QObject(parent), m_mpvCore(mpvCore), m_memoryBudget(DEFAULT_MEMORY_BUDGET), m_bitrate(DEFAULT_BITRATE), m_videoBitrate(0.0), m_audioBitrate(0.0), m_windowStart(0.0), m_liveEdge(0.0), m_position(0.0), m_windowSecs(DEFAULT_WINDOW_SECS), m_onDisk(false), m_active(false)
+{
+    connect(m_mpvCore, &MPVCore::propertyChanged, this, &TimeshiftController::onPropertyChanged);
+
+    m_mpvCore->observeProperty("demuxer-cache-state");
+    m_mpvCore->observeProperty("video-bitrate");
+    m_mpvCore->observeProperty("audio-bitrate");
+}
+
+void TimeshiftController::setWindow(int minutes)
+{
+    m_windowSecs = qMax(1, minutes) * 60;
+    if (m_active)
+    {
+        applyLimits();
+    }
+}
+
+void TimeshiftController::setMemoryBudget(qint64 bytes)
+{
+    m_memoryBudget = bytes;
+    if (m_active)
+    {
+        applyLimits();
+    }
+}
+
+void TimeshiftController::setCacheDirectory(const QString &directory)
+{
+    m_cacheDirectory = directory;
+}
+
+QVariantMap TimeshiftController::prepare()
+{
+    // Both buffers can each hold a full window, e.g. after a long pause at the live edge
+    m_onDisk = 2 * windowBytes() > m_memoryBudget && !m_cacheDirectory.isEmpty() && QDir().mkpath(m_cacheDirectory);
+
+    QVariantMap options;
+    options.insert("demuxer-seekable-cache", "yes");
+    options.insert("force-seekable", "yes");
+    options.insert("cache-on-disk", m_onDisk ? "yes" : "no");
+    if (m_onDisk)
+    {
+        options.insert("cache-dir", m_cacheDirectory);
+    }
+    return options;
+}
+
+void TimeshiftController::start()
+{
+    // Whatever limits were in place before are restored when timeshifting stops
+    if (!m_active)
+    {
+        m_savedLimits.clear();
+        for (const QString &name : {QStringLiteral("demuxer-readahead-secs"), QStringLiteral("demuxer-max-bytes"), QStringLiteral("demuxer-max-back-bytes")})
+        {
+            m_savedLimits.insert(name, m_mpvCore->getProperty(name));
+        }
+    }
+
+    m_windowStart = 0.0;
+    m_liveEdge = 0.0;
+    m_active = true;
+
+    applyLimits();
+    emit activeChanged(true);
+}
+
+void TimeshiftController::stop()
+{
+    if (!m_active)
+    {
+        return;
+    }
+
+    m_active = false;
+    for (auto it = m_savedLimits.constBegin(); it != m_savedLimits.constEnd(); ++it)
+    {
+        if (it.value().isValid())
+        {
+            m_mpvCore->setProperty(it.key(), it.value());
+        }
+    }
+    emit activeChanged(false);
+}
+
+bool TimeshiftController::isActive() const
+{
+    return m_active;
+}
+
+double TimeshiftController::windowStart() const
+{
+    return m_windowStart;
+}
+
+double TimeshiftController::liveEdge() const
+{
+    return m_liveEdge;
+}
+
+double TimeshiftController::delay() const
+{
+    return qMax(0.0, m_liveEdge - m_position);
+}
+
+void TimeshiftController::seekTo(double position)
+{
+    if (!m_active)
+    {
+        return;
+    }
+
+    m_mpvCore->seek(qBound(m_windowStart, position, qMax(m_windowStart, m_liveEdge - LIVE_MARGIN_SECS)));
+}
+
+void TimeshiftController::jumpToLive()
+{
+    if (!m_active)
+    {
+        return;
+    }
+
+    m_mpvCore->seek(qMax(m_windowStart, m_liveEdge - LIVE_MARGIN_SECS));
+    m_mpvCore->play();
+}
+
+void TimeshiftController::onPropertyChanged(const QString &name, const QVariant &value)
+{
+    if (name == "time-pos")
+    {
+        m_position = value.toDouble();
+    }
+    else if (name == "video-bitrate" || name == "audio-bitrate")
+    {
+        if (name == "video-bitrate")
+        {
+            m_videoBitrate = value.toDouble();
+        }
+        else
+        {
+            m_audioBitrate = value.toDouble();
+        }
+
+        // Remembered across channels as the estimate for the next prepare()
+        double bitrate = m_videoBitrate + m_audioBitrate;
+        if (bitrate > 0 && qAbs(bitrate - m_bitrate) > m_bitrate / 4)
+        {
+            m_bitrate = bitrate;
+            if (m_active)
+            {
+                applyLimits();
+            }
+        }
+    }
+    else if (name == "demuxer-cache-state" && m_active)
+    {
+        // The window is the seekable range that contains the playback position
+        const QVariantList ranges = value.toMap().value("seekable-ranges").toList();
+        double start = m_windowStart;
+        double end = m_liveEdge;
+        for (const QVariant &range : ranges)
+        {
+            const QVariantMap bounds = range.toMap();
+            double rangeStart = bounds.value("start").toDouble();
+            double rangeEnd = bounds.value("end").toDouble();
+            if (m_position >= rangeStart && m_position <= rangeEnd + LIVE_MARGIN_SECS)
+            {
+                start = rangeStart;
+                end = rangeEnd;
+                break;
+            }
+            end = qMax(end, rangeEnd);
+        }
+
+        if (start != m_windowStart || end != m_liveEdge)
+        {
+            m_windowStart = start;
+            m_liveEdge = end;
+            emit windowChanged(m_windowStart, m_liveEdge);
+        }
+    }
+}
+
+void TimeshiftController::applyLimits()
+{
+    qint64 bytes = windowBytes();
+    if (!m_onDisk)
+    {
+        bytes = qMin(bytes, m_memoryBudget / 2);
+    }
+
+    // Keep reading while paused, up to a full window ahead of the playback position
+    m_mpvCore->setProperty("demuxer-readahead-secs", m_windowSecs);
+    m_mpvCore->setProperty("demuxer-max-bytes", QVariant::fromValue<qlonglong>(bytes));
+    m_mpvCore->setProperty("demuxer-max-back-bytes", QVariant::fromValue<qlonglong>(bytes));
+
+    qDebug() << "Timeshift:" << m_windowSecs / 60 << "min window," << bytes / (1024 * 1024) << "MiB per buffer"
+             << (m_onDisk ? "on disk" : "in memory") << "at" << qRound(m_bitrate / 1000) << "kbit/s";
+}
+
+qint64 TimeshiftController::windowBytes() const
+{
+    // A little slack for container overhead and bitrate peaks
+    return static_cast<qint64>(m_bitrate / 8 * m_windowSecs * 1.1);
+}
\ No newline at end of file
@@ -0,0 +1,158 @@
+#ifndef TIMESHIFTCONTROLLER_H
+#define TIMESHIFTCONTROLLER_H
+
+#include <QObject>
+#include <QString>
+#include <QVariant>
+#include <QVariantMap>
+#include "mpvcore.h"
+
+/**
+ * @brief The TimeshiftController class keeps a rolling window of a live stream for pause and rewind
+ *
+ * The window is mpv's demuxer cache made seekable: everything received
+ * stays in the back buffer until the window's byte limit is reached, and
+ * the forward buffer keeps filling while playback is paused, so pausing
+ * live TV no longer drops what is broadcast meanwhile. The byte limits are
+ * derived from the window length and the stream bitrate. When the window
+ * does not fit the memory budget, the cache is backed by a file in the
+ * cache directory instead; either way forward and back buffers are each
+ * bounded by the window size, so usage stays flat over long sessions.
+ */
+class TimeshiftController : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor
+     * @param mpvCore MPV core instance
+     * @param parent Parent object
+     */
+    explicit TimeshiftController(MPVCore *mpvCore, QObject *parent = nullptr);
+
+    /**
+     * @brief Set the length of the rolling window
+     * @param minutes Window length in minutes
+     */
+    void setWindow(int minutes);
+
+    /**
+     * @brief Set the memory available before the window spills to disk
+     * @param bytes Maximum bytes kept in memory
+     */
+    void setMemoryBudget(qint64 bytes);
+
+    /**
+     * @brief Set the directory for the on-disk window
+     * @param directory Cache directory
+     */
+    void setCacheDirectory(const QString &directory);
+
+    /**
+     * @brief Get the cache options to open a network stream with
+     *
+     * Whether the window lives in memory or on disk can only be chosen
+     * before the stream is opened, so this uses the last measured bitrate.
+     * The options are meant for loadfile, so mpv drops them again when the
+     * file ends instead of leaving the next stream seekable and on disk.
+     *
+     * @return Per-file options
+     */
+    QVariantMap prepare();
+
+    /**
+     * @brief Start timeshifting the stream that was just opened
+     */
+    void start();
+
+    /**
+     * @brief Stop timeshifting
+     */
+    void stop();
+
+    /**
+     * @brief Check whether a live stream is being timeshifted
+     * @return True if active
+     */
+    bool isActive() const;
+
+    /**
+     * @brief Get the oldest position still in the window
+     * @return Position in seconds
+     */
+    double windowStart() const;
+
+    /**
+     * @brief Get the newest position received
+     * @return Position in seconds
+     */
+    double liveEdge() const;
+
+    /**
+     * @brief Get how far playback is behind the live edge
+     * @return Delay in seconds
+     */
+    double delay() const;
+
+    /**
+     * @brief Seek within the window
+     * @param position Position in seconds, clamped to the window
+     */
+    void seekTo(double position);
+
+    /**
+     * @brief Return to the live edge
+     */
+    void jumpToLive();
+
+signals:
+    /**
+     * @brief Signal emitted when timeshifting starts or stops
+     * @param active True if active
+     */
+    void activeChanged(bool active);
+
+    /**
+     * @brief Signal emitted when the seekable window moves
+     * @param start Oldest position in seconds
+     * @param liveEdge Newest position in seconds
+     */
+    void windowChanged(double start, double liveEdge);
+
+private slots:
+    /**
+     * @brief Track the cache state and bitrate
+     * @param name Property name
+     * @param value Property value
+     */
+    void onPropertyChanged(const QString &name, const QVariant &value);
+
+private:
+    /**
+     * @brief Set the byte limits for the window at the current bitrate
+     */
+    void applyLimits();
+
+    /**
+     * @brief Get the bytes needed for the window at the current bitrate
+     * @return Window size in bytes
+     */
+    qint64 windowBytes() const;
+
+    MPVCore *m_mpvCore;
+    QString m_cacheDirectory;
+    QVariantMap m_savedLimits;
+    qint64 m_memoryBudget;
+    double m_bitrate;
+    double m_videoBitrate;
+    double m_audioBitrate;
+    double m_windowStart;
+    double m_liveEdge;
+    double m_position;
+    int m_windowSecs;
+    bool m_onDisk;
+    bool m_active;
+};
+
+#endif // TIMESHIFTCONTROLLER_H
\ No newline at end of file
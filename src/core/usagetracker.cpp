@@ -0,0 +1,299 @@
+#include "usagetracker.h"
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <algorithm>
+
+static const quint32 USAGE_MAGIC = 0x48545655; // "HTVU"
+static const quint16 USAGE_VERSION = 1;
+static const int MAX_RECENT = 64;
+static const int MAX_TRANSITIONS = 16;
+// Recently watched channels that count towards a prediction
+static const int RECENT_DEPTH = 16;
+static const int SAVE_DELAY_MS = 5000;
+
+UsageTracker::UsageTracker(QObject *parent)
+    : QObject(parent), m_maxTuneCount(0)
+{
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(SAVE_DELAY_MS);
+    connect(&m_saveTimer, &QTimer::timeout, this, &UsageTracker::save);
+}
+
+UsageTracker::~UsageTracker()
+{
+    if (m_saveTimer.isActive())
+    {
+        save();
+    }
+}
+
+bool UsageTracker::load(const QString &filePath)
+{
+    m_filePath = filePath;
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    in >> magic >> version;
+    if (magic != USAGE_MAGIC || version != USAGE_VERSION)
+    {
+        qWarning() << "Ignoring usage file with unknown format:" << filePath;
+        return false;
+    }
+
+    QStringList favourites;
+    QStringList recent;
+    QHash<QString, quint32> tuneCounts;
+    QHash<QString, QHash<QString, quint32>> transitions;
+    QString lastKey;
+    in >> favourites >> recent >> tuneCounts >> transitions >> lastKey;
+
+    if (in.status() != QDataStream::Ok)
+    {
+        qWarning() << "Ignoring truncated usage file:" << filePath;
+        return false;
+    }
+
+    m_favourites = QSet<QString>(favourites.constBegin(), favourites.constEnd());
+    m_tuneCounts = tuneCounts;
+    m_transitions = transitions;
+    m_lastKey = lastKey;
+
+    m_recent.clear();
+    m_recentIndex.clear();
+    for (const QString &key : recent)
+    {
+        m_recentIndex.insert(key, m_recent.insert(m_recent.end(), key));
+    }
+
+    m_maxTuneCount = 0;
+    for (quint32 count : std::as_const(m_tuneCounts))
+    {
+        m_maxTuneCount = qMax(m_maxTuneCount, count);
+    }
+
+    return true;
+}
+
+bool UsageTracker::save()
+{
+    m_saveTimer.stop();
+
+    if (m_filePath.isEmpty())
+    {
+        return false;
+    }
+
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Could not save usage data:" << m_filePath;
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+
+    QStringList favourites(m_favourites.constBegin(), m_favourites.constEnd());
+    QStringList recent(m_recent.begin(), m_recent.end());
+    out << USAGE_MAGIC << USAGE_VERSION << favourites << recent << m_tuneCounts << m_transitions << m_lastKey;
+
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+void UsageTracker::recordTune(const QString &key)
+{
+    if (key.isEmpty() || key == m_lastKey)
+    {
+        return;
+    }
+
+    quint32 &count = m_tuneCounts[key];
+    ++count;
+    m_maxTuneCount = qMax(m_maxTuneCount, count);
+
+    if (!m_lastKey.isEmpty())
+    {
+        QHash<QString, quint32> &next = m_transitions[m_lastKey];
+        ++next[key];
+
+        // Keep only the strongest transitions per channel so the table stays small
+        if (next.size() > MAX_TRANSITIONS)
+        {
+            auto weakest = next.begin();
+            for (auto it = next.begin(); it != next.end(); ++it)
+            {
+                if (it.key() != key && (weakest.key() == key || it.value() < weakest.value()))
+                {
+                    weakest = it;
+                }
+            }
+            next.erase(weakest);
+        }
+    }
+
+    touch(key);
+    m_lastKey = key;
+    scheduleSave();
+}
+
+bool UsageTracker::isFavourite(const QString &key) const
+{
+    return m_favourites.contains(key);
+}
+
+void UsageTracker::setFavourite(const QString &key, bool favourite)
+{
+    if (key.isEmpty() || favourite == m_favourites.contains(key))
+    {
+        return;
+    }
+
+    if (favourite)
+    {
+        m_favourites.insert(key);
+    }
+    else
+    {
+        m_favourites.remove(key);
+    }
+
+    scheduleSave();
+    emit favouritesChanged();
+}
+
+bool UsageTracker::toggleFavourite(const QString &key)
+{
+    setFavourite(key, !isFavourite(key));
+    return isFavourite(key);
+}
+
+QSet<QString> UsageTracker::favourites() const
+{
+    return m_favourites;
+}
+
+QStringList UsageTracker::recent(int limit) const
+{
+    QStringList keys;
+    for (auto it = m_recent.begin(); it != m_recent.end() && (limit < 0 || keys.size() < limit); ++it)
+    {
+        keys.append(*it);
+    }
+    return keys;
+}
+
+quint32 UsageTracker::tuneCount(const QString &key) const
+{
+    return m_tuneCounts.value(key);
+}
+
+QStringList UsageTracker::likelyNext(const QString &currentKey, int limit) const
+{
+    QHash<QString, double> scores;
+
+    // Habitual zaps from this channel are the strongest signal
+    const QHash<QString, quint32> transitions = m_transitions.value(currentKey);
+    quint32 total = 0;
+    for (quint32 count : transitions)
+    {
+        total += count;
+    }
+    for (auto it = transitions.constBegin(); it != transitions.constEnd(); ++it)
+    {
+        scores[it.key()] += 4.0 * it.value() / total;
+    }
+
+    // Then going back to something watched recently
+    int rank = 0;
+    for (auto it = m_recent.begin(); it != m_recent.end() && rank < RECENT_DEPTH; ++it, ++rank)
+    {
+        scores[*it] += 2.0 / (rank + 1);
+    }
+
+    for (const QString &key : m_favourites)
+    {
+        scores[key] += 0.5;
+    }
+
+    scores.remove(currentKey);
+
+    QStringList keys = scores.keys();
+    for (const QString &key : std::as_const(keys))
+    {
+        if (m_maxTuneCount > 0)
+        {
+            scores[key] += static_cast<double>(m_tuneCounts.value(key)) / m_maxTuneCount;
+        }
+    }
+
+    int count = qMin(limit, static_cast<int>(keys.size()));
+    std::partial_sort(keys.begin(), keys.begin() + count, keys.end(), [&scores](const QString &a, const QString &b)
+                      { return scores.value(a) > scores.value(b); });
+
+    return keys.mid(0, count);
+}
+
+double UsageTracker::replayHitRate(const QStringList &zapLog, int limit)
+{
+    UsageTracker tracker;
+    int hits = 0;
+    int predictions = 0;
+
+    for (const QString &key : zapLog)
+    {
+        if (key == tracker.m_lastKey)
+        {
+            continue;
+        }
+
+        if (!tracker.m_lastKey.isEmpty())
+        {
+            ++predictions;
+            if (tracker.likelyNext(tracker.m_lastKey, limit).contains(key))
+            {
+                ++hits;
+            }
+        }
+
+        tracker.recordTune(key);
+    }
+
+    return predictions > 0 ? static_cast<double>(hits) / predictions : 0.0;
+}
+
+void UsageTracker::touch(const QString &key)
+{
+    auto it = m_recentIndex.find(key);
+    if (it != m_recentIndex.end())
+    {
+        m_recent.splice(m_recent.begin(), m_recent, it.value());
+        return;
+    }
+
+    m_recentIndex.insert(key, m_recent.insert(m_recent.begin(), key));
+
+    if (static_cast<int>(m_recent.size()) > MAX_RECENT)
+    {
+        m_recentIndex.remove(m_recent.back());
+        m_recent.pop_back();
+    }
+}
+
+void UsageTracker::scheduleSave()
+{
+    if (!m_filePath.isEmpty())
+    {
+        m_saveTimer.start();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+#ifndef USAGETRACKER_H
+#define USAGETRACKER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QSet>
+#include <QHash>
+#include <QTimer>
+#include <list>
+
+/**
+ * @brief The UsageTracker class records which channels are watched
+ *
+ * Channels are identified by their ChannelManager::channelKey, so usage
+ * survives reordering and URL rotation. The tracker keeps favourites, a
+ * most-recently-used list with O(1) updates, per-channel tune counts and
+ * counts of channel-to-channel transitions, and ranks likely next channels
+ * from them. The data is written compactly with QDataStream, a few seconds
+ * after the last change.
+ */
+class UsageTracker : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor
+     * @param parent Parent object
+     */
+    explicit UsageTracker(QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor
+     */
+    ~UsageTracker();
+
+    /**
+     * @brief Load usage data and persist future changes to a file
+     * @param filePath Path to the usage file
+     * @return True if the file was loaded, false if it is missing or invalid
+     */
+    bool load(const QString &filePath);
+
+    /**
+     * @brief Save usage data to the file it was loaded from
+     * @return True if successful, false otherwise
+     */
+    bool save();
+
+    /**
+     * @brief Record that a channel was tuned to
+     * @param key Channel key
+     */
+    void recordTune(const QString &key);
+
+    /**
+     * @brief Check whether a channel is a favourite
+     * @param key Channel key
+     * @return True if the channel is a favourite
+     */
+    bool isFavourite(const QString &key) const;
+
+    /**
+     * @brief Add or remove a favourite
+     * @param key Channel key
+     * @param favourite True to add, false to remove
+     */
+    void setFavourite(const QString &key, bool favourite);
+
+    /**
+     * @brief Toggle a favourite
+     * @param key Channel key
+     * @return True if the channel is now a favourite
+     */
+    bool toggleFavourite(const QString &key);
+
+    /**
+     * @brief Get all favourites
+     * @return Set of channel keys
+     */
+    QSet<QString> favourites() const;
+
+    /**
+     * @brief Get recently watched channels
+     * @param limit Maximum number of channels, -1 for all
+     * @return Channel keys, most recent first
+     */
+    QStringList recent(int limit = -1) const;
+
+    /**
+     * @brief Get how often a channel was tuned to
+     * @param key Channel key
+     * @return Tune count
+     */
+    quint32 tuneCount(const QString &key) const;
+
+    /**
+     * @brief Rank the channels most likely to be tuned to next
+     * @param currentKey Key of the channel being watched
+     * @param limit Maximum number of channels
+     * @return Channel keys, most likely first, never including the current one
+     */
+    QStringList likelyNext(const QString &currentKey, int limit) const;
+
+    /**
+     * @brief Replay a zap log and measure how well likelyNext predicts it
+     *
+     * Each tune is predicted from the tunes before it, starting with no
+     * usage history.
+     *
+     * @param zapLog Channel keys in the order they were tuned to
+     * @param limit Number of predictions counted as a hit
+     * @return Fraction of tunes that were among the predictions
+     */
+    static double replayHitRate(const QStringList &zapLog, int limit);
+
+signals:
+    /**
+     * @brief Signal emitted when a favourite is added or removed
+     */
+    void favouritesChanged();
+
+private:
+    /**
+     * @brief Move a channel to the front of the recent list
+     * @param key Channel key
+     */
+    void touch(const QString &key);
+
+    /**
+     * @brief Schedule a deferred save
+     */
+    void scheduleSave();
+
+    QString m_filePath;
+    QSet<QString> m_favourites;
+    std::list<QString> m_recent;
+    QHash<QString, std::list<QString>::iterator> m_recentIndex;
+    QHash<QString, quint32> m_tuneCounts;
+    QHash<QString, QHash<QString, quint32>> m_transitions;
+    QString m_lastKey;
+    quint32 m_maxTuneCount;
+    QTimer m_saveTimer;
+};
+
+#endif // USAGETRACKER_H
\ No newline at end of file
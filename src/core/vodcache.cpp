@@ -0,0 +1,412 @@
+#include "vodcache.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <iterator>
+
+static const quint32 INDEX_MAGIC = 0x48545643; // "HTVC"
+static const quint16 INDEX_VERSION = 2;
+static const qint64 DEFAULT_QUOTA = 2048LL * 1024 * 1024;
+static const int SAVE_DELAY_MS = 2000;
+
+// Bounds what a gap costs on filesystems that allocate files up to their last byte
+static const qint64 CHUNK_BYTES = 4LL * 1024 * 1024;
+
+VodCache::VodCache(QObject *parent)
+    : QObject(parent), m_quota(DEFAULT_QUOTA), m_usedBytes(0), m_bytesFromCache(0), m_bytesFromNetwork(0)
+{
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(SAVE_DELAY_MS);
+    connect(&m_saveTimer, &QTimer::timeout, this, &VodCache::saveIndex);
+}
+
+VodCache::~VodCache()
+{
+    if (m_saveTimer.isActive())
+    {
+        saveIndex();
+    }
+}
+
+bool VodCache::open(const QString &directory)
+{
+    m_directory = directory;
+    m_entries.clear();
+    m_usedBytes = 0;
+
+    if (!QDir().mkpath(directory))
+    {
+        qWarning() << "Could not create VOD cache directory:" << directory;
+        return false;
+    }
+
+    QFile file(directory + "/index.dat");
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return true;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 count = 0;
+    in >> magic >> version >> count;
+    if (magic != INDEX_MAGIC || version != INDEX_VERSION)
+    {
+        // Version 1 kept one sparse file per title; those are useless now
+        qWarning() << "Ignoring VOD cache index with unknown format";
+        QDir cacheDir(directory);
+        for (const QString &name : cacheDir.entryList({"*.data"}, QDir::Files))
+        {
+            cacheDir.remove(name);
+        }
+        return true;
+    }
+
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i)
+    {
+        QString url;
+        Entry entry;
+        in >> url >> entry.id >> entry.totalSize >> entry.contentType >> entry.ranges >> entry.lastAccess;
+
+        // Data deleted behind our back invalidates its ranges
+        if (in.status() != QDataStream::Ok || !QFileInfo(dataPath(entry)).isDir())
+        {
+            continue;
+        }
+
+        for (auto it = entry.ranges.constBegin(); it != entry.ranges.constEnd(); ++it)
+        {
+            allocate(entry, it.key(), it.value());
+        }
+        m_entries.insert(url, entry);
+    }
+
+    makeRoom(0, QString());
+    return true;
+}
+
+void VodCache::setQuota(qint64 bytes)
+{
+    m_quota = bytes;
+    makeRoom(0, QString());
+}
+
+void VodCache::setResourceInfo(const QString &url, qint64 totalSize, const QByteArray &contentType)
+{
+    Entry &entry = m_entries[url];
+    if (entry.id.isEmpty())
+    {
+        entry.id = QString::fromLatin1(QCryptographicHash::hash(url.toUtf8(), QCryptographicHash::Sha1).toHex());
+    }
+
+    // A different size means the resource changed upstream; the old bytes are useless
+    if (entry.totalSize >= 0 && entry.totalSize != totalSize)
+    {
+        m_usedBytes -= entry.storedBytes;
+        entry.ranges.clear();
+        entry.chunkSizes.clear();
+        entry.storedBytes = 0;
+        m_file.close();
+        QDir(dataPath(entry)).removeRecursively();
+    }
+
+    entry.totalSize = totalSize;
+    entry.contentType = contentType;
+    entry.lastAccess = QDateTime::currentMSecsSinceEpoch();
+    m_saveTimer.start();
+}
+
+bool VodCache::resourceInfo(const QString &url, qint64 *totalSize, QByteArray *contentType) const
+{
+    auto it = m_entries.constFind(url);
+    if (it == m_entries.constEnd() || it->totalSize < 0)
+    {
+        return false;
+    }
+
+    *totalSize = it->totalSize;
+    *contentType = it->contentType;
+    return true;
+}
+
+qint64 VodCache::cachedLength(const QString &url, qint64 offset) const
+{
+    auto entry = m_entries.constFind(url);
+    if (entry == m_entries.constEnd())
+    {
+        return 0;
+    }
+
+    // Ranges map start to end (exclusive) and never overlap
+    auto it = entry->ranges.upperBound(offset);
+    if (it == entry->ranges.constBegin())
+    {
+        return 0;
+    }
+    --it;
+
+    return offset < it.value() ? it.value() - offset : 0;
+}
+
+qint64 VodCache::nextCachedOffset(const QString &url, qint64 offset) const
+{
+    auto entry = m_entries.constFind(url);
+    if (entry == m_entries.constEnd())
+    {
+        return -1;
+    }
+
+    auto it = entry->ranges.upperBound(offset);
+    return it == entry->ranges.constEnd() ? -1 : it.key();
+}
+
+QByteArray VodCache::read(const QString &url, qint64 offset, qint64 length)
+{
+    qint64 available = qMin(length, cachedLength(url, offset));
+    if (available <= 0)
+    {
+        return QByteArray();
+    }
+
+    Entry &entry = m_entries[url];
+    QByteArray data;
+    data.reserve(available);
+    while (data.size() < available)
+    {
+        qint64 position = offset + data.size();
+        qint64 chunk = position / CHUNK_BYTES;
+        qint64 size = qMin<qint64>(available - data.size(), (chunk + 1) * CHUNK_BYTES - position);
+
+        QFile *file = chunkFile(entry, chunk, false);
+        QByteArray part = file && file->seek(position - chunk * CHUNK_BYTES) ? file->read(size) : QByteArray();
+        if (part.size() != size)
+        {
+            remove(url);
+            return QByteArray();
+        }
+        data += part;
+    }
+
+    entry.lastAccess = QDateTime::currentMSecsSinceEpoch();
+    m_bytesFromCache += data.size();
+    return data;
+}
+
+bool VodCache::write(const QString &url, qint64 offset, const QByteArray &data)
+{
+    m_bytesFromNetwork += data.size();
+
+    auto it = m_entries.find(url);
+    if (it == m_entries.end() || data.isEmpty() || m_directory.isEmpty())
+    {
+        return false;
+    }
+
+    if (!makeRoom(allocationGrowth(*it, offset, data.size()), url))
+    {
+        return false;
+    }
+
+    Entry &entry = m_entries[url];
+    for (qint64 written = 0; written < data.size();)
+    {
+        qint64 position = offset + written;
+        qint64 chunk = position / CHUNK_BYTES;
+        qint64 size = qMin<qint64>(data.size() - written, (chunk + 1) * CHUNK_BYTES - position);
+
+        QFile *file = chunkFile(entry, chunk, true);
+        if (!file || !file->seek(position - chunk * CHUNK_BYTES) ||
+            file->write(data.constData() + written, size) != size)
+        {
+            // The bytes are not indexed, but the files may have grown; count them as if they had
+            allocate(entry, offset, position + size);
+            return false;
+        }
+        written += size;
+    }
+    allocate(entry, offset, offset + data.size());
+
+    // Merge the new range with the ones it touches
+    qint64 start = offset;
+    qint64 end = offset + data.size();
+
+    auto range = entry.ranges.upperBound(start);
+    if (range != entry.ranges.begin())
+    {
+        auto previous = std::prev(range);
+        if (previous.value() >= start)
+        {
+            range = previous;
+        }
+    }
+
+    while (range != entry.ranges.end() && range.key() <= end)
+    {
+        start = qMin(start, range.key());
+        end = qMax(end, range.value());
+        range = entry.ranges.erase(range);
+    }
+
+    entry.ranges.insert(start, end);
+    entry.lastAccess = QDateTime::currentMSecsSinceEpoch();
+
+    m_saveTimer.start();
+    return true;
+}
+
+void VodCache::clear()
+{
+    const QStringList urls = m_entries.keys();
+    for (const QString &url : urls)
+    {
+        remove(url);
+    }
+
+    m_bytesFromCache = 0;
+    m_bytesFromNetwork = 0;
+    saveIndex();
+}
+
+VodCache::Stats VodCache::stats() const
+{
+    Stats stats;
+    stats.usedBytes = m_usedBytes;
+    stats.quotaBytes = m_quota;
+    stats.titles = m_entries.size();
+    stats.bytesFromCache = m_bytesFromCache;
+    stats.bytesFromNetwork = m_bytesFromNetwork;
+    return stats;
+}
+
+void VodCache::saveIndex()
+{
+    m_saveTimer.stop();
+
+    if (m_directory.isEmpty())
+    {
+        return;
+    }
+
+    QSaveFile file(m_directory + "/index.dat");
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Could not save VOD cache index:" << file.fileName();
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << INDEX_MAGIC << INDEX_VERSION << static_cast<quint32>(m_entries.size());
+
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+    {
+        out << it.key() << it->id << it->totalSize << it->contentType << it->ranges << it->lastAccess;
+    }
+
+    file.commit();
+}
+
+QString VodCache::dataPath(const Entry &entry) const
+{
+    return m_directory + "/" + entry.id;
+}
+
+QFile *VodCache::chunkFile(const Entry &entry, qint64 chunk, bool create)
+{
+    // Reads and writes mostly walk a title front to back, so the last chunk is usually the next one
+    QString path = dataPath(entry) + "/" + QString::number(chunk) + ".chunk";
+    if (m_file.isOpen() && m_file.fileName() == path)
+    {
+        return &m_file;
+    }
+
+    m_file.close();
+    if (!create && !QFile::exists(path))
+    {
+        return nullptr;
+    }
+    if (create && !QDir().mkpath(dataPath(entry)))
+    {
+        return nullptr;
+    }
+
+    m_file.setFileName(path);
+    return m_file.open(QIODevice::ReadWrite) ? &m_file : nullptr;
+}
+
+qint64 VodCache::allocationGrowth(const Entry &entry, qint64 offset, qint64 size)
+{
+    qint64 growth = 0;
+    qint64 end = offset + size;
+    for (qint64 chunk = offset / CHUNK_BYTES; chunk * CHUNK_BYTES < end; ++chunk)
+    {
+        qint64 chunkEnd = qMin(end, (chunk + 1) * CHUNK_BYTES) - chunk * CHUNK_BYTES;
+        growth += qMax<qint64>(0, chunkEnd - entry.chunkSizes.value(chunk));
+    }
+    return growth;
+}
+
+void VodCache::allocate(Entry &entry, qint64 start, qint64 end)
+{
+    for (qint64 chunk = start / CHUNK_BYTES; chunk * CHUNK_BYTES < end; ++chunk)
+    {
+        qint64 chunkEnd = qMin(end, (chunk + 1) * CHUNK_BYTES) - chunk * CHUNK_BYTES;
+        qint64 &size = entry.chunkSizes[chunk];
+        if (chunkEnd > size)
+        {
+            entry.storedBytes += chunkEnd - size;
+            m_usedBytes += chunkEnd - size;
+            size = chunkEnd;
+        }
+    }
+}
+
+bool VodCache::makeRoom(qint64 bytes, const QString &keepUrl)
+{
+    while (m_usedBytes + bytes > m_quota)
+    {
+        QString oldest;
+        qint64 oldestAccess = 0;
+        for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+        {
+            if (it.key() != keepUrl && it->storedBytes > 0 && (oldest.isEmpty() || it->lastAccess < oldestAccess))
+            {
+                oldest = it.key();
+                oldestAccess = it->lastAccess;
+            }
+        }
+
+        // Only the title being written is left; it cannot grow any further
+        if (oldest.isEmpty())
+        {
+            return false;
+        }
+
+        remove(oldest);
+    }
+
+    return true;
+}
+
+void VodCache::remove(const QString &url)
+{
+    auto it = m_entries.find(url);
+    if (it == m_entries.end())
+    {
+        return;
+    }
+
+    m_usedBytes -= it->storedBytes;
+    m_file.close();
+    QDir(dataPath(*it)).removeRecursively();
+    m_entries.erase(it);
+    m_saveTimer.start();
+}
\ No newline at end of file
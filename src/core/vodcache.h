@@ -0,0 +1,215 @@
+#ifndef VODCACHE_H
+#define VODCACHE_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QTimer>
+#include <QFile>
+
+/**
+ * @brief The VodCache class keeps byte ranges of VOD streams on disk
+ *
+ * Each URL is stored as a directory of fixed-size chunk files, with an index
+ * of the byte ranges already fetched, the total size and the content type.
+ * Ranges that are present are served from disk; only the gaps are fetched
+ * again. Filesystems without sparse files allocate a chunk up to its last
+ * byte written, so the quota counts those chunk sizes rather than the bytes
+ * fetched; a gap never costs more than one chunk. The cache evicts whole
+ * titles in least-recently-used order. The index is written to disk a few
+ * seconds after the last change.
+ */
+class VodCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Cache statistics
+     */
+    struct Stats
+    {
+        qint64 usedBytes = 0;
+        qint64 quotaBytes = 0;
+        int titles = 0;
+        qint64 bytesFromCache = 0;
+        qint64 bytesFromNetwork = 0;
+
+        /**
+         * @brief Get the fraction of bytes served from disk
+         * @return Hit ratio between 0 and 1
+         */
+        double hitRatio() const
+        {
+            qint64 total = bytesFromCache + bytesFromNetwork;
+            return total > 0 ? static_cast<double>(bytesFromCache) / total : 0.0;
+        }
+    };
+
+    /**
+     * @brief Constructor
+     * @param parent Parent object
+     */
+    explicit VodCache(QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor
+     */
+    ~VodCache();
+
+    /**
+     * @brief Open a cache directory and load its index
+     * @param directory Cache directory, created if missing
+     * @return True if successful, false otherwise
+     */
+    bool open(const QString &directory);
+
+    /**
+     * @brief Set the size quota, evicting titles if necessary
+     * @param bytes Maximum bytes stored on disk
+     */
+    void setQuota(qint64 bytes);
+
+    /**
+     * @brief Record the total size and content type of a URL
+     * @param url Stream URL
+     * @param totalSize Total size in bytes
+     * @param contentType Content type
+     */
+    void setResourceInfo(const QString &url, qint64 totalSize, const QByteArray &contentType);
+
+    /**
+     * @brief Get the total size and content type of a URL
+     * @param url Stream URL
+     * @param totalSize Filled with the total size in bytes
+     * @param contentType Filled with the content type
+     * @return True if the URL is known
+     */
+    bool resourceInfo(const QString &url, qint64 *totalSize, QByteArray *contentType) const;
+
+    /**
+     * @brief Get how many bytes are cached contiguously from an offset
+     * @param url Stream URL
+     * @param offset Byte offset
+     * @return Number of bytes available, 0 if the offset is not cached
+     */
+    qint64 cachedLength(const QString &url, qint64 offset) const;
+
+    /**
+     * @brief Get the start of the next cached range after an offset
+     * @param url Stream URL
+     * @param offset Byte offset
+     * @return Start of the next range, -1 if there is none
+     */
+    qint64 nextCachedOffset(const QString &url, qint64 offset) const;
+
+    /**
+     * @brief Read cached bytes
+     * @param url Stream URL
+     * @param offset Byte offset
+     * @param length Maximum number of bytes
+     * @return Data read, empty if the range is not cached
+     */
+    QByteArray read(const QString &url, qint64 offset, qint64 length);
+
+    /**
+     * @brief Store fetched bytes
+     * @param url Stream URL
+     * @param offset Byte offset of the data
+     * @param data Data fetched from the network
+     * @return True if the data was stored, false if it did not fit the quota
+     */
+    bool write(const QString &url, qint64 offset, const QByteArray &data);
+
+    /**
+     * @brief Remove all cached titles
+     */
+    void clear();
+
+    /**
+     * @brief Get cache statistics
+     * @return Current statistics
+     */
+    Stats stats() const;
+
+private slots:
+    /**
+     * @brief Write the index to disk
+     */
+    void saveIndex();
+
+private:
+    /**
+     * @brief Index entry of one cached URL
+     */
+    struct Entry
+    {
+        QString id;
+        qint64 totalSize = -1;
+        QByteArray contentType;
+        QMap<qint64, qint64> ranges;
+        QHash<qint64, qint64> chunkSizes;
+        qint64 storedBytes = 0;
+        qint64 lastAccess = 0;
+    };
+
+    /**
+     * @brief Get the directory holding the chunk files of an entry
+     * @param entry Index entry
+     * @return Path of the directory
+     */
+    QString dataPath(const Entry &entry) const;
+
+    /**
+     * @brief Open a chunk file, reusing the open handle when it is the same file
+     * @param entry Index entry
+     * @param chunk Chunk number
+     * @param create True to create the file if it is missing
+     * @return Open file, or nullptr on failure
+     */
+    QFile *chunkFile(const Entry &entry, qint64 chunk, bool create);
+
+    /**
+     * @brief Get how much more disk a write would allocate
+     * @param entry Index entry
+     * @param offset Byte offset of the data
+     * @param size Size of the data
+     * @return Bytes the chunk files would grow by
+     */
+    static qint64 allocationGrowth(const Entry &entry, qint64 offset, qint64 size);
+
+    /**
+     * @brief Grow the recorded chunk sizes of an entry to cover a range
+     * @param entry Index entry
+     * @param start Start of the range
+     * @param end End of the range (exclusive)
+     */
+    void allocate(Entry &entry, qint64 start, qint64 end);
+
+    /**
+     * @brief Evict least recently used titles until a size fits the quota
+     * @param bytes Bytes about to be added
+     * @param keepUrl URL that must not be evicted
+     * @return True if the bytes fit
+     */
+    bool makeRoom(qint64 bytes, const QString &keepUrl);
+
+    /**
+     * @brief Remove one title from the cache
+     * @param url Stream URL
+     */
+    void remove(const QString &url);
+
+    QString m_directory;
+    QHash<QString, Entry> m_entries;
+    qint64 m_quota;
+    qint64 m_usedBytes;
+    qint64 m_bytesFromCache;
+    qint64 m_bytesFromNetwork;
+    QTimer m_saveTimer;
+    QFile m_file;
+};
+
+#endif // VODCACHE_H
\ No newline at end of file
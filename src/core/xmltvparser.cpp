@@ -0,0 +1,187 @@
+#include "xmltvparser.h"
+#include <QFile>
+#include <QXmlStreamReader>
+
+// Days between 1970-01-01 and a proleptic Gregorian date
+static qint64 daysFromCivil(int year, int month, int day)
+{
+    year -= month <= 2 ? 1 : 0;
+    const int era = (year >= 0 ? year : year - 399) / 400;
+    const int yearOfEra = year - era * 400;
+    const int dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return static_cast<qint64>(era) * 146097 + dayOfEra - 719468;
+}
+
+// Read a fixed-width decimal field, returning -1 if it is missing or malformed
+static int readDigits(QStringView text, int pos, int count)
+{
+    if (pos + count > text.size())
+    {
+        return -1;
+    }
+
+    int value = 0;
+    for (int i = pos; i < pos + count; ++i)
+    {
+        const QChar c = text[i];
+        if (c < QLatin1Char('0') || c > QLatin1Char('9'))
+        {
+            return -1;
+        }
+        value = value * 10 + (c.unicode() - '0');
+    }
+
+    return value;
+}
+
+XMLTVParser::XMLTVParser()
+{
+}
+
+void XMLTVParser::setChannelFilter(const QSet<QString> &channelIds)
+{
+    m_channelFilter = channelIds;
+}
+
+int XMLTVParser::parseFile(const QString &filePath, const ProgrammeCallback &callback)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        throw QString("Could not open file: %1").arg(filePath);
+    }
+
+    return parse(&file, callback);
+}
+
+int XMLTVParser::parse(QIODevice *device, const ProgrammeCallback &callback)
+{
+    QXmlStreamReader reader(device);
+    int count = 0;
+
+    if (!reader.readNextStartElement() || reader.name() != QLatin1String("tv"))
+    {
+        throw QString("Not an XMLTV document");
+    }
+
+    while (reader.readNextStartElement())
+    {
+        if (reader.name() != QLatin1String("programme"))
+        {
+            reader.skipCurrentElement();
+            continue;
+        }
+
+        const QXmlStreamAttributes attributes = reader.attributes();
+        const QString channelId = attributes.value(QLatin1String("channel")).toString();
+        if (!m_channelFilter.isEmpty() && !m_channelFilter.contains(channelId))
+        {
+            reader.skipCurrentElement();
+            continue;
+        }
+
+        ProgrammeData programme;
+        programme.start = parseTime(attributes.value(QLatin1String("start")));
+        programme.stop = parseTime(attributes.value(QLatin1String("stop")));
+
+        while (reader.readNextStartElement())
+        {
+            if (reader.name() == QLatin1String("title") && programme.title.isEmpty())
+            {
+                programme.title = intern(reader.readElementText());
+            }
+            else if (reader.name() == QLatin1String("desc") && programme.description.isEmpty())
+            {
+                programme.description = intern(reader.readElementText());
+            }
+            else
+            {
+                reader.skipCurrentElement();
+            }
+        }
+
+        if (channelId.isEmpty() || programme.start < 0)
+        {
+            continue;
+        }
+
+        callback(intern(channelId), programme);
+        ++count;
+    }
+
+    // The interned strings stay shared through the programmes; only the lookup table goes
+    m_strings.clear();
+
+    if (reader.hasError())
+    {
+        throw QString("XMLTV parse error at line %1: %2").arg(reader.lineNumber()).arg(reader.errorString());
+    }
+
+    return count;
+}
+
+qint64 XMLTVParser::parseTime(QStringView text)
+{
+    text = text.trimmed();
+
+    const int year = readDigits(text, 0, 4);
+    const int month = readDigits(text, 4, 2);
+    const int day = readDigits(text, 6, 2);
+    if (year < 0 || month < 1 || month > 12 || day < 1 || day > 31)
+    {
+        return -1;
+    }
+
+    // Time of day fields are optional and default to zero
+    int pos = 8;
+    int fields[3] = {0, 0, 0};
+    for (int &field : fields)
+    {
+        const int value = readDigits(text, pos, 2);
+        if (value < 0)
+        {
+            break;
+        }
+        field = value;
+        pos += 2;
+    }
+
+    qint64 seconds = daysFromCivil(year, month, day) * 86400 + fields[0] * 3600 + fields[1] * 60 + fields[2];
+
+    // Optional UTC offset, e.g. " +0100"
+    while (pos < text.size() && text[pos] == QLatin1Char(' '))
+    {
+        ++pos;
+    }
+
+    if (pos < text.size() && (text[pos] == QLatin1Char('+') || text[pos] == QLatin1Char('-')))
+    {
+        const int hours = readDigits(text, pos + 1, 2);
+        const int minutes = readDigits(text, pos + 3, 2);
+        if (hours >= 0 && minutes >= 0)
+        {
+            const qint64 offset = hours * 3600 + minutes * 60;
+            seconds += text[pos] == QLatin1Char('+') ? -offset : offset;
+        }
+    }
+
+    return seconds;
+}
+
+QString XMLTVParser::intern(const QString &text)
+{
+    if (text.isEmpty())
+    {
+        return QString();
+    }
+
+    auto it = m_strings.constFind(text);
+    if (it != m_strings.constEnd())
+    {
+        return it.value();
+    }
+
+    m_strings.insert(text, text);
+    return text;
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#ifndef XMLTVPARSER_H
+#define XMLTVPARSER_H
+
+#include <QString>
+#include <QStringView>
+#include <QSet>
+#include <QHash>
+#include <QIODevice>
+#include <functional>
+#include "../data/programmedata.h"
+
+/**
+ * @brief The XMLTVParser class streams programme entries out of XMLTV guides
+ *
+ * The guide is read with QXmlStreamReader and every programme is handed to a
+ * callback as soon as its element is closed, so memory use does not depend
+ * on the size of the guide. Repeated titles and descriptions are interned so
+ * that the consumer shares their storage.
+ */
+class XMLTVParser
+{
+public:
+    /**
+     * @brief Callback receiving each parsed programme
+     */
+    using ProgrammeCallback = std::function<void(const QString &channelId, const ProgrammeData &programme)>;
+
+    /**
+     * @brief Constructor
+     */
+    XMLTVParser();
+
+    /**
+     * @brief Restrict parsing to a set of channel ids
+     * @param channelIds Channel ids to keep, empty to keep all channels
+     */
+    void setChannelFilter(const QSet<QString> &channelIds);
+
+    /**
+     * @brief Parse an XMLTV file
+     * @param filePath Path to the XMLTV file
+     * @param callback Callback receiving each programme
+     * @return Number of programmes passed to the callback
+     * @throws QString error message if parsing fails
+     */
+    int parseFile(const QString &filePath, const ProgrammeCallback &callback);
+
+    /**
+     * @brief Parse XMLTV data from a device
+     * @param device Open device to read from
+     * @param callback Callback receiving each programme
+     * @return Number of programmes passed to the callback
+     * @throws QString error message if parsing fails
+     */
+    int parse(QIODevice *device, const ProgrammeCallback &callback);
+
+    /**
+     * @brief Parse an XMLTV timestamp ("YYYYMMDDhhmmss +zzzz")
+     * @param text Timestamp text
+     * @return Seconds since the Unix epoch, or -1 if the timestamp is invalid
+     */
+    static qint64 parseTime(QStringView text);
+
+private:
+    /**
+     * @brief Return a shared copy of a string seen before
+     * @param text String to intern
+     * @return Interned string
+     */
+    QString intern(const QString &text);
+
+    QSet<QString> m_channelFilter;
+    QHash<QString, QString> m_strings;
+};
+
+#endif // XMLTVPARSER_H
\ No newline at end of file
@@ -31,11 +31,63 @@ void ChannelData::setUrl(const QString &url)
     m_url = url;
 }
 
+QString ChannelData::tvgId() const
+{
+    return m_tvgId;
+}
+
+void ChannelData::setTvgId(const QString &tvgId)
+{
+    m_tvgId = tvgId;
+}
+
+QString ChannelData::logoUrl() const
+{
+    return m_logoUrl;
+}
+
+void ChannelData::setLogoUrl(const QString &logoUrl)
+{
+    m_logoUrl = logoUrl;
+}
+
+QString ChannelData::source() const
+{
+    return m_source;
+}
+
+void ChannelData::setSource(const QString &source)
+{
+    m_source = source;
+}
+
+QString ChannelData::profile() const
+{
+    return m_profile;
+}
+
+void ChannelData::setProfile(const QString &profile)
+{
+    m_profile = profile;
+}
+
 QJsonObject ChannelData::toJson() const
 {
     QJsonObject json;
     json["name"] = m_name;
     json["url"] = m_url;
+    if (!m_tvgId.isEmpty())
+    {
+        json["tvg-id"] = m_tvgId;
+    }
+    if (!m_logoUrl.isEmpty())
+    {
+        json["tvg-logo"] = m_logoUrl;
+    }
+    if (!m_profile.isEmpty())
+    {
+        json["profile"] = m_profile;
+    }
     return json;
 }
 
@@ -43,5 +95,20 @@ ChannelData ChannelData::fromJson(const QJsonObject &json)
 {
     QString name = json["name"].toString();
     QString url = json["url"].toString();
-    return ChannelData(name, url);
+    ChannelData channel(name, url);
+    channel.setTvgId(json["tvg-id"].toString());
+    channel.setLogoUrl(json["tvg-logo"].toString());
+    channel.setProfile(json["profile"].toString());
+    return channel;
+}
+
+bool ChannelData::operator==(const ChannelData &other) const
+{
+    return m_name == other.m_name && m_url == other.m_url && m_tvgId == other.m_tvgId &&
+           m_logoUrl == other.m_logoUrl && m_source == other.m_source && m_profile == other.m_profile;
+}
+
+bool ChannelData::operator!=(const ChannelData &other) const
+{
+    return !(*this == other);
 }
\ No newline at end of file
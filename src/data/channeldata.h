@@ -5,7 +5,7 @@
 #include <QJsonObject>
 
 /**
- * @brief The ChannelData class represents a channel entry with name and URL
+ * @brief The ChannelData class represents a channel entry with name, URL, guide id and logo
  */
 class ChannelData
 {
@@ -46,6 +46,57 @@ public:
      */
     void setUrl(const QString &url);
 
+    /**
+     * @brief Get the XMLTV channel id used to link programme guide data
+     * @return The tvg-id, empty if the channel has no guide data
+     */
+    QString tvgId() const;
+
+    /**
+     * @brief Set the XMLTV channel id
+     * @param tvgId The new tvg-id
+     */
+    void setTvgId(const QString &tvgId);
+
+    /**
+     * @brief Get the URL of the channel logo
+     * @return The tvg-logo URL, empty if the channel has no logo
+     */
+    QString logoUrl() const;
+
+    /**
+     * @brief Set the URL of the channel logo
+     * @param logoUrl The new tvg-logo URL
+     */
+    void setLogoUrl(const QString &logoUrl);
+
+    /**
+     * @brief Get the name of the source the channel was loaded from
+     *
+     * Only set when several sources are merged; it is not saved to JSON.
+     *
+     * @return Source name, empty for a single-source lineup
+     */
+    QString source() const;
+
+    /**
+     * @brief Set the name of the source the channel was loaded from
+     * @param source Source name
+     */
+    void setSource(const QString &source);
+
+    /**
+     * @brief Get the performance profile to play the channel with
+     * @return Profile name, empty to use the global profile
+     */
+    QString profile() const;
+
+    /**
+     * @brief Set the performance profile to play the channel with
+     * @param profile Profile name, empty to use the global profile
+     */
+    void setProfile(const QString &profile);
+
     /**
      * @brief Convert the channel data to a JSON object
      * @return JSON object representation of the channel
@@ -59,9 +110,27 @@ public:
      */
     static ChannelData fromJson(const QJsonObject &json);
 
+    /**
+     * @brief Compare two channels field by field
+     * @param other Channel to compare with
+     * @return True if all fields are equal
+     */
+    bool operator==(const ChannelData &other) const;
+
+    /**
+     * @brief Compare two channels field by field
+     * @param other Channel to compare with
+     * @return True if any field differs
+     */
+    bool operator!=(const ChannelData &other) const;
+
 private:
     QString m_name;
     QString m_url;
+    QString m_tvgId;
+    QString m_logoUrl;
+    QString m_source;
+    QString m_profile;
 };
 
 #endif // CHANNELDATA_H
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef CHANNELSOURCE_H
+#define CHANNELSOURCE_H
+
+#include <QString>
+
+/**
+ * @brief The ChannelSource struct describes one lineup file merged into the channel list
+ *
+ * Sources are JSON channel files or M3U playlists. When the same channel
+ * appears in several sources, the entry from the source with the highest
+ * priority wins; its position is that of the first source listing it.
+ */
+struct ChannelSource
+{
+    QString name;
+    QString path;
+    int priority = 0;
+
+    /**
+     * @brief Compare two sources field by field
+     * @param other Source to compare with
+     * @return True if all fields are equal
+     */
+    bool operator==(const ChannelSource &other) const
+    {
+        return name == other.name && path == other.path && priority == other.priority;
+    }
+};
+
+#endif // CHANNELSOURCE_H
\ No newline at end of file
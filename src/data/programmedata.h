@@ -0,0 +1,31 @@
+#ifndef PROGRAMMEDATA_H
+#define PROGRAMMEDATA_H
+
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * @brief The ProgrammeData struct represents one programme guide entry
+ *
+ * Times are seconds since the Unix epoch (UTC). The struct is kept plain so
+ * that large guides can be stored in contiguous, sorted arrays.
+ */
+struct ProgrammeData
+{
+    qint64 start = 0;
+    qint64 stop = 0;
+    QString title;
+    QString description;
+
+    /**
+     * @brief Check whether the programme is airing at a given time
+     * @param time Seconds since the Unix epoch
+     * @return True if start <= time < stop
+     */
+    bool contains(qint64 time) const
+    {
+        return start <= time && time < stop;
+    }
+};
+
+#endif // PROGRAMMEDATA_H
\ No newline at end of file
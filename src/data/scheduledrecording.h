@@ -0,0 +1,34 @@
+#ifndef SCHEDULEDRECORDING_H
+#define SCHEDULEDRECORDING_H
+
+#include <QString>
+#include <QDateTime>
+
+/**
+ * @brief The ScheduledRecording struct describes one recording of a channel
+ *
+ * A recording runs from start to end. Recordings started by hand are
+ * scheduled from the current time with a generous end, and are stopped by
+ * moving the end to the moment the user stops them.
+ */
+struct ScheduledRecording
+{
+    QString id;
+    QString channelName;
+    QString url;
+    QDateTime start;
+    QDateTime end;
+
+    /**
+     * @brief Compare two recordings field by field
+     * @param other Recording to compare with
+     * @return True if all fields are equal
+     */
+    bool operator==(const ScheduledRecording &other) const
+    {
+        return id == other.id && channelName == other.channelName && url == other.url && start == other.start &&
+               end == other.end;
+    }
+};
+
+#endif // SCHEDULEDRECORDING_H
\ No newline at end of file
@@ -1,125 +1,594 @@
 #include "settings.h"
+#include <QSettings>
+#include <QStandardPaths>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QHash>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+
+// Changes made within this window are written together
+static const int SAVE_DELAY_MS = 1000;
+
+/**
+ * @brief Convert a stored value to the type of a schema setting
+ * @param info Schema entry of the setting
+ * @param value Stored value
+ * @param result Converted value
+ * @return True if the value converted
+ */
+static bool toSetting(const SettingInfo &info, const QVariant &value, int &result)
+{
+    bool ok = false;
+    int number = value.toInt(&ok);
+    if (!ok)
+    {
+        qWarning() << "Ignoring setting" << info.key << "- not a number:" << value.toString();
+        return false;
+    }
+
+    result = qBound(info.minimum, number, info.maximum);
+    if (result != number)
+    {
+        qWarning() << "Setting" << info.key << "out of range:" << number << "- using" << result;
+    }
+    return true;
+}
+
+static bool toSetting(const SettingInfo &info, const QVariant &value, bool &result)
+{
+    // QSettings reads booleans back from INI files as strings
+    if (value.typeId() != QMetaType::Bool)
+    {
+        const QString text = value.toString().toLower();
+        if (text != "true" && text != "false" && text != "1" && text != "0")
+        {
+            qWarning() << "Ignoring setting" << info.key << "- not a boolean:" << value.toString();
+            return false;
+        }
+    }
+
+    result = value.toBool();
+    return true;
+}
+
+static bool toSetting(const SettingInfo &, const QVariant &value, QString &result)
+{
+    result = value.toString();
+    return true;
+}
+
+static bool toSetting(const SettingInfo &, const QVariant &value, QByteArray &result)
+{
+    result = value.toByteArray();
+    return true;
+}
 
 Settings::Settings(QObject *parent)
-    : QObject(parent), m_appSettings(new QSettings("HarperTV", "HarperTV", this))
+    : QObject(parent), m_dirty(false), m_writePending(false)
 {
-    initDefaults();
+    // Changes made in one go are announced together
+    m_changeTimer.setSingleShot(true);
+    m_changeTimer.setInterval(0);
+    connect(&m_changeTimer, &QTimer::timeout, this, &Settings::emitChanges);
+
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(SAVE_DELAY_MS);
+    connect(&m_saveTimer, &QTimer::timeout, this, &Settings::save);
+    connect(&m_writeWatcher, &QFutureWatcher<bool>::finished, this, &Settings::onWriteFinished);
+
+    // Written before the event loop is gone, while the main window still exists
+    if (QCoreApplication::instance())
+    {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &Settings::sync);
+    }
+
     load();
 }
 
 Settings::~Settings()
 {
-    save();
+    sync();
 }
 
 void Settings::load()
 {
-    // Load application settings
-    // Nothing to do here as QSettings loads automatically
+    // The only blocking read; everything after works on the copy in memory
+    QSettings store("HarperTV", "HarperTV");
+
+    m_typed = SettingValues();
+    m_values.clear();
+    m_mpvSettings.clear();
+    initDefaults();
+
+    int stored = 0;
+    const QStringList keys = store.allKeys();
+    for (const QString &key : keys)
+    {
+        if (key.startsWith("MPVSettings/"))
+        {
+            continue;
+        }
+
+        int index = schemaIndex(key, false);
+        if (index < 0)
+        {
+            m_values.insert(key, store.value(key));
+            continue;
+        }
+
+        setTypedValue(static_cast<Setting>(index), store.value(key));
+        ++stored;
+    }
 
     // Load MPV settings
-    int size = m_appSettings->beginReadArray("MPVSettings");
+    int size = store.beginReadArray("MPVSettings");
     for (int i = 0; i < size; ++i)
     {
-        m_appSettings->setArrayIndex(i);
-        QString key = m_appSettings->value("key").toString();
-        QVariant value = m_appSettings->value("value");
-        m_mpvSettings[key] = value;
+        store.setArrayIndex(i);
+        QString key = store.value("key").toString();
+        QVariant value = store.value("value");
+
+        int index = schemaIndex(key, true);
+        if (index < 0)
+        {
+            m_mpvSettings[key] = value;
+            continue;
+        }
+
+        setTypedValue(static_cast<Setting>(index), value);
+        ++stored;
+    }
+    store.endArray();
+
+    // Defaults are written back so the file shows every setting
+    if (stored < static_cast<int>(Setting::Count))
+    {
+        scheduleSave();
     }
-    m_appSettings->endArray();
 
-    emit settingsChanged();
-    emit mpvSettingsChanged();
+    // Everything may have changed
+    markAllChanged();
+    emitChanges();
 }
 
 void Settings::save()
 {
-    // Save MPV settings
-    m_appSettings->beginWriteArray("MPVSettings");
-    int i = 0;
-    for (auto it = m_mpvSettings.constBegin(); it != m_mpvSettings.constEnd(); ++it)
+    m_saveTimer.stop();
+
+    if (!m_dirty)
     {
-        m_appSettings->setArrayIndex(i++);
-        m_appSettings->setValue("key", it.key());
-        m_appSettings->setValue("value", it.value());
+        return;
     }
-    m_appSettings->endArray();
 
-    m_appSettings->sync();
+    // One write at a time; changes made meanwhile go out in the next one
+    if (m_writeWatcher.isRunning())
+    {
+        m_writePending = true;
+        return;
+    }
+
+    m_dirty = false;
+    m_writeWatcher.setFuture(QtConcurrent::run(&Settings::writeStore, snapshot()));
+}
+
+void Settings::sync()
+{
+    m_saveTimer.stop();
+    m_writeWatcher.waitForFinished();
+    m_writePending = false;
+
+    if (m_dirty)
+    {
+        m_dirty = false;
+        if (!writeStore(snapshot()))
+        {
+            qWarning() << "Could not write settings";
+        }
+    }
 }
 
 QVariant Settings::value(const QString &key, const QVariant &defaultValue) const
 {
-    return m_appSettings->value(key, defaultValue);
+    int index = schemaIndex(key, false);
+    if (index >= 0)
+    {
+        return typedValue(static_cast<Setting>(index));
+    }
+
+    return m_values.value(key, defaultValue);
 }
 
 void Settings::setValue(const QString &key, const QVariant &value)
 {
-    m_appSettings->setValue(key, value);
-    emit settingsChanged();
+    int index = schemaIndex(key, false);
+    if (index >= 0)
+    {
+        if (setTypedValue(static_cast<Setting>(index), value))
+        {
+            markChanged(key, false);
+            scheduleSave();
+        }
+        return;
+    }
+
+    auto it = m_values.constFind(key);
+    if (it != m_values.constEnd() && sameValue(it.value(), value))
+    {
+        return;
+    }
+
+    m_values.insert(key, value);
+    markChanged(key, false);
+    scheduleSave();
 }
 
 QVariant Settings::mpvValue(const QString &key, const QVariant &defaultValue) const
 {
+    int index = schemaIndex(key, true);
+    if (index >= 0)
+    {
+        return typedValue(static_cast<Setting>(index));
+    }
+
     return m_mpvSettings.value(key, defaultValue);
 }
 
 void Settings::setMpvValue(const QString &key, const QVariant &value)
 {
+    int index = schemaIndex(key, true);
+    if (index >= 0)
+    {
+        if (setTypedValue(static_cast<Setting>(index), value))
+        {
+            markChanged(key, true);
+            scheduleSave();
+        }
+        return;
+    }
+
+    auto it = m_mpvSettings.constFind(key);
+    if (it != m_mpvSettings.constEnd() && sameValue(it.value(), value))
+    {
+        return;
+    }
+
     m_mpvSettings[key] = value;
-    emit mpvSettingsChanged();
+    markChanged(key, true);
+    scheduleSave();
 }
 
 QMap<QString, QVariant> Settings::allMpvSettings() const
 {
-    return m_mpvSettings;
+    QMap<QString, QVariant> settings = m_mpvSettings;
+    for (int i = 0; i < static_cast<int>(Setting::Count); ++i)
+    {
+        if (SETTINGS_SCHEMA[i].mpv)
+        {
+            settings.insert(SETTINGS_SCHEMA[i].key, typedValue(static_cast<Setting>(i)));
+        }
+    }
+    return settings;
+}
+
+QMap<QString, QVariant> Settings::defaultMpvSettings()
+{
+    const SettingValues defaults;
+    QMap<QString, QVariant> settings;
+    for (int i = 0; i < static_cast<int>(Setting::Count); ++i)
+    {
+        if (SETTINGS_SCHEMA[i].mpv)
+        {
+            settings.insert(SETTINGS_SCHEMA[i].key, typedValue(defaults, static_cast<Setting>(i)));
+        }
+    }
+    return settings;
+}
+
+QList<ChannelSource> Settings::channelSources() const
+{
+    QList<ChannelSource> sources;
+
+    // Stored the way QSettings lays out arrays, so the file format is unchanged
+    int size = m_values.value("ChannelSources/size").toInt();
+    for (int i = 1; i <= size; ++i)
+    {
+        QString prefix = QString("ChannelSources/%1/").arg(i);
+        ChannelSource source;
+        source.name = m_values.value(prefix + "name").toString();
+        source.path = m_values.value(prefix + "path").toString();
+        source.priority = m_values.value(prefix + "priority", 0).toInt();
+        sources.append(source);
+    }
+
+    return sources;
+}
+
+void Settings::setChannelSources(const QList<ChannelSource> &sources)
+{
+    if (sources == channelSources())
+    {
+        return;
+    }
+
+    removeGroup("ChannelSources");
+    m_values.insert("ChannelSources/size", sources.size());
+    for (int i = 0; i < sources.size(); ++i)
+    {
+        QString prefix = QString("ChannelSources/%1/").arg(i + 1);
+        m_values.insert(prefix + "name", sources[i].name);
+        m_values.insert(prefix + "path", sources[i].path);
+        m_values.insert(prefix + "priority", sources[i].priority);
+    }
+
+    markChanged("ChannelSources", false);
+    scheduleSave();
+}
+
+QList<ScheduledRecording> Settings::scheduledRecordings() const
+{
+    QList<ScheduledRecording> recordings;
+
+    int size = m_values.value("Recordings/size").toInt();
+    for (int i = 1; i <= size; ++i)
+    {
+        QString prefix = QString("Recordings/%1/").arg(i);
+        ScheduledRecording recording;
+        recording.id = m_values.value(prefix + "id").toString();
+        recording.channelName = m_values.value(prefix + "channel").toString();
+        recording.url = m_values.value(prefix + "url").toString();
+        recording.start = m_values.value(prefix + "start").toDateTime();
+        recording.end = m_values.value(prefix + "end").toDateTime();
+        recordings.append(recording);
+    }
+
+    return recordings;
+}
+
+void Settings::setScheduledRecordings(const QList<ScheduledRecording> &recordings)
+{
+    removeGroup("Recordings");
+    m_values.insert("Recordings/size", recordings.size());
+    for (int i = 0; i < recordings.size(); ++i)
+    {
+        QString prefix = QString("Recordings/%1/").arg(i + 1);
+        m_values.insert(prefix + "id", recordings[i].id);
+        m_values.insert(prefix + "channel", recordings[i].channelName);
+        m_values.insert(prefix + "url", recordings[i].url);
+        m_values.insert(prefix + "start", recordings[i].start);
+        m_values.insert(prefix + "end", recordings[i].end);
+    }
+
+    markChanged("Recordings", false);
+    scheduleSave();
 }
 
 void Settings::resetToDefaults()
 {
-    m_appSettings->clear();
+    // Keys that are dropped change as much as keys that are reset
+    markAllChanged();
+
+    m_typed = SettingValues();
+    m_values.clear();
     m_mpvSettings.clear();
     initDefaults();
 
-    emit settingsChanged();
-    emit mpvSettingsChanged();
+    emitChanges();
+    scheduleSave();
 }
 
-void Settings::initDefaults()
+void Settings::markChanged(const QString &key, bool mpv)
+{
+    if (mpv)
+    {
+        m_changedMpvKeys.insert(key);
+    }
+    else
+    {
+        m_changedKeys.insert(key);
+    }
+
+    if (!m_changeTimer.isActive())
+    {
+        m_changeTimer.start();
+    }
+}
+
+void Settings::emitChanges()
+{
+    m_changeTimer.stop();
+
+    QStringList keys(m_changedKeys.constBegin(), m_changedKeys.constEnd());
+    QStringList mpvKeys(m_changedMpvKeys.constBegin(), m_changedMpvKeys.constEnd());
+    m_changedKeys.clear();
+    m_changedMpvKeys.clear();
+
+    // Sorted, so options are applied in the same order every time
+    std::sort(keys.begin(), keys.end());
+    std::sort(mpvKeys.begin(), mpvKeys.end());
+
+    if (!keys.isEmpty())
+    {
+        emit settingsChanged(keys);
+    }
+    if (!mpvKeys.isEmpty())
+    {
+        emit mpvSettingsChanged(mpvKeys);
+    }
+}
+
+bool Settings::sameValue(const QVariant &a, const QVariant &b)
+{
+    if (a == b)
+    {
+        return true;
+    }
+
+    return a.canConvert<QString>() && b.canConvert<QString>() && a.toString() == b.toString();
+}
+
+int Settings::schemaIndex(const QString &key, bool mpv)
+{
+    static const QHash<QString, int> indices = []()
+    {
+        QHash<QString, int> result;
+        for (int i = 0; i < static_cast<int>(Setting::Count); ++i)
+        {
+            result.insert(SETTINGS_SCHEMA[i].key, i);
+        }
+        return result;
+    }();
+
+    int index = indices.value(key, -1);
+    return index >= 0 && SETTINGS_SCHEMA[index].mpv == mpv ? index : -1;
+}
+
+QVariant Settings::typedValue(Setting setting) const
+{
+    return typedValue(m_typed, setting);
+}
+
+QVariant Settings::typedValue(const SettingValues &values, Setting setting)
+{
+    switch (setting)
+    {
+#define HARPERTV_SETTING_GET(id, key, type, def, minimum, maximum, mpv, initOnly) \
+    case Setting::id:                                                             \
+        return QVariant::fromValue(values.id);
+        HARPERTV_SETTINGS(HARPERTV_SETTING_GET)
+#undef HARPERTV_SETTING_GET
+    case Setting::Count:
+        break;
+    }
+
+    return QVariant();
+}
+
+bool Settings::setTypedValue(Setting setting, const QVariant &value)
+{
+    switch (setting)
+    {
+#define HARPERTV_SETTING_SET(id, key, type, def, minimum, maximum, mpv, initOnly) \
+    case Setting::id:                                                             \
+    {                                                                             \
+        type converted{};                                                         \
+        if (!toSetting(settingInfo(setting), value, converted) ||                 \
+            m_typed.id == converted)                                              \
+        {                                                                         \
+            return false;                                                         \
+        }                                                                         \
+        m_typed.id = converted;                                                   \
+        return true;                                                              \
+    }
+        HARPERTV_SETTINGS(HARPERTV_SETTING_SET)
+#undef HARPERTV_SETTING_SET
+    case Setting::Count:
+        break;
+    }
+
+    return false;
+}
+
+void Settings::markAllChanged()
+{
+    for (const SettingInfo &info : SETTINGS_SCHEMA)
+    {
+        markChanged(info.key, info.mpv);
+    }
+    for (auto it = m_values.constBegin(); it != m_values.constEnd(); ++it)
+    {
+        markChanged(it.key(), false);
+    }
+    for (auto it = m_mpvSettings.constBegin(); it != m_mpvSettings.constEnd(); ++it)
+    {
+        markChanged(it.key(), true);
+    }
+}
+
+void Settings::scheduleSave()
 {
-    // Application defaults
-    if (!m_appSettings->contains("volume"))
+    m_dirty = true;
+
+    // Not restarted by later changes, so a steady stream of them is still written every window
+    if (!m_saveTimer.isActive())
     {
-        m_appSettings->setValue("volume", 100);
+        m_saveTimer.start();
     }
+}
 
-    if (!m_appSettings->contains("lastChannelIndex"))
+void Settings::onWriteFinished()
+{
+    if (!m_writeWatcher.result())
     {
-        m_appSettings->setValue("lastChannelIndex", 0);
+        qWarning() << "Could not write settings";
     }
 
-    if (!m_appSettings->contains("channelsFile"))
+    if (m_writePending)
     {
-        m_appSettings->setValue("channelsFile", ":/default_channels.json");
+        m_writePending = false;
+        save();
     }
+}
 
-    // MPV defaults
-    if (m_mpvSettings.isEmpty())
+void Settings::removeGroup(const QString &group)
+{
+    const QString prefix = group + '/';
+    m_values.removeIf([&prefix](QMap<QString, QVariant>::iterator it)
+                      { return it.key().startsWith(prefix); });
+}
+
+QMap<QString, QVariant> Settings::snapshot() const
+{
+    QMap<QString, QVariant> values = m_values;
+    for (int i = 0; i < static_cast<int>(Setting::Count); ++i)
     {
-        // Video settings
-        m_mpvSettings["vo"] = "gpu";
-        m_mpvSettings["hwdec"] = "auto";
+        if (!SETTINGS_SCHEMA[i].mpv)
+        {
+            values.insert(SETTINGS_SCHEMA[i].key, typedValue(static_cast<Setting>(i)));
+        }
+    }
 
-        // Audio settings
-        m_mpvSettings["audio-channels"] = "auto";
-        m_mpvSettings["audio-device"] = "auto";
+    const QMap<QString, QVariant> mpvSettings = allMpvSettings();
+    int i = 1;
+    values.insert("MPVSettings/size", mpvSettings.size());
+    for (auto it = mpvSettings.constBegin(); it != mpvSettings.constEnd(); ++it, ++i)
+    {
+        values.insert(QString("MPVSettings/%1/key").arg(i), it.key());
+        values.insert(QString("MPVSettings/%1/value").arg(i), it.value());
+    }
 
-        // Cache settings
-        m_mpvSettings["cache"] = true;
-        m_mpvSettings["cache-secs"] = 10;
+    return values;
+}
 
-        // Network settings
-        m_mpvSettings["network-timeout"] = 5;
-        m_mpvSettings["user-agent"] = "HarperTV/1.0";
+bool Settings::writeStore(const QMap<QString, QVariant> &values)
+{
+    // Native backends such as the registry apply each key on its own, so the store is
+    // updated key by key instead of cleared and rewritten; an interrupted write leaves
+    // some keys old rather than the whole store empty
+    QSettings store("HarperTV", "HarperTV");
+    const QStringList storedKeys = store.allKeys();
+    for (const QString &key : storedKeys)
+    {
+        if (!values.contains(key))
+        {
+            store.remove(key);
+        }
+    }
+    for (auto it = values.constBegin(); it != values.constEnd(); ++it)
+    {
+        if (!store.contains(it.key()) || !sameValue(store.value(it.key()), it.value()))
+        {
+            store.setValue(it.key(), it.value());
+        }
     }
+    store.sync();
+
+    return store.status() == QSettings::NoError;
+}
+
+void Settings::initDefaults()
+{
+    // Everything else comes from the schema; these depend on the platform
+    m_typed.RecordingsDir = QStandardPaths::writableLocation(QStandardPaths::MoviesLocation) + "/HarperTV";
+    m_typed.MpvConfigFile = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation) + "/mpv.conf";
 }
\ No newline at end of file
@@ -2,13 +2,40 @@
 #define SETTINGS_H
 
 #include <QObject>
-#include <QSettings>
 #include <QMap>
 #include <QString>
 #include <QVariant>
+#include <QList>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+#include <QFutureWatcher>
+#include "channelsource.h"
+#include "scheduledrecording.h"
+#include "settingsschema.h"
+#include <type_traits>
+#include <utility>
 
 /**
  * @brief The Settings class manages application and MPV settings
+ *
+ * Setting a value that is already stored does nothing. Real changes are
+ * collected per key and announced once the caller returns to the event
+ * loop, so a dialog saving twenty fields emits one change set listing only
+ * the fields that differ.
+ *
+ * The settings are read from QSettings once, when constructed; after that
+ * the copy in memory is authoritative and reads never touch the disk.
+ * Changes are written behind on a worker thread, all changes of a one
+ * second window in a single update of the store, so a slow home directory
+ * never stalls the UI. Pending changes are written synchronously when the
+ * application quits.
+ *
+ * The settings listed in the schema are kept in a plain struct and read
+ * through get<Setting::X>(), which costs a member load instead of a string
+ * hash and a QVariant conversion. The string-keyed accessors still work for
+ * them, converting and range-checking on the way in, and hold any other key
+ * as before.
  */
 class Settings : public QObject
 {
@@ -27,15 +54,54 @@ public:
     ~Settings();
 
     /**
-     * @brief Load settings from storage
+     * @brief Load settings from storage, replacing the copy in memory
      */
     void load();
 
     /**
-     * @brief Save settings to storage
+     * @brief Write pending changes now, in the background
      */
     void save();
 
+    /**
+     * @brief Write pending changes and wait until they are stored
+     */
+    void sync();
+
+    /**
+     * @brief Get a setting of the schema
+     * @return Setting value
+     */
+    template <Setting S>
+    typename SettingTraits<S>::Type get() const
+    {
+        return m_typed.*SettingTraits<S>::member;
+    }
+
+    /**
+     * @brief Set a setting of the schema, clamping numbers to its range
+     * @param value Setting value
+     */
+    template <Setting S>
+    void set(typename SettingTraits<S>::Type value)
+    {
+        constexpr SettingInfo info = settingInfo(S);
+        if constexpr (std::is_same_v<typename SettingTraits<S>::Type, int>)
+        {
+            value = qBound(info.minimum, value, info.maximum);
+        }
+
+        auto &stored = m_typed.*SettingTraits<S>::member;
+        if (stored == value)
+        {
+            return;
+        }
+
+        stored = std::move(value);
+        markChanged(info.key, info.mpv);
+        scheduleSave();
+    }
+
     /**
      * @brief Get an application setting value
      * @param key Setting key
@@ -72,6 +138,36 @@ public:
      */
     QMap<QString, QVariant> allMpvSettings() const;
 
+    /**
+     * @brief Get the defaults of the MPV settings of the schema
+     * @return Map of MPV option names to their default values
+     */
+    static QMap<QString, QVariant> defaultMpvSettings();
+
+    /**
+     * @brief Get the channel sources merged on top of the channels file
+     * @return Additional sources in lineup order
+     */
+    QList<ChannelSource> channelSources() const;
+
+    /**
+     * @brief Set the channel sources merged on top of the channels file
+     * @param sources Additional sources in lineup order
+     */
+    void setChannelSources(const QList<ChannelSource> &sources);
+
+    /**
+     * @brief Get the recordings that are scheduled or running
+     * @return Recordings in the order they were scheduled
+     */
+    QList<ScheduledRecording> scheduledRecordings() const;
+
+    /**
+     * @brief Set the recordings that are scheduled or running
+     * @param recordings Recordings in the order they were scheduled
+     */
+    void setScheduledRecordings(const QList<ScheduledRecording> &recordings);
+
     /**
      * @brief Reset all settings to defaults
      */
@@ -80,22 +176,129 @@ public:
 signals:
     /**
      * @brief Signal emitted when settings are changed
+     * @param keys Keys whose values changed
      */
-    void settingsChanged();
+    void settingsChanged(const QStringList &keys);
 
     /**
      * @brief Signal emitted when MPV settings are changed
+     * @param keys MPV option names whose values changed
      */
-    void mpvSettingsChanged();
+    void mpvSettingsChanged(const QStringList &keys);
 
 private:
     /**
-     * @brief Initialize default settings
+     * @brief Record a changed key and schedule the change signals
+     * @param key Setting key
+     * @param mpv True for an MPV setting, false for an application setting
+     */
+    void markChanged(const QString &key, bool mpv);
+
+    /**
+     * @brief Emit the change sets collected so far
+     */
+    void emitChanges();
+
+    /**
+     * @brief Check whether two setting values are the same
+     *
+     * Values read back from the settings file come as strings, so they are
+     * also compared in their string form.
+     *
+     * @param a First value
+     * @param b Second value
+     * @return True if setting one over the other changes nothing
+     */
+    static bool sameValue(const QVariant &a, const QVariant &b);
+
+    /**
+     * @brief Find a key in the schema
+     * @param key Setting key
+     * @param mpv True for an MPV setting, false for an application setting
+     * @return Index into the schema, or -1 if the key is not part of it
+     */
+    static int schemaIndex(const QString &key, bool mpv);
+
+    /**
+     * @brief Get a setting of the schema as a variant
+     * @param setting Setting
+     * @return Setting value
+     */
+    QVariant typedValue(Setting setting) const;
+
+    /**
+     * @brief Get a setting of a value set as a variant
+     * @param values Value set
+     * @param setting Setting
+     * @return Setting value
+     */
+    static QVariant typedValue(const SettingValues &values, Setting setting);
+
+    /**
+     * @brief Set a setting of the schema from a variant
+     *
+     * Values that do not convert to the setting's type are ignored and
+     * numbers are clamped to its range, with a warning either way.
+     *
+     * @param setting Setting
+     * @param value Setting value
+     * @return True if the stored value changed
+     */
+    bool setTypedValue(Setting setting, const QVariant &value);
+
+    /**
+     * @brief Mark every setting as changed
+     */
+    void markAllChanged();
+
+    /**
+     * @brief Schedule a write of the changes made in this window
+     */
+    void scheduleSave();
+
+    /**
+     * @brief Report a finished write and start the next one if changes came in meanwhile
+     */
+    void onWriteFinished();
+
+    /**
+     * @brief Remove all keys of a group, such as an array
+     * @param group Group name
+     */
+    void removeGroup(const QString &group);
+
+    /**
+     * @brief Get everything to store, with the MPV settings laid out as an array
+     * @return Values by QSettings key
+     */
+    QMap<QString, QVariant> snapshot() const;
+
+    /**
+     * @brief Replace the stored settings; safe to call from any thread
+     *
+     * Only keys whose value changed are written, and only keys missing from
+     * the values are removed.
+     *
+     * @param values Values by QSettings key
+     * @return True if the store was written
+     */
+    static bool writeStore(const QMap<QString, QVariant> &values);
+
+    /**
+     * @brief Fill in the defaults that depend on the platform
      */
     void initDefaults();
 
-    QSettings *m_appSettings;
+    SettingValues m_typed;
+    QMap<QString, QVariant> m_values;
     QMap<QString, QVariant> m_mpvSettings;
+    QSet<QString> m_changedKeys;
+    QSet<QString> m_changedMpvKeys;
+    QTimer m_changeTimer;
+    QTimer m_saveTimer;
+    QFutureWatcher<bool> m_writeWatcher;
+    bool m_dirty;
+    bool m_writePending;
 };
 
 #endif // SETTINGS_H
\ No newline at end of file
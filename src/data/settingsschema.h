@@ -0,0 +1,228 @@
+#ifndef SETTINGSSCHEMA_H
+#define SETTINGSSCHEMA_H
+
+#include <QString>
+#include <QByteArray>
+#include <climits>
+#include <cstddef>
+#include <iterator>
+
+/**
+ * @brief Every setting the application knows, with its key, type, default and range
+ *
+ * One line per setting: X(id, key, type, default, minimum, maximum, mpv, initOnly).
+ * The range only applies to int settings. mpv marks options passed to the
+ * mpv core, initOnly those that only take effect when the core starts.
+ * The empty recordingsDir and mpvConfigFile defaults are filled in at load
+ * time from the platform's standard locations.
+ */
+#define HARPERTV_SETTINGS(X)                                                                                        \
+    X(Volume, "volume", int, 100, 0, 100, false, false)                                                             \
+    X(LastChannelIndex, "lastChannelIndex", int, 0, 0, INT_MAX, false, false)                                       \
+    X(ChannelsFile, "channelsFile", QString, ":/default_channels.json", 0, 0, false, false)                         \
+    X(SortChannelsByUsage, "sortChannelsByUsage", bool, false, 0, 0, false, false)                                  \
+    X(HlsCache, "hlsCache", bool, true, 0, 0, false, false)                                                         \
+    X(HlsCacheMB, "hlsCacheMB", int, 64, 8, 1024, false, false)                                                     \
+    X(AdaptiveCache, "adaptiveCache", bool, true, 0, 0, false, false)                                               \
+    X(CacheMemoryMB, "cacheMemoryMB", int, 256, 32, 4096, false, false)                                             \
+    X(Timeshift, "timeshift", bool, false, 0, 0, false, false)                                                      \
+    X(TimeshiftMinutes, "timeshiftMinutes", int, 60, 5, 240, false, false)                                          \
+    X(TimeshiftMemoryMB, "timeshiftMemoryMB", int, 512, 64, 8192, false, false)                                     \
+    X(RecordingsDir, "recordingsDir", QString, "", 0, 0, false, false)                                              \
+    X(ResumePlayback, "resumePlayback", bool, true, 0, 0, false, false)                                             \
+    X(SeekThumbnails, "seekThumbnails", bool, true, 0, 0, false, false)                                             \
+    X(VodCache, "vodCache", bool, true, 0, 0, false, false)                                                         \
+    X(VodCacheMB, "vodCacheMB", int, 2048, 256, 102400, false, false)                                               \
+    X(EpgFile, "epgFile", QString, "", 0, 0, false, false)                                                          \
+    X(EpgRefreshMinutes, "epgRefreshMinutes", int, 60, 0, 1440, false, false)                                       \
+    X(MpvConfigFile, "mpvConfigFile", QString, "", 0, 0, false, false)                                              \
+    X(MpvProfiles, "mpvProfiles", QString, "", 0, 0, false, false)                                                  \
+    X(PerformanceProfile, "performanceProfile", QString, "", 0, 0, false, false)                                    \
+    X(WindowGeometry, "window/geometry", QByteArray, "", 0, 0, false, false)                                        \
+    X(WindowState, "window/state", QByteArray, "", 0, 0, false, false)                                              \
+    X(WindowFullscreen, "window/isFullscreen", bool, false, 0, 0, false, false)                                     \
+    X(Vo, "vo", QString, "gpu", 0, 0, true, true)                                                                   \
+    X(Hwdec, "hwdec", QString, "auto", 0, 0, true, false)                                                           \
+    X(KeepAspect, "keepaspect", bool, true, 0, 0, true, false)                                                      \
+    X(AudioChannels, "audio-channels", QString, "auto", 0, 0, true, false)                                          \
+    X(AudioDevice, "audio-device", QString, "auto", 0, 0, true, false)                                              \
+    X(Cache, "cache", bool, true, 0, 0, true, false)                                                                \
+    X(CacheSecs, "cache-secs", int, 10, 1, 600, true, false)                                                        \
+    X(NetworkTimeout, "network-timeout", int, 5, 1, 60, true, false)                                                \
+    X(UserAgent, "user-agent", QString, "HarperTV/1.0", 0, 0, true, false)
+
+/**
+ * @brief Identifies a setting of the schema
+ */
+enum class Setting
+{
+#define HARPERTV_SETTING_ID(id, key, type, def, minimum, maximum, mpv, initOnly) id,
+    HARPERTV_SETTINGS(HARPERTV_SETTING_ID)
+#undef HARPERTV_SETTING_ID
+    Count
+};
+
+/**
+ * @brief Storage type of a setting
+ */
+enum class SettingType
+{
+    Bool,
+    Int,
+    String,
+    Bytes
+};
+
+/**
+ * @brief Schema entry of a setting
+ */
+struct SettingInfo
+{
+    const char *key;
+    SettingType type;
+    int minimum;
+    int maximum;
+    bool mpv;
+    bool initOnly;
+};
+
+/**
+ * @brief The current value of every setting, one typed member each
+ */
+struct SettingValues
+{
+#define HARPERTV_SETTING_MEMBER(id, key, type, def, minimum, maximum, mpv, initOnly) type id = def;
+    HARPERTV_SETTINGS(HARPERTV_SETTING_MEMBER)
+#undef HARPERTV_SETTING_MEMBER
+};
+
+/**
+ * @brief Map a C++ type to its storage type
+ * @return Storage type
+ */
+template <typename T>
+constexpr SettingType settingTypeOf();
+
+template <>
+constexpr SettingType settingTypeOf<bool>() { return SettingType::Bool; }
+
+template <>
+constexpr SettingType settingTypeOf<int>() { return SettingType::Int; }
+
+template <>
+constexpr SettingType settingTypeOf<QString>() { return SettingType::String; }
+
+template <>
+constexpr SettingType settingTypeOf<QByteArray>() { return SettingType::Bytes; }
+
+/**
+ * @brief The schema, indexed by Setting
+ */
+inline constexpr SettingInfo SETTINGS_SCHEMA[] = {
+#define HARPERTV_SETTING_INFO(id, key, type, def, minimum, maximum, mpv, initOnly) \
+    {key, settingTypeOf<type>(), minimum, maximum, mpv, initOnly},
+    HARPERTV_SETTINGS(HARPERTV_SETTING_INFO)
+#undef HARPERTV_SETTING_INFO
+};
+
+/**
+ * @brief Get the schema entry of a setting
+ * @param setting Setting
+ * @return Schema entry
+ */
+constexpr const SettingInfo &settingInfo(Setting setting)
+{
+    return SETTINGS_SCHEMA[static_cast<int>(setting)];
+}
+
+/**
+ * @brief Get the key a setting is stored and announced under
+ * @param setting Setting
+ * @return Key
+ */
+constexpr const char *settingKey(Setting setting)
+{
+    return settingInfo(setting).key;
+}
+
+/**
+ * @brief Type, member and range of a setting, for the typed accessors
+ */
+template <Setting S>
+struct SettingTraits;
+
+#define HARPERTV_SETTING_TRAITS(id, key, type, def, minimum, maximum, mpv, initOnly) \
+    template <>                                                                    \
+    struct SettingTraits<Setting::id>                                              \
+    {                                                                              \
+        using Type = type;                                                         \
+        static constexpr type SettingValues::*member = &SettingValues::id;         \
+    };
+HARPERTV_SETTINGS(HARPERTV_SETTING_TRAITS)
+#undef HARPERTV_SETTING_TRAITS
+
+namespace SettingsSchemaCheck
+{
+/**
+ * @brief Compare two keys at compile time
+ * @return True if equal
+ */
+constexpr bool sameKey(const char *a, const char *b)
+{
+    while (*a && *a == *b)
+    {
+        ++a;
+        ++b;
+    }
+    return *a == *b;
+}
+
+/**
+ * @brief Check that keys are unique and ranges are ordered
+ * @return True if the schema is consistent
+ */
+constexpr bool isValid()
+{
+    for (std::size_t i = 0; i < std::size(SETTINGS_SCHEMA); ++i)
+    {
+        if (SETTINGS_SCHEMA[i].minimum > SETTINGS_SCHEMA[i].maximum)
+        {
+            return false;
+        }
+        for (std::size_t j = i + 1; j < std::size(SETTINGS_SCHEMA); ++j)
+        {
+            if (sameKey(SETTINGS_SCHEMA[i].key, SETTINGS_SCHEMA[j].key))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Check that an int default lies in its range; other types have none
+ * @return True if in range
+ */
+constexpr bool defaultInRange(int value, int minimum, int maximum)
+{
+    return minimum <= value && value <= maximum;
+}
+
+template <typename T>
+constexpr bool defaultInRange(const T &, int, int)
+{
+    return true;
+}
+} // namespace SettingsSchemaCheck
+
+static_assert(std::size(SETTINGS_SCHEMA) == static_cast<std::size_t>(Setting::Count), "Schema and Setting are out of step");
+static_assert(SettingsSchemaCheck::isValid(), "Settings schema has a duplicate key or an inverted range");
+
+#define HARPERTV_SETTING_CHECK(id, key, type, def, minimum, maximum, mpv, initOnly)                         \
+    static_assert(SettingsSchemaCheck::defaultInRange(def, minimum, maximum), "Default of " #id " out of range"); \
+    static_assert(!(initOnly) || (mpv), #id " is init-only but not an mpv option");
+HARPERTV_SETTINGS(HARPERTV_SETTING_CHECK)
+#undef HARPERTV_SETTING_CHECK
+
+#endif // SETTINGSSCHEMA_H
\ No newline at end of file
@@ -4,7 +4,1043 @@
 #include <QTranslator>
 #include <QLibraryInfo>
 #include <QLocale>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QTimer>
+#include <QEventLoop>
+#include <QSet>
+#include <QHash>
+#include <QEvent>
+#include <QDate>
+#include <QTemporaryDir>
+#include <QXmlStreamWriter>
+#include <QFileInfo>
+#include <QRandomGenerator>
+#include <QVector>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <functional>
 #include "ui/mainwindow.h"
+#include "core/usagetracker.h"
+#include "core/profilebenchmark.h"
+#include "core/cachetracebenchmark.h"
+#include "core/recordingbenchmark.h"
+#include "core/benchmarkserver.h"
+#include "core/streamproxy.h"
+#include "core/vodcache.h"
+#include "core/mediaplayer.h"
+#include "core/mpvconfig.h"
+#include "core/xmltvparser.h"
+#include "core/epgindex.h"
+#include "core/epgstore.h"
+#include "data/settings.h"
+
+/**
+ * @brief Replay a recorded zap log and report how well channel prediction works
+ * @param filePath Log with one channel key per line, optionally after a tab-separated timestamp
+ * @return Process exit code
+ */
+static int replayZapLog(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        qWarning() << "Could not open zap log:" << filePath;
+        return 1;
+    }
+
+    QStringList zapLog;
+    QTextStream in(&file);
+    while (!in.atEnd())
+    {
+        QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+        {
+            continue;
+        }
+        zapLog.append(line.section('\t', -1));
+    }
+
+    QTextStream out(stdout);
+    out << "Replaying " << zapLog.size() << " tunes from " << filePath << Qt::endl;
+
+    for (int limit : {1, 3, 5})
+    {
+        QElapsedTimer timer;
+        timer.start();
+        double hitRate = UsageTracker::replayHitRate(zapLog, limit);
+        out << "  top-" << limit << " hit rate: " << QString::number(hitRate * 100.0, 'f', 1) << "% ("
+            << timer.elapsed() << " ms)" << Qt::endl;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Check that options from an mpv config file survive the settings layer
+ *
+ * Settings left at their defaults must not replace the file's vo and hwdec;
+ * a setting the user changed must.
+ *
+ * @return Process exit code
+ */
+static int checkMpvConfig()
+{
+    QTextStream out(stdout);
+    int failures = 0;
+    auto expect = [&](const char *name, const QString &actual, const QString &expected)
+    {
+        bool ok = actual == expected;
+        failures += ok ? 0 : 1;
+        out << "  " << QString(name).leftJustified(32) << (ok ? "ok" : "FAILED") << " (" << actual << ", expected " << expected << ")" << Qt::endl;
+    };
+
+    out << "Resolving mpv options with vo=xv and hwdec=vaapi in the config file" << Qt::endl;
+
+    MpvConfig defaults;
+    defaults.loadData("vo=xv\nhwdec=vaapi\n");
+    defaults.addSettings(Settings::defaultMpvSettings());
+    QMap<QString, QString> options = defaults.resolve();
+    expect("vo with default settings", options.value("vo"), "xv");
+    expect("hwdec with default settings", options.value("hwdec"), "vaapi");
+    expect("cache-secs from settings", options.value("cache-secs"), "10");
+
+    QMap<QString, QVariant> changed = Settings::defaultMpvSettings();
+    changed.insert("hwdec", "no");
+    MpvConfig overridden;
+    overridden.loadData("vo=xv\nhwdec=vaapi\n");
+    overridden.addSettings(changed);
+    options = overridden.resolve();
+    expect("vo with hwdec changed", options.value("vo"), "xv");
+    expect("hwdec changed in settings", options.value("hwdec"), "no");
+
+    return failures == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Fetch a URL and wait for the whole response
+ * @param network Network access manager
+ * @param url URL to fetch
+ * @param range Range header value, empty for none
+ * @param status Set to the HTTP status, 0 without a response
+ * @return Response body
+ */
+static QByteArray fetchUrl(QNetworkAccessManager &network, const QString &url, const QByteArray &range, int *status)
+{
+    QNetworkRequest request{QUrl(url)};
+    request.setTransferTimeout(10000);
+    if (!range.isEmpty())
+    {
+        request.setRawHeader("Range", range);
+    }
+
+    QNetworkReply *reply = network.get(request);
+    QEventLoop loop;
+    QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
+    loop.exec();
+
+    *status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    QByteArray body = reply->readAll();
+    reply->deleteLater();
+    return body;
+}
+
+/**
+ * @brief Check that VOD ranges read through the proxy a second time come from the disk cache,
+ * and that resumes and ranges past the end are answered correctly
+ * @return Process exit code, 1 if any check failed
+ */
+static int checkVodCache()
+{
+    static const qint64 FILE_BYTES = 8 * 1024 * 1024;
+    static const QList<QPair<qint64, qint64>> RANGES = {
+        {0, 64 * 1024 - 1},
+        {1024 * 1024, 1536 * 1024 - 1},
+        {5 * 1024 * 1024, 6 * 1024 * 1024 - 1}};
+
+    QTextStream out(stdout);
+    int failures = 0;
+    auto expect = [&](const QString &name, bool ok, const QString &detail)
+    {
+        failures += ok ? 0 : 1;
+        out << "  " << name.leftJustified(40) << (ok ? "ok" : "FAILED") << " (" << detail << ")" << Qt::endl;
+    };
+
+    QTemporaryDir dir;
+    QByteArray file(FILE_BYTES, Qt::Uninitialized);
+    QRandomGenerator random(1);
+    random.fillRange(reinterpret_cast<quint32 *>(file.data()), file.size() / sizeof(quint32));
+
+    BenchmarkServer server;
+    server.setData("/clip.mp4", file, "video/mp4");
+    server.setData("/cold.mp4", file, "video/mp4");
+
+    VodCache cache;
+    StreamProxy proxy;
+    if (!dir.isValid() || !server.start() || !cache.open(dir.path()) || !proxy.start())
+    {
+        return 1;
+    }
+    cache.setQuota(4 * FILE_BYTES);
+    proxy.setDiskCache(&cache);
+
+    QNetworkAccessManager network;
+    const QString url = proxy.vodUrl(server.url("/clip.mp4"));
+    int status = 0;
+
+    out << "Reading " << RANGES.size() << " ranges of a " << FILE_BYTES / (1024 * 1024) << " MiB file twice through the VOD cache" << Qt::endl;
+    for (int pass = 1; pass <= 2; ++pass)
+    {
+        VodCache::Stats before = cache.stats();
+        int requestsBefore = server.requests();
+        qint64 rangeBytes = 0;
+        bool intact = true;
+        for (const auto &range : RANGES)
+        {
+            QByteArray body = fetchUrl(network, url, "bytes=" + QByteArray::number(range.first) + "-" + QByteArray::number(range.second), &status);
+            intact = intact && status == 206 && body == file.mid(range.first, range.second - range.first + 1);
+            rangeBytes += range.second - range.first + 1;
+        }
+
+        VodCache::Stats after = cache.stats();
+        qint64 fromCache = after.bytesFromCache - before.bytesFromCache;
+        qint64 fromNetwork = after.bytesFromNetwork - before.bytesFromNetwork;
+        expect(QString("pass %1 bytes intact").arg(pass), intact, QString("status %1").arg(status));
+        if (pass == 1)
+        {
+            expect("pass 1 from network", fromNetwork == rangeBytes, QString("%1 of %2 bytes").arg(fromNetwork).arg(rangeBytes));
+        }
+        else
+        {
+            expect("pass 2 from disk", fromCache == rangeBytes, QString("%1 of %2 bytes").arg(fromCache).arg(rangeBytes));
+            expect("pass 2 bytesFromNetwork unchanged", fromNetwork == 0, QString("%1 bytes").arg(fromNetwork));
+            expect("pass 2 upstream requests", server.requests() == requestsBefore, QString("%1").arg(server.requests() - requestsBefore));
+        }
+    }
+
+    // Crosses a gap, a cached range and another gap to the end
+    qint64 resume = 4 * 1024 * 1024 + 12345;
+    VodCache::Stats before = cache.stats();
+    QByteArray body = fetchUrl(network, url, "bytes=" + QByteArray::number(resume) + "-", &status);
+    VodCache::Stats after = cache.stats();
+    expect("resume from the middle", status == 206 && body == file.mid(resume),
+           QString("status %1, %2 of %3 bytes").arg(status).arg(body.size()).arg(FILE_BYTES - resume));
+    expect("resume reads the cached range from disk", after.bytesFromCache - before.bytesFromCache == RANGES.last().second - RANGES.last().first + 1,
+           QString("%1 bytes").arg(after.bytesFromCache - before.bytesFromCache));
+
+    // Once with the size known to the cache, once relayed from upstream
+    fetchUrl(network, url, "bytes=" + QByteArray::number(FILE_BYTES) + "-", &status);
+    expect("416 past the end of a cached file", status == 416, QString("status %1").arg(status));
+    fetchUrl(network, proxy.vodUrl(server.url("/cold.mp4")), "bytes=" + QByteArray::number(FILE_BYTES + 10) + "-", &status);
+    expect("416 past the end of an uncached file", status == 416, QString("status %1").arg(status));
+
+    return failures == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Zap A, B and back to A between two synthetic live HLS channels through the stream proxy
+ * and report the cache hit rate and bytes saved on each visit
+ * @return Process exit code, 1 if a request failed
+ */
+static int benchHlsZap()
+{
+    static const int WINDOW_SEGMENTS = 6;
+    static const int TUNE_IN_SEGMENTS = 3;
+    static const int DWELL_SEGMENTS = 2;
+    static const qint64 SEGMENT_BYTES = 200 * 1024;
+
+    // Live playlists in the proxy expire after half the one-second target duration
+    static const int PUBLISH_INTERVAL_MS = 600;
+
+    BenchmarkServer server;
+    StreamProxy proxy;
+    if (!server.start() || !proxy.start())
+    {
+        return 1;
+    }
+
+    // Index of the next segment each channel publishes; the window keeps the last few
+    QHash<QString, int> nextSegment;
+    auto publish = [&](const QString &channel)
+    {
+        int segment = nextSegment.value(channel);
+        server.setData(QString("/%1/seg%2.ts").arg(channel).arg(segment),
+                       QByteArray(SEGMENT_BYTES, char('a' + segment % 26)), "video/mp2t");
+        nextSegment.insert(channel, ++segment);
+
+        int first = qMax(0, segment - WINDOW_SEGMENTS);
+        QByteArray playlist = "#EXTM3U\n#EXT-X-VERSION:3\n#EXT-X-TARGETDURATION:1\n";
+        playlist += "#EXT-X-MEDIA-SEQUENCE:" + QByteArray::number(first) + "\n";
+        for (int i = first; i < segment; ++i)
+        {
+            playlist += "#EXTINF:1.000,\nseg" + QByteArray::number(i) + ".ts\n";
+        }
+        server.setData(QString("/%1/live.m3u8").arg(channel), playlist, "application/vnd.apple.mpegurl");
+    };
+
+    const QStringList channels = {"A", "B"};
+    for (const QString &channel : channels)
+    {
+        for (int i = 0; i < WINDOW_SEGMENTS; ++i)
+        {
+            publish(channel);
+        }
+    }
+
+    QNetworkAccessManager network;
+    int failures = 0;
+    auto fetch = [&](const QString &url)
+    {
+        int status = 0;
+        QByteArray body = fetchUrl(network, url, QByteArray(), &status);
+        failures += status == 200 ? 0 : 1;
+        return body;
+    };
+    auto segmentUrls = [](const QByteArray &playlist)
+    {
+        QStringList urls;
+        for (const QByteArray &line : playlist.split('\n'))
+        {
+            if (!line.trimmed().isEmpty() && !line.startsWith('#'))
+            {
+                urls.append(QString::fromUtf8(line.trimmed()));
+            }
+        }
+        return urls;
+    };
+
+    QTextStream out(stdout);
+    out << "Zapping A -> B -> A through the stream proxy, " << TUNE_IN_SEGMENTS << " segments at tune-in, "
+        << DWELL_SEGMENTS << " more while watching" << Qt::endl;
+    out << "Visit   Channel   requests   hits   hit %   KiB saved   KiB upstream" << Qt::endl;
+
+    const QStringList zaps = {"A", "B", "A"};
+    for (int visit = 0; visit < zaps.size(); ++visit)
+    {
+        const QString playlistUrl = proxy.proxyUrl(server.url(QString("/%1/live.m3u8").arg(zaps[visit])));
+        StreamProxy::Stats before = proxy.stats();
+
+        // Tune in a few segments from the live edge, as players do
+        QStringList urls = segmentUrls(fetch(playlistUrl));
+        for (const QString &url : urls.mid(qMax(0, urls.size() - TUNE_IN_SEGMENTS)))
+        {
+            fetch(url);
+        }
+
+        // Both channels keep publishing while this one is watched
+        for (int i = 0; i < DWELL_SEGMENTS; ++i)
+        {
+            QEventLoop wait;
+            QTimer::singleShot(PUBLISH_INTERVAL_MS, &wait, &QEventLoop::quit);
+            wait.exec();
+            for (const QString &channel : channels)
+            {
+                publish(channel);
+            }
+
+            urls = segmentUrls(fetch(playlistUrl));
+            if (!urls.isEmpty())
+            {
+                fetch(urls.last());
+            }
+        }
+
+        StreamProxy::Stats after = proxy.stats();
+        StreamProxy::Stats delta;
+        delta.requests = after.requests - before.requests;
+        delta.hits = after.hits - before.hits;
+        out << QString::number(visit + 1).rightJustified(5) << "   "
+            << zaps[visit].rightJustified(7) << "   "
+            << QString::number(delta.requests).rightJustified(8) << "   "
+            << QString::number(delta.hits).rightJustified(4) << "   "
+            << QString::number(delta.hitRate() * 100, 'f', 1).rightJustified(5) << "   "
+            << QString::number((after.bytesFromCache - before.bytesFromCache) / 1024).rightJustified(9) << "   "
+            << QString::number((after.bytesFromUpstream - before.bytesFromUpstream) / 1024).rightJustified(12) << Qt::endl;
+    }
+
+    StreamProxy::Stats total = proxy.stats();
+    out << "Total: " << total.hits << " of " << total.requests << " requests from cache ("
+        << QString::number(total.hitRate() * 100, 'f', 1) << "%), " << total.bytesFromCache / 1024 << " KiB saved, "
+        << total.bytesFromUpstream / 1024 << " KiB fetched" << Qt::endl;
+
+    if (failures > 0)
+    {
+        out << failures << " requests failed" << Qt::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Time reading a setting through the typed accessor and through its string key,
+ * and count the mpv property writes a single settings edit causes
+ * @return Process exit code
+ */
+static int benchSettings()
+{
+    static const int ITERATIONS = 10000000;
+
+    Settings settings;
+    const QMap<QString, QVariant> stringMap = settings.allMpvSettings();
+    volatile int sink = 0;
+
+    QTextStream out(stdout);
+    out << "Reading cache-secs " << ITERATIONS << " times" << Qt::endl;
+
+    auto report = [&out](const char *name, qint64 nsecs)
+    {
+        out << "  " << QString(name).leftJustified(24)
+            << QString::number(double(nsecs) / ITERATIONS, 'f', 2).rightJustified(8) << " ns/read" << Qt::endl;
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < ITERATIONS; ++i)
+    {
+        sink = settings.get<Setting::CacheSecs>();
+    }
+    report("get<Setting::CacheSecs>", timer.nsecsElapsed());
+
+    timer.restart();
+    for (int i = 0; i < ITERATIONS; ++i)
+    {
+        sink = settings.mpvValue("cache-secs").toInt();
+    }
+    report("mpvValue(\"cache-secs\")", timer.nsecsElapsed());
+
+    // How every read worked before the schema
+    timer.restart();
+    for (int i = 0; i < ITERATIONS; ++i)
+    {
+        sink = stringMap.value("cache-secs").toInt();
+    }
+    report("QMap<QString, QVariant>", timer.nsecsElapsed());
+
+    // What one edit in the settings dialog costs the running core
+    MediaPlayer player(&settings);
+    if (!player.initialize())
+    {
+        return 1;
+    }
+
+    auto settle = []()
+    {
+        // Change signals are queued; let them and the player's reaction run
+        QEventLoop loop;
+        QTimer::singleShot(50, &loop, &QEventLoop::quit);
+        loop.exec();
+    };
+    settle();
+
+    out << "mpv property writes per settings edit" << Qt::endl;
+    auto measure = [&](const char *name, auto edit)
+    {
+        quint64 before = player.mpvCore()->propertyWriteCount();
+        edit();
+        settle();
+        out << "  " << QString(name).leftJustified(24)
+            << QString::number(player.mpvCore()->propertyWriteCount() - before).rightJustified(8) << " writes" << Qt::endl;
+    };
+
+    // Each edit is undone again, so the stored settings end up as they were
+    const int cacheSecs = settings.get<Setting::CacheSecs>();
+    const int networkTimeout = settings.get<Setting::NetworkTimeout>();
+    const bool keepAspect = settings.get<Setting::KeepAspect>();
+    const int hlsCacheMB = settings.get<Setting::HlsCacheMB>();
+    const int volume = settings.get<Setting::Volume>();
+
+    measure("cache-secs", [&]()
+            { settings.set<Setting::CacheSecs>(cacheSecs == 1 ? 2 : cacheSecs - 1); });
+    measure("cache-secs back", [&]()
+            { settings.set<Setting::CacheSecs>(cacheSecs); });
+    measure("network-timeout", [&]()
+            { settings.set<Setting::NetworkTimeout>(networkTimeout == 1 ? 2 : networkTimeout - 1); });
+    measure("network-timeout back", [&]()
+            { settings.set<Setting::NetworkTimeout>(networkTimeout); });
+    measure("keepaspect", [&]()
+            { settings.set<Setting::KeepAspect>(!keepAspect); });
+    measure("keepaspect back", [&]()
+            { settings.set<Setting::KeepAspect>(keepAspect); });
+    measure("hlsCacheMB (not mpv)", [&]()
+            { settings.set<Setting::HlsCacheMB>(hlsCacheMB == 8 ? 16 : hlsCacheMB - 8); });
+    measure("hlsCacheMB back", [&]()
+            { settings.set<Setting::HlsCacheMB>(hlsCacheMB); });
+    measure("volume (not mpv)", [&]()
+            { settings.set<Setting::Volume>(volume == 0 ? 1 : volume - 1); });
+    measure("volume back", [&]()
+            { settings.set<Setting::Volume>(volume); });
+
+    return 0;
+}
+
+/**
+ * @brief Parse a generated XMLTV guide and report parse time and peak memory,
+ * then time opening its store and now/next lookups in it
+ * @param size Guide size as "<channels>x<days>", e.g. "500x14"
+ * @return Process exit code
+ */
+static int benchEpg(const QString &size)
+{
+    static const int SLOT_MINUTES = 30;
+    static const int TITLES = 200;
+
+    const QStringList parts = size.toLower().split('x');
+    bool channelsOk = false;
+    bool daysOk = false;
+    const int channels = parts.size() == 2 ? parts[0].toInt(&channelsOk) : 0;
+    const int days = parts.size() == 2 ? parts[1].toInt(&daysOk) : 0;
+    if (!channelsOk || !daysOk || channels <= 0 || days <= 0)
+    {
+        qWarning() << "Expected the guide size as <channels>x<days>, e.g. 500x14:" << size;
+        return 1;
+    }
+
+    QTemporaryDir dir;
+    if (!dir.isValid())
+    {
+        qWarning() << "Could not create a directory for the generated guide";
+        return 1;
+    }
+
+    QTextStream out(stdout);
+    QElapsedTimer timer;
+
+    // Every channel gets the same slot times, so they are formatted once
+    const int slotsPerDay = 24 * 60 / SLOT_MINUTES;
+    QStringList slotTimes;
+    for (int day = 0; day < days; ++day)
+    {
+        const QString date = QDate(2026, 1, 1).addDays(day).toString("yyyyMMdd");
+        for (int slot = 0; slot < slotsPerDay; ++slot)
+        {
+            int minutes = slot * SLOT_MINUTES;
+            slotTimes.append(QString("%1%2%300 +0000").arg(date).arg(minutes / 60, 2, 10, QChar('0')).arg(minutes % 60, 2, 10, QChar('0')));
+        }
+    }
+    slotTimes.append(QDate(2026, 1, 1).addDays(days).toString("yyyyMMdd") + "000000 +0000");
+
+    timer.start();
+    const QString guidePath = dir.filePath("guide.xml");
+    QFile file(guidePath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Could not write the generated guide:" << guidePath;
+        return 1;
+    }
+
+    // Written as it is generated, so the generator does not add to the peak
+    QXmlStreamWriter writer(&file);
+    writer.writeStartDocument();
+    writer.writeStartElement("tv");
+    for (int channel = 0; channel < channels; ++channel)
+    {
+        writer.writeStartElement("channel");
+        writer.writeAttribute("id", QString("ch%1").arg(channel));
+        writer.writeTextElement("display-name", QString("Channel %1").arg(channel));
+        writer.writeEndElement();
+    }
+    for (int channel = 0; channel < channels; ++channel)
+    {
+        const QString channelId = QString("ch%1").arg(channel);
+        for (int slot = 0; slot + 1 < slotTimes.size(); ++slot)
+        {
+            writer.writeStartElement("programme");
+            writer.writeAttribute("start", slotTimes[slot]);
+            writer.writeAttribute("stop", slotTimes[slot + 1]);
+            writer.writeAttribute("channel", channelId);
+            writer.writeTextElement("title", QString("Programme %1").arg((channel + slot) % TITLES));
+            writer.writeTextElement("desc", QString("Episode %1 of programme %2, first shown on channel %3.").arg(slot).arg((channel + slot) % TITLES).arg(channel));
+            writer.writeEndElement();
+        }
+    }
+    writer.writeEndElement();
+    writer.writeEndDocument();
+    file.close();
+
+    const int programmes = channels * (slotTimes.size() - 1);
+    out << "Generated " << channels << " channels x " << days << " days, " << programmes << " programmes, "
+        << file.size() / (1024 * 1024) << " MiB in " << timer.elapsed() << " ms" << Qt::endl;
+
+    auto report = [&out](const char *name, const QString &value)
+    {
+        out << "  " << QString(name).leftJustified(24) << value.rightJustified(12) << Qt::endl;
+    };
+    auto mib = [](qint64 bytes)
+    {
+        return QString::number(double(bytes) / (1024 * 1024), 'f', 1) + " MiB";
+    };
+
+    // The same steps as a guide load, up to the store
+    const qint64 peakBefore = ProfileBenchmark::peakMemoryBytes();
+    EPGIndex index;
+    XMLTVParser parser;
+    timer.restart();
+    try
+    {
+        parser.parseFile(guidePath, [&index](const QString &channelId, const ProgrammeData &programme)
+                         { index.addProgramme(channelId, programme); });
+    }
+    catch (const QString &error)
+    {
+        qWarning() << "Could not parse the generated guide:" << error;
+        return 1;
+    }
+    const qint64 parseMs = timer.restart();
+    index.finalize();
+    const qint64 finalizeMs = timer.elapsed();
+    const qint64 peakAfter = ProfileBenchmark::peakMemoryBytes();
+
+    report("parse", QString::number(parseMs) + " ms");
+    report("finalize", QString::number(finalizeMs) + " ms");
+    report("peak RSS before parse", mib(peakBefore));
+    report("peak RSS after parse", mib(peakAfter));
+    report("growth per programme", QString::number(double(peakAfter - peakBefore) / programmes, 'f', 0) + " B");
+
+    // What later starts see: the written store mapped and queried for now and next
+    const QString storePath = dir.filePath("guide.epg");
+    timer.restart();
+    if (!EPGStore::write(index, storePath, 0))
+    {
+        qWarning() << "Could not write the programme guide store:" << storePath;
+        return 1;
+    }
+    report("store write", QString::number(timer.elapsed()) + " ms");
+
+    EPGStore store;
+    timer.restart();
+    if (!store.open(storePath))
+    {
+        qWarning() << "Could not open the programme guide store:" << storePath;
+        return 1;
+    }
+    report("store open", QString::number(timer.nsecsElapsed() / 1000) + " us");
+    report("store size", mib(QFileInfo(storePath).size()));
+
+    // Channels and times are drawn up front so the loop only times the lookups
+    static const int LOOKUPS = 100000;
+    const qint64 guideStart = XMLTVParser::parseTime(slotTimes.first());
+    QRandomGenerator random(1);
+    QStringList channelIds;
+    QVector<qint64> times;
+    channelIds.reserve(LOOKUPS);
+    times.reserve(LOOKUPS);
+    for (int i = 0; i < LOOKUPS; ++i)
+    {
+        channelIds.append(QString("ch%1").arg(random.bounded(channels)));
+        times.append(guideStart + random.bounded(static_cast<quint32>(days) * 24 * 3600));
+    }
+
+    int found = 0;
+    ProgrammeData now;
+    ProgrammeData next;
+    timer.restart();
+    for (int i = 0; i < LOOKUPS; ++i)
+    {
+        found += store.programmeAt(channelIds[i], times[i], &now) ? 1 : 0;
+        found += store.nextProgramme(channelIds[i], times[i], &next) ? 1 : 0;
+    }
+    report("now/next lookup", QString::number(double(timer.nsecsElapsed()) / LOOKUPS / 1000, 'f', 2) + " us");
+    report("programmes found", QString("%1 of %2").arg(found).arg(2 * LOOKUPS));
+
+    return 0;
+}
+
+/**
+ * @brief Play a synthetic clip under each performance profile and report how it ran
+ * @param app Application, run until the benchmark is done
+ * @param mainWindow Initialized main window whose player and renderer are measured
+ * @param clip Clip to play, empty for the built-in test pattern
+ * @return Process exit code
+ */
+static int benchProfiles(QApplication &app, MainWindow &mainWindow, const QString &clip)
+{
+    ProfileBenchmark benchmark(mainWindow.mediaPlayer());
+    if (!clip.isEmpty())
+    {
+        benchmark.setClip(clip);
+    }
+
+    QObject::connect(&benchmark, &ProfileBenchmark::finished, &app, [&benchmark, &app]()
+                     {
+        QTextStream out(stdout);
+        out << "Profile         CPU %   dropped (vo/dec)   startup ms   stalled ms" << Qt::endl;
+        for (const ProfileBenchmark::Result &result : benchmark.results())
+        {
+            out << result.profile.leftJustified(16)
+                << QString::number(result.cpuPercent, 'f', 1).rightJustified(5) << "   "
+                << QString("%1/%2").arg(result.droppedFrames).arg(result.decoderDroppedFrames).rightJustified(16) << "   "
+                << QString::number(result.startupMs).rightJustified(10) << "   "
+                << QString::number(result.rebufferMs).rightJustified(10) << Qt::endl;
+        }
+        app.quit(); });
+
+    benchmark.start(MpvConfig::performanceProfiles());
+    return app.exec();
+}
+
+/**
+ * @brief Replay a throughput trace through a throttled local server, with and without the adaptive cache
+ * @param app Application, run until the benchmark is done
+ * @param mainWindow Initialized main window whose player is measured
+ * @param tracePath Trace with one "<seconds> <kbit/s>" step per line
+ * @param clip Local media file the server sends
+ * @return Process exit code
+ */
+static int benchCacheTrace(QApplication &app, MainWindow &mainWindow, const QString &tracePath, const QString &clip)
+{
+    CacheTraceBenchmark benchmark(mainWindow.mediaPlayer());
+    benchmark.setClip(clip);
+    if (!benchmark.loadTrace(tracePath))
+    {
+        return 1;
+    }
+
+    QObject::connect(&benchmark, &CacheTraceBenchmark::finished, &app, [&benchmark, &app]()
+                     {
+        QTextStream out(stdout);
+        out << "Cache      startup ms   stalls   stalled ms   sent MiB   readahead s" << Qt::endl;
+        for (const CacheTraceBenchmark::Result &result : benchmark.results())
+        {
+            out << result.mode.leftJustified(9)
+                << QString::number(result.startupMs).rightJustified(12) << "   "
+                << QString::number(result.stalls).rightJustified(6) << "   "
+                << QString::number(result.stalledMs).rightJustified(10) << "   "
+                << QString::number(double(result.bytesSent) / (1024 * 1024), 'f', 1).rightJustified(8) << "   "
+                << QString::number(result.finalCacheSecs).rightJustified(11) << Qt::endl;
+        }
+        app.quit(); });
+
+    if (!benchmark.start())
+    {
+        return 1;
+    }
+    return app.exec();
+}
+
+/**
+ * @brief Record a stream with one, two and four background recorders and report the CPU each costs
+ * @param app Application, run until the benchmark is done
+ * @param url Stream to record
+ * @return Process exit code
+ */
+static int benchRecording(QApplication &app, const QString &url)
+{
+    RecordingBenchmark benchmark(url);
+
+    QObject::connect(&benchmark, &RecordingBenchmark::finished, &app, [&benchmark, &app]()
+                     {
+        QTextStream out(stdout);
+        out << "Recordings   CPU %   CPU % each   KiB/s each" << Qt::endl;
+        for (const RecordingBenchmark::Result &result : benchmark.results())
+        {
+            out << QString::number(result.recordings).rightJustified(10) << "   "
+                << QString::number(result.cpuPercent, 'f', 1).rightJustified(5) << "   "
+                << (result.recordings > 0 ? QString::number(result.cpuPercentPerRecording, 'f', 2) : QString("-")).rightJustified(10) << "   "
+                << (result.recordings > 0 ? QString::number(result.bytesPerSecond / 1024) : QString("-")).rightJustified(10) << Qt::endl;
+        }
+        app.quit(); });
+
+    if (!benchmark.start())
+    {
+        return 1;
+    }
+    return app.exec();
+}
+
+/**
+ * @brief Fire a burst of rapid skips at a playing clip and count the seeks that reach mpv
+ * @param app Application, run until the benchmark is done
+ * @param mainWindow Initialized main window whose player is driven
+ * @param clip Clip to play, empty for a generated hour-long test pattern
+ * @return Process exit code, 1 if the skips were not coalesced
+ */
+static int benchSeekQueue(QApplication &app, MainWindow &mainWindow, const QString &clip)
+{
+    static const int SKIPS = 100;
+    static const int SKIP_INTERVAL_MS = 5;
+    static const double SKIP_SECS = 10.0;
+    static const int SETTLE_MS = 2000;
+    static const int MAX_SEEKS = 10;
+
+    MediaPlayer *player = mainWindow.mediaPlayer();
+    MPVCore *core = player->mpvCore();
+    PlaybackController *controller = player->playbackController();
+
+    // Every async command this controller sends is a seek, and each gets exactly one reply
+    QSet<quint64> seeks;
+    QObject::connect(core, &MPVCore::commandReply, &app, [&seeks](quint64 requestId, int)
+                     {
+        if (requestId != 0)
+        {
+            seeks.insert(requestId);
+        } });
+
+    int skipsSent = 0;
+    double startPosition = 0.0;
+    QTimer skipTimer;
+    skipTimer.setInterval(SKIP_INTERVAL_MS);
+    QTimer settleTimer;
+    settleTimer.setSingleShot(true);
+    settleTimer.setInterval(SETTLE_MS);
+
+    QObject::connect(&skipTimer, &QTimer::timeout, &app, [&]()
+                     {
+        controller->seekForward(SKIP_SECS);
+        if (++skipsSent == SKIPS)
+        {
+            skipTimer.stop();
+            settleTimer.start();
+        } });
+
+    int exitCode = 0;
+    QObject::connect(&settleTimer, &QTimer::timeout, &app, [&]()
+                     {
+        // Wait for the last coalesced seek to come back
+        if (controller->state() == PlaybackController::State::Seeking)
+        {
+            settleTimer.start();
+            return;
+        }
+
+        QTextStream out(stdout);
+        out << SKIPS << " skips of " << SKIP_SECS << " s every " << SKIP_INTERVAL_MS << " ms -> " << seeks.size()
+            << " mpv seeks; moved " << QString::number(controller->position() - startPosition, 'f', 1) << " s of "
+            << SKIPS * SKIP_SECS << " s (limit " << MAX_SEEKS << " seeks)" << Qt::endl;
+        exitCode = seeks.size() <= MAX_SEEKS ? 0 : 1;
+        app.quit(); });
+
+    bool burstScheduled = false;
+    QObject::connect(core, &MPVCore::fileLoaded, &app, [&]()
+                     {
+        if (burstScheduled)
+        {
+            return;
+        }
+        burstScheduled = true;
+
+        // Once the first frame is up, so the burst meets a playing file
+        QTimer::singleShot(1000, &app, [&]()
+                           {
+            startPosition = controller->position();
+            seeks.clear();
+            skipTimer.start(); }); });
+
+    player->loadMedia(clip.isEmpty() ? QString("av://lavfi:testsrc2=size=1280x720:rate=30:duration=3600") : clip);
+    app.exec();
+    return exitCode;
+}
+
+/**
+ * @brief Drag the same scrub across a local clip with the keyframe index off and on,
+ * and report the seeks sent to mpv and how long the final position takes to show
+ * @param app Application, used as the context of the signal connections
+ * @param mainWindow Initialized main window whose player is driven
+ * @param clip Local MP4 or Matroska file the indexer can read
+ * @return Process exit code, 1 if the clip could not be played or indexed
+ */
+static int benchScrub(QApplication &app, MainWindow &mainWindow, const QString &clip)
+{
+    static const int STEPS = 200;
+    static const int STEP_INTERVAL_MS = 10;
+    static const int POLL_MS = 1;
+    static const int LOAD_TIMEOUT_MS = 30000;
+    static const int SETTLE_TIMEOUT_MS = 10000;
+
+    if (clip.isEmpty() || !QFileInfo(clip).isFile())
+    {
+        qWarning() << "--bench-scrub needs a local MP4 or Matroska file in --bench-clip";
+        return 1;
+    }
+
+    MediaPlayer *player = mainWindow.mediaPlayer();
+    MPVCore *core = player->mpvCore();
+    PlaybackController *controller = player->playbackController();
+    KeyframeIndexer *indexer = player->keyframeIndexer();
+
+    // Every async command this controller sends is a seek, and each gets exactly one reply
+    QSet<quint64> seeks;
+    QObject::connect(core, &MPVCore::commandReply, &app, [&seeks](quint64 requestId, int)
+                     {
+        if (requestId != 0)
+        {
+            seeks.insert(requestId);
+        } });
+
+    bool loaded = false;
+    QObject::connect(core, &MPVCore::fileLoaded, &app, [&loaded]()
+                     { loaded = true; });
+
+    auto waitFor = [](const std::function<bool()> &done, int timeoutMs)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        while (!done() && timer.elapsed() < timeoutMs)
+        {
+            QEventLoop wait;
+            QTimer::singleShot(POLL_MS, &wait, &QEventLoop::quit);
+            wait.exec();
+        }
+        return done();
+    };
+    auto settled = [controller]()
+    { return controller->state() != PlaybackController::State::Seeking; };
+
+    player->loadMedia(clip);
+    if (!waitFor([&]()
+                 { return loaded && indexer->isReady() && controller->duration() > 0; },
+                 LOAD_TIMEOUT_MS))
+    {
+        qWarning() << "Clip did not load or could not be indexed:" << clip;
+        return 1;
+    }
+
+    // A slow drag across the middle of the clip, one slider step at a time
+    const double from = controller->duration() * 0.2;
+    const double to = controller->duration() * 0.6;
+    QVector<double> targets;
+    for (int i = 0; i < STEPS; ++i)
+    {
+        targets.append(from + (to - from) * i / (STEPS - 1));
+    }
+
+    QTextStream out(stdout);
+    out << STEPS << " scrub steps every " << STEP_INTERVAL_MS << " ms from " << QString::number(from, 'f', 1) << " s to "
+        << QString::number(to, 'f', 1) << " s, " << indexer->keyframeCount() << " keyframes in the index" << Qt::endl;
+    out << "Index   mpv seeks   drag ms   settle ms" << Qt::endl;
+
+    for (bool indexed : {false, true})
+    {
+        controller->setKeyframeIndexer(indexed ? indexer : nullptr);
+        controller->setPosition(targets.first());
+        waitFor(settled, SETTLE_TIMEOUT_MS);
+        seeks.clear();
+
+        QElapsedTimer drag;
+        drag.start();
+        for (double target : std::as_const(targets))
+        {
+            controller->scrubTo(target);
+            QEventLoop wait;
+            QTimer::singleShot(STEP_INTERVAL_MS, &wait, &QEventLoop::quit);
+            wait.exec();
+        }
+        qint64 dragMs = drag.elapsed();
+
+        // Released where the drag ended; the frame shows once the exact seek lands
+        QElapsedTimer settle;
+        settle.start();
+        controller->endScrub(targets.last());
+        waitFor(settled, SETTLE_TIMEOUT_MS);
+
+        out << QString(indexed ? "on" : "off").leftJustified(5) << "   "
+            << QString::number(seeks.size()).rightJustified(9) << "   "
+            << QString::number(dragMs).rightJustified(7) << "   "
+            << QString::number(settle.elapsed()).rightJustified(9) << Qt::endl;
+    }
+
+    controller->setKeyframeIndexer(indexer);
+    return 0;
+}
+
+/**
+ * @brief Counts the paint events of a widget tree
+ */
+class PaintCounter : public QObject
+{
+public:
+    QHash<QString, int> paints;
+
+    bool eventFilter(QObject *watched, QEvent *event) override
+    {
+        if (event->type() == QEvent::Paint)
+        {
+            QString name = watched->objectName().isEmpty() ? QString(watched->metaObject()->className()) : watched->objectName();
+            ++paints[name];
+        }
+        return false;
+    }
+};
+
+/**
+ * @brief Play a clip and count how often the player controls are repainted per second
+ * @param app Application, run until the benchmark is done
+ * @param mainWindow Initialized main window whose controls are measured
+ * @param clip Clip to play, empty for a generated 60 fps test pattern
+ * @return Process exit code
+ */
+static int benchControls(QApplication &app, MainWindow &mainWindow, const QString &clip)
+{
+    static const int DURATION_MS = 10000;
+
+    PlayerControls *controls = mainWindow.playerControls();
+    PaintCounter counter;
+    controls->installEventFilter(&counter);
+    const QList<QWidget *> children = controls->findChildren<QWidget *>();
+    for (QWidget *child : children)
+    {
+        child->installEventFilter(&counter);
+    }
+
+    // What arrives from mpv, before any throttling
+    int positionUpdates = 0;
+    QObject::connect(mainWindow.mediaPlayer()->playbackController(), &PlaybackController::positionChanged, &app,
+                     [&positionUpdates](double)
+                     { ++positionUpdates; });
+
+    QObject::connect(mainWindow.mediaPlayer()->mpvCore(), &MPVCore::fileLoaded, &app, [&]()
+                     {
+        // Start counting with the file playing
+        counter.paints.clear();
+        positionUpdates = 0;
+        QTimer::singleShot(DURATION_MS, &app, [&]()
+                           {
+            const double seconds = DURATION_MS / 1000.0;
+            int total = 0;
+            QTextStream out(stdout);
+            out << "Position updates: " << QString::number(positionUpdates / seconds, 'f', 1) << "/s" << Qt::endl;
+            for (auto it = counter.paints.constBegin(); it != counter.paints.constEnd(); ++it)
+            {
+                out << "  " << it.key().leftJustified(24) << QString::number(it.value() / seconds, 'f', 1).rightJustified(7)
+                    << " paints/s" << Qt::endl;
+                total += it.value();
+            }
+            out << "  " << QString("total").leftJustified(24) << QString::number(total / seconds, 'f', 1).rightJustified(7)
+                << " paints/s" << Qt::endl;
+            app.quit(); }); }, Qt::SingleShotConnection);
+
+    mainWindow.mediaPlayer()->loadMedia(clip.isEmpty() ? QString("av://lavfi:testsrc2=size=1280x720:rate=60") : clip);
+    return app.exec();
+}
+
+/**
+ * @brief Time drawing the stats overlay and compare it to its per-frame budget
+ * @param app Application, run until the measurement is done
+ * @param mainWindow Initialized main window whose video widget is measured
+ * @return Process exit code, 1 if the overlay is over budget
+ */
+static int benchOverlay(QApplication &app, MainWindow &mainWindow)
+{
+    static const int FRAMES = 600;
+    static const double BUDGET_MS = 0.2;
+
+    VideoWidget *videoWidget = mainWindow.videoWidget();
+    int exitCode = 0;
+
+    QObject::connect(videoWidget, &VideoWidget::overlayMeasured, &app, [&app, &exitCode](double meanMs, double maxMs)
+                     {
+        QTextStream out(stdout);
+        out << "Stats overlay over " << FRAMES << " frames: mean " << QString::number(meanMs, 'f', 3)
+            << " ms, max " << QString::number(maxMs, 'f', 3) << " ms (budget " << BUDGET_MS << " ms)" << Qt::endl;
+        exitCode = meanMs <= BUDGET_MS ? 0 : 1;
+        app.quit(); });
+
+    videoWidget->setStatsVisible(true);
+    videoWidget->measureOverlay(FRAMES);
+    app.exec();
+    return exitCode;
+}
 
 int main(int argc, char *argv[])
 {
@@ -17,6 +1053,76 @@ int main(int argc, char *argv[])
     // Create application
     QApplication app(argc, argv);
 
+    // Parse command line
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption replayOption("replay-zap-log", "Replay a zap log and report channel prediction hit rates.", "file");
+    parser.addOption(replayOption);
+    QCommandLineOption benchOption("bench-profiles", "Play a synthetic clip under each performance profile and report CPU, dropped frames and latency.");
+    parser.addOption(benchOption);
+    QCommandLineOption benchSettingsOption("bench-settings", "Time typed and string-keyed settings reads and count mpv property writes per settings edit.");
+    parser.addOption(benchSettingsOption);
+    QCommandLineOption benchEpgOption("bench-epg", "Parse a generated XMLTV guide of <channels>x<days>, report parse time and peak memory, and time store opens and now/next lookups.", "size");
+    parser.addOption(benchEpgOption);
+    QCommandLineOption checkMpvConfigOption("check-mpv-config", "Check that mpv config file options survive settings left at their defaults.");
+    parser.addOption(checkMpvConfigOption);
+    QCommandLineOption checkVodCacheOption("check-vod-cache", "Read file ranges twice through the VOD disk cache and check the second pass, a resume and a 416 are served correctly.");
+    parser.addOption(checkVodCacheOption);
+    QCommandLineOption benchHlsZapOption("bench-hls-zap", "Zap between two synthetic live HLS channels through the stream proxy and report its hit rate and bytes saved.");
+    parser.addOption(benchHlsZapOption);
+    QCommandLineOption benchOverlayOption("bench-overlay", "Time drawing the playback stats overlay, GPU work included.");
+    parser.addOption(benchOverlayOption);
+    QCommandLineOption benchCacheTraceOption("bench-cache-trace", "Replay a throughput trace through a throttled local server, with fixed and adaptive cache sizing.", "trace");
+    parser.addOption(benchCacheTraceOption);
+    QCommandLineOption benchRecordingOption("bench-recording", "Record a stream with 1, 2 and 4 background recorders and report the CPU each costs.", "url");
+    parser.addOption(benchRecordingOption);
+    QCommandLineOption benchSeekQueueOption("bench-seek-queue", "Fire 100 rapid skips at a playing clip and count the seeks sent to mpv.");
+    parser.addOption(benchSeekQueueOption);
+    QCommandLineOption benchScrubOption("bench-scrub", "Drag the same scrub across a local clip with the keyframe index off and on, and count the seeks sent to mpv.");
+    parser.addOption(benchScrubOption);
+    QCommandLineOption benchControlsOption("bench-controls", "Play a clip and count player control repaints per second.");
+    parser.addOption(benchControlsOption);
+    QCommandLineOption benchClipOption("bench-clip", "Clip played by the benchmarks; required by --bench-cache-trace and --bench-scrub.", "file");
+    parser.addOption(benchClipOption);
+    parser.process(app);
+
+    if (parser.isSet(replayOption))
+    {
+        return replayZapLog(parser.value(replayOption));
+    }
+
+    if (parser.isSet(benchSettingsOption))
+    {
+        return benchSettings();
+    }
+
+    if (parser.isSet(benchEpgOption))
+    {
+        return benchEpg(parser.value(benchEpgOption));
+    }
+
+    if (parser.isSet(checkMpvConfigOption))
+    {
+        return checkMpvConfig();
+    }
+
+    if (parser.isSet(checkVodCacheOption))
+    {
+        return checkVodCache();
+    }
+
+    if (parser.isSet(benchHlsZapOption))
+    {
+        return benchHlsZap();
+    }
+
+    if (parser.isSet(benchRecordingOption))
+    {
+        return benchRecording(app, parser.value(benchRecordingOption));
+    }
+
     // Load translations
     QTranslator qtTranslator;
     if (qtTranslator.load(QLocale::system(), "qt", "_",
@@ -56,6 +1162,36 @@ int main(int argc, char *argv[])
     // Show main window
     mainWindow.show();
 
+    if (parser.isSet(benchOption))
+    {
+        return benchProfiles(app, mainWindow, parser.value(benchClipOption));
+    }
+
+    if (parser.isSet(benchSeekQueueOption))
+    {
+        return benchSeekQueue(app, mainWindow, parser.value(benchClipOption));
+    }
+
+    if (parser.isSet(benchScrubOption))
+    {
+        return benchScrub(app, mainWindow, parser.value(benchClipOption));
+    }
+
+    if (parser.isSet(benchControlsOption))
+    {
+        return benchControls(app, mainWindow, parser.value(benchClipOption));
+    }
+
+    if (parser.isSet(benchCacheTraceOption))
+    {
+        return benchCacheTrace(app, mainWindow, parser.value(benchCacheTraceOption), parser.value(benchClipOption));
+    }
+
+    if (parser.isSet(benchOverlayOption))
+    {
+        return benchOverlay(app, mainWindow);
+    }
+
     // Run application
     return app.exec();
 }
\ No newline at end of file
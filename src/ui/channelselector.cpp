@@ -1,12 +1,50 @@
 #include "channelselector.h"
 #include <QDebug>
+#include <QAbstractItemView>
+#include <QIcon>
+#include <QVector>
+#include <numeric>
+#include <algorithm>
+
+ChannelSelector::LogoDelegate::LogoDelegate(LogoCache *logoCache, QObject *parent)
+    : QStyledItemDelegate(parent), m_logoCache(logoCache)
+{
+}
+
+void ChannelSelector::LogoDelegate::initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const
+{
+    QStyledItemDelegate::initStyleOption(option, index);
+
+    QString url = index.data(LogoUrlRole).toString();
+    if (url.isEmpty())
+    {
+        return;
+    }
+
+    // Reserve the logo space up front so rows do not jump when logos arrive
+    option->features |= QStyleOptionViewItem::HasDecoration;
+    option->decorationSize = m_logoCache->logoSize();
+
+    // Only rows that are actually painted ever trigger a fetch
+    QPixmap logo = m_logoCache->logo(url);
+    if (!logo.isNull())
+    {
+        option->icon = QIcon(logo);
+    }
+}
 
 ChannelSelector::ChannelSelector(ChannelManager *channelManager, QWidget *parent)
-    : QComboBox(parent), m_channelManager(channelManager)
+    : QComboBox(parent), m_channelManager(channelManager), m_logoCache(new LogoCache(this)), m_usageTracker(nullptr), m_logoRow(-1), m_sortByUsage(false)
 {
     // Set properties
     setToolTip(tr("Select Channel"));
     setMinimumWidth(200);
+    setIconSize(QSize(24, 24));
+
+    // Set up logo loading
+    m_logoCache->setLogoSize(iconSize());
+    setItemDelegate(new LogoDelegate(m_logoCache, this));
+    connect(m_logoCache, &LogoCache::logoReady, this, &ChannelSelector::onLogoReady);
 
     // Connect signals
     connect(this, QOverload<int>::of(&QComboBox::currentIndexChanged),
@@ -18,6 +56,21 @@ ChannelSelector::ChannelSelector(ChannelManager *channelManager, QWidget *parent
     connect(m_channelManager, &ChannelManager::currentChannelChanged,
             this, &ChannelSelector::onCurrentChannelChanged);
 
+    connect(m_channelManager, &ChannelManager::channelInserted,
+            this, &ChannelSelector::onChannelInserted);
+
+    connect(m_channelManager, &ChannelManager::channelRemoved,
+            this, &ChannelSelector::onChannelRemoved);
+
+    connect(m_channelManager, &ChannelManager::channelUpdated,
+            this, &ChannelSelector::onChannelUpdated);
+
+    connect(m_channelManager, &ChannelManager::channelsMerged,
+            this, &ChannelSelector::onChannelsMerged);
+
+    connect(this, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &ChannelSelector::updateCurrentLogo);
+
     // Initialize channel list
     updateChannelList();
 }
@@ -32,21 +85,57 @@ void ChannelSelector::updateChannelList()
     blockSignals(true);
     clear();
 
+    m_logoRow = -1;
+
     // Add channels
     QList<ChannelData> channels = m_channelManager->channels();
-    for (const ChannelData &channel : channels)
+    if (m_sortByUsage && m_usageTracker)
     {
-        addItem(channel.name());
-    }
+        QVector<int> order(channels.size());
+        std::iota(order.begin(), order.end(), 0);
 
-    // Set current index
-    int currentIndex = m_channelManager->currentIndex();
-    if (currentIndex >= 0 && currentIndex < count())
+        QVector<bool> favourite(channels.size());
+        QVector<quint32> tuneCounts(channels.size());
+        for (int i = 0; i < channels.size(); ++i)
+        {
+            QString key = ChannelManager::channelKey(channels[i]);
+            favourite[i] = m_usageTracker->isFavourite(key);
+            tuneCounts[i] = m_usageTracker->tuneCount(key);
+        }
+
+        // Stable, so equally used channels keep their lineup order
+        std::stable_sort(order.begin(), order.end(), [&favourite, &tuneCounts](int a, int b)
+                         {
+                             if (favourite[a] != favourite[b])
+                             {
+                                 return favourite[a];
+                             }
+                             return tuneCounts[a] > tuneCounts[b]; });
+
+        for (int row = 0; row < order.size(); ++row)
+        {
+            addItem(QString());
+            setItemChannel(row, channels[order[row]]);
+            setItemData(row, order[row], ChannelIndexRole);
+        }
+    }
+    else
     {
-        setCurrentIndex(currentIndex);
+        for (int i = 0; i < channels.size(); ++i)
+        {
+            addItem(QString());
+            setItemChannel(i, channels[i]);
+        }
     }
 
+    // Set current index
+    // Without a current channel nothing is selected, not the row addItem() picked
+    int currentRow = rowOfChannel(m_channelManager->currentIndex());
+    setCurrentIndex(currentRow >= 0 && currentRow < count() ? currentRow : -1);
+
     blockSignals(false);
+
+    updateCurrentLogo();
 }
 
 ChannelData ChannelSelector::currentChannel() const
@@ -56,18 +145,52 @@ ChannelData ChannelSelector::currentChannel() const
 
 void ChannelSelector::setCurrentChannelIndex(int index)
 {
-    if (index >= 0 && index < count())
+    int row = rowOfChannel(index);
+    if (row >= 0 && row < count())
     {
-        setCurrentIndex(index);
+        setCurrentIndex(row);
         m_channelManager->setCurrentIndex(index);
     }
 }
 
+void ChannelSelector::setUsageTracker(UsageTracker *usageTracker)
+{
+    if (m_usageTracker)
+    {
+        disconnect(m_usageTracker, nullptr, this, nullptr);
+    }
+
+    m_usageTracker = usageTracker;
+
+    if (m_usageTracker)
+    {
+        connect(m_usageTracker, &UsageTracker::favouritesChanged, this, &ChannelSelector::updateChannelList);
+    }
+
+    updateChannelList();
+}
+
+void ChannelSelector::setSortByUsage(bool enabled)
+{
+    if (enabled == m_sortByUsage)
+    {
+        return;
+    }
+
+    m_sortByUsage = enabled;
+    updateChannelList();
+}
+
+bool ChannelSelector::sortByUsage() const
+{
+    return m_sortByUsage;
+}
+
 void ChannelSelector::onCurrentIndexChanged(int index)
 {
     if (index >= 0 && index < count())
     {
-        m_channelManager->setCurrentIndex(index);
+        m_channelManager->setCurrentIndex(channelIndexAt(index));
         emit channelSelected(m_channelManager->currentChannel());
     }
 }
@@ -79,11 +202,160 @@ void ChannelSelector::onChannelListChanged()
 
 void ChannelSelector::onCurrentChannelChanged(const ChannelData &channel)
 {
-    int index = m_channelManager->currentIndex();
-    if (index >= 0 && index < count() && index != currentIndex())
+    int row = rowOfChannel(m_channelManager->currentIndex());
+    if (row >= 0 && row < count() && row != currentIndex())
     {
         blockSignals(true);
-        setCurrentIndex(index);
+        setCurrentIndex(row);
         blockSignals(false);
+
+        updateCurrentLogo();
+    }
+}
+
+void ChannelSelector::onChannelInserted(int index)
+{
+    // A sorted list is rebuilt once the merge completes
+    if (m_sortByUsage)
+    {
+        return;
+    }
+
+    // Signals stay blocked so a shifting selection never retunes the player
+    blockSignals(true);
+    insertItem(index, QString());
+    setItemChannel(index, m_channelManager->channels().at(index));
+    blockSignals(false);
+
+    if (m_logoRow >= index)
+    {
+        ++m_logoRow;
+    }
+}
+
+void ChannelSelector::onChannelRemoved(int index)
+{
+    if (m_sortByUsage)
+    {
+        return;
+    }
+
+    blockSignals(true);
+    removeItem(index);
+    blockSignals(false);
+
+    if (m_logoRow == index)
+    {
+        m_logoRow = -1;
+    }
+    else if (m_logoRow > index)
+    {
+        --m_logoRow;
+    }
+}
+
+void ChannelSelector::onChannelUpdated(int index)
+{
+    if (m_sortByUsage)
+    {
+        return;
+    }
+
+    setItemChannel(index, m_channelManager->channels().at(index));
+
+    if (index == m_logoRow)
+    {
+        m_logoRow = -1;
+        updateCurrentLogo();
+    }
+}
+
+void ChannelSelector::onChannelsMerged()
+{
+    if (m_sortByUsage)
+    {
+        updateChannelList();
+        return;
+    }
+
+    blockSignals(true);
+    setCurrentIndex(m_channelManager->currentIndex());
+    blockSignals(false);
+
+    updateCurrentLogo();
+}
+
+void ChannelSelector::onLogoReady(const QString &url)
+{
+    if (view()->isVisible())
+    {
+        view()->viewport()->update();
+    }
+
+    if (currentIndex() >= 0 && itemData(currentIndex(), LogoUrlRole).toString() == url)
+    {
+        m_logoRow = -1;
+        updateCurrentLogo();
+    }
+}
+
+void ChannelSelector::updateCurrentLogo()
+{
+    int row = currentIndex();
+    if (row == m_logoRow)
+    {
+        return;
+    }
+
+    // Only the selected row carries an icon; the popup draws the others through the delegate
+    if (m_logoRow >= 0 && m_logoRow < count())
+    {
+        setItemIcon(m_logoRow, QIcon());
+    }
+    m_logoRow = -1;
+
+    if (row < 0)
+    {
+        return;
+    }
+
+    QPixmap logo = m_logoCache->logo(itemData(row, LogoUrlRole).toString());
+    if (!logo.isNull())
+    {
+        setItemIcon(row, QIcon(logo));
+        m_logoRow = row;
+    }
+}
+
+void ChannelSelector::setItemChannel(int index, const ChannelData &channel)
+{
+    if (m_usageTracker && m_usageTracker->isFavourite(ChannelManager::channelKey(channel)))
+    {
+        setItemText(index, QStringLiteral("\u2605 ") + channel.name());
+    }
+    else
+    {
+        setItemText(index, channel.name());
     }
+    setItemData(index, channel.logoUrl(), LogoUrlRole);
+}
+
+int ChannelSelector::channelIndexAt(int row) const
+{
+    if (m_sortByUsage && row >= 0 && row < count())
+    {
+        return itemData(row, ChannelIndexRole).toInt();
+    }
+
+    return row;
+}
+
+int ChannelSelector::rowOfChannel(int index) const
+{
+    if (m_sortByUsage && index >= 0)
+    {
+        return findData(index, ChannelIndexRole);
+    }
+
+    return index;
 }
\ No newline at end of file
@@ -2,7 +2,10 @@
 #define CHANNELSELECTOR_H
 
 #include <QComboBox>
+#include <QStyledItemDelegate>
 #include "../core/channelmanager.h"
+#include "../core/logocache.h"
+#include "../core/usagetracker.h"
 
 /**
  * @brief The ChannelSelector class displays channel list from JSON
@@ -41,6 +44,24 @@ public:
      */
     void setCurrentChannelIndex(int index);
 
+    /**
+     * @brief Set the usage tracker used to mark favourites and sort channels
+     * @param usageTracker Usage tracker, may be null
+     */
+    void setUsageTracker(UsageTracker *usageTracker);
+
+    /**
+     * @brief List favourites first, then the most watched channels
+     * @param enabled True to sort by usage, false to keep the lineup order
+     */
+    void setSortByUsage(bool enabled);
+
+    /**
+     * @brief Check whether channels are sorted by usage
+     * @return True if sorted by usage
+     */
+    bool sortByUsage() const;
+
 signals:
     /**
      * @brief Signal emitted when a channel is selected
@@ -66,8 +87,92 @@ private slots:
      */
     void onCurrentChannelChanged(const ChannelData &channel);
 
+    /**
+     * @brief Handle a channel inserted by a reload merge
+     * @param index Index of the new channel
+     */
+    void onChannelInserted(int index);
+
+    /**
+     * @brief Handle a channel removed by a reload merge
+     * @param index Index of the removed channel
+     */
+    void onChannelRemoved(int index);
+
+    /**
+     * @brief Handle a channel updated by a reload merge
+     * @param index Index of the updated channel
+     */
+    void onChannelUpdated(int index);
+
+    /**
+     * @brief Resynchronize the selection after a reload merge
+     */
+    void onChannelsMerged();
+
+    /**
+     * @brief Repaint rows whose logo has been loaded
+     * @param url Logo URL
+     */
+    void onLogoReady(const QString &url);
+
+    /**
+     * @brief Show the logo of the selected channel in the closed combo box
+     */
+    void updateCurrentLogo();
+
 private:
+    /**
+     * @brief Item data role holding the logo URL of a row
+     */
+    static const int LogoUrlRole = Qt::UserRole + 1;
+
+    /**
+     * @brief Item data role holding the channel index of a row when sorted by usage
+     */
+    static const int ChannelIndexRole = Qt::UserRole + 2;
+
+    /**
+     * @brief Set the text and logo of a row from channel data
+     * @param index Row index
+     * @param channel Channel data
+     */
+    void setItemChannel(int index, const ChannelData &channel);
+
+    /**
+     * @brief Map a row to a channel index
+     * @param row Row index
+     * @return Channel index
+     */
+    int channelIndexAt(int row) const;
+
+    /**
+     * @brief Map a channel index to a row
+     * @param index Channel index
+     * @return Row index, -1 if the channel is not listed
+     */
+    int rowOfChannel(int index) const;
+
+    /**
+     * @brief Item delegate that requests logos only for rows being painted
+     */
+    class LogoDelegate : public QStyledItemDelegate
+    {
+    public:
+        LogoDelegate(LogoCache *logoCache, QObject *parent);
+
+    protected:
+        void initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const override;
+
+    private:
+        LogoCache *m_logoCache;
+    };
+
     ChannelManager *m_channelManager;
+    LogoCache *m_logoCache;
+    UsageTracker *m_usageTracker;
+    int m_logoRow;
+    bool m_sortByUsage;
 };
 
 #endif // CHANNELSELECTOR_H
\ No newline at end of file
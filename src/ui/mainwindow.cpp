@@ -4,9 +4,13 @@
 #include <QCloseEvent>
 #include <QApplication>
 #include <QScreen>
+#include <QDateTime>
+#include <QSet>
+#include <QDir>
+#include <QStandardPaths>
 
 MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent), m_settings(nullptr), m_channelManager(nullptr), m_mediaPlayer(nullptr), m_videoWidget(nullptr), m_playerControls(nullptr), m_channelSelector(nullptr), m_mainToolBar(nullptr), m_isFullscreen(false)
+    : QMainWindow(parent), m_settings(nullptr), m_channelManager(nullptr), m_epgManager(nullptr), m_usageTracker(nullptr), m_recordingScheduler(nullptr), m_mediaPlayer(nullptr), m_videoWidget(nullptr), m_playerControls(nullptr), m_channelSelector(nullptr), m_mainToolBar(nullptr), m_isFullscreen(false)
 {
     setWindowTitle("HarperTV");
     setMinimumSize(800, 600);
@@ -17,6 +21,18 @@ MainWindow::MainWindow(QWidget *parent)
     // Create channel manager
     m_channelManager = new ChannelManager(this);
 
+    // Create programme guide manager
+    m_epgManager = new EPGManager(this);
+
+    // Create usage tracker
+    QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(dataDir);
+    m_usageTracker = new UsageTracker(this);
+    m_usageTracker->load(dataDir + "/usage.dat");
+
+    // Create recording scheduler
+    m_recordingScheduler = new RecordingScheduler(m_settings, this);
+
     // Create media player
     m_mediaPlayer = new MediaPlayer(m_settings, this);
 
@@ -28,6 +44,14 @@ MainWindow::MainWindow(QWidget *parent)
 
     // Connect signals
     connect(m_mediaPlayer, &MediaPlayer::error, this, &MainWindow::onMediaPlayerError);
+    connect(m_channelManager, &ChannelManager::channelListChanged, this, &MainWindow::onChannelListChanged);
+    connect(m_channelManager, &ChannelManager::channelsMerged, this, &MainWindow::onChannelListChanged);
+    connect(m_epgManager, &EPGManager::guideUpdated, this, [this]()
+            { m_channelManager->setGuide(m_epgManager->store()); });
+    connect(m_recordingScheduler, &RecordingScheduler::recordingStarted, this, [this](const QString &, const QString &outputPath)
+            { statusBar()->showMessage(tr("Recording to %1").arg(outputPath), 5000); });
+    connect(m_recordingScheduler, &RecordingScheduler::recordingFinished, this, [this](const QString &, bool ok, const QString &error)
+            { statusBar()->showMessage(ok ? tr("Recording finished") : tr("Recording failed: %1").arg(error), 5000); });
 
     // Restore window state
     restoreWindowState();
@@ -35,7 +59,6 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
-    saveWindowState();
 }
 
 bool MainWindow::initialize()
@@ -53,9 +76,27 @@ bool MainWindow::initialize()
     // Load channels
     loadChannels();
 
+    // Load programme guide
+    loadGuide();
+
     return true;
 }
 
+MediaPlayer *MainWindow::mediaPlayer() const
+{
+    return m_mediaPlayer;
+}
+
+VideoWidget *MainWindow::videoWidget() const
+{
+    return m_videoWidget;
+}
+
+PlayerControls *MainWindow::playerControls() const
+{
+    return m_playerControls;
+}
+
 void MainWindow::keyPressEvent(QKeyEvent *event)
 {
     switch (event->key())
@@ -75,6 +116,15 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
         m_mediaPlayer->playbackController()->togglePlayPause();
         break;
 
+    // Auto-repeat is fine here; the playback controller coalesces the skips
+    case Qt::Key_Left:
+        m_mediaPlayer->playbackController()->seekBackward();
+        break;
+
+    case Qt::Key_Right:
+        m_mediaPlayer->playbackController()->seekForward();
+        break;
+
     default:
         QMainWindow::keyPressEvent(event);
         break;
@@ -120,11 +170,20 @@ void MainWindow::onOpenURL()
 
 void MainWindow::onShowSettings()
 {
+    QString channelsFile = m_settings->get<Setting::ChannelsFile>();
+    QList<ChannelSource> channelSources = m_settings->channelSources();
+
     SettingsDialog dialog(m_settings, this);
+    dialog.setDiskCache(m_mediaPlayer->vodCache());
     if (dialog.exec() == QDialog::Accepted)
     {
-        // Reload channels if channels file changed
-        loadChannels();
+        // Content changes of the same files are picked up by the channel manager's watcher
+        if (m_settings->get<Setting::ChannelsFile>() != channelsFile || m_settings->channelSources() != channelSources)
+        {
+            loadChannels();
+        }
+
+        loadGuide();
     }
 }
 
@@ -160,7 +219,19 @@ void MainWindow::onToggleFullscreen()
 void MainWindow::onChannelSelected(const ChannelData &channel)
 {
     m_mediaPlayer->loadChannel(channel);
-    statusBar()->showMessage(tr("Loading channel: %1").arg(channel.name()), 3000);
+
+    m_usageTracker->recordTune(ChannelManager::channelKey(channel));
+    updatePrefetchHints(channel);
+
+    QString summary = guideSummary(channel);
+    if (summary.isEmpty())
+    {
+        statusBar()->showMessage(tr("Loading channel: %1").arg(channel.name()), 3000);
+    }
+    else
+    {
+        statusBar()->showMessage(tr("Loading channel: %1 - %2").arg(channel.name(), summary), 5000);
+    }
 }
 
 void MainWindow::onMediaPlayerError(const QString &message)
@@ -178,6 +249,77 @@ void MainWindow::onFullscreenButtonClick()
     onToggleFullscreen();
 }
 
+void MainWindow::onChannelListChanged()
+{
+    QSet<QString> channelIds;
+    for (const ChannelData &channel : m_channelManager->channels())
+    {
+        if (!channel.tvgId().isEmpty())
+        {
+            channelIds.insert(channel.tvgId());
+        }
+    }
+
+    m_epgManager->setChannelFilter(channelIds);
+}
+
+void MainWindow::onToggleFavourite()
+{
+    ChannelData channel = m_channelManager->currentChannel();
+    if (channel.url().isEmpty())
+    {
+        return;
+    }
+
+    if (m_usageTracker->toggleFavourite(ChannelManager::channelKey(channel)))
+    {
+        statusBar()->showMessage(tr("Added %1 to favourites").arg(channel.name()), 3000);
+    }
+    else
+    {
+        statusBar()->showMessage(tr("Removed %1 from favourites").arg(channel.name()), 3000);
+    }
+}
+
+void MainWindow::onToggleRecording()
+{
+    ChannelData channel = m_channelManager->currentChannel();
+    if (channel.url().isEmpty())
+    {
+        return;
+    }
+
+    QString id = m_recordingScheduler->recordingForUrl(channel.url());
+    if (!id.isEmpty())
+    {
+        m_recordingScheduler->remove(id);
+        return;
+    }
+
+    m_recordingScheduler->recordNow(channel.name(), channel.url());
+}
+
+void MainWindow::onShowRecordings()
+{
+    RecordingDialog dialog(m_recordingScheduler, m_channelManager->channels(), this);
+    dialog.exec();
+}
+
+void MainWindow::onSortByUsage(bool enabled)
+{
+    m_settings->set<Setting::SortChannelsByUsage>(enabled);
+
+    if (m_channelSelector)
+    {
+        m_channelSelector->setSortByUsage(enabled);
+    }
+}
+
+void MainWindow::onToggleStats(bool visible)
+{
+    m_videoWidget->setStatsVisible(visible);
+}
+
 void MainWindow::createActions()
 {
     // File menu actions
@@ -202,6 +344,36 @@ void MainWindow::createActions()
     m_fullscreenAction->setStatusTip(tr("Toggle fullscreen mode"));
     connect(m_fullscreenAction, &QAction::triggered, this, &MainWindow::onToggleFullscreen);
 
+    m_favouriteAction = new QAction(tr("Toggle F&avourite"), this);
+    m_favouriteAction->setShortcut(QKeySequence("Ctrl+D"));
+    m_favouriteAction->setStatusTip(tr("Add or remove the current channel from favourites"));
+    connect(m_favouriteAction, &QAction::triggered, this, &MainWindow::onToggleFavourite);
+
+    m_sortByUsageAction = new QAction(tr("Sort Channels by &Usage"), this);
+    m_sortByUsageAction->setCheckable(true);
+    m_sortByUsageAction->setChecked(m_settings->get<Setting::SortChannelsByUsage>());
+    m_sortByUsageAction->setStatusTip(tr("List favourites and the most watched channels first"));
+    connect(m_sortByUsageAction, &QAction::toggled, this, &MainWindow::onSortByUsage);
+
+    m_statsAction = new QAction(tr("Playback &Statistics"), this);
+    m_statsAction->setCheckable(true);
+    m_statsAction->setShortcut(QKeySequence("Ctrl+I"));
+    m_statsAction->setStatusTip(tr("Show render, decoder, cache and network figures on top of the video"));
+    connect(m_statsAction, &QAction::toggled, this, &MainWindow::onToggleStats);
+
+    // Stutter is often noticed in fullscreen, where the menu bar and its shortcuts are hidden
+    addAction(m_statsAction);
+
+    // Recording actions
+    m_recordAction = new QAction(tr("&Record Current Channel"), this);
+    m_recordAction->setShortcut(QKeySequence("Ctrl+R"));
+    m_recordAction->setStatusTip(tr("Start or stop recording the current channel to disk"));
+    connect(m_recordAction, &QAction::triggered, this, &MainWindow::onToggleRecording);
+
+    m_recordingsAction = new QAction(tr("Recor&dings..."), this);
+    m_recordingsAction->setStatusTip(tr("Schedule and manage recordings"));
+    connect(m_recordingsAction, &QAction::triggered, this, &MainWindow::onShowRecordings);
+
     // Tools menu actions
     m_settingsAction = new QAction(tr("&Settings..."), this);
     m_settingsAction->setStatusTip(tr("Configure application settings"));
@@ -230,9 +402,16 @@ void MainWindow::createMenus()
     // View menu
     QMenu *viewMenu = menuBar()->addMenu(tr("&View"));
     viewMenu->addAction(m_fullscreenAction);
+    viewMenu->addAction(m_statsAction);
+    viewMenu->addSeparator();
+    viewMenu->addAction(m_favouriteAction);
+    viewMenu->addAction(m_sortByUsageAction);
 
     // Tools menu
     QMenu *toolsMenu = menuBar()->addMenu(tr("&Tools"));
+    toolsMenu->addAction(m_recordAction);
+    toolsMenu->addAction(m_recordingsAction);
+    toolsMenu->addSeparator();
     toolsMenu->addAction(m_settingsAction);
 
     // Help menu
@@ -263,14 +442,19 @@ void MainWindow::createCentralWidget()
 {
     // Create video widget
     m_videoWidget = new VideoWidget(m_mediaPlayer->mpvCore(), this);
+    m_videoWidget->setPlaybackStats(m_mediaPlayer->playbackStats());
     connect(m_videoWidget, &VideoWidget::doubleClicked, this, &MainWindow::onVideoDoubleClick);
 
     // Create player controls
     m_playerControls = new PlayerControls(m_mediaPlayer->playbackController(), this);
+    m_playerControls->setTimeshiftController(m_mediaPlayer->timeshiftController());
+    m_playerControls->setThumbnailGenerator(m_mediaPlayer->thumbnailGenerator());
     connect(m_playerControls, &PlayerControls::fullscreenClicked, this, &MainWindow::onFullscreenButtonClick);
 
     // Create channel selector
     m_channelSelector = new ChannelSelector(m_channelManager, this);
+    m_channelSelector->setUsageTracker(m_usageTracker);
+    m_channelSelector->setSortByUsage(m_sortByUsageAction->isChecked());
     connect(m_channelSelector, &ChannelSelector::channelSelected, this, &MainWindow::onChannelSelected);
 
     // Create layouts
@@ -294,13 +478,47 @@ void MainWindow::createCentralWidget()
 
 void MainWindow::loadChannels()
 {
-    QString channelsFile = m_settings->value("channelsFile", ":/default_channels.json").toString();
-    if (!m_channelManager->loadFromFile(channelsFile))
+    QString channelsFile = m_settings->get<Setting::ChannelsFile>();
+    QList<ChannelSource> extraSources = m_settings->channelSources();
+
+    bool loaded = false;
+    QStringList sourceFiles{channelsFile};
+    if (extraSources.isEmpty())
+    {
+        loaded = m_channelManager->loadFromFile(channelsFile);
+    }
+    else
+    {
+        // The channels file is the base lineup; extra sources are merged on top of it
+        ChannelSource base;
+        base.name = tr("Base");
+        base.path = channelsFile;
+
+        QList<ChannelSource> sources{base};
+        for (const ChannelSource &source : extraSources)
+        {
+            sources.append(source);
+            sourceFiles.append(source.path);
+        }
+
+        loaded = m_channelManager->loadFromSources(sources);
+    }
+
+    if (loaded)
+    {
+        m_channelManager->watchFiles(sourceFiles);
+
+        // Come back to the channel that was selected last time
+        m_channelManager->setCurrentIndex(m_settings->get<Setting::LastChannelIndex>());
+    }
+    else
     {
+        m_channelManager->watchFile(QString());
+
         QMessageBox::warning(
             this,
             tr("Error"),
-            tr("Failed to load channels from %1. Using default channels.").arg(channelsFile));
+            tr("Failed to load channels from %1. Using default channels.").arg(sourceFiles.join(", ")));
 
         // Try to load default channels
         if (!m_channelManager->loadFromFile(":/default_channels.json"))
@@ -313,26 +531,74 @@ void MainWindow::loadChannels()
     }
 }
 
+void MainWindow::loadGuide()
+{
+    m_epgManager->setRefreshInterval(m_settings->get<Setting::EpgRefreshMinutes>());
+    m_epgManager->setGuideFile(m_settings->get<Setting::EpgFile>());
+}
+
+QString MainWindow::guideSummary(const ChannelData &channel) const
+{
+    ProgrammeData current;
+    ProgrammeData next;
+    if (!m_channelManager->nowAndNext(channel, &current, &next))
+    {
+        return QString();
+    }
+
+    QStringList parts;
+    if (!current.title.isEmpty())
+    {
+        parts << tr("Now: %1").arg(current.title);
+    }
+    if (!next.title.isEmpty())
+    {
+        parts << tr("Next: %1 (%2)").arg(next.title, QDateTime::fromSecsSinceEpoch(next.start).toString("HH:mm"));
+    }
+
+    return parts.join(", ");
+}
+
+void MainWindow::updatePrefetchHints(const ChannelData &channel)
+{
+    static const int PREFETCH_CHANNELS = 3;
+
+    QStringList keys = m_usageTracker->likelyNext(ChannelManager::channelKey(channel), PREFETCH_CHANNELS);
+
+    QStringList urls;
+    for (const ChannelData &next : m_channelManager->channelsForKeys(keys))
+    {
+        urls.append(next.url());
+    }
+
+    m_mediaPlayer->setPrefetchHints(urls);
+}
+
 void MainWindow::saveWindowState()
 {
-    m_settings->setValue("window/geometry", saveGeometry());
-    m_settings->setValue("window/state", saveState());
-    m_settings->setValue("window/isFullscreen", m_isFullscreen);
+    m_settings->set<Setting::WindowGeometry>(saveGeometry());
+    m_settings->set<Setting::WindowState>(saveState());
+    m_settings->set<Setting::WindowFullscreen>(m_isFullscreen);
+
+    if (m_channelManager->currentIndex() >= 0)
+    {
+        m_settings->set<Setting::LastChannelIndex>(m_channelManager->currentIndex());
+    }
 }
 
 void MainWindow::restoreWindowState()
 {
-    if (m_settings->value("window/geometry").isValid())
+    if (!m_settings->get<Setting::WindowGeometry>().isEmpty())
     {
-        restoreGeometry(m_settings->value("window/geometry").toByteArray());
+        restoreGeometry(m_settings->get<Setting::WindowGeometry>());
     }
 
-    if (m_settings->value("window/state").isValid())
+    if (!m_settings->get<Setting::WindowState>().isEmpty())
     {
-        restoreState(m_settings->value("window/state").toByteArray());
+        restoreState(m_settings->get<Setting::WindowState>());
     }
 
-    if (m_settings->value("window/isFullscreen", false).toBool())
+    if (m_settings->get<Setting::WindowFullscreen>())
     {
         onToggleFullscreen();
     }
@@ -13,11 +13,15 @@
 #include <QKeyEvent>
 #include "../core/mediaplayer.h"
 #include "../core/channelmanager.h"
+#include "../core/epgmanager.h"
+#include "../core/usagetracker.h"
+#include "../core/recordingscheduler.h"
 #include "../data/settings.h"
 #include "videowidget.h"
 #include "playercontrols.h"
 #include "channelselector.h"
 #include "settingsdialog.h"
+#include "recordingdialog.h"
 
 /**
  * @brief The MainWindow class is the main application window
@@ -44,6 +48,24 @@ public:
      */
     bool initialize();
 
+    /**
+     * @brief Get the media player
+     * @return Media player instance
+     */
+    MediaPlayer *mediaPlayer() const;
+
+    /**
+     * @brief Get the video widget
+     * @return Video widget instance
+     */
+    VideoWidget *videoWidget() const;
+
+    /**
+     * @brief Get the player controls
+     * @return Player controls instance
+     */
+    PlayerControls *playerControls() const;
+
 protected:
     /**
      * @brief Handle key press events
@@ -100,6 +122,38 @@ private slots:
      */
     void onFullscreenButtonClick();
 
+    /**
+     * @brief Restrict the programme guide to the channels in the lineup
+     */
+    void onChannelListChanged();
+
+    /**
+     * @brief Toggle whether the current channel is a favourite
+     */
+    void onToggleFavourite();
+
+    /**
+     * @brief Toggle sorting the channel list by usage
+     * @param enabled True to sort by usage
+     */
+    void onSortByUsage(bool enabled);
+
+    /**
+     * @brief Show or hide the playback stats overlay
+     * @param visible True to show the overlay
+     */
+    void onToggleStats(bool visible);
+
+    /**
+     * @brief Start or stop recording the current channel
+     */
+    void onToggleRecording();
+
+    /**
+     * @brief Show the recordings dialog
+     */
+    void onShowRecordings();
+
 private:
     /**
      * @brief Create actions
@@ -131,6 +185,24 @@ private:
      */
     void loadChannels();
 
+    /**
+     * @brief Apply programme guide settings
+     */
+    void loadGuide();
+
+    /**
+     * @brief Describe what is on a channel now and next
+     * @param channel Channel data
+     * @return Now/next summary, empty if the channel has no guide data
+     */
+    QString guideSummary(const ChannelData &channel) const;
+
+    /**
+     * @brief Pass the channels likely to be tuned next to the media player
+     * @param channel Channel being watched
+     */
+    void updatePrefetchHints(const ChannelData &channel);
+
     /**
      * @brief Save window state
      */
@@ -144,6 +216,9 @@ private:
     // Core components
     Settings *m_settings;
     ChannelManager *m_channelManager;
+    EPGManager *m_epgManager;
+    UsageTracker *m_usageTracker;
+    RecordingScheduler *m_recordingScheduler;
     MediaPlayer *m_mediaPlayer;
 
     // UI components
@@ -157,6 +232,11 @@ private:
     QAction *m_exitAction;
     QAction *m_settingsAction;
     QAction *m_fullscreenAction;
+    QAction *m_favouriteAction;
+    QAction *m_sortByUsageAction;
+    QAction *m_statsAction;
+    QAction *m_recordAction;
+    QAction *m_recordingsAction;
     QAction *m_aboutAction;
 
     // Toolbar
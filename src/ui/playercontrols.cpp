@@ -2,13 +2,19 @@
 #include <QDebug>
 #include <QStyle>
 #include <QTime>
+#include <QMouseEvent>
+#include <limits>
+
+// Labels show whole seconds and the slider has a few hundred pixels, so 10 updates a second are enough
+static const int REFRESH_INTERVAL_MS = 100;
+static const qint64 NOT_SHOWN = std::numeric_limits<qint64>::min();
 
 PlayerControls::PlayerControls(PlaybackController *playbackController, QWidget *parent)
-    : QWidget(parent), m_playbackController(playbackController), m_duration(0.0), m_position(0.0), m_isPlaying(false), m_isMuted(false), m_isPositionSliderPressed(false)
+    : QWidget(parent), m_playbackController(playbackController), m_timeshift(nullptr), m_thumbnails(nullptr), m_hoverTime(-1.0), m_duration(0.0), m_position(0.0), m_isPlaying(false), m_isMuted(false), m_isPositionSliderPressed(false), m_isTimeshifting(false), m_shownCurrentSecs(NOT_SHOWN), m_shownTotalSecs(NOT_SHOWN), m_playIcon(":/icons/play.png"), m_pauseIcon(":/icons/pause.png"), m_volumeIcon(":/icons/volume.png"), m_muteIcon(":/icons/mute.png")
 {
     // Create buttons
     m_playPauseButton = new QPushButton(this);
-    m_playPauseButton->setIcon(QIcon(":/icons/play.png"));
+    m_playPauseButton->setIcon(m_playIcon);
     m_playPauseButton->setToolTip(tr("Play"));
     m_playPauseButton->setIconSize(QSize(24, 24));
     m_playPauseButton->setFlat(true);
@@ -20,7 +26,7 @@ PlayerControls::PlayerControls(PlaybackController *playbackController, QWidget *
     m_stopButton->setFlat(true);
 
     m_muteButton = new QPushButton(this);
-    m_muteButton->setIcon(QIcon(":/icons/volume.png"));
+    m_muteButton->setIcon(m_volumeIcon);
     m_muteButton->setToolTip(tr("Mute"));
     m_muteButton->setIconSize(QSize(24, 24));
     m_muteButton->setFlat(true);
@@ -31,6 +37,11 @@ PlayerControls::PlayerControls(PlaybackController *playbackController, QWidget *
     m_fullscreenButton->setIconSize(QSize(24, 24));
     m_fullscreenButton->setFlat(true);
 
+    m_liveButton = new QPushButton(tr("Live"), this);
+    m_liveButton->setToolTip(tr("Jump to the live broadcast"));
+    m_liveButton->setFlat(true);
+    m_liveButton->hide();
+
     // Create sliders
     m_positionSlider = new QSlider(Qt::Horizontal, this);
     m_positionSlider->setRange(0, 1000);
@@ -46,6 +57,20 @@ PlayerControls::PlayerControls(PlaybackController *playbackController, QWidget *
     m_currentTimeLabel = new QLabel("00:00:00", this);
     m_totalTimeLabel = new QLabel("00:00:00", this);
 
+    // Thumbnail popup shown above the position slider
+    m_thumbnailPopup = new QFrame(this, Qt::ToolTip);
+    m_thumbnailPopup->setFrameShape(QFrame::Box);
+    m_thumbnailImage = new QLabel(m_thumbnailPopup);
+    m_thumbnailImage->setAlignment(Qt::AlignCenter);
+    m_thumbnailTime = new QLabel(m_thumbnailPopup);
+    m_thumbnailTime->setAlignment(Qt::AlignCenter);
+    QVBoxLayout *popupLayout = new QVBoxLayout(m_thumbnailPopup);
+    popupLayout->setContentsMargins(2, 2, 2, 2);
+    popupLayout->setSpacing(2);
+    popupLayout->addWidget(m_thumbnailImage);
+    popupLayout->addWidget(m_thumbnailTime);
+    m_thumbnailPopup->hide();
+
     // Create layouts
     QHBoxLayout *controlLayout = new QHBoxLayout();
     controlLayout->addWidget(m_playPauseButton);
@@ -53,6 +78,7 @@ PlayerControls::PlayerControls(PlaybackController *playbackController, QWidget *
     controlLayout->addWidget(m_currentTimeLabel);
     controlLayout->addWidget(m_positionSlider);
     controlLayout->addWidget(m_totalTimeLabel);
+    controlLayout->addWidget(m_liveButton);
     controlLayout->addWidget(m_muteButton);
     controlLayout->addWidget(m_volumeSlider);
     controlLayout->addWidget(m_fullscreenButton);
@@ -61,11 +87,17 @@ PlayerControls::PlayerControls(PlaybackController *playbackController, QWidget *
     mainLayout->addLayout(controlLayout);
     setLayout(mainLayout);
 
+    // Position updates arrive with every frame; the controls are redrawn at a fixed rate
+    m_refreshTimer.setSingleShot(true);
+    m_refreshTimer.setInterval(REFRESH_INTERVAL_MS);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &PlayerControls::refreshPosition);
+
     // Connect signals
     connect(m_playPauseButton, &QPushButton::clicked, this, &PlayerControls::onPlayPauseClicked);
     connect(m_stopButton, &QPushButton::clicked, this, &PlayerControls::onStopClicked);
     connect(m_muteButton, &QPushButton::clicked, this, &PlayerControls::onMuteClicked);
     connect(m_fullscreenButton, &QPushButton::clicked, this, &PlayerControls::onFullscreenClicked);
+    connect(m_liveButton, &QPushButton::clicked, this, &PlayerControls::onLiveClicked);
 
     connect(m_positionSlider, &QSlider::valueChanged, this, &PlayerControls::onPositionSliderValueChanged);
     connect(m_positionSlider, &QSlider::sliderReleased, this, &PlayerControls::onPositionSliderReleased);
@@ -101,19 +133,36 @@ void PlayerControls::setPosition(double position)
     {
         m_position = position;
 
-        // Update position slider
-        if (m_duration > 0)
-        {
-            int sliderValue = static_cast<int>((position / m_duration) * 1000);
-            m_positionSlider->setValue(sliderValue);
-        }
-        else
+        // Later updates within the interval only replace the position
+        if (!m_refreshTimer.isActive())
         {
-            m_positionSlider->setValue(0);
+            m_refreshTimer.start();
         }
+    }
+}
+
+void PlayerControls::refreshPosition()
+{
+    if (m_isPositionSliderPressed)
+    {
+        return;
+    }
 
-        updateTimeLabels();
+    int sliderValue = 0;
+    if (sliderSpan() > 0)
+    {
+        sliderValue = qBound(0, static_cast<int>(((m_position - sliderStart()) / sliderSpan()) * 1000), 1000);
+    }
+
+    // Moving the handle within the same pixel would only cost a repaint
+    int width = m_positionSlider->width();
+    if (QStyle::sliderPositionFromValue(0, 1000, sliderValue, width) !=
+        QStyle::sliderPositionFromValue(0, 1000, m_positionSlider->value(), width))
+    {
+        m_positionSlider->setValue(sliderValue);
     }
+
+    updateTimeLabels();
 }
 
 void PlayerControls::setVolume(int volume)
@@ -123,32 +172,42 @@ void PlayerControls::setVolume(int volume)
 
 void PlayerControls::setPlaying(bool playing)
 {
+    if (playing == m_isPlaying)
+    {
+        return;
+    }
+
     m_isPlaying = playing;
 
     if (playing)
     {
-        m_playPauseButton->setIcon(QIcon(":/icons/pause.png"));
+        m_playPauseButton->setIcon(m_pauseIcon);
         m_playPauseButton->setToolTip(tr("Pause"));
     }
     else
     {
-        m_playPauseButton->setIcon(QIcon(":/icons/play.png"));
+        m_playPauseButton->setIcon(m_playIcon);
         m_playPauseButton->setToolTip(tr("Play"));
     }
 }
 
 void PlayerControls::setMuted(bool muted)
 {
+    if (muted == m_isMuted)
+    {
+        return;
+    }
+
     m_isMuted = muted;
 
     if (muted)
     {
-        m_muteButton->setIcon(QIcon(":/icons/mute.png"));
+        m_muteButton->setIcon(m_muteIcon);
         m_muteButton->setToolTip(tr("Unmute"));
     }
     else
     {
-        m_muteButton->setIcon(QIcon(":/icons/volume.png"));
+        m_muteButton->setIcon(m_volumeIcon);
         m_muteButton->setToolTip(tr("Mute"));
     }
 }
@@ -180,10 +239,16 @@ void PlayerControls::onPositionSliderValueChanged(int value)
         m_isPositionSliderPressed = true;
 
         // Update position
-        if (m_duration > 0)
+        if (sliderSpan() > 0)
         {
-            m_position = (value / 1000.0) * m_duration;
+            m_position = sliderStart() + (value / 1000.0) * sliderSpan();
             updateTimeLabels();
+
+            // Follow the handle with keyframe seeks; the exact seek comes on release
+            if (!m_isTimeshifting)
+            {
+                m_playbackController->scrubTo(m_position);
+            }
         }
     }
 }
@@ -193,10 +258,17 @@ void PlayerControls::onPositionSliderReleased()
     m_isPositionSliderPressed = false;
 
     // Set position
-    if (m_duration > 0)
+    if (sliderSpan() > 0)
     {
-        double position = (m_positionSlider->value() / 1000.0) * m_duration;
-        m_playbackController->setPosition(position);
+        double position = sliderStart() + (m_positionSlider->value() / 1000.0) * sliderSpan();
+        if (m_isTimeshifting)
+        {
+            m_timeshift->seekTo(position);
+        }
+        else
+        {
+            m_playbackController->endScrub(position);
+        }
         emit positionChanged(position);
     }
 }
@@ -220,19 +292,196 @@ void PlayerControls::onFullscreenClicked()
 
 void PlayerControls::updateTimeLabels()
 {
-    m_currentTimeLabel->setText(formatTime(m_position));
-    m_totalTimeLabel->setText(formatTime(m_duration));
+    if (m_isTimeshifting)
+    {
+        // Delay behind the broadcast, and how far back the window reaches
+        double delay = qMax(0.0, m_timeshift->liveEdge() - m_position);
+        setTimeLabel(m_currentTimeLabel, &m_shownCurrentSecs, delay, "-");
+        setTimeLabel(m_totalTimeLabel, &m_shownTotalSecs, sliderSpan());
+        m_liveButton->setEnabled(delay > 5.0);
+        return;
+    }
+
+    setTimeLabel(m_currentTimeLabel, &m_shownCurrentSecs, m_position);
+    setTimeLabel(m_totalTimeLabel, &m_shownTotalSecs, m_duration);
+}
+
+void PlayerControls::setTimeLabel(QLabel *label, qint64 *shown, double seconds, const QString &prefix)
+{
+    qint64 wholeSeconds = static_cast<qint64>(seconds);
+    if (wholeSeconds == *shown)
+    {
+        return;
+    }
+
+    *shown = wholeSeconds;
+    label->setText(prefix + formatTime(seconds));
+}
+
+void PlayerControls::setTimeshiftController(TimeshiftController *timeshift)
+{
+    m_timeshift = timeshift;
+    connect(m_timeshift, &TimeshiftController::activeChanged, this, &PlayerControls::onTimeshiftActiveChanged);
+    connect(m_timeshift, &TimeshiftController::windowChanged, this, &PlayerControls::onTimeshiftWindowChanged);
+    onTimeshiftActiveChanged(m_timeshift->isActive());
+}
+
+void PlayerControls::setThumbnailGenerator(ThumbnailGenerator *thumbnails)
+{
+    m_thumbnails = thumbnails;
+    connect(m_thumbnails, &ThumbnailGenerator::thumbnailReady, this, &PlayerControls::onThumbnailReady);
+
+    m_positionSlider->setMouseTracking(true);
+    m_positionSlider->installEventFilter(this);
+}
+
+void PlayerControls::onThumbnailReady(double time, const QImage &image)
+{
+    if (m_thumbnailPopup->isVisible() && m_thumbnails->bucketStart(m_hoverTime) == time)
+    {
+        m_thumbnailImage->setPixmap(QPixmap::fromImage(image));
+        m_thumbnailPopup->adjustSize();
+    }
+}
+
+bool PlayerControls::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_positionSlider)
+    {
+        switch (event->type())
+        {
+        case QEvent::MouseMove:
+            showThumbnail(static_cast<QMouseEvent *>(event)->position().toPoint().x());
+            break;
+
+        case QEvent::Leave:
+        case QEvent::MouseButtonRelease:
+            hideThumbnail();
+            break;
+
+        case QEvent::ToolTip:
+            // The popup already shows the time
+            if (m_thumbnailPopup->isVisible())
+            {
+                return true;
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return QWidget::eventFilter(watched, event);
+}
+
+void PlayerControls::showThumbnail(int x)
+{
+    if (m_isTimeshifting || m_thumbnails->media().isEmpty() || sliderSpan() <= 0)
+    {
+        hideThumbnail();
+        return;
+    }
+
+    int value = QStyle::sliderValueFromPosition(m_positionSlider->minimum(), m_positionSlider->maximum(), x, m_positionSlider->width());
+    double time = sliderStart() + (value / 1000.0) * sliderSpan();
+    bool moved = m_thumbnails->bucketStart(time) != m_thumbnails->bucketStart(m_hoverTime);
+    m_hoverTime = time;
+
+    m_thumbnailTime->setText(formatTime(time));
+    if (moved || !m_thumbnailPopup->isVisible())
+    {
+        // Keep showing the previous image until the new one is ready
+        QImage image = m_thumbnails->thumbnail(time);
+        if (!image.isNull())
+        {
+            m_thumbnailImage->setPixmap(QPixmap::fromImage(image));
+        }
+        else
+        {
+            m_thumbnails->request(time);
+        }
+    }
+
+    m_thumbnailPopup->adjustSize();
+    QPoint anchor = m_positionSlider->mapToGlobal(QPoint(x, 0));
+    m_thumbnailPopup->move(anchor.x() - m_thumbnailPopup->width() / 2, anchor.y() - m_thumbnailPopup->height() - 4);
+    m_thumbnailPopup->show();
+}
+
+void PlayerControls::hideThumbnail()
+{
+    if (!m_thumbnails)
+    {
+        return;
+    }
+
+    m_thumbnailPopup->hide();
+    m_thumbnailImage->clear();
+    m_thumbnails->cancel();
+    m_hoverTime = -1.0;
+}
+
+void PlayerControls::onTimeshiftActiveChanged(bool active)
+{
+    m_isTimeshifting = active;
+    m_shownCurrentSecs = NOT_SHOWN;
+    m_shownTotalSecs = NOT_SHOWN;
+    m_liveButton->setVisible(active);
+    m_positionSlider->setToolTip(active ? tr("Timeshift window") : tr("Position"));
+    setPosition(m_position);
+    updateTimeLabels();
+}
+
+void PlayerControls::onTimeshiftWindowChanged(double start, double liveEdge)
+{
+    Q_UNUSED(start);
+    Q_UNUSED(liveEdge);
+
+    setPosition(m_position);
+    updateTimeLabels();
+}
+
+void PlayerControls::onLiveClicked()
+{
+    if (m_isTimeshifting)
+    {
+        m_timeshift->jumpToLive();
+    }
+}
+
+double PlayerControls::sliderStart() const
+{
+    return m_isTimeshifting ? m_timeshift->windowStart() : 0.0;
+}
+
+double PlayerControls::sliderSpan() const
+{
+    return m_isTimeshifting ? m_timeshift->liveEdge() - m_timeshift->windowStart() : m_duration;
 }
 
 QString PlayerControls::formatTime(double seconds) const
 {
-    int totalSeconds = static_cast<int>(seconds);
+    int totalSeconds = qMax(0, static_cast<int>(seconds));
     int hours = totalSeconds / 3600;
     int minutes = (totalSeconds % 3600) / 60;
     int secs = totalSeconds % 60;
 
-    return QString("%1:%2:%3")
-        .arg(hours, 2, 10, QChar('0'))
-        .arg(minutes, 2, 10, QChar('0'))
-        .arg(secs, 2, 10, QChar('0'));
+    if (hours > 99)
+    {
+        return QString("%1:%2:%3")
+            .arg(hours)
+            .arg(minutes, 2, 10, QChar('0'))
+            .arg(secs, 2, 10, QChar('0'));
+    }
+
+    // Filled in place; this runs for every label change
+    char text[] = "00:00:00";
+    text[0] = static_cast<char>('0' + hours / 10);
+    text[1] = static_cast<char>('0' + hours % 10);
+    text[3] = static_cast<char>('0' + minutes / 10);
+    text[4] = static_cast<char>('0' + minutes % 10);
+    text[6] = static_cast<char>('0' + secs / 10);
+    text[7] = static_cast<char>('0' + secs % 10);
+    return QString::fromLatin1(text, 8);
 }
\ No newline at end of file
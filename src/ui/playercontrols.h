@@ -7,7 +7,12 @@
 #include <QLabel>
 #include <QHBoxLayout>
 #include <QVBoxLayout>
+#include <QFrame>
+#include <QTimer>
+#include <QIcon>
 #include "../core/playbackcontroller.h"
+#include "../core/timeshiftcontroller.h"
+#include "../core/thumbnailgenerator.h"
 
 /**
  * @brief The PlayerControls class provides UI controls for playback
@@ -59,6 +64,18 @@ public:
      */
     void setMuted(bool muted);
 
+    /**
+     * @brief Show the timeshift window of live streams on the position slider
+     * @param timeshift Timeshift controller instance
+     */
+    void setTimeshiftController(TimeshiftController *timeshift);
+
+    /**
+     * @brief Show thumbnails when hovering or dragging the position slider
+     * @param thumbnails Thumbnail generator instance
+     */
+    void setThumbnailGenerator(ThumbnailGenerator *thumbnails);
+
 signals:
     /**
      * @brief Signal emitted when the play button is clicked
@@ -141,6 +158,45 @@ private slots:
      */
     void updateTimeLabels();
 
+    /**
+     * @brief Show the latest position on the slider and labels
+     */
+    void refreshPosition();
+
+    /**
+     * @brief Switch the position slider between media and timeshift window
+     * @param active True if a live stream is being timeshifted
+     */
+    void onTimeshiftActiveChanged(bool active);
+
+    /**
+     * @brief Rescale the position slider to the timeshift window
+     * @param start Oldest position in seconds
+     * @param liveEdge Newest position in seconds
+     */
+    void onTimeshiftWindowChanged(double start, double liveEdge);
+
+    /**
+     * @brief Handle live button click
+     */
+    void onLiveClicked();
+
+    /**
+     * @brief Show a thumbnail that arrived for the hovered position
+     * @param time Bucket start in seconds
+     * @param image Thumbnail
+     */
+    void onThumbnailReady(double time, const QImage &image);
+
+protected:
+    /**
+     * @brief Track the cursor over the position slider for thumbnails
+     * @param watched Watched object
+     * @param event Event
+     * @return True if the event was handled
+     */
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
 private:
     /**
      * @brief Format time as a string
@@ -149,12 +205,47 @@ private:
      */
     QString formatTime(double seconds) const;
 
+    /**
+     * @brief Set a time label if the whole second it shows has changed
+     * @param label Label to update
+     * @param shown Second currently shown, updated
+     * @param seconds Time in seconds
+     * @param prefix Text before the time
+     */
+    void setTimeLabel(QLabel *label, qint64 *shown, double seconds, const QString &prefix = QString());
+
+    /**
+     * @brief Get the start of the range the position slider spans
+     * @return Position in seconds
+     */
+    double sliderStart() const;
+
+    /**
+     * @brief Get the length of the range the position slider spans
+     * @return Length in seconds
+     */
+    double sliderSpan() const;
+
+    /**
+     * @brief Show the thumbnail popup for a point on the position slider
+     * @param x Horizontal position in slider coordinates
+     */
+    void showThumbnail(int x);
+
+    /**
+     * @brief Hide the thumbnail popup and drop its queued requests
+     */
+    void hideThumbnail();
+
     PlaybackController *m_playbackController;
+    TimeshiftController *m_timeshift;
+    ThumbnailGenerator *m_thumbnails;
 
     QPushButton *m_playPauseButton;
     QPushButton *m_stopButton;
     QPushButton *m_muteButton;
     QPushButton *m_fullscreenButton;
+    QPushButton *m_liveButton;
 
     QSlider *m_positionSlider;
     QSlider *m_volumeSlider;
@@ -162,11 +253,26 @@ private:
     QLabel *m_currentTimeLabel;
     QLabel *m_totalTimeLabel;
 
+    QFrame *m_thumbnailPopup;
+    QLabel *m_thumbnailImage;
+    QLabel *m_thumbnailTime;
+    double m_hoverTime;
+
     double m_duration;
     double m_position;
     bool m_isPlaying;
     bool m_isMuted;
     bool m_isPositionSliderPressed;
+    bool m_isTimeshifting;
+
+    QTimer m_refreshTimer;
+    qint64 m_shownCurrentSecs;
+    qint64 m_shownTotalSecs;
+
+    QIcon m_playIcon;
+    QIcon m_pauseIcon;
+    QIcon m_volumeIcon;
+    QIcon m_muteIcon;
 };
 
 #endif // PLAYERCONTROLS_H
\ No newline at end of file
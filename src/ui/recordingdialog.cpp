@@ -0,0 +1,127 @@
+#include "recordingdialog.h"
+#include <QFormLayout>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QSet>
+
+RecordingDialog::RecordingDialog(RecordingScheduler *scheduler, const QList<ChannelData> &channels, QWidget *parent)
+    : QDialog(parent), m_scheduler(scheduler)
+{
+    setWindowTitle(tr("Recordings"));
+    setMinimumSize(600, 400);
+
+    // Schedule
+    m_table = new QTableWidget(0, 4, this);
+    m_table->setHorizontalHeaderLabels({tr("Channel"), tr("Start"), tr("End"), tr("Status")});
+    m_table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_table->verticalHeader()->hide();
+    m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    QPushButton *removeButton = new QPushButton(tr("Stop / Cancel"), this);
+
+    // New recording
+    m_channelCombo = new QComboBox(this);
+    for (const ChannelData &channel : channels)
+    {
+        m_channelCombo->addItem(channel.name(), channel.url());
+    }
+
+    QDateTime now = QDateTime::currentDateTime();
+    m_startEdit = new QDateTimeEdit(now, this);
+    m_startEdit->setCalendarPopup(true);
+    m_endEdit = new QDateTimeEdit(now.addSecs(60 * 60), this);
+    m_endEdit->setCalendarPopup(true);
+
+    QPushButton *addButton = new QPushButton(tr("Schedule"), this);
+
+    QFormLayout *formLayout = new QFormLayout();
+    formLayout->addRow(tr("Channel:"), m_channelCombo);
+    formLayout->addRow(tr("Start:"), m_startEdit);
+    formLayout->addRow(tr("End:"), m_endEdit);
+    formLayout->addRow("", addButton);
+
+    QPushButton *closeButton = new QPushButton(tr("Close"), this);
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    buttonLayout->addWidget(removeButton);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(closeButton);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->addWidget(m_table);
+    mainLayout->addLayout(buttonLayout);
+    mainLayout->addLayout(formLayout);
+    setLayout(mainLayout);
+
+    // Connect signals
+    connect(addButton, &QPushButton::clicked, this, &RecordingDialog::onAddRecording);
+    connect(removeButton, &QPushButton::clicked, this, &RecordingDialog::onRemoveRecording);
+    connect(closeButton, &QPushButton::clicked, this, &QDialog::accept);
+    connect(m_scheduler, &RecordingScheduler::scheduleChanged, this, &RecordingDialog::updateTable);
+    connect(m_scheduler, &RecordingScheduler::recordingStarted, this, &RecordingDialog::updateTable);
+    connect(m_scheduler, &RecordingScheduler::recordingFinished, this, &RecordingDialog::updateTable);
+
+    updateTable();
+}
+
+void RecordingDialog::onAddRecording()
+{
+    if (m_channelCombo->currentIndex() < 0)
+    {
+        return;
+    }
+
+    if (m_endEdit->dateTime() <= m_startEdit->dateTime() || m_endEdit->dateTime() <= QDateTime::currentDateTime())
+    {
+        QMessageBox::warning(this, tr("Recordings"), tr("The recording must end after it starts and in the future."));
+        return;
+    }
+
+    ScheduledRecording recording;
+    recording.channelName = m_channelCombo->currentText();
+    recording.url = m_channelCombo->currentData().toString();
+    recording.start = m_startEdit->dateTime();
+    recording.end = m_endEdit->dateTime();
+    m_scheduler->schedule(recording);
+}
+
+void RecordingDialog::onRemoveRecording()
+{
+    QSet<int> rows;
+    const QList<QTableWidgetItem *> selected = m_table->selectedItems();
+    for (QTableWidgetItem *item : selected)
+    {
+        rows.insert(item->row());
+    }
+
+    QStringList ids;
+    for (int row : rows)
+    {
+        ids.append(m_table->item(row, 0)->data(Qt::UserRole).toString());
+    }
+
+    for (const QString &id : std::as_const(ids))
+    {
+        m_scheduler->remove(id);
+    }
+}
+
+void RecordingDialog::updateTable()
+{
+    const QList<ScheduledRecording> recordings = m_scheduler->recordings();
+
+    m_table->setRowCount(recordings.size());
+    for (int i = 0; i < recordings.size(); ++i)
+    {
+        const ScheduledRecording &recording = recordings[i];
+
+        QTableWidgetItem *channelItem = new QTableWidgetItem(recording.channelName);
+        channelItem->setData(Qt::UserRole, recording.id);
+        m_table->setItem(i, 0, channelItem);
+        m_table->setItem(i, 1, new QTableWidgetItem(recording.start.toString("yyyy-MM-dd hh:mm")));
+        m_table->setItem(i, 2, new QTableWidgetItem(recording.end.toString("yyyy-MM-dd hh:mm")));
+        m_table->setItem(i, 3, new QTableWidgetItem(m_scheduler->isRecording(recording.id) ? tr("Recording") : tr("Scheduled")));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef RECORDINGDIALOG_H
+#define RECORDINGDIALOG_H
+
+#include <QDialog>
+#include <QTableWidget>
+#include <QComboBox>
+#include <QDateTimeEdit>
+#include <QPushButton>
+#include "../core/recordingscheduler.h"
+#include "../data/channeldata.h"
+
+/**
+ * @brief The RecordingDialog class lists, schedules and cancels recordings
+ */
+class RecordingDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor
+     * @param scheduler Recording scheduler
+     * @param channels Channels that can be recorded
+     * @param parent Parent widget
+     */
+    RecordingDialog(RecordingScheduler *scheduler, const QList<ChannelData> &channels, QWidget *parent = nullptr);
+
+private slots:
+    /**
+     * @brief Schedule a recording from the form
+     */
+    void onAddRecording();
+
+    /**
+     * @brief Stop or cancel the selected recordings
+     */
+    void onRemoveRecording();
+
+    /**
+     * @brief Show the current schedule
+     */
+    void updateTable();
+
+private:
+    RecordingScheduler *m_scheduler;
+    QTableWidget *m_table;
+    QComboBox *m_channelCombo;
+    QDateTimeEdit *m_startEdit;
+    QDateTimeEdit *m_endEdit;
+};
+
+#endif // RECORDINGDIALOG_H
\ No newline at end of file
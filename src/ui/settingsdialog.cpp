@@ -2,9 +2,21 @@
 #include <QDebug>
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QFileInfo>
+#include <QHeaderView>
+
+/**
+ * @brief Limit a spin box to the range the schema allows for a setting
+ * @param spinBox Spin box
+ * @param setting Setting the spin box edits
+ */
+static void setSchemaRange(QSpinBox *spinBox, Setting setting)
+{
+    spinBox->setRange(settingInfo(setting).minimum, settingInfo(setting).maximum);
+}
 
 SettingsDialog::SettingsDialog(Settings *settings, QWidget *parent)
-    : QDialog(parent), m_settings(settings)
+    : QDialog(parent), m_settings(settings), m_diskCache(nullptr)
 {
     setWindowTitle(tr("Settings"));
     setMinimumSize(500, 400);
@@ -61,8 +73,53 @@ QWidget *SettingsDialog::createGeneralTab()
 
     layout->addRow(tr("Channels File:"), channelsFileLayout);
 
+    // Additional channel sources
+    m_sourcesTable = new QTableWidget(0, 3, widget);
+    m_sourcesTable->setHorizontalHeaderLabels({tr("Name"), tr("File"), tr("Priority")});
+    m_sourcesTable->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
+    m_sourcesTable->verticalHeader()->hide();
+    m_sourcesTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_sourcesTable->setToolTip(tr("Lineups merged after the channels file; on duplicates the higher priority wins"));
+
+    QPushButton *addSourceButton = new QPushButton(tr("Add..."), widget);
+    QPushButton *removeSourceButton = new QPushButton(tr("Remove"), widget);
+    QHBoxLayout *sourceButtonsLayout = new QHBoxLayout();
+    sourceButtonsLayout->addWidget(addSourceButton);
+    sourceButtonsLayout->addWidget(removeSourceButton);
+    sourceButtonsLayout->addStretch();
+
+    QVBoxLayout *sourcesLayout = new QVBoxLayout();
+    sourcesLayout->addWidget(m_sourcesTable);
+    sourcesLayout->addLayout(sourceButtonsLayout);
+
+    layout->addRow(tr("Extra Sources:"), sourcesLayout);
+
+    // Programme guide file
+    QHBoxLayout *epgFileLayout = new QHBoxLayout();
+    m_epgFileEdit = new QLineEdit(widget);
+    m_epgFileEdit->setPlaceholderText(tr("XMLTV file"));
+    QPushButton *epgBrowseButton = new QPushButton(tr("Browse..."), widget);
+    epgFileLayout->addWidget(m_epgFileEdit);
+    epgFileLayout->addWidget(epgBrowseButton);
+
+    layout->addRow(tr("Programme Guide:"), epgFileLayout);
+
+    // Programme guide refresh interval
+    m_epgRefreshSpinBox = new QSpinBox(widget);
+    setSchemaRange(m_epgRefreshSpinBox, Setting::EpgRefreshMinutes);
+    m_epgRefreshSpinBox->setSuffix(tr(" minutes"));
+    m_epgRefreshSpinBox->setSpecialValueText(tr("Never"));
+    layout->addRow(tr("Guide Refresh:"), m_epgRefreshSpinBox);
+
+    // Resume positions
+    m_resumePlaybackCheck = new QCheckBox(tr("Resume files and VOD where they were left"), widget);
+    layout->addRow("", m_resumePlaybackCheck);
+
     // Connect signals
     connect(browseButton, &QPushButton::clicked, this, &SettingsDialog::onBrowseChannelsFile);
+    connect(addSourceButton, &QPushButton::clicked, this, &SettingsDialog::onAddChannelSource);
+    connect(removeSourceButton, &QPushButton::clicked, this, &SettingsDialog::onRemoveChannelSource);
+    connect(epgBrowseButton, &QPushButton::clicked, this, &SettingsDialog::onBrowseEpgFile);
 
     return widget;
 }
@@ -95,6 +152,28 @@ QWidget *SettingsDialog::createVideoTab()
     m_keepAspectCheck = new QCheckBox(tr("Maintain aspect ratio"), widget);
     layout->addRow("", m_keepAspectCheck);
 
+    // Seek bar previews
+    m_seekThumbnailsCheck = new QCheckBox(tr("Show thumbnails when hovering the seek bar"), widget);
+    layout->addRow("", m_seekThumbnailsCheck);
+
+    // Performance profile, switched immediately; channels may name their own
+    m_performanceProfileCombo = new QComboBox(widget);
+    m_performanceProfileCombo->addItem(tr("Default"), "");
+    m_performanceProfileCombo->addItem(tr("Low Latency"), "low-latency");
+    m_performanceProfileCombo->addItem(tr("Power Saver"), "power-saver");
+    m_performanceProfileCombo->addItem(tr("Quality"), "quality");
+    m_performanceProfileCombo->setToolTip(tr("Curated decoder, scaling and cache options; overrides the settings above"));
+    layout->addRow(tr("Performance Profile:"), m_performanceProfileCombo);
+
+    // mpv.conf-style file and the profiles from it to use
+    m_mpvConfigFileEdit = new QLineEdit(widget);
+    m_mpvConfigFileEdit->setToolTip(tr("Options and profiles in mpv.conf syntax; the settings above take precedence"));
+    layout->addRow(tr("MPV Config File:"), m_mpvConfigFileEdit);
+
+    m_mpvProfilesEdit = new QLineEdit(widget);
+    m_mpvProfilesEdit->setPlaceholderText(tr("Comma-separated profile names"));
+    layout->addRow(tr("MPV Profiles:"), m_mpvProfilesEdit);
+
     return widget;
 }
 
@@ -131,13 +210,38 @@ QWidget *SettingsDialog::createNetworkTab()
 
     // Cache seconds
     m_cacheSecsSpinBox = new QSpinBox(widget);
-    m_cacheSecsSpinBox->setRange(1, 600);
+    setSchemaRange(m_cacheSecsSpinBox, Setting::CacheSecs);
     m_cacheSecsSpinBox->setSuffix(tr(" seconds"));
     layout->addRow(tr("Cache Duration:"), m_cacheSecsSpinBox);
 
+    // Adaptive cache sizing
+    m_adaptiveCacheCheck = new QCheckBox(tr("Adapt cache duration to measured throughput"), widget);
+    layout->addRow("", m_adaptiveCacheCheck);
+
+    m_cacheMemorySpinBox = new QSpinBox(widget);
+    setSchemaRange(m_cacheMemorySpinBox, Setting::CacheMemoryMB);
+    m_cacheMemorySpinBox->setSuffix(tr(" MB"));
+    layout->addRow(tr("Cache Memory Limit:"), m_cacheMemorySpinBox);
+
+    // Timeshift for live streams
+    m_timeshiftCheck = new QCheckBox(tr("Allow pausing and rewinding live streams"), widget);
+    m_timeshiftCheck->setToolTip(tr("A long window at a high bitrate can use several GB of disk while a channel plays"));
+    layout->addRow("", m_timeshiftCheck);
+
+    m_timeshiftWindowSpinBox = new QSpinBox(widget);
+    setSchemaRange(m_timeshiftWindowSpinBox, Setting::TimeshiftMinutes);
+    m_timeshiftWindowSpinBox->setSuffix(tr(" minutes"));
+    layout->addRow(tr("Timeshift Window:"), m_timeshiftWindowSpinBox);
+
+    m_timeshiftMemorySpinBox = new QSpinBox(widget);
+    setSchemaRange(m_timeshiftMemorySpinBox, Setting::TimeshiftMemoryMB);
+    m_timeshiftMemorySpinBox->setSuffix(tr(" MB"));
+    m_timeshiftMemorySpinBox->setToolTip(tr("Larger windows are kept on disk"));
+    layout->addRow(tr("Timeshift Memory Limit:"), m_timeshiftMemorySpinBox);
+
     // Network timeout
     m_networkTimeoutSpinBox = new QSpinBox(widget);
-    m_networkTimeoutSpinBox->setRange(1, 60);
+    setSchemaRange(m_networkTimeoutSpinBox, Setting::NetworkTimeout);
     m_networkTimeoutSpinBox->setSuffix(tr(" seconds"));
     layout->addRow(tr("Network Timeout:"), m_networkTimeoutSpinBox);
 
@@ -145,40 +249,88 @@ QWidget *SettingsDialog::createNetworkTab()
     m_userAgentEdit = new QLineEdit(widget);
     layout->addRow(tr("User Agent:"), m_userAgentEdit);
 
+    // Local HLS cache
+    m_hlsCacheCheck = new QCheckBox(tr("Cache HLS playlists and segments across channel switches"), widget);
+    layout->addRow("", m_hlsCacheCheck);
+
+    m_hlsCacheSizeSpinBox = new QSpinBox(widget);
+    setSchemaRange(m_hlsCacheSizeSpinBox, Setting::HlsCacheMB);
+    m_hlsCacheSizeSpinBox->setSuffix(tr(" MB"));
+    layout->addRow(tr("HLS Cache Size:"), m_hlsCacheSizeSpinBox);
+
+    // On-disk VOD cache
+    m_vodCacheCheck = new QCheckBox(tr("Keep downloaded parts of VOD files on disk"), widget);
+    layout->addRow("", m_vodCacheCheck);
+
+    m_vodCacheSizeSpinBox = new QSpinBox(widget);
+    setSchemaRange(m_vodCacheSizeSpinBox, Setting::VodCacheMB);
+    m_vodCacheSizeSpinBox->setSingleStep(256);
+    m_vodCacheSizeSpinBox->setSuffix(tr(" MB"));
+    layout->addRow(tr("VOD Cache Size:"), m_vodCacheSizeSpinBox);
+
+    m_vodCacheStatsLabel = new QLabel(widget);
+    m_clearVodCacheButton = new QPushButton(tr("Clear"), widget);
+    m_clearVodCacheButton->setEnabled(false);
+    QHBoxLayout *statsLayout = new QHBoxLayout();
+    statsLayout->addWidget(m_vodCacheStatsLabel, 1);
+    statsLayout->addWidget(m_clearVodCacheButton);
+    layout->addRow(tr("VOD Cache Usage:"), statsLayout);
+
+    connect(m_clearVodCacheButton, &QPushButton::clicked, this, &SettingsDialog::onClearDiskCache);
+
     return widget;
 }
 
 void SettingsDialog::loadSettings()
 {
     // General settings
-    m_channelsFileEdit->setText(m_settings->value("channelsFile").toString());
+    m_channelsFileEdit->setText(m_settings->get<Setting::ChannelsFile>());
+
+    const QList<ChannelSource> sources = m_settings->channelSources();
+    m_sourcesTable->setRowCount(sources.size());
+    for (int i = 0; i < sources.size(); ++i)
+    {
+        m_sourcesTable->setItem(i, 0, new QTableWidgetItem(sources[i].name));
+        m_sourcesTable->setItem(i, 1, new QTableWidgetItem(sources[i].path));
+        QTableWidgetItem *priorityItem = new QTableWidgetItem();
+        priorityItem->setData(Qt::EditRole, sources[i].priority);
+        m_sourcesTable->setItem(i, 2, priorityItem);
+    }
+    m_epgFileEdit->setText(m_settings->get<Setting::EpgFile>());
+    m_epgRefreshSpinBox->setValue(m_settings->get<Setting::EpgRefreshMinutes>());
+    m_resumePlaybackCheck->setChecked(m_settings->get<Setting::ResumePlayback>());
 
     // Video settings
-    QString vo = m_settings->mpvValue("vo", "gpu").toString();
+    QString vo = m_settings->get<Setting::Vo>();
     int voIndex = m_videoOutputCombo->findData(vo);
     if (voIndex >= 0)
     {
         m_videoOutputCombo->setCurrentIndex(voIndex);
     }
 
-    QString hwdec = m_settings->mpvValue("hwdec", "auto").toString();
+    QString hwdec = m_settings->get<Setting::Hwdec>();
     int hwdecIndex = m_hwdecCombo->findData(hwdec);
     if (hwdecIndex >= 0)
     {
         m_hwdecCombo->setCurrentIndex(hwdecIndex);
     }
 
-    m_keepAspectCheck->setChecked(m_settings->mpvValue("keepaspect", true).toBool());
+    m_keepAspectCheck->setChecked(m_settings->get<Setting::KeepAspect>());
+    m_seekThumbnailsCheck->setChecked(m_settings->get<Setting::SeekThumbnails>());
+    m_mpvConfigFileEdit->setText(m_settings->get<Setting::MpvConfigFile>());
+    int profileIndex = m_performanceProfileCombo->findData(m_settings->get<Setting::PerformanceProfile>());
+    m_performanceProfileCombo->setCurrentIndex(profileIndex >= 0 ? profileIndex : 0);
+    m_mpvProfilesEdit->setText(m_settings->get<Setting::MpvProfiles>());
 
     // Audio settings
-    QString audioChannels = m_settings->mpvValue("audio-channels", "auto").toString();
+    QString audioChannels = m_settings->get<Setting::AudioChannels>();
     int audioChannelsIndex = m_audioChannelsCombo->findData(audioChannels);
     if (audioChannelsIndex >= 0)
     {
         m_audioChannelsCombo->setCurrentIndex(audioChannelsIndex);
     }
 
-    QString audioDevice = m_settings->mpvValue("audio-device", "auto").toString();
+    QString audioDevice = m_settings->get<Setting::AudioDevice>();
     int audioDeviceIndex = m_audioDeviceCombo->findData(audioDevice);
     if (audioDeviceIndex >= 0)
     {
@@ -186,31 +338,71 @@ void SettingsDialog::loadSettings()
     }
 
     // Network settings
-    m_cacheCheck->setChecked(m_settings->mpvValue("cache", true).toBool());
-    m_cacheSecsSpinBox->setValue(m_settings->mpvValue("cache-secs", 10).toInt());
-    m_networkTimeoutSpinBox->setValue(m_settings->mpvValue("network-timeout", 5).toInt());
-    m_userAgentEdit->setText(m_settings->mpvValue("user-agent", "HarperTV/1.0").toString());
+    m_cacheCheck->setChecked(m_settings->get<Setting::Cache>());
+    m_cacheSecsSpinBox->setValue(m_settings->get<Setting::CacheSecs>());
+    m_adaptiveCacheCheck->setChecked(m_settings->get<Setting::AdaptiveCache>());
+    m_cacheMemorySpinBox->setValue(m_settings->get<Setting::CacheMemoryMB>());
+    m_timeshiftCheck->setChecked(m_settings->get<Setting::Timeshift>());
+    m_timeshiftWindowSpinBox->setValue(m_settings->get<Setting::TimeshiftMinutes>());
+    m_timeshiftMemorySpinBox->setValue(m_settings->get<Setting::TimeshiftMemoryMB>());
+    m_networkTimeoutSpinBox->setValue(m_settings->get<Setting::NetworkTimeout>());
+    m_userAgentEdit->setText(m_settings->get<Setting::UserAgent>());
+    m_hlsCacheCheck->setChecked(m_settings->get<Setting::HlsCache>());
+    m_hlsCacheSizeSpinBox->setValue(m_settings->get<Setting::HlsCacheMB>());
+    m_vodCacheCheck->setChecked(m_settings->get<Setting::VodCache>());
+    m_vodCacheSizeSpinBox->setValue(m_settings->get<Setting::VodCacheMB>());
+    updateDiskCacheStats();
 }
 
 void SettingsDialog::saveSettings()
 {
     // General settings
-    m_settings->setValue("channelsFile", m_channelsFileEdit->text());
+    m_settings->set<Setting::ChannelsFile>(m_channelsFileEdit->text());
+
+    QList<ChannelSource> sources;
+    for (int i = 0; i < m_sourcesTable->rowCount(); ++i)
+    {
+        ChannelSource source;
+        source.name = m_sourcesTable->item(i, 0) ? m_sourcesTable->item(i, 0)->text() : QString();
+        source.path = m_sourcesTable->item(i, 1) ? m_sourcesTable->item(i, 1)->text() : QString();
+        source.priority = m_sourcesTable->item(i, 2) ? m_sourcesTable->item(i, 2)->data(Qt::EditRole).toInt() : 0;
+        if (!source.path.isEmpty())
+        {
+            sources.append(source);
+        }
+    }
+    m_settings->setChannelSources(sources);
+    m_settings->set<Setting::EpgFile>(m_epgFileEdit->text());
+    m_settings->set<Setting::EpgRefreshMinutes>(m_epgRefreshSpinBox->value());
+    m_settings->set<Setting::ResumePlayback>(m_resumePlaybackCheck->isChecked());
 
     // Video settings
-    m_settings->setMpvValue("vo", m_videoOutputCombo->currentData());
-    m_settings->setMpvValue("hwdec", m_hwdecCombo->currentData());
-    m_settings->setMpvValue("keepaspect", m_keepAspectCheck->isChecked());
+    m_settings->set<Setting::Vo>(m_videoOutputCombo->currentData().toString());
+    m_settings->set<Setting::Hwdec>(m_hwdecCombo->currentData().toString());
+    m_settings->set<Setting::KeepAspect>(m_keepAspectCheck->isChecked());
+    m_settings->set<Setting::SeekThumbnails>(m_seekThumbnailsCheck->isChecked());
+    m_settings->set<Setting::MpvConfigFile>(m_mpvConfigFileEdit->text());
+    m_settings->set<Setting::PerformanceProfile>(m_performanceProfileCombo->currentData().toString());
+    m_settings->set<Setting::MpvProfiles>(m_mpvProfilesEdit->text());
 
     // Audio settings
-    m_settings->setMpvValue("audio-channels", m_audioChannelsCombo->currentData());
-    m_settings->setMpvValue("audio-device", m_audioDeviceCombo->currentData());
+    m_settings->set<Setting::AudioChannels>(m_audioChannelsCombo->currentData().toString());
+    m_settings->set<Setting::AudioDevice>(m_audioDeviceCombo->currentData().toString());
 
     // Network settings
-    m_settings->setMpvValue("cache", m_cacheCheck->isChecked());
-    m_settings->setMpvValue("cache-secs", m_cacheSecsSpinBox->value());
-    m_settings->setMpvValue("network-timeout", m_networkTimeoutSpinBox->value());
-    m_settings->setMpvValue("user-agent", m_userAgentEdit->text());
+    m_settings->set<Setting::Cache>(m_cacheCheck->isChecked());
+    m_settings->set<Setting::CacheSecs>(m_cacheSecsSpinBox->value());
+    m_settings->set<Setting::AdaptiveCache>(m_adaptiveCacheCheck->isChecked());
+    m_settings->set<Setting::CacheMemoryMB>(m_cacheMemorySpinBox->value());
+    m_settings->set<Setting::Timeshift>(m_timeshiftCheck->isChecked());
+    m_settings->set<Setting::TimeshiftMinutes>(m_timeshiftWindowSpinBox->value());
+    m_settings->set<Setting::TimeshiftMemoryMB>(m_timeshiftMemorySpinBox->value());
+    m_settings->set<Setting::NetworkTimeout>(m_networkTimeoutSpinBox->value());
+    m_settings->set<Setting::UserAgent>(m_userAgentEdit->text());
+    m_settings->set<Setting::HlsCache>(m_hlsCacheCheck->isChecked());
+    m_settings->set<Setting::HlsCacheMB>(m_hlsCacheSizeSpinBox->value());
+    m_settings->set<Setting::VodCache>(m_vodCacheCheck->isChecked());
+    m_settings->set<Setting::VodCacheMB>(m_vodCacheSizeSpinBox->value());
 
     // Save settings
     m_settings->save();
@@ -248,10 +440,90 @@ void SettingsDialog::onBrowseChannelsFile()
         this,
         tr("Select Channels File"),
         QString(),
-        tr("JSON Files (*.json);;All Files (*.*)"));
+        tr("Channel Lists (*.json *.m3u *.m3u8);;All Files (*.*)"));
 
     if (!filePath.isEmpty())
     {
         m_channelsFileEdit->setText(filePath);
     }
+}
+
+void SettingsDialog::onBrowseEpgFile()
+{
+    QString filePath = QFileDialog::getOpenFileName(
+        this,
+        tr("Select Programme Guide"),
+        QString(),
+        tr("XMLTV Files (*.xml);;All Files (*.*)"));
+
+    if (!filePath.isEmpty())
+    {
+        m_epgFileEdit->setText(filePath);
+    }
+}
+
+void SettingsDialog::onAddChannelSource()
+{
+    QString filePath = QFileDialog::getOpenFileName(
+        this,
+        tr("Select Channel Source"),
+        QString(),
+        tr("Channel Lists (*.json *.m3u *.m3u8);;All Files (*.*)"));
+
+    if (filePath.isEmpty())
+    {
+        return;
+    }
+
+    // Later sources default to overriding earlier ones
+    int row = m_sourcesTable->rowCount();
+    m_sourcesTable->insertRow(row);
+    m_sourcesTable->setItem(row, 0, new QTableWidgetItem(QFileInfo(filePath).completeBaseName()));
+    m_sourcesTable->setItem(row, 1, new QTableWidgetItem(filePath));
+    QTableWidgetItem *priorityItem = new QTableWidgetItem();
+    priorityItem->setData(Qt::EditRole, row + 1);
+    m_sourcesTable->setItem(row, 2, priorityItem);
+}
+
+void SettingsDialog::onRemoveChannelSource()
+{
+    int row = m_sourcesTable->currentRow();
+    if (row >= 0)
+    {
+        m_sourcesTable->removeRow(row);
+    }
+}
+
+void SettingsDialog::setDiskCache(VodCache *cache)
+{
+    m_diskCache = cache;
+    m_clearVodCacheButton->setEnabled(cache != nullptr);
+    updateDiskCacheStats();
+}
+
+void SettingsDialog::onClearDiskCache()
+{
+    if (!m_diskCache)
+    {
+        return;
+    }
+
+    m_diskCache->clear();
+    updateDiskCacheStats();
+}
+
+void SettingsDialog::updateDiskCacheStats()
+{
+    if (!m_diskCache)
+    {
+        m_vodCacheStatsLabel->setText(tr("Not available"));
+        return;
+    }
+
+    VodCache::Stats stats = m_diskCache->stats();
+    m_vodCacheStatsLabel->setText(tr("%1 of %2 MB in %3 titles, %4% served from disk")
+                                      .arg(stats.usedBytes / (1024 * 1024))
+                                      .arg(stats.quotaBytes / (1024 * 1024))
+                                      .arg(stats.titles)
+                                      .arg(qRound(stats.hitRatio() * 100)));
 }
\ No newline at end of file
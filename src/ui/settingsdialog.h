@@ -12,7 +12,9 @@
 #include <QSpinBox>
 #include <QCheckBox>
 #include <QPushButton>
+#include <QTableWidget>
 #include "../data/settings.h"
+#include "../core/vodcache.h"
 
 /**
  * @brief The SettingsDialog class provides UI for configuring settings
@@ -34,6 +36,12 @@ public:
      */
     ~SettingsDialog();
 
+    /**
+     * @brief Show statistics and controls for the VOD disk cache
+     * @param cache VOD cache, null to hide the statistics
+     */
+    void setDiskCache(VodCache *cache);
+
 private slots:
     /**
      * @brief Save settings and close dialog
@@ -55,6 +63,26 @@ private slots:
      */
     void onBrowseChannelsFile();
 
+    /**
+     * @brief Browse for programme guide file
+     */
+    void onBrowseEpgFile();
+
+    /**
+     * @brief Add a channel source
+     */
+    void onAddChannelSource();
+
+    /**
+     * @brief Remove the selected channel source
+     */
+    void onRemoveChannelSource();
+
+    /**
+     * @brief Remove everything from the VOD disk cache
+     */
+    void onClearDiskCache();
+
 private:
     /**
      * @brief Create general settings tab
@@ -90,16 +118,30 @@ private:
      */
     void saveSettings();
 
+    /**
+     * @brief Show the current VOD disk cache statistics
+     */
+    void updateDiskCacheStats();
+
     Settings *m_settings;
+    VodCache *m_diskCache;
     QTabWidget *m_tabWidget;
 
     // General settings
     QLineEdit *m_channelsFileEdit;
+    QTableWidget *m_sourcesTable;
+    QLineEdit *m_epgFileEdit;
+    QSpinBox *m_epgRefreshSpinBox;
+    QCheckBox *m_resumePlaybackCheck;
 
     // Video settings
     QComboBox *m_videoOutputCombo;
     QComboBox *m_hwdecCombo;
     QCheckBox *m_keepAspectCheck;
+    QCheckBox *m_seekThumbnailsCheck;
+    QComboBox *m_performanceProfileCombo;
+    QLineEdit *m_mpvConfigFileEdit;
+    QLineEdit *m_mpvProfilesEdit;
 
     // Audio settings
     QComboBox *m_audioChannelsCombo;
@@ -108,8 +150,19 @@ private:
     // Network settings
     QCheckBox *m_cacheCheck;
     QSpinBox *m_cacheSecsSpinBox;
+    QCheckBox *m_adaptiveCacheCheck;
+    QSpinBox *m_cacheMemorySpinBox;
+    QCheckBox *m_timeshiftCheck;
+    QSpinBox *m_timeshiftWindowSpinBox;
+    QSpinBox *m_timeshiftMemorySpinBox;
     QSpinBox *m_networkTimeoutSpinBox;
     QLineEdit *m_userAgentEdit;
+    QCheckBox *m_hlsCacheCheck;
+    QSpinBox *m_hlsCacheSizeSpinBox;
+    QCheckBox *m_vodCacheCheck;
+    QSpinBox *m_vodCacheSizeSpinBox;
+    QLabel *m_vodCacheStatsLabel;
+    QPushButton *m_clearVodCacheButton;
 
     // Buttons
     QPushButton *m_okButton;
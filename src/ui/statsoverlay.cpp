@@ -0,0 +1,315 @@
+#include "statsoverlay.h"
+#include <QDebug>
+#include <QImage>
+#include <QPainter>
+#include <QFont>
+#include <QFontMetrics>
+#include <QFontDatabase>
+#include <QOpenGLContext>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QVector2D>
+
+// Printable ASCII; the last cell, DEL, is filled solid for the panel
+static const int FIRST_GLYPH = 32;
+static const int GLYPH_COUNT = 96;
+static const int SOLID_GLYPH = GLYPH_COUNT - 1;
+static const int ATLAS_COLUMNS = 16;
+
+static const int FONT_PIXEL_SIZE = 13;
+static const int MARGIN = 10;
+static const int PADDING = 6;
+
+// x, y, u, v, r, g, b, a
+static const int VERTEX_FLOATS = 8;
+
+static const float TEXT_COLOR[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+static const float PANEL_COLOR[4] = {0.0f, 0.0f, 0.0f, 0.6f};
+
+static const char *VERTEX_SHADER = R"(
+attribute vec2 position;
+attribute vec2 texCoord;
+attribute vec4 color;
+uniform vec2 viewport;
+varying vec2 vTexCoord;
+varying vec4 vColor;
+void main()
+{
+    gl_Position = vec4(position.x / viewport.x * 2.0 - 1.0, 1.0 - position.y / viewport.y * 2.0, 0.0, 1.0);
+    vTexCoord = texCoord;
+    vColor = color;
+}
+)";
+
+static const char *FRAGMENT_SHADER = R"(
+uniform sampler2D atlas;
+varying vec2 vTexCoord;
+varying vec4 vColor;
+void main()
+{
+    gl_FragColor = vec4(vColor.rgb, vColor.a * texture2D(atlas, vTexCoord).a);
+}
+)";
+
+StatsOverlay::StatsOverlay()
+    : m_program(nullptr), m_atlas(nullptr), m_vertexBuffer(QOpenGLBuffer::VertexBuffer), m_atlasRatio(0.0), m_vertexCount(0), m_initialized(false), m_dirty(true)
+{
+}
+
+StatsOverlay::~StatsOverlay()
+{
+    if (m_initialized)
+    {
+        qWarning() << "StatsOverlay destroyed without releasing its GL resources";
+    }
+}
+
+void StatsOverlay::setLines(const QStringList &lines)
+{
+    if (lines == m_lines)
+    {
+        return;
+    }
+
+    m_lines = lines;
+    m_dirty = true;
+}
+
+void StatsOverlay::paint(const QSize &viewport, qreal devicePixelRatio)
+{
+    if (m_lines.isEmpty() || viewport.isEmpty())
+    {
+        return;
+    }
+
+    if (!m_initialized && !initialize(devicePixelRatio))
+    {
+        return;
+    }
+
+    // Moving to a screen with another scale needs glyphs of another size
+    if (!qFuzzyCompare(devicePixelRatio, m_atlasRatio))
+    {
+        buildAtlas(devicePixelRatio);
+        m_dirty = true;
+    }
+
+    if (m_dirty)
+    {
+        buildVertices();
+    }
+
+    if (m_vertexCount == 0)
+    {
+        return;
+    }
+
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+
+    glViewport(0, 0, viewport.width(), viewport.height());
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_SCISSOR_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    m_program->bind();
+    m_program->setUniformValue("viewport", QVector2D(viewport.width(), viewport.height()));
+    m_program->setUniformValue("atlas", 0);
+
+    glActiveTexture(GL_TEXTURE0);
+    m_atlas->bind();
+    m_vertexBuffer.bind();
+
+    const int stride = VERTEX_FLOATS * sizeof(float);
+    m_program->enableAttributeArray("position");
+    m_program->enableAttributeArray("texCoord");
+    m_program->enableAttributeArray("color");
+    m_program->setAttributeBuffer("position", GL_FLOAT, 0, 2, stride);
+    m_program->setAttributeBuffer("texCoord", GL_FLOAT, 2 * sizeof(float), 2, stride);
+    m_program->setAttributeBuffer("color", GL_FLOAT, 4 * sizeof(float), 4, stride);
+
+    glDrawArrays(GL_TRIANGLES, 0, m_vertexCount);
+
+    m_program->disableAttributeArray("position");
+    m_program->disableAttributeArray("texCoord");
+    m_program->disableAttributeArray("color");
+    m_vertexBuffer.release();
+    m_atlas->release();
+    m_program->release();
+    glDisable(GL_BLEND);
+}
+
+void StatsOverlay::cleanup()
+{
+    if (!m_initialized)
+    {
+        return;
+    }
+
+    delete m_atlas;
+    m_atlas = nullptr;
+    delete m_program;
+    m_program = nullptr;
+    m_vertexBuffer.destroy();
+    m_vao.destroy();
+
+    m_atlasRatio = 0.0;
+    m_vertexCount = 0;
+    m_initialized = false;
+    m_dirty = true;
+}
+
+bool StatsOverlay::initialize(qreal devicePixelRatio)
+{
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    if (!context)
+    {
+        return false;
+    }
+
+    initializeOpenGLFunctions();
+
+    // Written for GLSL 1.20 / ES 2.0; a core profile needs the 1.50 spelling
+    QByteArray vertexSource;
+    QByteArray fragmentSource;
+    if (context->isOpenGLES())
+    {
+        fragmentSource = "precision mediump float;\n";
+    }
+    else if (context->format().profile() == QSurfaceFormat::CoreProfile)
+    {
+        vertexSource = "#version 150\n#define attribute in\n#define varying out\n";
+        fragmentSource = "#version 150\n#define varying in\n#define texture2D texture\n"
+                         "out vec4 fragColor;\n#define gl_FragColor fragColor\n";
+    }
+    vertexSource += VERTEX_SHADER;
+    fragmentSource += FRAGMENT_SHADER;
+
+    m_program = new QOpenGLShaderProgram();
+    if (!m_program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexSource) ||
+        !m_program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentSource) ||
+        !m_program->link())
+    {
+        qWarning() << "Could not build the stats overlay shader:" << m_program->log();
+        delete m_program;
+        m_program = nullptr;
+        return false;
+    }
+
+    // Core profiles draw nothing without one; elsewhere it is optional
+    m_vao.create();
+
+    m_vertexBuffer.create();
+    m_vertexBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+
+    m_initialized = true;
+    buildAtlas(devicePixelRatio);
+    return true;
+}
+
+void StatsOverlay::buildAtlas(qreal devicePixelRatio)
+{
+    QFont font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+    font.setPixelSize(qRound(FONT_PIXEL_SIZE * devicePixelRatio));
+    font.setStyleStrategy(QFont::PreferAntialias);
+    QFontMetrics metrics(font);
+
+    // One fixed cell per character, so laying out a line is a multiplication
+    m_cellSize = QSize(metrics.horizontalAdvance(QLatin1Char('M')), metrics.height());
+    const int rows = (GLYPH_COUNT + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS;
+    QImage image(m_cellSize.width() * ATLAS_COLUMNS, m_cellSize.height() * rows, QImage::Format_RGBA8888);
+    image.fill(Qt::transparent);
+
+    m_glyphs.resize(GLYPH_COUNT);
+    QPainter painter(&image);
+    painter.setFont(font);
+    painter.setPen(Qt::white);
+    for (int i = 0; i < GLYPH_COUNT; ++i)
+    {
+        QRect cell((i % ATLAS_COLUMNS) * m_cellSize.width(), (i / ATLAS_COLUMNS) * m_cellSize.height(),
+                   m_cellSize.width(), m_cellSize.height());
+        if (i == SOLID_GLYPH)
+        {
+            painter.fillRect(cell, Qt::white);
+        }
+        else
+        {
+            painter.drawText(cell.left(), cell.top() + metrics.ascent(), QString(QChar(FIRST_GLYPH + i)));
+        }
+
+        m_glyphs[i] = QRectF(double(cell.left()) / image.width(), double(cell.top()) / image.height(),
+                             double(cell.width()) / image.width(), double(cell.height()) / image.height());
+    }
+    painter.end();
+
+    delete m_atlas;
+    m_atlas = new QOpenGLTexture(image, QOpenGLTexture::DontGenerateMipMaps);
+
+    // Quads land on whole pixels at the atlas' own scale, so nothing needs filtering
+    m_atlas->setMinificationFilter(QOpenGLTexture::Nearest);
+    m_atlas->setMagnificationFilter(QOpenGLTexture::Nearest);
+    m_atlas->setWrapMode(QOpenGLTexture::ClampToEdge);
+    m_atlasRatio = devicePixelRatio;
+}
+
+void StatsOverlay::buildVertices()
+{
+    m_dirty = false;
+
+    int columns = 0;
+    for (const QString &line : std::as_const(m_lines))
+    {
+        columns = qMax(columns, int(line.size()));
+    }
+
+    const int margin = qRound(MARGIN * m_atlasRatio);
+    const int padding = qRound(PADDING * m_atlasRatio);
+    const QRectF panel(margin, margin, columns * m_cellSize.width() + 2 * padding,
+                       m_lines.size() * m_cellSize.height() + 2 * padding);
+
+    QVector<float> vertices;
+    vertices.reserve((1 + m_lines.size() * columns) * 6 * VERTEX_FLOATS);
+
+    // Sampled at the centre of the solid cell, the whole panel gets full coverage
+    const QRectF solid = m_glyphs[SOLID_GLYPH];
+    appendQuad(vertices, panel, QRectF(solid.center(), QSizeF(0.0, 0.0)), PANEL_COLOR);
+
+    double y = panel.top() + padding;
+    for (const QString &line : std::as_const(m_lines))
+    {
+        double x = panel.left() + padding;
+        for (QChar ch : line)
+        {
+            ushort code = ch.unicode();
+            if (code != ' ')
+            {
+                int glyph = code > FIRST_GLYPH && code < FIRST_GLYPH + SOLID_GLYPH ? code - FIRST_GLYPH : '?' - FIRST_GLYPH;
+                appendQuad(vertices, QRectF(x, y, m_cellSize.width(), m_cellSize.height()), m_glyphs[glyph], TEXT_COLOR);
+            }
+            x += m_cellSize.width();
+        }
+        y += m_cellSize.height();
+    }
+
+    m_vertexCount = vertices.size() / VERTEX_FLOATS;
+    m_vertexBuffer.bind();
+    m_vertexBuffer.allocate(vertices.constData(), int(vertices.size() * sizeof(float)));
+    m_vertexBuffer.release();
+}
+
+void StatsOverlay::appendQuad(QVector<float> &vertices, const QRectF &rect, const QRectF &texture, const float color[4])
+{
+    const float corners[6][4] = {
+        {float(rect.left()), float(rect.top()), float(texture.left()), float(texture.top())},
+        {float(rect.right()), float(rect.top()), float(texture.right()), float(texture.top())},
+        {float(rect.left()), float(rect.bottom()), float(texture.left()), float(texture.bottom())},
+        {float(rect.right()), float(rect.top()), float(texture.right()), float(texture.top())},
+        {float(rect.right()), float(rect.bottom()), float(texture.right()), float(texture.bottom())},
+        {float(rect.left()), float(rect.bottom()), float(texture.left()), float(texture.bottom())}};
+
+    for (const auto &corner : corners)
+    {
+        vertices << corner[0] << corner[1] << corner[2] << corner[3]
+                 << color[0] << color[1] << color[2] << color[3];
+    }
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#ifndef STATSOVERLAY_H
+#define STATSOVERLAY_H
+
+#include <QStringList>
+#include <QSize>
+#include <QRectF>
+#include <QVector>
+#include <QOpenGLFunctions>
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+
+class QOpenGLShaderProgram;
+class QOpenGLTexture;
+
+/**
+ * @brief The StatsOverlay class draws lines of text on top of the video with OpenGL
+ *
+ * The printable ASCII characters of a monospace font are rendered once into
+ * a glyph atlas texture. Changing the text only rebuilds a small vertex
+ * buffer of textured quads; each frame then costs one draw call, with no
+ * QPainter and no texture upload. The panel behind the text comes from a
+ * solid cell of the same atlas, so it is part of the same draw call.
+ *
+ * All methods that touch GL must be called with the widget's context current.
+ */
+class StatsOverlay : protected QOpenGLFunctions
+{
+public:
+    /**
+     * @brief Constructor
+     */
+    StatsOverlay();
+
+    /**
+     * @brief Destructor; GL resources must have been released with cleanup()
+     */
+    ~StatsOverlay();
+
+    /**
+     * @brief Set the text to show
+     * @param lines Lines from top to bottom; characters outside ASCII show as '?'
+     */
+    void setLines(const QStringList &lines);
+
+    /**
+     * @brief Draw the overlay into the bound framebuffer
+     * @param viewport Framebuffer size in device pixels
+     * @param devicePixelRatio Ratio of device pixels to logical pixels
+     */
+    void paint(const QSize &viewport, qreal devicePixelRatio);
+
+    /**
+     * @brief Release the GL resources, e.g. before the context goes away
+     */
+    void cleanup();
+
+private:
+    /**
+     * @brief Create the shader program, buffers and atlas for the current context
+     * @param devicePixelRatio Ratio of device pixels to logical pixels
+     * @return True if the overlay can be drawn
+     */
+    bool initialize(qreal devicePixelRatio);
+
+    /**
+     * @brief Render the glyph atlas and upload it
+     * @param devicePixelRatio Ratio of device pixels to logical pixels
+     */
+    void buildAtlas(qreal devicePixelRatio);
+
+    /**
+     * @brief Lay out the text as quads and upload them
+     */
+    void buildVertices();
+
+    /**
+     * @brief Append one quad
+     * @param vertices Vertex data to append to
+     * @param rect Position in device pixels
+     * @param texture Atlas coordinates
+     * @param color Colour as RGBA
+     */
+    static void appendQuad(QVector<float> &vertices, const QRectF &rect, const QRectF &texture, const float color[4]);
+
+    QOpenGLShaderProgram *m_program;
+    QOpenGLTexture *m_atlas;
+    QOpenGLBuffer m_vertexBuffer;
+    QOpenGLVertexArrayObject m_vao;
+    QVector<QRectF> m_glyphs;
+    QSize m_cellSize;
+    qreal m_atlasRatio;
+    QStringList m_lines;
+    int m_vertexCount;
+    bool m_initialized;
+    bool m_dirty;
+};
+
+#endif // STATSOVERLAY_H
\ No newline at end of file
@@ -6,6 +6,21 @@
 #include <QOpenGLFunctions>
 #include <QVBoxLayout>
 #include <QDebug>
+#include <algorithm>
+
+// Overlay text of unavailable figures
+static const char *NOT_AVAILABLE = "-";
+
+/**
+ * @brief Format a figure of the stats overlay
+ * @param value Value, negative if unavailable
+ * @param precision Digits after the decimal point
+ * @return Formatted value
+ */
+static QString formatStat(double value, int precision)
+{
+    return value < 0.0 ? QString(NOT_AVAILABLE) : QString::number(value, 'f', precision);
+}
 
 VideoWidget::GLWidget::GLWidget(VideoWidget *videoWidget)
     : QOpenGLWidget(videoWidget), m_videoWidget(videoWidget), m_fbo(nullptr)
@@ -24,6 +39,12 @@ VideoWidget::GLWidget::GLWidget(VideoWidget *videoWidget)
 
 VideoWidget::GLWidget::~GLWidget()
 {
+    // The video widget has released the overlay already and is mostly gone
+    if (context())
+    {
+        context()->disconnect(this);
+    }
+
     makeCurrent();
     delete m_fbo;
     doneCurrent();
@@ -61,6 +82,13 @@ void VideoWidget::GLWidget::initializeGL()
     qDebug() << "GLWidget::initializeGL() - OpenGL functions obtained";
     f->glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
+    // A new context comes with reparenting, e.g. into fullscreen; the overlay's resources belong to the old one
+    QObject::connect(context, &QOpenGLContext::aboutToBeDestroyed, this, [this]()
+                     {
+        makeCurrent();
+        m_videoWidget->releaseOverlay();
+        doneCurrent(); });
+
     // Create framebuffer object with error handling
     try
     {
@@ -121,6 +149,7 @@ void VideoWidget::GLWidget::paintGL()
     try
     {
         m_videoWidget->renderFrame();
+        m_videoWidget->paintOverlay();
     }
     catch (const std::exception &e)
     {
@@ -185,7 +214,7 @@ void VideoWidget::GLWidget::resizeGL(int width, int height)
 }
 
 VideoWidget::VideoWidget(MPVCore *mpvCore, QWidget *parent)
-    : QWidget(parent), m_mpvCore(mpvCore), m_glWidget(new GLWidget(this)), m_keepAspect(true)
+    : QWidget(parent), m_mpvCore(mpvCore), m_glWidget(new GLWidget(this)), m_keepAspect(true), m_stats(nullptr), m_statsVisible(false), m_paintCount(0), m_renderCount(0), m_renderNsecs(0), m_overlayCount(0), m_overlayNsecs(0), m_measureFrames(0)
 {
     // Set up layout
     QVBoxLayout *layout = new QVBoxLayout(this);
@@ -200,6 +229,9 @@ VideoWidget::VideoWidget(MPVCore *mpvCore, QWidget *parent)
     if (m_mpvCore)
     {
         connect(m_mpvCore, &MPVCore::frameSwapped, this, &VideoWidget::onFrameSwapped);
+        // Direct, so the renderer is gone before the old instance is
+        connect(m_mpvCore, &MPVCore::aboutToRestart, this, &VideoWidget::onAboutToRestart, Qt::DirectConnection);
+        connect(m_mpvCore, &MPVCore::coreRestarted, this, &VideoWidget::onCoreRestarted);
     }
 
     // Set up update timer
@@ -213,6 +245,9 @@ VideoWidget::VideoWidget(MPVCore *mpvCore, QWidget *parent)
 
 VideoWidget::~VideoWidget()
 {
+    m_glWidget->makeCurrent();
+    releaseOverlay();
+    m_glWidget->doneCurrent();
 }
 
 void VideoWidget::setKeepAspect(bool keepAspect)
@@ -226,6 +261,58 @@ bool VideoWidget::keepAspect() const
     return m_keepAspect;
 }
 
+void VideoWidget::setPlaybackStats(PlaybackStats *stats)
+{
+    if (m_stats)
+    {
+        disconnect(m_stats, &PlaybackStats::updated, this, &VideoWidget::onStatsUpdated);
+    }
+
+    m_stats = stats;
+    if (m_stats)
+    {
+        connect(m_stats, &PlaybackStats::updated, this, &VideoWidget::onStatsUpdated);
+        m_stats->setEnabled(m_statsVisible);
+    }
+}
+
+void VideoWidget::setStatsVisible(bool visible)
+{
+    if (visible == m_statsVisible)
+    {
+        return;
+    }
+
+    m_statsVisible = visible;
+    m_paintCount = 0;
+    m_renderCount = 0;
+    m_renderNsecs = 0;
+    m_overlayCount = 0;
+    m_overlayNsecs = 0;
+    m_sampleTimer.start();
+
+    if (m_stats)
+    {
+        m_stats->setEnabled(visible);
+    }
+    if (visible)
+    {
+        onStatsUpdated();
+    }
+    m_glWidget->update();
+}
+
+bool VideoWidget::isStatsVisible() const
+{
+    return m_statsVisible;
+}
+
+void VideoWidget::measureOverlay(int frames)
+{
+    m_measurements.clear();
+    m_measureFrames = qMax(1, frames);
+}
+
 void VideoWidget::resizeEvent(QResizeEvent *event)
 {
     QWidget::resizeEvent(event);
@@ -273,12 +360,63 @@ void VideoWidget::onFrameSwapped()
     m_glWidget->update();
 }
 
+void VideoWidget::onAboutToRestart()
+{
+    m_glWidget->makeCurrent();
+    m_mpvCore->releaseRenderer();
+    m_glWidget->doneCurrent();
+}
+
+void VideoWidget::onCoreRestarted()
+{
+    // The old renderer was released in onAboutToRestart()
+    initializeGL();
+    m_glWidget->update();
+}
+
 void VideoWidget::update()
 {
     // Update the widget periodically
     m_glWidget->update();
 }
 
+void VideoWidget::onStatsUpdated()
+{
+    if (!m_statsVisible)
+    {
+        return;
+    }
+
+    const PlaybackStats::Sample sample = m_stats ? m_stats->sample() : PlaybackStats::Sample();
+
+    // Rates and times are averaged over the frames painted since the last sample
+    double seconds = qMax<qint64>(1, m_sampleTimer.restart()) / 1000.0;
+    double renderMs = m_renderCount > 0 ? m_renderNsecs / 1e6 / m_renderCount : -1.0;
+    double overlayMs = m_overlayCount > 0 ? m_overlayNsecs / 1e6 / m_overlayCount : -1.0;
+    double paintRate = m_paintCount / seconds;
+    m_paintCount = 0;
+    m_renderCount = 0;
+    m_renderNsecs = 0;
+    m_overlayCount = 0;
+    m_overlayNsecs = 0;
+
+    QString decoder = sample.hwdec.isEmpty() ? QString(NOT_AVAILABLE) : (sample.hwdec == "no" ? QString("software") : sample.hwdec);
+
+    QStringList lines;
+    lines << QString("Render   %1 ms   paint %2 Hz").arg(formatStat(renderMs, 2), formatStat(paintRate, 1))
+          << QString("Frames   dropped %1   decoder %2   delayed %3")
+                 .arg(sample.droppedFrames < 0 ? QString(NOT_AVAILABLE) : QString::number(sample.droppedFrames),
+                      sample.decoderDroppedFrames < 0 ? QString(NOT_AVAILABLE) : QString::number(sample.decoderDroppedFrames),
+                      sample.delayedFrames < 0 ? QString(NOT_AVAILABLE) : QString::number(sample.delayedFrames))
+          << QString("Decoder  %1   %2 fps").arg(decoder, formatStat(sample.estimatedFps, 2))
+          << QString("Cache    %1 s   %2 MB/s").arg(formatStat(sample.cacheSeconds, 1), formatStat(sample.cacheSpeed < 0 ? -1.0 : sample.cacheSpeed / 1e6, 2))
+          << QString("Bitrate  %1 Mbit/s").arg(formatStat(sample.bitrate < 0 ? -1.0 : sample.bitrate / 1e6, 2))
+          << QString("Live     %1 s behind").arg(formatStat(sample.liveDelay, 1))
+          << QString("Overlay  %1 ms").arg(formatStat(overlayMs, 3));
+    m_overlay.setLines(lines);
+    m_glWidget->update();
+}
+
 void VideoWidget::initializeGL()
 {
     qDebug() << "VideoWidget::initializeGL() - Starting OpenGL initialization";
@@ -474,7 +612,18 @@ void VideoWidget::renderFrame()
             qDebug() << "VideoWidget::renderFrame() - Rendering frame to FBO"
                      << fbo->handle() << "size:" << m_glWidget->width() << "x" << m_glWidget->height();
         }
-        m_mpvCore->renderFrame(fbo->handle(), m_glWidget->width(), m_glWidget->height());
+        if (m_statsVisible)
+        {
+            QElapsedTimer renderTimer;
+            renderTimer.start();
+            m_mpvCore->renderFrame(fbo->handle(), m_glWidget->width(), m_glWidget->height());
+            m_renderNsecs += renderTimer.nsecsElapsed();
+            ++m_renderCount;
+        }
+        else
+        {
+            m_mpvCore->renderFrame(fbo->handle(), m_glWidget->width(), m_glWidget->height());
+        }
     }
     catch (const std::exception &e)
     {
@@ -495,4 +644,70 @@ void VideoWidget::renderFrame()
             f->glClear(GL_COLOR_BUFFER_BIT);
         }
     }
+}
+
+void VideoWidget::paintOverlay()
+{
+    if (!m_statsVisible)
+    {
+        return;
+    }
+
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    QOpenGLFunctions *f = context ? context->functions() : nullptr;
+    if (!f)
+    {
+        return;
+    }
+
+    ++m_paintCount;
+
+    // mpv leaves its own target bound; the overlay goes on what the widget shows
+    f->glBindFramebuffer(GL_FRAMEBUFFER, m_glWidget->defaultFramebufferObject());
+
+    const qreal ratio = m_glWidget->devicePixelRatioF();
+    const QSize viewport(qRound(m_glWidget->width() * ratio), qRound(m_glWidget->height() * ratio));
+    const bool measuring = m_measureFrames > 0;
+    if (measuring)
+    {
+        f->glFinish();
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    m_overlay.paint(viewport, ratio);
+    if (measuring)
+    {
+        f->glFinish();
+    }
+    qint64 nsecs = timer.nsecsElapsed();
+
+    m_overlayNsecs += nsecs;
+    ++m_overlayCount;
+
+    if (!measuring)
+    {
+        return;
+    }
+
+    m_measurements.append(nsecs);
+    if (m_measurements.size() < m_measureFrames)
+    {
+        return;
+    }
+
+    m_measureFrames = 0;
+    qint64 total = 0;
+    for (qint64 measurement : std::as_const(m_measurements))
+    {
+        total += measurement;
+    }
+    double meanMs = total / 1e6 / m_measurements.size();
+    double maxMs = *std::max_element(m_measurements.cbegin(), m_measurements.cend()) / 1e6;
+    emit overlayMeasured(meanMs, maxMs);
+}
+
+void VideoWidget::releaseOverlay()
+{
+    m_overlay.cleanup();
 }
\ No newline at end of file
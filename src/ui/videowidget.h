@@ -5,7 +5,11 @@
 #include <QOpenGLWidget>
 #include <QOpenGLFramebufferObject>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QList>
+#include "statsoverlay.h"
 #include "../core/mpvcore.h"
+#include "../core/playbackstats.h"
 
 /**
  * @brief The VideoWidget class renders video content using MPV
@@ -39,6 +43,34 @@ public:
      */
     bool keepAspect() const;
 
+    /**
+     * @brief Set where the stats overlay gets its playback figures
+     * @param stats Playback stats sampler, enabled while the overlay is shown
+     */
+    void setPlaybackStats(PlaybackStats *stats);
+
+    /**
+     * @brief Show or hide the stats overlay
+     * @param visible True to draw the overlay on top of the video
+     */
+    void setStatsVisible(bool visible);
+
+    /**
+     * @brief Check if the stats overlay is shown
+     * @return True if shown
+     */
+    bool isStatsVisible() const;
+
+    /**
+     * @brief Time drawing the stats overlay, including the GPU work, over the next frames
+     *
+     * Each measured frame waits for the GPU before and after the overlay is
+     * drawn, so this is for benchmarking only.
+     *
+     * @param frames Number of frames to measure
+     */
+    void measureOverlay(int frames);
+
 protected:
     /**
      * @brief Handle resize events
@@ -81,17 +113,39 @@ signals:
      */
     void keyPressed(int key);
 
+    /**
+     * @brief Signal emitted when an overlay measurement has finished
+     * @param meanMs Mean cost per frame in milliseconds
+     * @param maxMs Highest cost of a frame in milliseconds
+     */
+    void overlayMeasured(double meanMs, double maxMs);
+
 private slots:
     /**
      * @brief Handle frame swapped signal from MPV
      */
     void onFrameSwapped();
 
+    /**
+     * @brief Release the renderer of the old mpv instance while its GL context is current
+     */
+    void onAboutToRestart();
+
+    /**
+     * @brief Create a renderer for the new mpv instance after a core restart
+     */
+    void onCoreRestarted();
+
     /**
      * @brief Update the video widget
      */
     void update();
 
+    /**
+     * @brief Format a new playback stats sample for the overlay
+     */
+    void onStatsUpdated();
+
 private:
     /**
      * @brief Initialize the OpenGL widget
@@ -103,6 +157,16 @@ private:
      */
     void renderFrame();
 
+    /**
+     * @brief Draw the stats overlay on top of the rendered frame
+     */
+    void paintOverlay();
+
+    /**
+     * @brief Release the overlay's GL resources while the context is current
+     */
+    void releaseOverlay();
+
     class GLWidget : public QOpenGLWidget
     {
     public:
@@ -125,6 +189,17 @@ private:
     GLWidget *m_glWidget;
     QTimer m_updateTimer;
     bool m_keepAspect;
+    PlaybackStats *m_stats;
+    StatsOverlay m_overlay;
+    bool m_statsVisible;
+    QElapsedTimer m_sampleTimer;
+    int m_paintCount;
+    int m_renderCount;
+    qint64 m_renderNsecs;
+    int m_overlayCount;
+    qint64 m_overlayNsecs;
+    int m_measureFrames;
+    QList<qint64> m_measurements;
 };
 
 #endif // VIDEOWIDGET_H
\ No newline at end of file